@@ -0,0 +1,85 @@
+#include "benchmark.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <regex>
+#include <utility>
+#include <vector>
+
+namespace benchmark {
+
+namespace {
+
+std::vector<std::pair<std::string, Function>> &Registry() {
+  static std::vector<std::pair<std::string, Function>> registry;
+  return registry;
+}
+
+const int64_t kMaxIterations = 1000000000;
+
+}  // namespace
+
+int RegisterBenchmark(const std::string &name, Function fn) {
+  Registry().emplace_back(name, std::move(fn));
+  return 0;
+}
+
+int RunSpecifiedBenchmarks(int argc, char **argv) {
+  std::string filter = ".";
+  double min_time = 0.5;
+  for (int i = 1; i < argc; ++i) {
+    if (strncmp(argv[i], "--benchmark_filter=", 19) == 0) {
+      filter = argv[i] + 19;
+    } else if (strncmp(argv[i], "--benchmark_min_time=", 21) == 0) {
+      min_time = atof(argv[i] + 21);
+    } else {
+      fprintf(stderr, "Unknown flag: %s\n", argv[i]);
+      return 1;
+    }
+  }
+  std::regex re(filter);
+  size_t name_width = 10;
+  for (const auto &entry : Registry()) {
+    name_width = std::max(name_width, entry.first.size());
+  }
+  printf("%-*s %15s %12s\n", (int)name_width, "Benchmark", "Time (us/iter)",
+         "Iterations");
+  printf("%s\n", std::string(name_width + 29, '-').c_str());
+  for (const auto &entry : Registry()) {
+    if (!std::regex_search(entry.first, re)) continue;
+    int64_t iterations = 1;
+    while (true) {
+      State state(iterations);
+      entry.second(state);
+      if (!state.error().empty()) {
+        printf("%-*s ERROR: %s\n", (int)name_width, entry.first.c_str(),
+               state.error().c_str());
+        break;
+      }
+      double elapsed = state.elapsed_seconds();
+      if (elapsed >= min_time || iterations >= kMaxIterations) {
+        printf("%-*s %15.1f %12lld", (int)name_width, entry.first.c_str(),
+               elapsed * 1e6 / iterations, (long long)iterations);
+        for (const auto &counter : state.counters) {
+          printf(" %s=%.6g", counter.first.c_str(), counter.second);
+        }
+        printf("\n");
+        fflush(stdout);
+        break;
+      }
+      // Estimate the number of iterations needed, with some margin, but grow
+      // at most 10x at a time.
+      double multiplier =
+          elapsed <= 0 ? 10 : std::min(10.0, 1.4 * min_time / elapsed);
+      iterations = std::min<int64_t>(
+          kMaxIterations,
+          std::max<int64_t>(iterations + 1, iterations * multiplier));
+    }
+  }
+  return 0;
+}
+
+}  // namespace benchmark
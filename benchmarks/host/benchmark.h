@@ -0,0 +1,139 @@
+#pragma once
+
+// Minimal, dependency-free benchmark harness, modeled after Google Benchmark:
+//
+//   void BM_Something(benchmark::State& state) {
+//     ...setup...
+//     for (auto _ : state) {
+//       ...code to measure...
+//     }
+//     state.counters["bytes"] = ...;
+//   }
+//   BENCHMARK(BM_Something);
+//
+// Each benchmark is run for increasing number of iterations, until it takes
+// at least --benchmark_min_time seconds. The results are reported as time per
+// iteration, along with the user-defined counters (reported as set).
+//
+// Supported flags:
+//   --benchmark_filter=<regex>   runs only the benchmarks with matching names.
+//   --benchmark_min_time=<sec>   minimum measured time per benchmark.
+
+#include <stdint.h>
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <string>
+
+namespace benchmark {
+
+class State {
+ public:
+  explicit State(int64_t max_iterations)
+      : max_iterations_(max_iterations),
+        remaining_(0),
+        elapsed_(0),
+        running_(false) {}
+
+  // Iteration support, for use with range-based for loop. The timer runs from
+  // the first call to begin() until the loop ends.
+  class Iterator {
+   public:
+    explicit Iterator(State *state) : state_(state) {}
+
+    int operator*() const { return 0; }
+
+    Iterator &operator++() {
+      --state_->remaining_;
+      return *this;
+    }
+
+    bool operator!=(const Iterator &) const {
+      if (state_->remaining_ > 0) return true;
+      state_->stopTimer();
+      return false;
+    }
+
+   private:
+    State *state_;
+  };
+
+  Iterator begin() {
+    remaining_ = max_iterations_;
+    startTimer();
+    return Iterator(this);
+  }
+
+  Iterator end() { return Iterator(nullptr); }
+
+  // Excludes the code between PauseTiming() and ResumeTiming() from the
+  // measurement.
+  void PauseTiming() { stopTimer(); }
+  void ResumeTiming() { startTimer(); }
+
+  int64_t iterations() const { return max_iterations_; }
+
+  // Skips the benchmark, reporting the specified message.
+  void SkipWithError(const std::string &message) {
+    error_ = message;
+    remaining_ = 0;
+  }
+
+  const std::string &error() const { return error_; }
+
+  double elapsed_seconds() const { return elapsed_.count(); }
+
+  // User-defined counters, reported as set by the benchmark.
+  std::map<std::string, double> counters;
+
+ private:
+  void startTimer() {
+    if (running_) return;
+    running_ = true;
+    start_ = std::chrono::steady_clock::now();
+  }
+
+  void stopTimer() {
+    if (!running_) return;
+    running_ = false;
+    elapsed_ += std::chrono::steady_clock::now() - start_;
+  }
+
+  int64_t max_iterations_;
+  int64_t remaining_;
+  std::chrono::steady_clock::time_point start_;
+  std::chrono::duration<double> elapsed_;
+  bool running_;
+  std::string error_;
+};
+
+typedef std::function<void(State &)> Function;
+
+// Registers the benchmark with the specified name. Returns a dummy value, so
+// that it can be used to initialize a static variable.
+int RegisterBenchmark(const std::string &name, Function fn);
+
+// Runs all the registered benchmarks that match the filter from the command
+// line, and prints the results to stdout. Returns the process exit code.
+int RunSpecifiedBenchmarks(int argc, char **argv);
+
+// Prevents the compiler from optimizing away the value.
+template <typename T>
+inline void DoNotOptimize(T const &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+}  // namespace benchmark
+
+#define BENCHMARK_CONCAT_IMPL(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT_IMPL(a, b)
+
+#define BENCHMARK(fn)                                             \
+  static int BENCHMARK_CONCAT(benchmark_registration_, __LINE__) = \
+      ::benchmark::RegisterBenchmark(#fn, fn)
+
+#define BENCHMARK_MAIN()                                  \
+  int main(int argc, char **argv) {                       \
+    return ::benchmark::RunSpecifiedBenchmarks(argc, argv); \
+  }
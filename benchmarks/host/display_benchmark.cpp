@@ -0,0 +1,538 @@
+// Host-side benchmark suite. Reproduces the tests from benchmarks/adafruit.ino
+// (based on the Adafruit GFX demo), plus smooth shapes, smooth fonts, image
+// decoding, and composition, without any hardware.
+//
+// Each scene is run against two devices:
+// * 'offscreen': OffscreenDevice<Rgb565>, i.e. a raw in-memory framebuffer,
+//   measuring the CPU cost of rasterization;
+// * 'ili9341_spi': the ILI9341 driver (AddrWindowDevice) over FakeSpiTransport,
+//   which discards the data, but accounts for the traffic, measuring the driver
+//   overhead and the traffic on the wire.
+//
+// For the 'ili9341_spi' variants, the following counters are reported (per
+// iteration): 'wire_bytes' (all bytes written to the transport), 'commands'
+// (command bytes, e.g. CASET, PASET, RAMWR), 'addr_windows' (CASET and PASET
+// commands), and 'wire_us' (the estimated wire time at 40 MHz).
+//
+// Example:
+//
+//   bazel run -c opt //lib/roo_display:host_benchmark -- \
+//       --benchmark_filter=Circles --benchmark_min_time=1
+
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "benchmark.h"
+#include "roo_display.h"
+#include "roo_display/color/gradient.h"
+#include "roo_display/composition/streamable_stack.h"
+#include "roo_display/core/offscreen.h"
+#include "roo_display/core/tiled_offscreen.h"
+#include "roo_display/driver/ili9341.h"
+#include "roo_display/font/font_adafruit_fixed_5x7.h"
+#include "roo_display/image/jpeg/jpeg.h"
+#include "roo_display/image/png/png.h"
+#include "roo_display/io/memory.h"
+#include "roo_display/shape/basic.h"
+#include "roo_display/shape/shadow.h"
+#include "roo_display/shape/smooth.h"
+#include "roo_display/transport/fake_spi.h"
+#include "roo_display/ui/text_label.h"
+#include "roo_smooth_fonts/NotoSans_Regular/27.h"
+
+using namespace roo_display;
+
+namespace {
+
+static const int16_t kWidth = 240;
+static const int16_t kHeight = 320;
+
+// Context passed to the scenes.
+class Bench {
+ public:
+  Bench(Display &display, benchmark::State &state, FakeSpiBus *wire)
+      : display_(display), state_(state), wire_(wire) {}
+
+  Display &display() { return display_; }
+
+  // Aborts the benchmark, reporting the specified error.
+  void skip(const std::string &message) { state_.SkipWithError(message); }
+
+  // Fills the screen with black. Excluded from the measurements (both the
+  // time, and the wire traffic).
+  void clear() {
+    state_.PauseTiming();
+    FakeSpiBus saved;
+    if (wire_ != nullptr) saved = *wire_;
+    {
+      DrawingContext dc(display_);
+      dc.fill(color::Black);
+    }
+    if (wire_ != nullptr) *wire_ = saved;
+    state_.ResumeTiming();
+  }
+
+ private:
+  Display &display_;
+  benchmark::State &state_;
+  FakeSpiBus *wire_;
+};
+
+typedef void (*Scene)(Bench &bench);
+
+void RunOnOffscreen(benchmark::State &state, Scene scene) {
+  std::unique_ptr<uint8_t[]> buffer(
+      new uint8_t[kWidth * kHeight * Rgb565::bits_per_pixel / 8]);
+  OffscreenDevice<Rgb565> device(kWidth, kHeight, buffer.get(), Rgb565());
+  Display display(device);
+  Bench bench(display, state, nullptr);
+  for (auto _ : state) {
+    scene(bench);
+  }
+}
+
+void RunOnSpi(benchmark::State &state, Scene scene) {
+  FakeSpiBus wire(SpiCostModel(ili9341::SpiFrequency), false);
+  Ili9341<FakeSpiTransport> device{FakeSpiTransport(wire)};
+  Display display(device);
+  Bench bench(display, state, &wire);
+  wire.reset();
+  for (auto _ : state) {
+    scene(bench);
+  }
+  double iterations = state.iterations();
+  state.counters["wire_bytes"] = wire.bytes() / iterations;
+  state.counters["commands"] = wire.totalCommands() / iterations;
+  state.counters["addr_windows"] =
+      (wire.commandCount(ili9341::CASET) + wire.commandCount(ili9341::PASET)) /
+      iterations;
+  state.counters["wire_us"] = wire.estimatedWireTimeNs() / iterations / 1000;
+}
+
+// Registers the scene to run on both devices.
+int RegisterScene(const char *name, Scene scene) {
+  benchmark::RegisterBenchmark(
+      std::string(name) + "/offscreen",
+      [scene](benchmark::State &state) { RunOnOffscreen(state, scene); });
+  benchmark::RegisterBenchmark(
+      std::string(name) + "/ili9341_spi",
+      [scene](benchmark::State &state) { RunOnSpi(state, scene); });
+  return 0;
+}
+
+#define BENCHMARK_SCENE(scene) \
+  static int scene##_registration = RegisterScene(#scene, scene)
+
+// Reads the entire file, trying the paths relative to the repository root,
+// and to the Bazel runfiles root. Returns an empty string on failure.
+std::string ReadTestData(const std::string &path) {
+  for (const char *prefix : {"", "lib/roo_display/"}) {
+    std::ifstream file(prefix + path, std::ios::binary);
+    if (!file) continue;
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+  }
+  return "";
+}
+
+// The Adafruit benchmark tests.
+
+void FillScreen(Bench &bench) {
+  DrawingContext dc(bench.display());
+  dc.fill(color::Black);
+  dc.fill(color::Red);
+  dc.fill(color::Lime);
+  dc.fill(color::Blue);
+  dc.fill(color::Black);
+}
+BENCHMARK_SCENE(FillScreen);
+
+void Text(Bench &bench) {
+  static FontAdafruitFixed5x7 font;
+  bench.clear();
+  int16_t y = 0;
+  auto println = [&](const char *s, int16_t scale, Color color) {
+    DrawingContext dc(bench.display());
+    dc.setTransformation(Transformation()
+                             .translate(0, font.metrics().glyphYMax())
+                             .scale(scale, scale)
+                             .translate(0, y));
+    dc.draw(StringViewLabel(s, font, color));
+    y += font.metrics().linespace() * scale;
+  };
+  println("Hello World!", 1, color::White);
+  println("1234.56", 2, color::Yellow);
+  println("DEADBEEF", 3, color::Red);
+  println("", 3, color::Red);
+  println("Groop", 5, color::Lime);
+  println("I implore thee,", 2, color::Lime);
+  println("my foonting turlingdromes.", 1, color::Lime);
+  println("And hooptiously drangle me", 1, color::Lime);
+  println("with crinkly bindlewurdles,", 1, color::Lime);
+  println("Or I will rend thee", 1, color::Lime);
+  println("in the gobberwarts", 1, color::Lime);
+  println("with my blurglecruncheon,", 1, color::Lime);
+  println("see if I don't!", 1, color::Lime);
+}
+BENCHMARK_SCENE(Text);
+
+void Lines(Bench &bench) {
+  int16_t w = bench.display().width();
+  int16_t h = bench.display().height();
+  const int16_t corners[4][2] = {
+      {0, 0}, {w - 1, 0}, {0, h - 1}, {w - 1, h - 1}};
+  for (const auto &corner : corners) {
+    bench.clear();
+    int16_t x1 = corner[0];
+    int16_t y1 = corner[1];
+    DrawingContext dc(bench.display());
+    for (int16_t x2 = 0; x2 < w; x2 += 6) {
+      dc.draw(Line(x1, y1, x2, h - 1 - y1, color::Cyan));
+    }
+    for (int16_t y2 = 0; y2 < h; y2 += 6) {
+      dc.draw(Line(x1, y1, w - 1 - x1, y2, color::Cyan));
+    }
+  }
+}
+BENCHMARK_SCENE(Lines);
+
+void FastLines(Bench &bench) {
+  int16_t w = bench.display().width();
+  int16_t h = bench.display().height();
+  bench.clear();
+  DrawingContext dc(bench.display());
+  for (int16_t y = 0; y < h; y += 5) dc.draw(Line(0, y, w - 1, y, color::Red));
+  for (int16_t x = 0; x < w; x += 5) dc.draw(Line(x, 0, x, h - 1, color::Blue));
+}
+BENCHMARK_SCENE(FastLines);
+
+void Rects(Bench &bench) {
+  int16_t cx = bench.display().width() / 2;
+  int16_t cy = bench.display().height() / 2;
+  int16_t n = std::min(bench.display().width(), bench.display().height());
+  bench.clear();
+  DrawingContext dc(bench.display());
+  for (int16_t i = 2; i < n; i += 6) {
+    int16_t i2 = i / 2;
+    dc.draw(Rect(cx - i2, cy - i2, cx - i2 + i - 1, cy - i2 + i - 1,
+                 color::Lime));
+  }
+}
+BENCHMARK_SCENE(Rects);
+
+void FilledRects(Bench &bench) {
+  int16_t cx = bench.display().width() / 2 - 1;
+  int16_t cy = bench.display().height() / 2 - 1;
+  int16_t n = std::min(bench.display().width(), bench.display().height());
+  bench.clear();
+  DrawingContext dc(bench.display());
+  for (int16_t i = n; i > 0; i -= 6) {
+    int16_t i2 = i / 2;
+    dc.draw(FilledRect(cx - i2, cy - i2, cx - i2 + i - 1, cy - i2 + i - 1,
+                       color::Yellow));
+    dc.draw(Rect(cx - i2, cy - i2, cx - i2 + i - 1, cy - i2 + i - 1,
+                 color::Magenta));
+  }
+}
+BENCHMARK_SCENE(FilledRects);
+
+void FilledCircles(Bench &bench) {
+  const int16_t radius = 10;
+  int16_t w = bench.display().width();
+  int16_t h = bench.display().height();
+  bench.clear();
+  DrawingContext dc(bench.display());
+  for (int16_t x = radius; x < w; x += 2 * radius) {
+    for (int16_t y = radius; y < h; y += 2 * radius) {
+      dc.draw(FilledCircle::ByRadius(x, y, radius, color::Magenta));
+    }
+  }
+}
+BENCHMARK_SCENE(FilledCircles);
+
+void Circles(Bench &bench) {
+  const int16_t radius = 10;
+  int16_t w = bench.display().width() + radius;
+  int16_t h = bench.display().height() + radius;
+  DrawingContext dc(bench.display());
+  for (int16_t x = 0; x < w; x += 2 * radius) {
+    for (int16_t y = 0; y < h; y += 2 * radius) {
+      dc.draw(Circle::ByRadius(x, y, radius, color::White));
+    }
+  }
+}
+BENCHMARK_SCENE(Circles);
+
+void Triangles(Bench &bench) {
+  int16_t cx = bench.display().width() / 2 - 1;
+  int16_t cy = bench.display().height() / 2 - 1;
+  int16_t n = std::min(cx, cy);
+  bench.clear();
+  DrawingContext dc(bench.display());
+  for (int16_t i = 0; i < n; i += 5) {
+    dc.draw(Triangle(cx, cy - i, cx - i, cy + i, cx + i, cy + i,
+                     Color(i, i, i)));
+  }
+}
+BENCHMARK_SCENE(Triangles);
+
+void FilledTriangles(Bench &bench) {
+  int16_t cx = bench.display().width() / 2 - 1;
+  int16_t cy = bench.display().height() / 2 - 1;
+  bench.clear();
+  DrawingContext dc(bench.display());
+  for (int16_t i = std::min(cx, cy); i > 10; i -= 5) {
+    dc.draw(FilledTriangle(cx, cy - i, cx - i, cy + i, cx + i, cy + i,
+                           Color(0, i * 10, i * 10)));
+    dc.draw(Triangle(cx, cy - i, cx - i, cy + i, cx + i, cy + i,
+                     Color(i * 10, i * 10, 0)));
+  }
+}
+BENCHMARK_SCENE(FilledTriangles);
+
+void RoundRects(Bench &bench) {
+  int16_t cx = bench.display().width() / 2 - 1;
+  int16_t cy = bench.display().height() / 2 - 1;
+  int16_t w = std::min(bench.display().width(), bench.display().height());
+  bench.clear();
+  DrawingContext dc(bench.display());
+  for (int16_t i = 0; i < w; i += 6) {
+    int16_t i2 = i / 2;
+    dc.draw(RoundRect(cx - i2, cy - i2, cx - i2 + i - 1, cy - i2 + i - 1, i / 8,
+                      Color(i, 0, 0)));
+  }
+}
+BENCHMARK_SCENE(RoundRects);
+
+void FilledRoundRects(Bench &bench) {
+  int16_t cx = bench.display().width() / 2 - 1;
+  int16_t cy = bench.display().height() / 2 - 1;
+  bench.clear();
+  DrawingContext dc(bench.display());
+  for (int16_t i = std::min(bench.display().width(), bench.display().height());
+       i > 20; i -= 6) {
+    int16_t i2 = i / 2;
+    dc.draw(FilledRoundRect(cx - i2, cy - i2, cx - i2 + i - 1, cy - i2 + i - 1,
+                            i / 8, Color(0, i, 0)));
+  }
+}
+BENCHMARK_SCENE(FilledRoundRects);
+
+// Additional tests.
+
+void SmoothShapes(Bench &bench) {
+  bench.clear();
+  DrawingContext dc(bench.display());
+  for (int i = 0; i < 10; ++i) {
+    dc.draw(SmoothFilledCircle({20.5f + i * 20, 40.3f}, 15.2f,
+                               Color(0xC0FF4020)));
+    dc.draw(SmoothThickCircle({20.5f + i * 20, 100.7f}, 15.2f, 3.5f,
+                              Color(0xFF2080F0)));
+    dc.draw(SmoothThickLine({5.0f + i * 20, 140.0f}, {25.0f + i * 15, 300.0f},
+                            2.5f, color::Yellow));
+    dc.draw(SmoothFilledRoundRect(10.0f + i * 20, 180.0f, 28.0f + i * 20,
+                                  240.0f, 6.0f, Color(0x8040FF40)));
+  }
+}
+BENCHMARK_SCENE(SmoothShapes);
+
+// Rasterizables drawn via the default (tile-based) Rasterizable::drawTo: a
+// banded background gradient, and drop shadows of a few 'cards'.
+void Shadows(Bench &bench) {
+  LinearGradient background(
+      {0, 0}, 0.0f, 1.0f,
+      ColorGradient({{0, color::LightSteelBlue},
+                     {80, color::LightSteelBlue},
+                     {80, color::SteelBlue},
+                     {160, color::SteelBlue},
+                     {240, color::LightSlateGray}}),
+      Box(0, 0, kWidth - 1, kHeight - 1));
+  DrawingContext dc(bench.display());
+  dc.draw(background);
+  for (int i = 0; i < 3; ++i) {
+    Box card(20 + i * 70, 30 + i * 90, 139 + i * 70, 99 + i * 90);
+    dc.draw(RoundRectShadow(card, Color(0x80000000), 10, 2, 3, 8));
+    dc.draw(FilledRoundRect(card.xMin(), card.yMin(), card.xMax(),
+                            card.yMax(), 8, color::White));
+  }
+}
+BENCHMARK_SCENE(Shadows);
+
+// Full-screen skewed gradient, and radial gradients, evaluated via baked lookup
+// tables.
+void Gradients(Bench &bench) {
+  LinearGradient linear(
+      {0, 0}, 0.37f, 0.21f,
+      ColorGradient({{0, color::Navy},
+                     {60, color::Purple},
+                     {120, color::Orange},
+                     {180, color::Navy}},
+                    ColorGradient::PERIODIC)
+          .bake(),
+      Box(0, 0, kWidth - 1, kHeight - 1));
+  RadialGradientSq radial(
+      {kWidth / 2, kHeight / 2},
+      ColorGradient({{0, Color(0xC0FFFFFF)}, {100 * 100, color::Transparent}},
+                    ColorGradient::TRUNCATED)
+          .bake(),
+      Box(kWidth / 2 - 100, kHeight / 2 - 100, kWidth / 2 + 100,
+          kHeight / 2 + 100));
+  RadialGradient ring(
+      {kWidth / 2 + 0.5f, kHeight / 2 - 0.5f},
+      ColorGradient({{60, color::Transparent},
+                     {61, color::Gold},
+                     {90, color::Crimson},
+                     {91, color::Transparent}},
+                    ColorGradient::TRUNCATED)
+          .bake(),
+      Box(kWidth / 2 - 92, kHeight / 2 - 92, kWidth / 2 + 92,
+          kHeight / 2 + 92));
+  DrawingContext dc(bench.display());
+  dc.draw(linear);
+  dc.draw(radial);
+  dc.draw(ring);
+}
+BENCHMARK_SCENE(Gradients);
+
+void SmoothFontText(Bench &bench) {
+  const Font &font = font_NotoSans_Regular_27();
+  bench.clear();
+  DrawingContext dc(bench.display());
+  const char *lines[] = {"I implore thee,", "my foonting", "turlingdromes.",
+                         "And hooptiously", "drangle me with",
+                         "crinkly bindle-", "wurdles."};
+  int16_t y = font.metrics().glyphYMax();
+  for (const char *line : lines) {
+    dc.draw(StringViewLabel(line, font, color::White), 0, y);
+    y += font.metrics().linespace();
+  }
+}
+BENCHMARK_SCENE(SmoothFontText);
+
+void JpegDecode(Bench &bench) {
+  static std::string data =
+      ReadTestData("benchmarks/host/testdata/gradient.jpg");
+  if (data.empty()) {
+    bench.skip("gradient.jpg not found");
+    return;
+  }
+  static JpegDecoder decoder;
+  const uint8_t *begin = (const uint8_t *)data.data();
+  JpegImage<ConstDramResource> image(decoder, begin, begin + data.size());
+  DrawingContext dc(bench.display());
+  dc.draw(image);
+}
+BENCHMARK_SCENE(JpegDecode);
+
+void PngDecode(Bench &bench) {
+  static std::string data = ReadTestData("doc/images/img59.png");
+  if (data.empty()) {
+    bench.skip("img59.png not found");
+    return;
+  }
+  static PngDecoder decoder;
+  const uint8_t *begin = (const uint8_t *)data.data();
+  PngImage<ConstDramResource> image(decoder, begin, begin + data.size());
+  bench.clear();
+  DrawingContext dc(bench.display());
+  dc.draw(image);
+}
+BENCHMARK_SCENE(PngDecode);
+
+// Full-screen blit of an image stored in the native format of both devices.
+void RasterBlit(Bench &bench) {
+  static Offscreen<Rgb565> *image = []() {
+    auto *offscreen = new Offscreen<Rgb565>(kWidth, kHeight, color::Black);
+    DrawingContext dc(*offscreen);
+    for (int16_t y = 0; y < kHeight; y += 8) {
+      dc.draw(FilledRect(0, y, kWidth - 1, y + 3, Color(0xFF000000 | y * 807)));
+    }
+    return offscreen;
+  }();
+  DrawingContext dc(bench.display());
+  dc.draw(image->raster());
+}
+BENCHMARK_SCENE(RasterBlit);
+
+void StreamableStackComposition(Bench &bench) {
+  static Offscreen<Rgb565> *background = []() {
+    auto *offscreen = new Offscreen<Rgb565>(kWidth, kHeight, color::Navy);
+    DrawingContext dc(*offscreen);
+    for (int16_t y = 0; y < kHeight; y += 20) {
+      dc.draw(FilledRect(0, y, kWidth - 1, y + 9, color::DarkSlateGray));
+    }
+    return offscreen;
+  }();
+  static Offscreen<Argb4444> *overlay = []() {
+    auto *offscreen = new Offscreen<Argb4444>(160, 120, color::Transparent);
+    DrawingContext dc(*offscreen);
+    dc.draw(FilledCircle::ByRadius(80, 60, 55, Color(0x80FFA000)));
+    return offscreen;
+  }();
+  StreamableStack stack(Box(0, 0, kWidth - 1, kHeight - 1));
+  stack.addInput(background);
+  stack.addInput(overlay, 10, 20);
+  stack.addInput(overlay, 70, 150);
+  DrawingContext dc(bench.display());
+  dc.draw(stack);
+}
+BENCHMARK_SCENE(StreamableStackComposition);
+
+// Selected scenes, run on XY-swapped in-memory framebuffers, in the linear
+// (OffscreenDevice) and the tiled (TiledOffscreenDevice) layout. In the linear
+// layout, horizontal writes turn into column walks.
+
+void RunRotated(benchmark::State &state, Scene scene, DisplayDevice &device) {
+  Display display(device);
+  display.setOrientation(Orientation::RightDown().swapXY());
+  Bench bench(display, state, nullptr);
+  for (auto _ : state) {
+    scene(bench);
+  }
+}
+
+void RunOnRotatedLinear(benchmark::State &state, Scene scene) {
+  std::unique_ptr<uint8_t[]> buffer(
+      new uint8_t[kWidth * kHeight * Rgb565::bits_per_pixel / 8]);
+  OffscreenDevice<Rgb565> device(kWidth, kHeight, buffer.get(), Rgb565());
+  RunRotated(state, scene, device);
+}
+
+void RunOnRotatedTiled(benchmark::State &state, Scene scene) {
+  typedef TiledOffscreenDevice<Rgb565, 8, 8> Device;
+  std::unique_ptr<uint8_t[]> buffer(
+      new uint8_t[Device::BufferSize(kWidth, kHeight)]);
+  Device device(kWidth, kHeight, buffer.get(), Rgb565());
+  RunRotated(state, scene, device);
+}
+
+int RegisterRotatedScenes() {
+  const struct {
+    const char *name;
+    Scene scene;
+  } scenes[] = {{"FillScreen", FillScreen},
+                {"Text", Text},
+                {"Lines", Lines},
+                {"SmoothShapes", SmoothShapes},
+                {"SmoothFontText", SmoothFontText},
+                {"RasterBlit", RasterBlit}};
+  for (const auto &s : scenes) {
+    Scene scene = s.scene;
+    benchmark::RegisterBenchmark(
+        std::string(s.name) + "/rotated_linear",
+        [scene](benchmark::State &state) { RunOnRotatedLinear(state, scene); });
+    benchmark::RegisterBenchmark(
+        std::string(s.name) + "/rotated_tiled",
+        [scene](benchmark::State &state) { RunOnRotatedTiled(state, scene); });
+  }
+  return 0;
+}
+
+static int rotated_registration = RegisterRotatedScenes();
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -68,7 +68,8 @@ Display::Display(DisplayDevice& display_device, TouchDevice* touch_device,
       orientation_(display_device.orientation()),
       extents_(Box::MaximumBox()),
       bgcolor_(Color(0)),
-      background_(nullptr) {
+      background_(nullptr),
+      damage_tracker_(nullptr) {
   resetExtents();
 }
 
@@ -191,18 +192,21 @@ void DrawingContext::drawInternalTransformed(Surface& s,
                                              const Drawable& object) {
   if (!transformed_) {
     if (s.clipToExtents(object.extents()) == Box::CLIP_RESULT_EMPTY) return;
+    reportDamage(s.clip_box());
     s.drawObject(object);
   } else if (!transformation_.is_rescaled() && !transformation_.xy_swap()) {
     // Translation only.
     s.set_dx(s.dx() + transformation_.x_offset());
     s.set_dy(s.dy() + transformation_.y_offset());
     if (s.clipToExtents(object.extents()) == Box::CLIP_RESULT_EMPTY) return;
+    reportDamage(s.clip_box());
     s.drawObject(object);
   } else {
     auto transformed = TransformedDrawable(transformation_, &object);
     if (s.clipToExtents(transformed.extents()) == Box::CLIP_RESULT_EMPTY) {
       return;
     }
+    reportDamage(s.clip_box());
     s.drawObject(transformed);
   }
 }
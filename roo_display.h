@@ -2,6 +2,7 @@
 
 #include <functional>
 
+#include "roo_display/core/damage.h"
 #include "roo_display/core/device.h"
 #include "roo_display/core/drawable.h"
 #include "roo_display/core/streamable.h"
@@ -135,6 +136,15 @@ class Display {
 
   Color getBackgroundColor() const { return bgcolor_; }
 
+  // Sets the damage tracker, to which all derived contexts report the
+  // (clipped) extents of the drawn objects. Pass nullptr to disable tracking
+  // (the default). The tracker is not owned and must outlive the contexts.
+  void setDamageTracker(DamageTracker *damage_tracker) {
+    damage_tracker_ = damage_tracker;
+  }
+
+  DamageTracker *damage_tracker() const { return damage_tracker_; }
+
   // Clears the display, respecting the clip box, and background settings.
   void clear();
 
@@ -168,6 +178,7 @@ class Display {
   Box extents_;
   Color bgcolor_;
   const Rasterizable *background_;
+  DamageTracker *damage_tracker_;
 };
 
 // Primary top-level interface for drawing to screens, off-screen buffers,
@@ -222,6 +233,7 @@ class DrawingContext {
         clip_mask_(nullptr),
         background_(display.getRasterizableBackground()),
         bgcolor_(display.getBackgroundColor()),
+        damage_tracker_(display.damage_tracker()),
         transformed_(false),
         transformation_() {
     display.nest();
@@ -328,6 +340,10 @@ class DrawingContext {
 
   void drawInternalTransformed(Surface &s, const Drawable &object);
 
+  void reportDamage(const Box &box) {
+    if (damage_tracker_ != nullptr) damage_tracker_->add(box);
+  }
+
   DisplayOutput &output_;
 
   // Offset of the origin in the output coordinates. Empty Transformation maps
@@ -358,6 +374,10 @@ class DrawingContext {
   const ClipMask *clip_mask_;
   const Rasterizable *background_;
   Color bgcolor_;
+
+  // If not null, receives the clipped extents of all drawn objects.
+  DamageTracker *damage_tracker_;
+
   bool transformed_;
   Transformation transformation_;
 };
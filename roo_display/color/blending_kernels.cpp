@@ -0,0 +1,468 @@
+#include "roo_display/color/blending_kernels.h"
+
+#include <string.h>
+
+#include "roo_display/color/blending.h"
+#include "roo_display/color/color_modes.h"
+#include "roo_display/internal/byte_order.h"
+
+#if ROO_DISPLAY_BLENDING_SIMD >= 2
+#include <immintrin.h>
+#elif ROO_DISPLAY_BLENDING_SIMD >= 1
+#include <emmintrin.h>
+#endif
+
+namespace roo_display {
+namespace internal {
+
+static_assert(sizeof(Color) == 4, "Kernels rely on Color being a raw uint32_t");
+
+namespace {
+
+// Scalar reference implementations; also handle the tails left over by the
+// vectorized loops.
+
+inline uint16_t Swap(uint16_t v, bool swap) {
+  return swap ? byte_order::Swapper<uint16_t>()(v) : v;
+}
+
+inline uint32_t Swap(uint32_t v, bool swap) {
+  return swap ? byte_order::Swapper<uint32_t>()(v) : v;
+}
+
+inline uint16_t Rgb565BlendOpaque(uint16_t dst, Color src) {
+  Rgb565 mode;
+  return mode.fromArgbColor(AlphaBlendOverOpaque(mode.toArgbColor(dst), src));
+}
+
+// Calls fn(buf, n) for chunks of a buffer filled with the specified color. Used
+// to implement fills in terms of the writes.
+template <typename Fn>
+inline void ForEachFillChunk(Color color, uint32_t count, Fn fn) {
+  Color buf[64];
+  uint32_t n = count < 64 ? count : 64;
+  for (uint32_t i = 0; i < n; ++i) buf[i] = color;
+  while (count > 0) {
+    n = count < 64 ? count : 64;
+    fn(buf, n);
+    count -= n;
+  }
+}
+
+#if ROO_DISPLAY_BLENDING_SIMD >= 1
+
+// SSE2 helpers. Channels are processed as 16-bit lanes.
+
+inline __m128i Swap16(__m128i v) {
+  return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+inline __m128i Swap32(__m128i v) {
+  v = Swap16(v);
+  return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xB1), 0xB1);
+}
+
+// Splits 8 colors into a, r, g, b channels, as 16-bit lanes.
+inline void LoadColors8(const Color *src, __m128i &a, __m128i &r, __m128i &g,
+                        __m128i &b) {
+  __m128i lo = _mm_loadu_si128((const __m128i *)src);
+  __m128i hi = _mm_loadu_si128((const __m128i *)(src + 4));
+  __m128i mask = _mm_set1_epi32(0xFF);
+  b = _mm_packs_epi32(_mm_and_si128(lo, mask), _mm_and_si128(hi, mask));
+  g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(lo, 8), mask),
+                      _mm_and_si128(_mm_srli_epi32(hi, 8), mask));
+  r = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(lo, 16), mask),
+                      _mm_and_si128(_mm_srli_epi32(hi, 16), mask));
+  a = _mm_packs_epi32(_mm_srli_epi32(lo, 24), _mm_srli_epi32(hi, 24));
+}
+
+// Computes __div_255_rounded(s * a + d * (255 - a)).
+inline __m128i BlendChannel(__m128i s, __m128i d, __m128i a, __m128i inv_a) {
+  __m128i x = _mm_add_epi16(_mm_mullo_epi16(s, a), _mm_mullo_epi16(d, inv_a));
+  x = _mm_add_epi16(x, _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+// Same as Rgb565::fromArgbColor().
+inline __m128i PackRgb565(__m128i r, __m128i g, __m128i b) {
+  r = _mm_srli_epi16(_mm_sub_epi16(r, _mm_srli_epi16(r, 6)), 3);
+  g = _mm_srli_epi16(_mm_sub_epi16(g, _mm_srli_epi16(g, 7)), 2);
+  b = _mm_srli_epi16(_mm_sub_epi16(b, _mm_srli_epi16(b, 6)), 3);
+  return _mm_or_si128(_mm_or_si128(_mm_slli_epi16(r, 11), _mm_slli_epi16(g, 5)),
+                      b);
+}
+
+// Same as Rgb565::toArgbColor().
+inline void UnpackRgb565(__m128i v, __m128i &r, __m128i &g, __m128i &b) {
+  r = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(v, 8), _mm_set1_epi16(0xF8)),
+                   _mm_srli_epi16(v, 13));
+  g = _mm_or_si128(
+      _mm_and_si128(_mm_srli_epi16(v, 3), _mm_set1_epi16(0xFC)),
+      _mm_and_si128(_mm_srli_epi16(v, 9), _mm_set1_epi16(0x03)));
+  b = _mm_or_si128(_mm_and_si128(_mm_slli_epi16(v, 3), _mm_set1_epi16(0xF8)),
+                   _mm_and_si128(_mm_srli_epi16(v, 2), _mm_set1_epi16(0x07)));
+}
+
+// Blends 4 ARGB colors over 4 ARGB colors, assuming the destination is
+// opaque. Same as BlendOp<BLENDING_MODE_SOURCE_OVER_OPAQUE>.
+inline __m128i BlendArgbOpaque4(__m128i d, __m128i s) {
+  __m128i zero = _mm_setzero_si128();
+  __m128i s_lo = _mm_unpacklo_epi8(s, zero);
+  __m128i s_hi = _mm_unpackhi_epi8(s, zero);
+  __m128i d_lo = _mm_unpacklo_epi8(d, zero);
+  __m128i d_hi = _mm_unpackhi_epi8(d, zero);
+  __m128i a_lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_lo, 0xFF), 0xFF);
+  __m128i a_hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_hi, 0xFF), 0xFF);
+  __m128i ff = _mm_set1_epi16(0xFF);
+  __m128i lo = BlendChannel(s_lo, d_lo, a_lo, _mm_xor_si128(a_lo, ff));
+  __m128i hi = BlendChannel(s_hi, d_hi, a_hi, _mm_xor_si128(a_hi, ff));
+  return _mm_or_si128(_mm_packus_epi16(lo, hi),
+                      _mm_set1_epi32((int32_t)0xFF000000));
+}
+
+#endif  // ROO_DISPLAY_BLENDING_SIMD >= 1
+
+#if ROO_DISPLAY_BLENDING_SIMD >= 2
+
+// AVX2 counterparts of the SSE2 helpers.
+
+inline __m256i Swap16(__m256i v) {
+  return _mm256_or_si256(_mm256_slli_epi16(v, 8), _mm256_srli_epi16(v, 8));
+}
+
+inline __m256i Swap32(__m256i v) {
+  v = Swap16(v);
+  return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(v, 0xB1), 0xB1);
+}
+
+// Splits 16 colors into a, r, g, b channels, as 16-bit lanes.
+inline void LoadColors16(const Color *src, __m256i &a, __m256i &r, __m256i &g,
+                         __m256i &b) {
+  __m256i lo = _mm256_loadu_si256((const __m256i *)src);
+  __m256i hi = _mm256_loadu_si256((const __m256i *)(src + 8));
+  __m256i mask = _mm256_set1_epi32(0xFF);
+  // packs works within 128-bit lanes; permute restores the order.
+  b = _mm256_permute4x64_epi64(
+      _mm256_packs_epi32(_mm256_and_si256(lo, mask),
+                         _mm256_and_si256(hi, mask)),
+      0xD8);
+  g = _mm256_permute4x64_epi64(
+      _mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(lo, 8), mask),
+                         _mm256_and_si256(_mm256_srli_epi32(hi, 8), mask)),
+      0xD8);
+  r = _mm256_permute4x64_epi64(
+      _mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(lo, 16), mask),
+                         _mm256_and_si256(_mm256_srli_epi32(hi, 16), mask)),
+      0xD8);
+  a = _mm256_permute4x64_epi64(
+      _mm256_packs_epi32(_mm256_srli_epi32(lo, 24), _mm256_srli_epi32(hi, 24)),
+      0xD8);
+}
+
+inline __m256i BlendChannel(__m256i s, __m256i d, __m256i a, __m256i inv_a) {
+  __m256i x =
+      _mm256_add_epi16(_mm256_mullo_epi16(s, a), _mm256_mullo_epi16(d, inv_a));
+  x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+  return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+inline __m256i PackRgb565(__m256i r, __m256i g, __m256i b) {
+  r = _mm256_srli_epi16(_mm256_sub_epi16(r, _mm256_srli_epi16(r, 6)), 3);
+  g = _mm256_srli_epi16(_mm256_sub_epi16(g, _mm256_srli_epi16(g, 7)), 2);
+  b = _mm256_srli_epi16(_mm256_sub_epi16(b, _mm256_srli_epi16(b, 6)), 3);
+  return _mm256_or_si256(
+      _mm256_or_si256(_mm256_slli_epi16(r, 11), _mm256_slli_epi16(g, 5)), b);
+}
+
+inline void UnpackRgb565(__m256i v, __m256i &r, __m256i &g, __m256i &b) {
+  r = _mm256_or_si256(
+      _mm256_and_si256(_mm256_srli_epi16(v, 8), _mm256_set1_epi16(0xF8)),
+      _mm256_srli_epi16(v, 13));
+  g = _mm256_or_si256(
+      _mm256_and_si256(_mm256_srli_epi16(v, 3), _mm256_set1_epi16(0xFC)),
+      _mm256_and_si256(_mm256_srli_epi16(v, 9), _mm256_set1_epi16(0x03)));
+  b = _mm256_or_si256(
+      _mm256_and_si256(_mm256_slli_epi16(v, 3), _mm256_set1_epi16(0xF8)),
+      _mm256_and_si256(_mm256_srli_epi16(v, 2), _mm256_set1_epi16(0x07)));
+}
+
+inline __m256i BlendArgbOpaque8(__m256i d, __m256i s) {
+  __m256i zero = _mm256_setzero_si256();
+  __m256i s_lo = _mm256_unpacklo_epi8(s, zero);
+  __m256i s_hi = _mm256_unpackhi_epi8(s, zero);
+  __m256i d_lo = _mm256_unpacklo_epi8(d, zero);
+  __m256i d_hi = _mm256_unpackhi_epi8(d, zero);
+  __m256i a_lo =
+      _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s_lo, 0xFF), 0xFF);
+  __m256i a_hi =
+      _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s_hi, 0xFF), 0xFF);
+  __m256i ff = _mm256_set1_epi16(0xFF);
+  __m256i lo = BlendChannel(s_lo, d_lo, a_lo, _mm256_xor_si256(a_lo, ff));
+  __m256i hi = BlendChannel(s_hi, d_hi, a_hi, _mm256_xor_si256(a_hi, ff));
+  // unpack and packus both work within 128-bit lanes, so the order is
+  // preserved.
+  return _mm256_or_si256(_mm256_packus_epi16(lo, hi),
+                         _mm256_set1_epi32((int32_t)0xFF000000));
+}
+
+#endif  // ROO_DISPLAY_BLENDING_SIMD >= 2
+
+}  // namespace
+
+const char *BlendingKernelIsa() {
+#if ROO_DISPLAY_BLENDING_SIMD >= 2
+  return "avx2";
+#elif ROO_DISPLAY_BLENDING_SIMD >= 1
+  return "sse2";
+#else
+  return "portable";
+#endif
+}
+
+void Rgb565WriteSource(uint16_t *dst, const Color *src, uint32_t count,
+                       bool swap) {
+#if ROO_DISPLAY_BLENDING_SIMD >= 2
+  while (count >= 16) {
+    __m256i a, r, g, b;
+    LoadColors16(src, a, r, g, b);
+    __m256i result = PackRgb565(r, g, b);
+    if (swap) result = Swap16(result);
+    _mm256_storeu_si256((__m256i *)dst, result);
+    src += 16;
+    dst += 16;
+    count -= 16;
+  }
+#endif
+#if ROO_DISPLAY_BLENDING_SIMD >= 1
+  while (count >= 8) {
+    __m128i a, r, g, b;
+    LoadColors8(src, a, r, g, b);
+    __m128i result = PackRgb565(r, g, b);
+    if (swap) result = Swap16(result);
+    _mm_storeu_si128((__m128i *)dst, result);
+    src += 8;
+    dst += 8;
+    count -= 8;
+  }
+#endif
+  Rgb565 mode;
+  while (count-- > 0) {
+    *dst++ = Swap(mode.fromArgbColor(*src++), swap);
+  }
+}
+
+void Rgb565WriteSourceOverOpaque(uint16_t *dst, const Color *src,
+                                 uint32_t count, bool swap) {
+#if ROO_DISPLAY_BLENDING_SIMD >= 2
+  while (count >= 16) {
+    __m256i sa, sr, sg, sb;
+    LoadColors16(src, sa, sr, sg, sb);
+    __m256i d = _mm256_loadu_si256((const __m256i *)dst);
+    if (swap) d = Swap16(d);
+    __m256i dr, dg, db;
+    UnpackRgb565(d, dr, dg, db);
+    __m256i inv_a = _mm256_xor_si256(sa, _mm256_set1_epi16(0xFF));
+    __m256i result = PackRgb565(BlendChannel(sr, dr, sa, inv_a),
+                                BlendChannel(sg, dg, sa, inv_a),
+                                BlendChannel(sb, db, sa, inv_a));
+    if (swap) result = Swap16(result);
+    _mm256_storeu_si256((__m256i *)dst, result);
+    src += 16;
+    dst += 16;
+    count -= 16;
+  }
+#endif
+#if ROO_DISPLAY_BLENDING_SIMD >= 1
+  while (count >= 8) {
+    __m128i sa, sr, sg, sb;
+    LoadColors8(src, sa, sr, sg, sb);
+    __m128i d = _mm_loadu_si128((const __m128i *)dst);
+    if (swap) d = Swap16(d);
+    __m128i dr, dg, db;
+    UnpackRgb565(d, dr, dg, db);
+    __m128i inv_a = _mm_xor_si128(sa, _mm_set1_epi16(0xFF));
+    __m128i result = PackRgb565(BlendChannel(sr, dr, sa, inv_a),
+                                BlendChannel(sg, dg, sa, inv_a),
+                                BlendChannel(sb, db, sa, inv_a));
+    if (swap) result = Swap16(result);
+    _mm_storeu_si128((__m128i *)dst, result);
+    src += 8;
+    dst += 8;
+    count -= 8;
+  }
+#endif
+  while (count-- > 0) {
+    *dst = Swap(Rgb565BlendOpaque(Swap(*dst, swap), *src++), swap);
+    ++dst;
+  }
+}
+
+void Rgb565FillSourceOverOpaque(uint16_t *dst, Color src, uint32_t count,
+                                bool swap) {
+  ForEachFillChunk(src, count, [&dst, swap](const Color *buf, uint32_t n) {
+    Rgb565WriteSourceOverOpaque(dst, buf, n, swap);
+    dst += n;
+  });
+}
+
+void Argb8888WriteSource(uint32_t *dst, const Color *src, uint32_t count,
+                         bool swap) {
+  if (!swap) {
+    memcpy(dst, src, count * sizeof(uint32_t));
+    return;
+  }
+#if ROO_DISPLAY_BLENDING_SIMD >= 2
+  while (count >= 8) {
+    _mm256_storeu_si256(
+        (__m256i *)dst,
+        Swap32(_mm256_loadu_si256((const __m256i *)src)));
+    src += 8;
+    dst += 8;
+    count -= 8;
+  }
+#endif
+#if ROO_DISPLAY_BLENDING_SIMD >= 1
+  while (count >= 4) {
+    _mm_storeu_si128((__m128i *)dst,
+                     Swap32(_mm_loadu_si128((const __m128i *)src)));
+    src += 4;
+    dst += 4;
+    count -= 4;
+  }
+#endif
+  while (count-- > 0) {
+    *dst++ = Swap((*src++).asArgb(), true);
+  }
+}
+
+void Argb8888WriteSourceOverOpaque(uint32_t *dst, const Color *src,
+                                   uint32_t count, bool swap) {
+#if ROO_DISPLAY_BLENDING_SIMD >= 2
+  while (count >= 8) {
+    __m256i d = _mm256_loadu_si256((const __m256i *)dst);
+    if (swap) d = Swap32(d);
+    __m256i result =
+        BlendArgbOpaque8(d, _mm256_loadu_si256((const __m256i *)src));
+    if (swap) result = Swap32(result);
+    _mm256_storeu_si256((__m256i *)dst, result);
+    src += 8;
+    dst += 8;
+    count -= 8;
+  }
+#endif
+#if ROO_DISPLAY_BLENDING_SIMD >= 1
+  while (count >= 4) {
+    __m128i d = _mm_loadu_si128((const __m128i *)dst);
+    if (swap) d = Swap32(d);
+    __m128i result = BlendArgbOpaque4(d, _mm_loadu_si128((const __m128i *)src));
+    if (swap) result = Swap32(result);
+    _mm_storeu_si128((__m128i *)dst, result);
+    src += 4;
+    dst += 4;
+    count -= 4;
+  }
+#endif
+  while (count-- > 0) {
+    *dst = Swap(AlphaBlendOverOpaque(Color(Swap(*dst, swap)), *src++).asArgb(),
+                swap);
+    ++dst;
+  }
+}
+
+void Argb8888FillSourceOverOpaque(uint32_t *dst, Color src, uint32_t count,
+                                  bool swap) {
+  ForEachFillChunk(src, count, [&dst, swap](const Color *buf, uint32_t n) {
+    Argb8888WriteSourceOverOpaque(dst, buf, n, swap);
+    dst += n;
+  });
+}
+
+void Argb8888WriteSourceOver(uint32_t *dst, const Color *src, uint32_t count,
+                             bool swap) {
+  // The general case requires a per-pixel division. The vectorized loops
+  // handle the groups of pixels in which every pixel has either an opaque
+  // source, an opaque destination, or a transparent source; other groups
+  // fall back to the scalar implementation.
+#if ROO_DISPLAY_BLENDING_SIMD >= 2
+  while (count >= 8) {
+    __m256i d = _mm256_loadu_si256((const __m256i *)dst);
+    if (swap) d = Swap32(d);
+    __m256i s = _mm256_loadu_si256((const __m256i *)src);
+    __m256i alpha_mask = _mm256_set1_epi32((int32_t)0xFF000000);
+    __m256i s_alpha = _mm256_and_si256(s, alpha_mask);
+    __m256i d_alpha = _mm256_and_si256(d, alpha_mask);
+    __m256i s_clear = _mm256_cmpeq_epi32(s_alpha, _mm256_setzero_si256());
+    __m256i d_opaque = _mm256_cmpeq_epi32(d_alpha, alpha_mask);
+    __m256i handled = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi32(s_alpha, alpha_mask), d_opaque),
+        s_clear);
+    if (_mm256_movemask_epi8(handled) == -1) {
+      // Where the source is transparent and the destination is not opaque,
+      // the destination stays as-is. Everywhere else, the result is the same
+      // as if the destination was opaque.
+      __m256i keep = _mm256_andnot_si256(d_opaque, s_clear);
+      __m256i result = _mm256_or_si256(
+          _mm256_and_si256(keep, d),
+          _mm256_andnot_si256(keep, BlendArgbOpaque8(d, s)));
+      if (swap) result = Swap32(result);
+      _mm256_storeu_si256((__m256i *)dst, result);
+    } else {
+      BlendOp<BLENDING_MODE_SOURCE_OVER> blend;
+      for (int i = 0; i < 8; ++i) {
+        dst[i] = Swap(blend(Color(Swap(dst[i], swap)), src[i]).asArgb(), swap);
+      }
+    }
+    src += 8;
+    dst += 8;
+    count -= 8;
+  }
+#endif
+#if ROO_DISPLAY_BLENDING_SIMD >= 1
+  while (count >= 4) {
+    __m128i d = _mm_loadu_si128((const __m128i *)dst);
+    if (swap) d = Swap32(d);
+    __m128i s = _mm_loadu_si128((const __m128i *)src);
+    __m128i alpha_mask = _mm_set1_epi32((int32_t)0xFF000000);
+    __m128i s_alpha = _mm_and_si128(s, alpha_mask);
+    __m128i d_alpha = _mm_and_si128(d, alpha_mask);
+    __m128i s_clear = _mm_cmpeq_epi32(s_alpha, _mm_setzero_si128());
+    __m128i d_opaque = _mm_cmpeq_epi32(d_alpha, alpha_mask);
+    __m128i handled = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi32(s_alpha, alpha_mask), d_opaque),
+        s_clear);
+    if (_mm_movemask_epi8(handled) == 0xFFFF) {
+      __m128i keep = _mm_andnot_si128(d_opaque, s_clear);
+      __m128i result =
+          _mm_or_si128(_mm_and_si128(keep, d),
+                       _mm_andnot_si128(keep, BlendArgbOpaque4(d, s)));
+      if (swap) result = Swap32(result);
+      _mm_storeu_si128((__m128i *)dst, result);
+    } else {
+      BlendOp<BLENDING_MODE_SOURCE_OVER> blend;
+      for (int i = 0; i < 4; ++i) {
+        dst[i] = Swap(blend(Color(Swap(dst[i], swap)), src[i]).asArgb(), swap);
+      }
+    }
+    src += 4;
+    dst += 4;
+    count -= 4;
+  }
+#endif
+  BlendOp<BLENDING_MODE_SOURCE_OVER> blend;
+  while (count-- > 0) {
+    *dst = Swap(blend(Color(Swap(*dst, swap)), *src++).asArgb(), swap);
+    ++dst;
+  }
+}
+
+void Argb8888FillSourceOver(uint32_t *dst, Color src, uint32_t count,
+                            bool swap) {
+  if (src.a() == 0) return;
+  ForEachFillChunk(src, count, [&dst, swap](const Color *buf, uint32_t n) {
+    Argb8888WriteSourceOver(dst, buf, n, swap);
+    dst += n;
+  });
+}
+
+}  // namespace internal
+}  // namespace roo_display
@@ -0,0 +1,76 @@
+#pragma once
+
+// Bulk blending kernels, used by OffscreenDevice to write and fill contiguous
+// runs of pixels in the most common color modes (Rgb565 and Argb8888) and
+// blending modes (SOURCE, SOURCE_OVER, SOURCE_OVER_OPAQUE).
+//
+// The results are bit-exact with the per-pixel RawBlender.
+//
+// The implementation is selected at compile time, via
+// ROO_DISPLAY_BLENDING_SIMD:
+// * 2: AVX2 (default if __AVX2__ is defined),
+// * 1: SSE2 (default if __SSE2__ is defined),
+// * 0: portable (default otherwise).
+//
+// On the ESP32-S3, the PIE vector extension is not exposed via compiler
+// intrinsics, so the portable implementation is used.
+//
+// The 'swap' argument indicates that the pixels in the buffer are stored in
+// the non-native byte order.
+
+#include <inttypes.h>
+
+#include "roo_display/color/color.h"
+
+#ifndef ROO_DISPLAY_BLENDING_SIMD
+#if defined(__AVX2__)
+#define ROO_DISPLAY_BLENDING_SIMD 2
+#elif defined(__SSE2__)
+#define ROO_DISPLAY_BLENDING_SIMD 1
+#else
+#define ROO_DISPLAY_BLENDING_SIMD 0
+#endif
+#endif
+
+namespace roo_display {
+namespace internal {
+
+// Returns the name of the implementation in use, e.g. "sse2".
+const char *BlendingKernelIsa();
+
+// Rgb565.
+
+// BLENDING_MODE_SOURCE.
+void Rgb565WriteSource(uint16_t *dst, const Color *src, uint32_t count,
+                       bool swap);
+
+// BLENDING_MODE_SOURCE_OVER_OPAQUE (equivalent to BLENDING_MODE_SOURCE_OVER,
+// as Rgb565 is always opaque).
+void Rgb565WriteSourceOverOpaque(uint16_t *dst, const Color *src,
+                                 uint32_t count, bool swap);
+
+void Rgb565FillSourceOverOpaque(uint16_t *dst, Color src, uint32_t count,
+                                bool swap);
+
+// Argb8888.
+
+// BLENDING_MODE_SOURCE.
+void Argb8888WriteSource(uint32_t *dst, const Color *src, uint32_t count,
+                         bool swap);
+
+// BLENDING_MODE_SOURCE_OVER_OPAQUE.
+void Argb8888WriteSourceOverOpaque(uint32_t *dst, const Color *src,
+                                   uint32_t count, bool swap);
+
+void Argb8888FillSourceOverOpaque(uint32_t *dst, Color src, uint32_t count,
+                                  bool swap);
+
+// BLENDING_MODE_SOURCE_OVER.
+void Argb8888WriteSourceOver(uint32_t *dst, const Color *src, uint32_t count,
+                             bool swap);
+
+void Argb8888FillSourceOver(uint32_t *dst, Color src, uint32_t count,
+                            bool swap);
+
+}  // namespace internal
+}  // namespace roo_display
@@ -1,12 +1,16 @@
 #include "roo_display/color/gradient.h"
 
+#include "roo_display/internal/isqrt.h"
+
 namespace roo_display {
 
 ColorGradient::ColorGradient(std::vector<Node> gradient, Boundary boundary)
     : gradient_(std::move(gradient)),
       boundary_(boundary),
       transparency_mode_(TRANSPARENCY_NONE),
-      inv_period_(1.0f / (gradient_.back().value - gradient_.front().value)) {
+      inv_period_(1.0f / (gradient_.back().value - gradient_.front().value)),
+      lut_scale_(0),
+      lut_unit_(0) {
   for (const Node& n : gradient_) {
     uint8_t a = n.color.a();
     if (a != 255) {
@@ -20,6 +24,67 @@ ColorGradient::ColorGradient(std::vector<Node> gradient, Boundary boundary)
 }
 
 Color ColorGradient::getColor(float value) const {
+  if (baked()) return lookup(lutPosition(value));
+  return interpolate(value);
+}
+
+ColorGradient& ColorGradient::bake(uint16_t lut_size) {
+  float domain = gradient_.back().value - gradient_.front().value;
+  if (lut_size < 2 || !(domain > 0)) return *this;
+  lut_.clear();
+  lut_.reserve(lut_size);
+  for (uint16_t i = 0; i < lut_size; ++i) {
+    lut_.push_back(
+        interpolate(gradient_.front().value + domain * i / (lut_size - 1)));
+  }
+  lut_scale_ = (lut_size - 1) / domain;
+  lut_unit_ = lutPositionDelta(1);
+  return *this;
+}
+
+namespace {
+
+inline int64_t ToFixedPoint(float value, int64_t limit) {
+  if (value >= limit) return limit;
+  if (value <= -limit) return -limit;
+  return llroundf(value);
+}
+
+}  // namespace
+
+int64_t ColorGradient::lutPosition(float value) const {
+  return ToFixedPoint((value - gradient_.front().value) * lut_scale_ * 65536.0f,
+                      1LL << 46);
+}
+
+int64_t ColorGradient::lutPositionDelta(float delta) const {
+  return ToFixedPoint(delta * lut_scale_ * 65536.0f, 1LL << 31);
+}
+
+Color ColorGradient::lookupOutOfRange(int64_t idx, int64_t position) const {
+  int64_t last = lut_.size() - 1;
+  switch (boundary_) {
+    case EXTENDED: {
+      return idx < 0 ? lut_.front() : lut_.back();
+    }
+    case TRUNCATED: {
+      // Fades out within 1 of the boundary; see interpolate().
+      if (position <= -lut_unit_ || position >= (last << 16) + lut_unit_) {
+        return color::Transparent;
+      }
+      return interpolate(gradient_.front().value +
+                         position / (65536.0f * lut_scale_));
+    }
+    case PERIODIC: {
+      idx %= last;
+      if (idx < 0) idx += last;
+      return lut_[idx];
+    }
+  }
+  return color::Transparent;
+}
+
+Color ColorGradient::interpolate(float value) const {
   // Adjust the value, handling the boundary type.
   switch (boundary_) {
     case EXTENDED: {
@@ -78,7 +143,7 @@ Color ColorGradient::getColor(float value) const {
       if_c = 0;
     } else {
       float f_c = f_a * right.a() / ((1 - f_a) * left.a() + f_a * right.a());
-      int16_t if_c = (int16_t)(256 * f_c);
+      if_c = (int16_t)(256 * f_c);
     }
     uint32_t r =
         ((uint16_t)left.r() * (256 - if_c) + (uint16_t)right.r() * if_c) / 256;
@@ -95,10 +160,58 @@ RadialGradient::RadialGradient(FpPoint center, ColorGradient gradient,
     : cx_(center.x),
       cy_(center.y),
       gradient_(std::move(gradient)),
-      extents_(extents) {}
+      extents_(extents),
+      cx_q4_(lroundf(center.x * 16)),
+      cy_q4_(lroundf(center.y * 16)),
+      center_pos_(0),
+      pos_step_(0) {
+  if (gradient_.baked()) {
+    center_pos_ = gradient_.lutPosition(0);
+    pos_step_ = gradient_.lutPositionDelta(1);
+  }
+}
+
+namespace {
+
+// Returns floor(sqrt(x)), given its estimate `r` that is off by at most a few
+// units, and its square `r_sq`. Updates both to the result.
+inline void AdjustSqrt(uint64_t x, uint32_t& r, uint64_t& r_sq) {
+  while (r_sq > x) {
+    --r;
+    r_sq -= 2 * r + 1;
+  }
+  while (r_sq + 2 * r + 1 <= x) {
+    r_sq += 2 * r + 1;
+    ++r;
+  }
+}
+
+// Returns floor(sqrt(x)).
+inline uint32_t Sqrt64(uint64_t x) {
+  if (x <= 0xFFFFFFFFu) return isqrt32(x);
+  // Distances of over 4096 pixels; too rare to bother.
+  uint32_t r = (uint32_t)sqrtf((float)x);
+  uint64_t r_sq = (uint64_t)r * r;
+  AdjustSqrt(x, r, r_sq);
+  return r;
+}
+
+}  // namespace
+
+Color RadialGradient::bakedColorAt(uint32_t dist) const {
+  return gradient_.lookup(center_pos_ + ((dist * pos_step_) >> 4));
+}
 
 void RadialGradient::readColors(const int16_t* x, const int16_t* y,
                                 uint32_t count, Color* result) const {
+  if (gradient_.baked()) {
+    while (count-- > 0) {
+      int64_t dx = (int32_t)(*x++) * 16 - cx_q4_;
+      int64_t dy = (int32_t)(*y++) * 16 - cy_q4_;
+      *result++ = bakedColorAt(Sqrt64(dx * dx + dy * dy));
+    }
+    return;
+  }
   while (count-- > 0) {
     float dx = *x - cx_;
     float dy = *y - cy_;
@@ -110,15 +223,62 @@ void RadialGradient::readColors(const int16_t* x, const int16_t* y,
   }
 }
 
+void RadialGradient::readColorRow(int16_t y, int16_t x0, int16_t x1,
+                                  Color* result) const {
+  if (gradient_.baked()) {
+    int64_t dx = (int32_t)x0 * 16 - cx_q4_;
+    int64_t dy = (int32_t)y * 16 - cy_q4_;
+    uint64_t dist_sq = dx * dx + dy * dy;
+    uint32_t dist = Sqrt64(dist_sq);
+    int32_t step = 0;
+    for (int16_t x = x0; x <= x1; ++x) {
+      // The distance changes smoothly, so it is cheaper to extrapolate it
+      // from the previous pixels, and adjust, than to calculate it anew.
+      uint32_t prev = dist;
+      if (step >= 0 || dist >= (uint32_t)-step) dist += step;
+      uint64_t dist_floor_sq = (uint64_t)dist * dist;
+      AdjustSqrt(dist_sq, dist, dist_floor_sq);
+      step = dist - prev;
+      *result++ = bakedColorAt(dist);
+      // (dx + 16)^2 = dx^2 + 32 * dx + 256.
+      dist_sq += 32 * dx + 256;
+      dx += 16;
+    }
+    return;
+  }
+  float dy = y - cy_;
+  float dy_sq = dy * dy;
+  for (int16_t x = x0; x <= x1; ++x) {
+    float dx = x - cx_;
+    *result++ = gradient_.getColor(sqrtf(dx * dx + dy_sq));
+  }
+}
+
 RadialGradientSq::RadialGradientSq(Point center, ColorGradient gradient,
                                    Box extents)
     : cx_(center.x),
       cy_(center.y),
       gradient_(std::move(gradient)),
-      extents_(extents) {}
+      extents_(extents),
+      center_pos_(0),
+      pos_step_(0) {
+  if (gradient_.baked()) {
+    center_pos_ = gradient_.lutPosition(0);
+    pos_step_ = gradient_.lutPositionDelta(1);
+  }
+}
 
 void RadialGradientSq::readColors(const int16_t* x, const int16_t* y,
                                   uint32_t count, Color* result) const {
+  if (gradient_.baked()) {
+    while (count-- > 0) {
+      int16_t dx = *x++ - cx_;
+      int16_t dy = *y++ - cy_;
+      uint32_t r = dx * dx + dy * dy;
+      *result++ = gradient_.lookup(center_pos_ + r * pos_step_);
+    }
+    return;
+  }
   while (count-- > 0) {
     int16_t dx = *x - cx_;
     int16_t dy = *y - cy_;
@@ -130,6 +290,27 @@ void RadialGradientSq::readColors(const int16_t* x, const int16_t* y,
   }
 }
 
+void RadialGradientSq::readColorRow(int16_t y, int16_t x0, int16_t x1,
+                                    Color* result) const {
+  int16_t dx = x0 - cx_;
+  int16_t dy = y - cy_;
+  uint32_t r = dx * dx + dy * dy;
+  if (gradient_.baked()) {
+    for (int16_t x = x0; x <= x1; ++x) {
+      *result++ = gradient_.lookup(center_pos_ + r * pos_step_);
+      r += 2 * dx + 1;
+      ++dx;
+    }
+    return;
+  }
+  for (int16_t x = x0; x <= x1; ++x) {
+    *result++ = gradient_.getColor(r);
+    // (dx + 1)^2 = dx^2 + 2 * dx + 1.
+    r += 2 * dx + 1;
+    ++dx;
+  }
+}
+
 LinearGradient::LinearGradient(Point origin, float dx, float dy,
                                ColorGradient gradient, Box extents)
     : cx_(origin.x),
@@ -137,10 +318,25 @@ LinearGradient::LinearGradient(Point origin, float dx, float dy,
       dx_(dx),
       dy_(dy),
       gradient_(std::move(gradient)),
-      extents_(extents) {}
+      extents_(extents),
+      origin_pos_(0),
+      pos_step_x_(0),
+      pos_step_y_(0) {
+  if (gradient_.baked()) {
+    origin_pos_ = gradient_.lutPosition(0);
+    pos_step_x_ = gradient_.lutPositionDelta(dx_);
+    pos_step_y_ = gradient_.lutPositionDelta(dy_);
+  }
+}
 
 void LinearGradient::readColors(const int16_t* x, const int16_t* y,
                                 uint32_t count, Color* result) const {
+  if (gradient_.baked()) {
+    while (count-- > 0) {
+      *result++ = gradient_.lookup(lutPosition(*x++, *y++));
+    }
+    return;
+  }
   if (dx_ == 0.0f) {
     if (dy_ == 1.0f) {
       while (count-- > 0) {
@@ -168,9 +364,52 @@ void LinearGradient::readColors(const int16_t* x, const int16_t* y,
   }
 }
 
+void LinearGradient::readColorRow(int16_t y, int16_t x0, int16_t x1,
+                                  Color* result) const {
+  if (gradient_.baked()) {
+    int64_t pos = lutPosition(x0, y);
+    if (pos_step_x_ == 0) {
+      FillColor(result, x1 - x0 + 1, gradient_.lookup(pos));
+      return;
+    }
+    for (int16_t x = x0; x <= x1; ++x) {
+      *result++ = gradient_.lookup(pos);
+      pos += pos_step_x_;
+    }
+    return;
+  }
+  if (dx_ == 0.0f) {
+    // The same color in the entire row.
+    FillColor(result, x1 - x0 + 1,
+              gradient_.getColor(dy_ == 1.0f ? y - cy_ : (y - cy_) * dy_));
+  } else if (dy_ == 0.0f) {
+    if (dx_ == 1.0f) {
+      for (int16_t x = x0; x <= x1; ++x) {
+        *result++ = gradient_.getColor(x - cx_);
+      }
+    } else {
+      for (int16_t x = x0; x <= x1; ++x) {
+        *result++ = gradient_.getColor((x - cx_) * dx_);
+      }
+    }
+  } else {
+    float row = (y - cy_) * dy_;
+    for (int16_t x = x0; x <= x1; ++x) {
+      *result++ = gradient_.getColor((x - cx_) * dx_ + row);
+    }
+  }
+}
+
 bool LinearGradient::readColorRect(int16_t xMin, int16_t yMin, int16_t xMax,
                                    int16_t yMax, Color* result) const {
   int16_t width = xMax - xMin + 1;
+  if (gradient_.baked()) {
+    for (int16_t y = yMin; y <= yMax; ++y) {
+      readColorRow(y, xMin, xMax, result);
+      result += width;
+    }
+    return false;
+  }
   if (dx_ == 0.0f) {
     if (dy_ == 1.0f) {
       for (int16_t y = yMin; y <= yMax; ++y) {
@@ -227,4 +466,12 @@ void AngularGradient::readColors(const int16_t* x, const int16_t* y,
   }
 }
 
+void AngularGradient::readColorRow(int16_t y, int16_t x0, int16_t x1,
+                                   Color* result) const {
+  float dy = cy_ - y;
+  for (int16_t x = x0; x <= x1; ++x) {
+    *result++ = gradient_.getColor(atan2f(x - cx_, dy));
+  }
+}
+
 }  // namespace roo_display
@@ -50,16 +50,65 @@ class ColorGradient {
   // according to the boundary specification.
   Color getColor(float value) const;
 
+  // Precomputes the colors at `lut_size` evenly spaced values, spanning the
+  // gradient's domain (from the first to the last node value). Afterwards,
+  // colors are looked up in the table rather than interpolated, and the
+  // gradient rasterizables (LinearGradient, RadialGradient, RadialGradientSq)
+  // evaluate them in integer arithmetic. The cost is 4 * `lut_size` bytes,
+  // and the quantization of the value to the table resolution (the nearest
+  // entry is used, so e.g. sharp transitions may shift by up to half an
+  // entry). The boundary specification is honored. Requires at least two
+  // nodes with different values; otherwise, has no effect. Returns *this, for
+  // chaining.
+  ColorGradient& bake(uint16_t lut_size = 256);
+
+  // Returns true if the gradient has a lookup table.
+  bool baked() const { return !lut_.empty(); }
+
+  // For baked gradients: returns the position in the lookup table (in the
+  // Q16.16 fixed-point format) corresponding to the specified value. Saturates
+  // at +/- 2^46.
+  int64_t lutPosition(float value) const;
+
+  // For baked gradients: returns the difference between lookup table positions
+  // (in the Q16.16 fixed-point format) corresponding to the specified
+  // difference of values. Saturates at +/- 2^31, so that it can be multiplied
+  // by a 32-bit integer without overflow.
+  int64_t lutPositionDelta(float delta) const;
+
+  // For baked gradients: returns the color at the specified position in the
+  // lookup table (in the Q16.16 fixed-point format), applying the boundary
+  // specification if the position is out of the table range.
+  Color lookup(int64_t position) const {
+    int64_t idx = (position + 0x8000) >> 16;
+    if ((uint64_t)idx < lut_.size()) return lut_[idx];
+    return lookupOutOfRange(idx, position);
+  }
+
   // Returns the transparency mode of the gradient. If all nodes are opaque, it
   // is TRANSPARENCY_NONE. Otherwise, if any node has a non-zero alpha, it is
   // TRANSPARENCY_GRADUAL. Otherwise, it is TRANSPARENCY_BINARY.
   TransparencyMode getTransparencyMode() const { return transparency_mode_; }
 
  private:
+  // Calculates the color by interpolating the nodes.
+  Color interpolate(float value) const;
+
+  Color lookupOutOfRange(int64_t idx, int64_t position) const;
+
   std::vector<Node> gradient_;
   Boundary boundary_;
   TransparencyMode transparency_mode_;
   float inv_period_;
+
+  std::vector<Color> lut_;
+
+  // Lookup table entries per unit of value.
+  float lut_scale_;
+
+  // The lookup table position difference corresponding to the value
+  // difference of 1 (i.e., the fade-out margin of truncated gradients).
+  int64_t lut_unit_;
 };
 
 // Represents a radial gradient, in which the value depends solely on the
@@ -75,6 +124,9 @@ class RadialGradient : public Rasterizable {
   // circles, maintain distances between node point values to be at least 1. In
   // particular, if you want a smooth outer circle, add an artificial terminator
   // node with color::Transparent and the value 1 greater than its predecessor.
+  //
+  // If the gradient is baked (see ColorGradient::bake()), the distances are
+  // evaluated in integer arithmetic, with the precision of 1/16 pixel.
   RadialGradient(FpPoint center, ColorGradient gradient,
                  Box extents = Box::MaximumBox());
 
@@ -83,11 +135,25 @@ class RadialGradient : public Rasterizable {
   void readColors(const int16_t* x, const int16_t* y, uint32_t count,
                   Color* result) const override;
 
+  void readColorRow(int16_t y, int16_t x0, int16_t x1,
+                    Color* result) const override;
+
  private:
+  // For baked gradients: returns the color at the specified distance, in
+  // units of 1/16 pixel.
+  Color bakedColorAt(uint32_t dist) const;
+
   float cx_;
   float cy_;
   ColorGradient gradient_;
   Box extents_;
+
+  // For baked gradients: the center, in units of 1/16 pixel, the lookup table
+  // position at the center, and its increment per pixel of distance.
+  int32_t cx_q4_;
+  int32_t cy_q4_;
+  int64_t center_pos_;
+  int64_t pos_step_;
 };
 
 // Similar to RadialGradient, but uses the square of point distance to calculate
@@ -109,11 +175,19 @@ class RadialGradientSq : public Rasterizable {
   void readColors(const int16_t* x, const int16_t* y, uint32_t count,
                   Color* result) const override;
 
+  void readColorRow(int16_t y, int16_t x0, int16_t x1,
+                    Color* result) const override;
+
  private:
   int16_t cx_;
   int16_t cy_;
   ColorGradient gradient_;
   Box extents_;
+
+  // For baked gradients: the lookup table position at the center, and its
+  // increment per unit of the squared distance.
+  int64_t center_pos_;
+  int64_t pos_step_;
 };
 
 // Represents an arbitrary linear gradient (horizontal, vertical, or skewed).
@@ -137,16 +211,30 @@ class LinearGradient : public Rasterizable {
   void readColors(const int16_t* x, const int16_t* y, uint32_t count,
                   Color* result) const override;
 
+  void readColorRow(int16_t y, int16_t x0, int16_t x1,
+                    Color* result) const override;
+
   bool readColorRect(int16_t xMin, int16_t yMin, int16_t xMax, int16_t yMax,
                      Color* result) const override;
 
  private:
+  int64_t lutPosition(int16_t x, int16_t y) const {
+    return origin_pos_ + (int64_t)(x - cx_) * pos_step_x_ +
+           (int64_t)(y - cy_) * pos_step_y_;
+  }
+
   int16_t cx_;
   int16_t cy_;
   float dx_;
   float dy_;
   ColorGradient gradient_;
   Box extents_;
+
+  // For baked gradients: the lookup table position at the origin, and its
+  // increments per pixel.
+  int64_t origin_pos_;
+  int64_t pos_step_x_;
+  int64_t pos_step_y_;
 };
 
 // Creates a vertical gradient, in which the color value depends solely on the x
@@ -190,6 +278,9 @@ class AngularGradient : public Rasterizable {
   void readColors(const int16_t* x, const int16_t* y, uint32_t count,
                   Color* result) const override;
 
+  void readColorRow(int16_t y, int16_t x0, int16_t x1,
+                    Color* result) const override;
+
  private:
   float cx_;
   float cy_;
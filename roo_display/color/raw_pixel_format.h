@@ -0,0 +1,79 @@
+#pragma once
+
+// Identification of raw (native) pixel formats, used to negotiate a
+// zero-conversion path between the content being drawn and the display
+// output. When a raster is stored in the same format that the output uses
+// internally, the pixels can be copied verbatim (e.g. using memcpy, or
+// directly sent to the display controller), rather than being converted to
+// Color and back.
+//
+// Only stateless color modes with at least 8 bits per pixel are supported.
+// (Stateful color modes, such as Indexed or Alpha8, would need to compare
+// their state, i.e. palettes or colors, which is not worth it.)
+
+#include <inttypes.h>
+
+#include <type_traits>
+
+#include "roo_display/color/traits.h"
+#include "roo_display/internal/byte_order.h"
+
+namespace roo_display {
+
+class RawPixelFormat {
+ public:
+  // Creates an 'invalid' format, not matching any other format.
+  RawPixelFormat()
+      : id_(nullptr), byte_order_(BYTE_ORDER_BIG_ENDIAN), bytes_per_pixel_(0) {}
+
+  RawPixelFormat(const void *id, ByteOrder byte_order, int8_t bytes_per_pixel)
+      : id_(id), byte_order_(byte_order), bytes_per_pixel_(bytes_per_pixel) {}
+
+  bool valid() const { return id_ != nullptr; }
+
+  ByteOrder byte_order() const { return byte_order_; }
+  int8_t bytes_per_pixel() const { return bytes_per_pixel_; }
+
+  bool operator==(const RawPixelFormat &other) const {
+    return valid() && id_ == other.id_ && byte_order_ == other.byte_order_;
+  }
+
+  bool operator!=(const RawPixelFormat &other) const {
+    return !(*this == other);
+  }
+
+ private:
+  // Unique per color mode type.
+  const void *id_;
+  ByteOrder byte_order_;
+  int8_t bytes_per_pixel_;
+};
+
+namespace internal {
+
+template <typename ColorMode>
+struct RawPixelFormatTag {
+  static const char id;
+};
+
+template <typename ColorMode>
+const char RawPixelFormatTag<ColorMode>::id = 0;
+
+}  // namespace internal
+
+// Returns the raw format of pixels stored using the specified color mode and
+// byte order, or an invalid format if the color mode is not supported.
+template <typename ColorMode, ByteOrder byte_order>
+inline RawPixelFormat RawPixelFormatOf() {
+  if (!std::is_empty<ColorMode>::value || ColorMode::bits_per_pixel < 8) {
+    return RawPixelFormat();
+  }
+  // Byte order is irrelevant for single-byte pixels.
+  return RawPixelFormat(
+      &internal::RawPixelFormatTag<ColorMode>::id,
+      ColorTraits<ColorMode>::bytes_per_pixel == 1 ? BYTE_ORDER_BIG_ENDIAN
+                                                   : byte_order,
+      ColorTraits<ColorMode>::bytes_per_pixel);
+}
+
+}  // namespace roo_display
@@ -0,0 +1,638 @@
+#include "roo_display/composition/display_list.h"
+
+#include <string.h>
+
+namespace roo_display {
+
+namespace {
+
+// Serialized format (all integers little-endian):
+//
+// Header:
+//   'R', 'D', 'L', version, extents (4 x int16: xMin, yMin, xMax, yMax)
+//
+// Followed by a sequence of commands, each starting with a one-byte opcode:
+//
+//   SET_ADDRESS  mode:u8 x0:i16 y0:i16 x1:i16 y1:i16
+//   WRITE        count:u32 color:u32 * count
+//   WRITE_PIXELS mode:u8 count:u16 (x:i16 y:i16 color:u32) * count
+//   FILL_PIXELS  mode:u8 color:u32 count:u16 (x:i16 y:i16) * count
+//   WRITE_RECTS  mode:u8 count:u16 (x0 y0 x1 y1:i16 color:u32) * count
+//   FILL_RECTS   mode:u8 color:u32 count:u16 (x0 y0 x1 y1:i16) * count
+//   WRITE_SPANS  mode:u8 count:u16 (x0 y x1:i16 color:u32 * (x1-x0+1)) * count
+//   FILL_SPANS   mode:u8 color:u32 count:u16 (x0 y x1:i16) * count
+
+static const uint8_t kVersion = 1;
+static const size_t kHeaderSize = 12;
+
+enum Opcode : uint8_t {
+  OP_SET_ADDRESS = 1,
+  OP_WRITE = 2,
+  OP_WRITE_PIXELS = 3,
+  OP_FILL_PIXELS = 4,
+  OP_WRITE_RECTS = 5,
+  OP_FILL_RECTS = 6,
+  OP_WRITE_SPANS = 7,
+  OP_FILL_SPANS = 8,
+};
+
+// Number of items decoded at a time, during replay.
+static const int kChunkSize = 64;
+
+inline int16_t Get16(const uint8_t *ptr) {
+  return (int16_t)(ptr[0] | (ptr[1] << 8));
+}
+
+class Reader {
+ public:
+  Reader(const uint8_t *data, size_t size) : ptr_(data), end_(data + size) {}
+
+  bool done() const { return ptr_ >= end_; }
+
+  // Returns true if at least count items of the specified size remain.
+  bool has(uint32_t count, size_t size) const {
+    return (size_t)(end_ - ptr_) / size >= count;
+  }
+
+  uint8_t u8() { return *ptr_++; }
+
+  int16_t i16() {
+    int16_t result = Get16(ptr_);
+    ptr_ += 2;
+    return result;
+  }
+
+  uint16_t u16() { return (uint16_t)i16(); }
+
+  void skip(size_t size) { ptr_ += size; }
+
+  uint32_t u32() {
+    uint32_t result = (uint32_t)ptr_[0] | ((uint32_t)ptr_[1] << 8) |
+                      ((uint32_t)ptr_[2] << 16) | ((uint32_t)ptr_[3] << 24);
+    ptr_ += 4;
+    return result;
+  }
+
+  Color color() { return Color(u32()); }
+
+  BlendingMode mode() { return (BlendingMode)u8(); }
+
+ private:
+  const uint8_t *ptr_;
+  const uint8_t *end_;
+};
+
+// Decodes the commands, translates them by (dx, dy), clips them to the
+// clip box, and sends them to the output, in batches of up to kChunkSize.
+class Replayer {
+ public:
+  Replayer(DisplayOutput &out, int16_t dx, int16_t dy, const Box &clip_box)
+      : out_(out),
+        dx_(dx),
+        dy_(dy),
+        clip_box_(clip_box),
+        window_(0, 0, -1, -1),
+        window_mode_(BLENDING_MODE_SOURCE),
+        window_unclipped_(false),
+        cursor_x_(0),
+        cursor_y_(0) {}
+
+  // Replays the commands, until the end of the data, or until a truncated or
+  // otherwise corrupted command, which is not replayed.
+  void run(Reader &in) {
+    while (!in.done()) {
+      bool ok;
+      switch (in.u8()) {
+        case OP_SET_ADDRESS: {
+          ok = setAddress(in);
+          break;
+        }
+        case OP_WRITE: {
+          ok = write(in);
+          break;
+        }
+        case OP_WRITE_PIXELS: {
+          ok = writePixels(in);
+          break;
+        }
+        case OP_FILL_PIXELS: {
+          ok = fillPixels(in);
+          break;
+        }
+        case OP_WRITE_RECTS: {
+          ok = writeRects(in);
+          break;
+        }
+        case OP_FILL_RECTS: {
+          ok = fillRects(in);
+          break;
+        }
+        case OP_WRITE_SPANS: {
+          ok = writeSpans(in);
+          break;
+        }
+        case OP_FILL_SPANS: {
+          ok = fillSpans(in);
+          break;
+        }
+        default: {
+          ok = false;
+          break;
+        }
+      }
+      if (!ok) return;
+    }
+  }
+
+ private:
+  // Each of the commands below returns false if the command is corrupted.
+  // In that case, nothing is sent to the output.
+
+  bool setAddress(Reader &in) {
+    if (!in.has(1, 9)) return false;
+    window_mode_ = in.mode();
+    int16_t x0 = in.i16() + dx_;
+    int16_t y0 = in.i16() + dy_;
+    int16_t x1 = in.i16() + dx_;
+    int16_t y1 = in.i16() + dy_;
+    if (x1 < x0 || y1 < y0) {
+      window_ = Box(0, 0, -1, -1);
+      return false;
+    }
+    window_ = Box(x0, y0, x1, y1);
+    cursor_x_ = x0;
+    cursor_y_ = y0;
+    window_unclipped_ = clip_box_.contains(window_);
+    if (window_unclipped_) {
+      out_.setAddress(x0, y0, x1, y1, window_mode_);
+    }
+    return true;
+  }
+
+  bool write(Reader &in) {
+    if (!in.has(1, 4)) return false;
+    uint32_t count = in.u32();
+    if (window_.empty() || !in.has(count, 4)) return false;
+    while (count > 0) {
+      uint16_t n = count < kChunkSize ? count : kChunkSize;
+      for (uint16_t i = 0; i < n; ++i) color_[i] = in.color();
+      count -= n;
+      if (window_unclipped_) {
+        out_.write(color_, n);
+      } else {
+        writeClipped(n);
+      }
+    }
+    return true;
+  }
+
+  // Sends the n colors from color_, that would have been written to the
+  // address window at the cursor, as spans clipped to the clip box.
+  void writeClipped(uint16_t n) {
+    uint16_t span_count = 0;
+    uint16_t color_count = 0;
+    uint16_t i = 0;
+    while (i < n) {
+      uint16_t run = window_.xMax() - cursor_x_ + 1;
+      if (run > n - i) run = n - i;
+      if (cursor_y_ >= clip_box_.yMin() && cursor_y_ <= clip_box_.yMax()) {
+        int16_t x0 = std::max(cursor_x_, clip_box_.xMin());
+        int16_t x1 = std::min<int16_t>(cursor_x_ + run - 1, clip_box_.xMax());
+        if (x0 <= x1) {
+          memmove(&color_[color_count], &color_[i + x0 - cursor_x_],
+                  (x1 - x0 + 1) * sizeof(Color));
+          color_count += x1 - x0 + 1;
+          x0_[span_count] = x0;
+          y0_[span_count] = cursor_y_;
+          x1_[span_count] = x1;
+          ++span_count;
+        }
+      }
+      i += run;
+      cursor_x_ += run;
+      if (cursor_x_ > window_.xMax()) {
+        cursor_x_ = window_.xMin();
+        ++cursor_y_;
+      }
+    }
+    if (span_count > 0) {
+      out_.writeSpans(window_mode_, color_, x0_, y0_, x1_, span_count);
+    }
+  }
+
+  bool writePixels(Reader &in) {
+    if (!in.has(1, 3)) return false;
+    BlendingMode mode = in.mode();
+    uint16_t count = in.u16();
+    if (!in.has(count, 8)) return false;
+    uint16_t n = 0;
+    while (count-- > 0) {
+      int16_t x = in.i16() + dx_;
+      int16_t y = in.i16() + dy_;
+      Color color = in.color();
+      if (!clip_box_.contains(x, y)) continue;
+      x0_[n] = x;
+      y0_[n] = y;
+      color_[n] = color;
+      if (++n == kChunkSize) {
+        out_.writePixels(mode, color_, x0_, y0_, n);
+        n = 0;
+      }
+    }
+    if (n > 0) out_.writePixels(mode, color_, x0_, y0_, n);
+    return true;
+  }
+
+  bool fillPixels(Reader &in) {
+    if (!in.has(1, 7)) return false;
+    BlendingMode mode = in.mode();
+    Color color = in.color();
+    uint16_t count = in.u16();
+    if (!in.has(count, 4)) return false;
+    uint16_t n = 0;
+    while (count-- > 0) {
+      int16_t x = in.i16() + dx_;
+      int16_t y = in.i16() + dy_;
+      if (!clip_box_.contains(x, y)) continue;
+      x0_[n] = x;
+      y0_[n] = y;
+      if (++n == kChunkSize) {
+        out_.fillPixels(mode, color, x0_, y0_, n);
+        n = 0;
+      }
+    }
+    if (n > 0) out_.fillPixels(mode, color, x0_, y0_, n);
+    return true;
+  }
+
+  // Reads a rectangle, translates and clips it. Returns false if the result
+  // is empty.
+  bool readRect(Reader &in, Box &result) {
+    int16_t x0 = in.i16() + dx_;
+    int16_t y0 = in.i16() + dy_;
+    int16_t x1 = in.i16() + dx_;
+    int16_t y1 = in.i16() + dy_;
+    result = Box(x0, y0, x1, y1);
+    return result.clip(clip_box_) != Box::CLIP_RESULT_EMPTY;
+  }
+
+  bool writeRects(Reader &in) {
+    if (!in.has(1, 3)) return false;
+    BlendingMode mode = in.mode();
+    uint16_t count = in.u16();
+    if (!in.has(count, 12)) return false;
+    uint16_t n = 0;
+    Box rect;
+    while (count-- > 0) {
+      bool visible = readRect(in, rect);
+      Color color = in.color();
+      if (!visible) continue;
+      x0_[n] = rect.xMin();
+      y0_[n] = rect.yMin();
+      x1_[n] = rect.xMax();
+      y1_[n] = rect.yMax();
+      color_[n] = color;
+      if (++n == kChunkSize) {
+        out_.writeRects(mode, color_, x0_, y0_, x1_, y1_, n);
+        n = 0;
+      }
+    }
+    if (n > 0) out_.writeRects(mode, color_, x0_, y0_, x1_, y1_, n);
+    return true;
+  }
+
+  bool fillRects(Reader &in) {
+    if (!in.has(1, 7)) return false;
+    BlendingMode mode = in.mode();
+    Color color = in.color();
+    uint16_t count = in.u16();
+    if (!in.has(count, 8)) return false;
+    uint16_t n = 0;
+    Box rect;
+    while (count-- > 0) {
+      if (!readRect(in, rect)) continue;
+      x0_[n] = rect.xMin();
+      y0_[n] = rect.yMin();
+      x1_[n] = rect.xMax();
+      y1_[n] = rect.yMax();
+      if (++n == kChunkSize) {
+        out_.fillRects(mode, color, x0_, y0_, x1_, y1_, n);
+        n = 0;
+      }
+    }
+    if (n > 0) out_.fillRects(mode, color, x0_, y0_, x1_, y1_, n);
+    return true;
+  }
+
+  bool writeSpans(Reader &in) {
+    if (!in.has(1, 3)) return false;
+    BlendingMode mode = in.mode();
+    uint16_t count = in.u16();
+    if (!checkSpans(in, count)) return false;
+    uint16_t span_count = 0;
+    uint16_t color_count = 0;
+    while (count-- > 0) {
+      int16_t x0 = in.i16() + dx_;
+      int16_t y = in.i16() + dy_;
+      int16_t x1 = in.i16() + dx_;
+      bool visible_row = (y >= clip_box_.yMin() && y <= clip_box_.yMax());
+      // Long spans are split into pieces that fit in the color buffer.
+      while (x0 <= x1) {
+        if (color_count == kChunkSize || span_count == kChunkSize) {
+          out_.writeSpans(mode, color_, x0_, y0_, x1_, span_count);
+          span_count = 0;
+          color_count = 0;
+        }
+        int16_t piece_x1 = x1;
+        if (piece_x1 - x0 + 1 > kChunkSize - color_count) {
+          piece_x1 = x0 + kChunkSize - color_count - 1;
+        }
+        for (int16_t x = x0; x <= piece_x1; ++x) {
+          Color color = in.color();
+          if (visible_row && x >= clip_box_.xMin() && x <= clip_box_.xMax()) {
+            color_[color_count++] = color;
+          }
+        }
+        int16_t cx0 = std::max(x0, clip_box_.xMin());
+        int16_t cx1 = std::min(piece_x1, clip_box_.xMax());
+        if (visible_row && cx0 <= cx1) {
+          x0_[span_count] = cx0;
+          y0_[span_count] = y;
+          x1_[span_count] = cx1;
+          ++span_count;
+        }
+        x0 = piece_x1 + 1;
+      }
+    }
+    if (span_count > 0) {
+      out_.writeSpans(mode, color_, x0_, y0_, x1_, span_count);
+    }
+    return true;
+  }
+
+  // Returns true if the data holds the specified number of spans, each with
+  // its colors, without reading them.
+  bool checkSpans(const Reader &in, uint16_t count) {
+    Reader ahead = in;
+    while (count-- > 0) {
+      if (!ahead.has(1, 6)) return false;
+      int16_t x0 = ahead.i16();
+      ahead.i16();
+      int16_t x1 = ahead.i16();
+      if (x1 < x0) continue;
+      uint32_t width = (int32_t)x1 - x0 + 1;
+      if (!ahead.has(width, 4)) return false;
+      ahead.skip(width * 4);
+    }
+    return true;
+  }
+
+  bool fillSpans(Reader &in) {
+    if (!in.has(1, 7)) return false;
+    BlendingMode mode = in.mode();
+    Color color = in.color();
+    uint16_t count = in.u16();
+    if (!in.has(count, 6)) return false;
+    uint16_t n = 0;
+    while (count-- > 0) {
+      int16_t x0 = in.i16() + dx_;
+      int16_t y = in.i16() + dy_;
+      int16_t x1 = in.i16() + dx_;
+      if (y < clip_box_.yMin() || y > clip_box_.yMax()) continue;
+      x0 = std::max(x0, clip_box_.xMin());
+      x1 = std::min(x1, clip_box_.xMax());
+      if (x0 > x1) continue;
+      x0_[n] = x0;
+      y0_[n] = y;
+      x1_[n] = x1;
+      if (++n == kChunkSize) {
+        out_.fillSpans(mode, color, x0_, y0_, x1_, n);
+        n = 0;
+      }
+    }
+    if (n > 0) out_.fillSpans(mode, color, x0_, y0_, x1_, n);
+    return true;
+  }
+
+  DisplayOutput &out_;
+  int16_t dx_;
+  int16_t dy_;
+  Box clip_box_;
+
+  // Current address window, in the output coordinates.
+  Box window_;
+  BlendingMode window_mode_;
+  // Whether the address window is entirely within the clip box, in which
+  // case the writes are passed through as-is.
+  bool window_unclipped_;
+  int16_t cursor_x_;
+  int16_t cursor_y_;
+
+  Color color_[kChunkSize];
+  int16_t x0_[kChunkSize];
+  int16_t y0_[kChunkSize];
+  int16_t x1_[kChunkSize];
+  int16_t y1_[kChunkSize];
+};
+
+}  // namespace
+
+bool DisplayList::valid() const {
+  return size_ >= kHeaderSize && data_[0] == 'R' && data_[1] == 'D' &&
+         data_[2] == 'L' && data_[3] == kVersion;
+}
+
+Box DisplayList::extents() const {
+  if (!valid()) return Box(0, 0, -1, -1);
+  return Box(Get16(data_ + 4), Get16(data_ + 6), Get16(data_ + 8),
+             Get16(data_ + 10));
+}
+
+void DisplayList::replay(DisplayOutput &out) const {
+  replay(out, 0, 0, Box::MaximumBox());
+}
+
+void DisplayList::replay(DisplayOutput &out, int16_t dx, int16_t dy,
+                         const Box &clip_box) const {
+  if (!valid()) return;
+  if (!extents().translate(dx, dy).intersects(clip_box)) return;
+  Reader in(data_ + kHeaderSize, size_ - kHeaderSize);
+  Replayer replayer(out, dx, dy, clip_box);
+  replayer.run(in);
+}
+
+void DisplayList::drawTo(const Surface &s) const {
+  replay(s.out(), s.dx(), s.dy(), s.clip_box());
+}
+
+RecordingDisplayOutput::RecordingDisplayOutput(int16_t width, int16_t height)
+    : DisplayDevice(width, height) {
+  clear();
+}
+
+void RecordingDisplayOutput::clear() {
+  buffer_.clear();
+  put8('R');
+  put8('D');
+  put8('L');
+  put8(kVersion);
+  extents_ = Box(0, 0, -1, -1);
+  put16(extents_.xMin());
+  put16(extents_.yMin());
+  put16(extents_.xMax());
+  put16(extents_.yMax());
+}
+
+void RecordingDisplayOutput::put16(int16_t v) {
+  buffer_.push_back((uint16_t)v & 0xFF);
+  buffer_.push_back((uint16_t)v >> 8);
+}
+
+void RecordingDisplayOutput::put32(uint32_t v) {
+  buffer_.push_back(v & 0xFF);
+  buffer_.push_back((v >> 8) & 0xFF);
+  buffer_.push_back((v >> 16) & 0xFF);
+  buffer_.push_back(v >> 24);
+}
+
+void RecordingDisplayOutput::putColors(const Color *color, uint32_t count) {
+  size_t offset = buffer_.size();
+  buffer_.resize(offset + count * 4);
+  uint8_t *ptr = &buffer_[offset];
+  while (count-- > 0) {
+    uint32_t argb = (color++)->asArgb();
+    *ptr++ = argb & 0xFF;
+    *ptr++ = (argb >> 8) & 0xFF;
+    *ptr++ = (argb >> 16) & 0xFF;
+    *ptr++ = argb >> 24;
+  }
+}
+
+void RecordingDisplayOutput::extend(const Box &box) {
+  if (box.empty()) return;
+  extents_ = extents_.empty() ? box : Box::Extent(extents_, box);
+  uint8_t *header = &buffer_[4];
+  int16_t values[] = {extents_.xMin(), extents_.yMin(), extents_.xMax(),
+                      extents_.yMax()};
+  for (int16_t v : values) {
+    *header++ = (uint16_t)v & 0xFF;
+    *header++ = (uint16_t)v >> 8;
+  }
+}
+
+void RecordingDisplayOutput::setAddress(uint16_t x0, uint16_t y0, uint16_t x1,
+                                        uint16_t y1,
+                                        BlendingMode blending_mode) {
+  put8(OP_SET_ADDRESS);
+  put8(blending_mode);
+  put16(x0);
+  put16(y0);
+  put16(x1);
+  put16(y1);
+  extend(Box(x0, y0, x1, y1));
+}
+
+void RecordingDisplayOutput::write(Color *color, uint32_t pixel_count) {
+  put8(OP_WRITE);
+  put32(pixel_count);
+  putColors(color, pixel_count);
+}
+
+void RecordingDisplayOutput::writePixels(BlendingMode blending_mode,
+                                         Color *color, int16_t *x, int16_t *y,
+                                         uint16_t pixel_count) {
+  put8(OP_WRITE_PIXELS);
+  put8(blending_mode);
+  put16(pixel_count);
+  Box bounds(0, 0, -1, -1);
+  for (uint16_t i = 0; i < pixel_count; ++i) {
+    put16(x[i]);
+    put16(y[i]);
+    put32(color[i].asArgb());
+    bounds = (i == 0 ? Box(x[i], y[i], x[i], y[i]) : bounds.extend(x[i], y[i]));
+  }
+  extend(bounds);
+}
+
+void RecordingDisplayOutput::fillPixels(BlendingMode blending_mode,
+                                        Color color, int16_t *x, int16_t *y,
+                                        uint16_t pixel_count) {
+  put8(OP_FILL_PIXELS);
+  put8(blending_mode);
+  put32(color.asArgb());
+  put16(pixel_count);
+  Box bounds(0, 0, -1, -1);
+  for (uint16_t i = 0; i < pixel_count; ++i) {
+    put16(x[i]);
+    put16(y[i]);
+    bounds = (i == 0 ? Box(x[i], y[i], x[i], y[i]) : bounds.extend(x[i], y[i]));
+  }
+  extend(bounds);
+}
+
+void RecordingDisplayOutput::writeRects(BlendingMode blending_mode,
+                                        Color *color, int16_t *x0, int16_t *y0,
+                                        int16_t *x1, int16_t *y1,
+                                        uint16_t count) {
+  put8(OP_WRITE_RECTS);
+  put8(blending_mode);
+  put16(count);
+  for (uint16_t i = 0; i < count; ++i) {
+    put16(x0[i]);
+    put16(y0[i]);
+    put16(x1[i]);
+    put16(y1[i]);
+    put32(color[i].asArgb());
+    extend(Box(x0[i], y0[i], x1[i], y1[i]));
+  }
+}
+
+void RecordingDisplayOutput::fillRects(BlendingMode blending_mode, Color color,
+                                       int16_t *x0, int16_t *y0, int16_t *x1,
+                                       int16_t *y1, uint16_t count) {
+  put8(OP_FILL_RECTS);
+  put8(blending_mode);
+  put32(color.asArgb());
+  put16(count);
+  for (uint16_t i = 0; i < count; ++i) {
+    put16(x0[i]);
+    put16(y0[i]);
+    put16(x1[i]);
+    put16(y1[i]);
+    extend(Box(x0[i], y0[i], x1[i], y1[i]));
+  }
+}
+
+void RecordingDisplayOutput::writeSpans(BlendingMode blending_mode,
+                                        Color *color, int16_t *x0, int16_t *y,
+                                        int16_t *x1, uint16_t count) {
+  put8(OP_WRITE_SPANS);
+  put8(blending_mode);
+  put16(count);
+  for (uint16_t i = 0; i < count; ++i) {
+    put16(x0[i]);
+    put16(y[i]);
+    put16(x1[i]);
+    uint16_t pixel_count = x1[i] - x0[i] + 1;
+    putColors(color, pixel_count);
+    color += pixel_count;
+    extend(Box(x0[i], y[i], x1[i], y[i]));
+  }
+}
+
+void RecordingDisplayOutput::fillSpans(BlendingMode blending_mode, Color color,
+                                       int16_t *x0, int16_t *y, int16_t *x1,
+                                       uint16_t count) {
+  put8(OP_FILL_SPANS);
+  put8(blending_mode);
+  put32(color.asArgb());
+  put16(count);
+  for (uint16_t i = 0; i < count; ++i) {
+    put16(x0[i]);
+    put16(y[i]);
+    put16(x1[i]);
+    extend(Box(x0[i], y[i], x1[i], y[i]));
+  }
+}
+
+}  // namespace roo_display
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <inttypes.h>
+
+#include <vector>
+
+#include "roo_display/core/box.h"
+#include "roo_display/core/device.h"
+#include "roo_display/core/drawable.h"
+
+namespace roo_display {
+
+// Immutable, serialized sequence of DisplayOutput commands, as captured by
+// RecordingDisplayOutput (see below). Does not own the data.
+//
+// The serialized form is position-independent and endianness-neutral, so
+// it can be stored as-is, e.g. in a const (flash) array, or in a file, and
+// wrapped in a DisplayList later:
+//
+//   static const uint8_t kBootScreen[] PROGMEM = { ... };
+//   DisplayList boot_screen(kBootScreen, sizeof(kBootScreen));
+//   dc.draw(boot_screen);
+//
+// When drawn as a Drawable, the recording is translated by the surface's
+// offset, and clipped to the surface's clip box. The recorded blending modes
+// are preserved; the surface's background color and fill mode are ignored.
+class DisplayList : public Drawable {
+ public:
+  // Wraps the specified serialized recording. The data must remain valid for
+  // the lifetime of this object. If the data is truncated or corrupted, the
+  // commands preceding the first damaged one are replayed.
+  DisplayList(const uint8_t *data, size_t size) : data_(data), size_(size) {}
+
+  // Returns true if the data has a recognized header.
+  bool valid() const;
+
+  const uint8_t *data() const { return data_; }
+  size_t size() const { return size_; }
+
+  // Returns the bounding box of everything that the recording draws.
+  Box extents() const override;
+
+  // Sends all the recorded commands to the specified output.
+  void replay(DisplayOutput &out) const;
+
+  // Sends all the recorded commands to the specified output, translated by
+  // (dx, dy), and clipped to the specified clip box (in the output
+  // coordinates).
+  void replay(DisplayOutput &out, int16_t dx, int16_t dy,
+              const Box &clip_box) const;
+
+ private:
+  void drawTo(const Surface &s) const override;
+
+  const uint8_t *data_;
+  size_t size_;
+};
+
+// DisplayDevice that, instead of drawing, appends all the commands it
+// receives to a compact in-memory command buffer, which can later be replayed
+// to any DisplayOutput (see DisplayList above). Since it is a DisplayDevice,
+// it can be wrapped in a Display and drawn to with a DrawingContext:
+//
+//   RecordingDisplayOutput recorder(320, 240);
+//   {
+//     Display display(recorder);
+//     DrawingContext dc(display);
+//     dc.draw(...);
+//   }
+//   DisplayList menu = recorder.displayList();
+//   ...
+//   DrawingContext dc(real_display);
+//   dc.draw(menu);
+//
+// Colors are stored as ARGB8888, and coordinates as 16-bit integers. Blending
+// is deferred until replay, so that the result of replaying is the same as if
+// the commands had been sent to the target directly.
+class RecordingDisplayOutput : public DisplayDevice {
+ public:
+  RecordingDisplayOutput(int16_t width, int16_t height);
+
+  // Discards everything recorded so far.
+  void clear();
+
+  // Returns the recording. The returned object is invalidated by subsequent
+  // writes and by clear().
+  DisplayList displayList() const {
+    return DisplayList(buffer_.data(), buffer_.size());
+  }
+
+  // Returns the serialized recording.
+  const uint8_t *data() const { return buffer_.data(); }
+  size_t size() const { return buffer_.size(); }
+
+  void setAddress(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1,
+                  BlendingMode blending_mode) override;
+
+  void write(Color *color, uint32_t pixel_count) override;
+
+  void writePixels(BlendingMode blending_mode, Color *color, int16_t *x,
+                   int16_t *y, uint16_t pixel_count) override;
+
+  void fillPixels(BlendingMode blending_mode, Color color, int16_t *x,
+                  int16_t *y, uint16_t pixel_count) override;
+
+  void writeRects(BlendingMode blending_mode, Color *color, int16_t *x0,
+                  int16_t *y0, int16_t *x1, int16_t *y1,
+                  uint16_t count) override;
+
+  void fillRects(BlendingMode blending_mode, Color color, int16_t *x0,
+                 int16_t *y0, int16_t *x1, int16_t *y1,
+                 uint16_t count) override;
+
+  void writeSpans(BlendingMode blending_mode, Color *color, int16_t *x0,
+                  int16_t *y, int16_t *x1, uint16_t count) override;
+
+  void fillSpans(BlendingMode blending_mode, Color color, int16_t *x0,
+                 int16_t *y, int16_t *x1, uint16_t count) override;
+
+ private:
+  void put8(uint8_t v) { buffer_.push_back(v); }
+  void put16(int16_t v);
+  void put32(uint32_t v);
+  void putColors(const Color *color, uint32_t count);
+
+  // Extends the recorded extents by the specified box, and updates the
+  // header.
+  void extend(const Box &box);
+
+  std::vector<uint8_t> buffer_;
+  Box extents_;
+};
+
+}  // namespace roo_display
@@ -34,13 +34,35 @@ void RasterizableStack::readColors(const int16_t* x, const int16_t* y,
   }
 }
 
+void RasterizableStack::readColorRow(int16_t y, int16_t x0, int16_t x1,
+                                     Color* result) const {
+  FillColor(result, x1 - x0 + 1, color::Transparent);
+  Color buffer[kMaxBufSize];
+  for (auto r = inputs_.begin(); r != inputs_.end(); r++) {
+    const Box& bounds = r->extents();
+    if (y < bounds.yMin() || y > bounds.yMax()) continue;
+    int16_t xMin = std::max(x0, bounds.xMin());
+    int16_t xMax = std::min(x1, bounds.xMax());
+    while (xMin <= xMax) {
+      int16_t xEnd = xMax;
+      if (xEnd - xMin >= kMaxBufSize) xEnd = xMin + kMaxBufSize - 1;
+      uint16_t count = xEnd - xMin + 1;
+      r->source()->readColorRow(y - r->dy(), xMin - r->dx(), xEnd - r->dx(),
+                                buffer);
+      ApplyBlendingInPlace(r->blending_mode(), &result[xMin - x0], buffer,
+                           count);
+      xMin = xEnd + 1;
+    }
+  }
+}
+
 bool RasterizableStack::readColorRect(int16_t xMin, int16_t yMin, int16_t xMax,
                                       int16_t yMax, Color* result) const {
   bool is_uniform_color = true;
   *result = color::Transparent;
   Box box(xMin, yMin, xMax, yMax);
   int32_t pixel_count = box.area();
-  Color buffer[pixel_count];
+  Color buffer[kMaxBufSize];
   for (auto r = inputs_.begin(); r != inputs_.end(); r++) {
     Box bounds = r->extents();
     Box clipped = Box::Intersect(bounds, box);
@@ -53,7 +75,8 @@ bool RasterizableStack::readColorRect(int16_t xMin, int16_t yMin, int16_t xMax,
       is_uniform_color = false;
       FillColor(&result[1], pixel_count - 1, *result);
     }
-    if (r->source()->readColorRect(
+    if (clipped.area() <= kMaxBufSize &&
+        r->source()->readColorRect(
             clipped.xMin() - r->dx(), clipped.yMin() - r->dy(),
             clipped.xMax() - r->dx(), clipped.yMax() - r->dy(), buffer)) {
       if (is_uniform_color) {
@@ -71,12 +94,30 @@ bool RasterizableStack::readColorRect(int16_t xMin, int16_t yMin, int16_t xMax,
         is_uniform_color = false;
         FillColor(&result[1], pixel_count - 1, *result);
       }
-      uint32_t i = 0;
-      for (int16_t y = clipped.yMin(); y <= clipped.yMax(); ++y) {
-        Color* row = &result[(y - yMin) * box.width()];
-        ApplyBlendingInPlace(r->blending_mode(), &row[clipped.xMin() - xMin],
-                             &buffer[i], clipped.width());
-        i += clipped.width();
+      if (clipped.area() <= kMaxBufSize) {
+        // Already read into the buffer.
+        uint32_t i = 0;
+        for (int16_t y = clipped.yMin(); y <= clipped.yMax(); ++y) {
+          Color* row = &result[(y - yMin) * box.width()];
+          ApplyBlendingInPlace(r->blending_mode(), &row[clipped.xMin() - xMin],
+                               &buffer[i], clipped.width());
+          i += clipped.width();
+        }
+      } else {
+        // Too large for the buffer; read row by row, in chunks.
+        for (int16_t y = clipped.yMin(); y <= clipped.yMax(); ++y) {
+          Color* row = &result[(y - yMin) * box.width()];
+          int16_t x = clipped.xMin();
+          while (x <= clipped.xMax()) {
+            int16_t xEnd = clipped.xMax();
+            if (xEnd - x >= kMaxBufSize) xEnd = x + kMaxBufSize - 1;
+            r->source()->readColorRow(y - r->dy(), x - r->dx(), xEnd - r->dx(),
+                                      buffer);
+            ApplyBlendingInPlace(r->blending_mode(), &row[x - xMin], buffer,
+                                 xEnd - x + 1);
+            x = xEnd + 1;
+          }
+        }
       }
     }
   }
@@ -92,4 +133,4 @@ bool RasterizableStack::readColorRect(int16_t xMin, int16_t yMin, int16_t xMax,
   return true;
 }
 
-}  // namespace roo_display
\ No newline at end of file
+}  // namespace roo_display
@@ -105,6 +105,9 @@ class RasterizableStack : public Rasterizable {
   void readColors(const int16_t* x, const int16_t* y, uint32_t count,
                   Color* result) const override;
 
+  void readColorRow(int16_t y, int16_t x0, int16_t x1,
+                    Color* result) const override;
+
   bool readColorRect(int16_t xMin, int16_t yMin, int16_t xMax, int16_t yMax,
                      Color* result) const override;
 
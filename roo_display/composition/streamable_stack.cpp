@@ -511,7 +511,7 @@ void WriteRect(Engine* engine, const Box& bounds,
 void WriteVisible(Engine* engine, const Box& bounds,
                   internal::BufferingStream* streams,
                   const BlendingMode* blending_modes, const Surface& s) {
-  BufferedPixelWriter writer(s.out(), s.blending_mode());
+  BufferedSpanWriter writer(s.out(), s.blending_mode());
   uint16_t x = bounds.xMin();
   uint16_t y = bounds.yMin();
   while (true) {
@@ -0,0 +1,115 @@
+#include "roo_display/composition/tiled_renderer.h"
+
+#if defined(ESP32) && !defined(ROO_TESTING)
+#include "esp_pthread.h"
+#endif
+
+namespace roo_display {
+namespace internal {
+
+TileScheduler::TileScheduler(int num_threads, int num_slots)
+    : num_slots_(num_slots),
+      render_(nullptr),
+      tile_count_(0),
+      next_tile_(0),
+      flushed_(0),
+      ready_(num_slots, -1),
+      shutdown_(false) {
+#if defined(ESP32) && !defined(ROO_TESTING)
+  // The pthread config is per calling thread, and applies to all the threads
+  // it spawns later; we restore it once the workers are running.
+  esp_pthread_cfg_t prev_cfg;
+  if (esp_pthread_get_cfg(&prev_cfg) != ESP_OK) {
+    prev_cfg = esp_pthread_get_default_config();
+  }
+  esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+  cfg.pin_to_core = 0;
+  cfg.stack_size = 8192;
+  cfg.thread_name = "roo_tiles";
+  esp_pthread_set_cfg(&cfg);
+#endif
+  workers_.reserve(num_threads);
+  for (int i = 0; i < num_threads; ++i) {
+    workers_.emplace_back([this]() { workerLoop(); });
+  }
+#if defined(ESP32) && !defined(ROO_TESTING)
+  esp_pthread_set_cfg(&prev_cfg);
+#endif
+}
+
+TileScheduler::~TileScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  cv_.notify_all();
+  for (std::thread &worker : workers_) {
+    worker.join();
+  }
+}
+
+int TileScheduler::DefaultThreadCount() {
+#if defined(ESP32) && !defined(ROO_TESTING)
+  // The 'other' core.
+  return 1;
+#else
+  int n = std::thread::hardware_concurrency();
+  return n > 0 ? n : 1;
+#endif
+}
+
+void TileScheduler::workerLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    cv_.wait(lock, [this]() { return shutdown_ || canClaim(); });
+    if (shutdown_) return;
+    int tile = next_tile_++;
+    int slot = tile % num_slots_;
+    const std::function<void(int, int)> &render = *render_;
+    lock.unlock();
+    render(tile, slot);
+    lock.lock();
+    ready_[slot] = tile;
+    cv_.notify_all();
+  }
+}
+
+void TileScheduler::run(int tile_count,
+                        const std::function<void(int, int)> &render,
+                        const std::function<void(int, int)> &flush) {
+  if (workers_.empty()) {
+    for (int tile = 0; tile < tile_count; ++tile) {
+      render(tile, 0);
+      flush(tile, 0);
+    }
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    render_ = &render;
+    tile_count_ = tile_count;
+    next_tile_ = 0;
+    flushed_ = 0;
+    std::fill(ready_.begin(), ready_.end(), -1);
+  }
+  cv_.notify_all();
+  for (int tile = 0; tile < tile_count; ++tile) {
+    int slot = tile % num_slots_;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [&]() { return ready_[slot] == tile; });
+    }
+    flush(tile, slot);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ready_[slot] = -1;
+      flushed_ = tile + 1;
+    }
+    cv_.notify_all();
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  render_ = nullptr;
+}
+
+}  // namespace internal
+}  // namespace roo_display
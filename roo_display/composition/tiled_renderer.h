@@ -0,0 +1,175 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "roo_display/color/color_modes.h"
+#include "roo_display/core/drawable.h"
+#include "roo_display/core/offscreen.h"
+
+namespace roo_display {
+
+namespace internal {
+
+// Fixed pool of worker threads, rendering tiles into a bounded ring of
+// 'slots' (tile buffers), so that the calling thread can consume the finished
+// tiles in order, while the subsequent tiles are still being rendered.
+class TileScheduler {
+ public:
+  // Creates the scheduler with the specified number of worker threads, and
+  // the specified number of slots. With zero threads, all the tiles are
+  // rendered by the calling thread, using slot 0.
+  //
+  // On ESP32, the worker threads are pinned to the core 0 (leaving core 1,
+  // on which the Arduino loop() runs, for flushing the tiles to the device).
+  TileScheduler(int num_threads, int num_slots);
+
+  ~TileScheduler();
+
+  int num_threads() const { return workers_.size(); }
+  int num_slots() const { return num_slots_; }
+
+  // Calls render(tile, slot) for all tiles in [0, tile_count), on the worker
+  // threads, and flush(tile, slot) on the calling thread, in the tile order.
+  // A slot is not reused for a subsequent tile until the previous tile using
+  // that slot has been flushed. Blocks until all the tiles have been flushed.
+  void run(int tile_count, const std::function<void(int, int)> &render,
+           const std::function<void(int, int)> &flush);
+
+  // Returns the default number of worker threads for the platform.
+  static int DefaultThreadCount();
+
+ private:
+  void workerLoop();
+
+  // Must be called with mutex_ held.
+  bool canClaim() const {
+    return render_ != nullptr && next_tile_ < tile_count_ &&
+           next_tile_ - flushed_ < num_slots_;
+  }
+
+  std::vector<std::thread> workers_;
+  int num_slots_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+
+  // State of the current run(), guarded by mutex_.
+  const std::function<void(int, int)> *render_;
+  int tile_count_;
+  int next_tile_;
+  int flushed_;
+  // For each slot, the index of the tile that is ready in it, or -1.
+  std::vector<int> ready_;
+  bool shutdown_;
+};
+
+}  // namespace internal
+
+// Drawable that renders a list of drawables in parallel, by splitting the clip
+// box into tiles, rendering the tiles into in-memory buffers on a pool of
+// worker threads, and flushing the finished tiles to the underlying device in
+// order (left-to-right, top-to-bottom).
+//
+// The inputs are rendered to each tile in the order in which they have been
+// added, using the surface's background color, fill mode, and blending mode.
+// The finished tiles are then alpha-blended over the device, skipping the
+// pixels that have not been drawn. The result is the same as drawing the
+// inputs one by one, as long as the surface's blending mode is
+// BLENDING_MODE_SOURCE_OVER (the default), and the ColorMode can represent
+// all the drawn colors exactly (e.g. Argb8888). The ColorMode must support
+// transparency.
+//
+// Since the inputs are drawn concurrently from multiple threads, their
+// drawTo() must be safe to call concurrently (with different surfaces). This
+// is the case for immutable objects, such as shapes, images, and
+// rasterizables.
+//
+// Each slot uses a buffer of tile_width * tile_height pixels; there are
+// 2 * num_threads slots.
+//
+// Example:
+//
+//   TiledRenderer<Argb8888> scene(display.extents(), 64, 64, 4);
+//   scene.addInput(&background);
+//   scene.addInput(&shape1);
+//   scene.addInput(&shape2);
+//   DrawingContext dc(display);
+//   dc.draw(scene);
+template <typename ColorMode = Argb8888>
+class TiledRenderer : public Drawable {
+ public:
+  TiledRenderer(Box extents, int16_t tile_width, int16_t tile_height,
+                int num_threads = internal::TileScheduler::DefaultThreadCount(),
+                ColorMode color_mode = ColorMode())
+      : extents_(extents),
+        tile_width_(tile_width),
+        tile_height_(tile_height),
+        color_mode_(std::move(color_mode)),
+        scheduler_(new internal::TileScheduler(
+            num_threads, num_threads == 0 ? 1 : 2 * num_threads)),
+        slot_size_((ColorMode::bits_per_pixel * tile_width * tile_height + 7) /
+                   8),
+        buffer_(new uint8_t[slot_size_ * scheduler_->num_slots()]) {}
+
+  // Adds a new input, to be drawn after all previously added inputs.
+  void addInput(const Drawable *input) { inputs_.push_back(input); }
+
+  Box extents() const override { return extents_; }
+
+  int num_threads() const { return scheduler_->num_threads(); }
+
+ private:
+  void drawTo(const Surface &s) const override {
+    const Box &clip = s.clip_box();
+    int16_t cols = (clip.width() + tile_width_ - 1) / tile_width_;
+    int16_t rows = (clip.height() + tile_height_ - 1) / tile_height_;
+    auto tile_box = [&](int tile) {
+      int16_t x0 = clip.xMin() + (tile % cols) * tile_width_;
+      int16_t y0 = clip.yMin() + (tile / cols) * tile_height_;
+      return Box(x0, y0, std::min<int16_t>(x0 + tile_width_ - 1, clip.xMax()),
+                 std::min<int16_t>(y0 + tile_height_ - 1, clip.yMax()));
+    };
+    scheduler_->run(
+        cols * rows,
+        [&](int tile, int slot) {
+          Box box = tile_box(tile);
+          Offscreen<ColorMode> offscreen(box, slot_buffer(slot), color_mode_);
+          offscreen.output().fillRect(BLENDING_MODE_SOURCE, 0, 0,
+                                      box.width() - 1, box.height() - 1,
+                                      color::Transparent);
+          Surface ts(offscreen.output(), s.dx() - box.xMin(),
+                     s.dy() - box.yMin(),
+                     Box(0, 0, box.width() - 1, box.height() - 1), false,
+                     s.bgcolor(), s.fill_mode(), s.blending_mode());
+          for (const Drawable *input : inputs_) {
+            ts.drawObject(*input);
+          }
+        },
+        [&](int tile, int slot) {
+          Box box = tile_box(tile);
+          Offscreen<ColorMode> offscreen(box, slot_buffer(slot), color_mode_);
+          Surface fs(s.out(), 0, 0, box, s.is_write_once(), color::Transparent,
+                     FILL_MODE_VISIBLE, BLENDING_MODE_SOURCE_OVER);
+          fs.drawObject(offscreen);
+        });
+  }
+
+  uint8_t *slot_buffer(int slot) const { return &buffer_[slot * slot_size_]; }
+
+  Box extents_;
+  int16_t tile_width_;
+  int16_t tile_height_;
+  ColorMode color_mode_;
+  std::unique_ptr<internal::TileScheduler> scheduler_;
+  size_t slot_size_;
+  std::unique_ptr<uint8_t[]> buffer_;
+  std::vector<const Drawable *> inputs_;
+};
+
+}  // namespace roo_display
@@ -119,6 +119,68 @@ class ClippingBufferedPixelWriter {
 
 using PixelWriter = ClippingBufferedPixelWriter;
 
+// Similar to BufferedPixelWriter, but coalesces horizontally adjacent pixels
+// into spans, and sends them to the device using writeSpans(). Use it instead
+// of BufferedPixelWriter when pixels are mostly written left-to-right, row by
+// row (e.g. when scanning a rectangle and skipping transparent pixels).
+class BufferedSpanWriter {
+ public:
+  BufferedSpanWriter(DisplayOutput& device, BlendingMode blending_mode)
+      : device_(device),
+        blending_mode_(blending_mode),
+        span_count_(0),
+        pixel_count_(0) {}
+
+  BufferedSpanWriter(BufferedSpanWriter&) = delete;
+  BufferedSpanWriter(const BufferedSpanWriter&) = delete;
+
+  BufferedSpanWriter& operator=(const BufferedSpanWriter&) = delete;
+  BufferedSpanWriter& operator=(BufferedSpanWriter&&) = delete;
+
+  void writePixel(int16_t x, int16_t y, Color color) {
+    if (color.asArgb() == 0 &&
+        (blending_mode_ == BLENDING_MODE_SOURCE_OVER ||
+         blending_mode_ == BLENDING_MODE_SOURCE_OVER_OPAQUE))
+      return;
+    if (span_count_ > 0 && y == y_buffer_[span_count_ - 1] &&
+        x == x1_buffer_[span_count_ - 1] + 1 &&
+        pixel_count_ < kPixelWritingBufferSize) {
+      // Extends the last span.
+      ++x1_buffer_[span_count_ - 1];
+    } else {
+      if (span_count_ == kRectWritingBufferSize ||
+          pixel_count_ == kPixelWritingBufferSize) {
+        flush();
+      }
+      x0_buffer_[span_count_] = x;
+      y_buffer_[span_count_] = y;
+      x1_buffer_[span_count_] = x;
+      ++span_count_;
+    }
+    color_buffer_[pixel_count_++] = color;
+  }
+
+  ~BufferedSpanWriter() { flush(); }
+
+  void flush() {
+    if (span_count_ == 0) return;
+    device_.writeSpans(blending_mode_, color_buffer_, x0_buffer_, y_buffer_,
+                       x1_buffer_, span_count_);
+    span_count_ = 0;
+    pixel_count_ = 0;
+  }
+
+ private:
+  DisplayOutput& device_;
+  BlendingMode blending_mode_;
+  int16_t span_count_;
+  int16_t pixel_count_;
+  Color color_buffer_[kPixelWritingBufferSize];
+  int16_t x0_buffer_[kRectWritingBufferSize];
+  int16_t y_buffer_[kRectWritingBufferSize];
+  int16_t x1_buffer_[kRectWritingBufferSize];
+};
+
 class BufferedPixelFiller {
  public:
   BufferedPixelFiller(DisplayOutput& device, Color color,
@@ -311,8 +373,8 @@ class BufferedHLineFiller {
 
   void flush() {
     if (buffer_size_ == 0) return;
-    device_.fillRects(blending_mode_, color_, x0_buffer_, y0_buffer_,
-                      x1_buffer_, y0_buffer_, buffer_size_);
+    device_.fillSpans(blending_mode_, color_, x0_buffer_, y0_buffer_,
+                      x1_buffer_, buffer_size_);
     buffer_size_ = 0;
   }
 
@@ -0,0 +1,766 @@
+#pragma once
+
+// Offscreen that keeps its content run-length encoded, row by row.
+//
+// A full-screen offscreen may not fit in the memory of boards without PSRAM
+// (e.g. a 480x320 Rgb565 buffer takes 300 KB), yet typical UI screens consist
+// mostly of large flat-colored areas, which compress very well. The
+// compressed offscreen stores each row as a sequence of runs and literal
+// groups, and keeps a single row decompressed, in a scratch buffer. Drawing
+// decompresses the row being modified, updates it using the same pixel
+// kernels as the regular Offscreen (so that all blending modes, including
+// BLENDING_MODE_SOURCE_OVER, are supported), and recompresses it when moving
+// on to another row, or at the end of the drawing transaction.
+//
+// Since visiting a new row costs a decompression and a recompression, the
+// offscreen works best when the drawing proceeds row by row (fills, text,
+// images), in the orientations that are not XY-swapped.
+
+#include <assert.h>
+
+#include <memory>
+
+#include "roo_display/color/raw_pixel_format.h"
+#include "roo_display/core/offscreen.h"
+#include "roo_display/core/rasterizable.h"
+#include "roo_display/internal/memfill.h"
+
+namespace roo_display {
+
+namespace internal {
+
+// Run-length codec for rows of raw pixel data, consisting of units of
+// unit_size bytes. The encoded row is a sequence of groups, each starting with
+// a header byte. If bit 7 of the header is set, the group is a run of
+// (header & 0x7F) + 1 copies of the single unit that follows. Otherwise, the
+// group consists of header + 1 units, stored verbatim.
+template <int8_t unit_size>
+class RleRowCodec {
+ public:
+  // Returns the capacity needed to encode a row of the specified size, in
+  // bytes, in the worst case.
+  static uint32_t MaxEncodedSize(uint32_t size) {
+    return size + (size / unit_size + 127) / 128;
+  }
+
+  // Encodes the row of the specified size, in bytes (which must be a multiple
+  // of unit_size). Returns the number of bytes written to dst.
+  static uint32_t Encode(const uint8_t *src, uint32_t size, uint8_t *dst) {
+    uint32_t units = size / unit_size;
+    uint8_t *out = dst;
+    uint32_t i = 0;
+    while (i < units) {
+      uint32_t n = RunLength(src, i, units);
+      if (n >= kMinRun) {
+        *out++ = 0x80 | (n - 1);
+        memcpy(out, src + i * unit_size, unit_size);
+        out += unit_size;
+      } else {
+        // Extend the literal group up to the next run worth encoding.
+        uint32_t end = i + n;
+        while (end < units && end - i < 128) {
+          uint32_t r = RunLength(src, end, units);
+          if (r >= kMinRun) break;
+          end += r;
+        }
+        n = end - i;
+        if (n > 128) n = 128;
+        *out++ = n - 1;
+        memcpy(out, src + i * unit_size, n * unit_size);
+        out += n * unit_size;
+      }
+      i += n;
+    }
+    return out - dst;
+  }
+
+  // Decodes the row of the specified size, in bytes, into dst.
+  static void Decode(const uint8_t *src, uint32_t size, uint8_t *dst) {
+    uint32_t units = size / unit_size;
+    while (units > 0) {
+      uint8_t header = *src++;
+      uint32_t n = (header & 0x7F) + 1;
+      if (header & 0x80) {
+        pattern_fill<unit_size>(dst, n, src);
+        src += unit_size;
+      } else {
+        memcpy(dst, src, n * unit_size);
+        src += n * unit_size;
+      }
+      dst += n * unit_size;
+      units -= n;
+    }
+  }
+
+ private:
+  // Runs shorter than that are cheaper to store as part of a literal group.
+  static const uint8_t kMinRun = (unit_size == 1 ? 3 : 2);
+
+  // Returns the number of consecutive units equal to the unit at index i, up to
+  // 128.
+  static uint32_t RunLength(const uint8_t *src, uint32_t i, uint32_t units) {
+    const uint8_t *unit = src + i * unit_size;
+    uint32_t max = units - i;
+    if (max > 128) max = 128;
+    uint32_t n = 1;
+    while (n < max && memcmp(unit, unit + n * unit_size, unit_size) == 0) ++n;
+    return n;
+  }
+};
+
+}  // namespace internal
+
+// Display device that draws to a run-length-encoded in-memory buffer. See
+// OffscreenDevice for the general contract. The device keeps one row
+// decompressed; the modifications are compressed when the drawing moves on to
+// a different row, and in end() (or flush()).
+template <typename ColorMode,
+          ColorPixelOrder pixel_order = COLOR_PIXEL_ORDER_MSB_FIRST,
+          ByteOrder byte_order = BYTE_ORDER_BIG_ENDIAN>
+class CompressedOffscreenDevice : public DisplayDevice {
+ public:
+  // Sub-byte pixels are compressed a byte at a time.
+  typedef internal::RleRowCodec<(ColorMode::bits_per_pixel >= 8
+                                     ? ColorTraits<ColorMode>::bytes_per_pixel
+                                     : 1)>
+      Codec;
+
+  // Creates a compressed offscreen device with specified geometry. The content
+  // is initialized to zero bits.
+  CompressedOffscreenDevice(int16_t width, int16_t height,
+                            ColorMode color_mode);
+
+  CompressedOffscreenDevice(CompressedOffscreenDevice &&other) = delete;
+
+  ~CompressedOffscreenDevice() override;
+
+  void end() override { flush(); }
+
+  void orientationUpdated() override;
+
+  void setAddress(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1,
+                  BlendingMode mode) override;
+
+  void write(Color *color, uint32_t pixel_count) override;
+
+  bool acceptsRaw(const RawPixelFormat &format) const override {
+    return format == RawPixelFormatOf<ColorMode, byte_order>();
+  }
+
+  void writeRaw(const uint8_t *data, uint32_t pixel_count) override;
+
+  void writePixels(BlendingMode mode, Color *color, int16_t *x, int16_t *y,
+                   uint16_t pixel_count) override;
+
+  void fillPixels(BlendingMode mode, Color color, int16_t *x, int16_t *y,
+                  uint16_t pixel_count) override;
+
+  void writeRects(BlendingMode mode, Color *color, int16_t *x0, int16_t *y0,
+                  int16_t *x1, int16_t *y1, uint16_t count) override;
+
+  void fillRects(BlendingMode mode, Color color, int16_t *x0, int16_t *y0,
+                 int16_t *x1, int16_t *y1, uint16_t count) override;
+
+  void writeSpans(BlendingMode mode, Color *color, int16_t *x0, int16_t *y,
+                  int16_t *x1, uint16_t count) override;
+
+  // Compresses the pending modifications, if any.
+  void flush() {
+    if (!row_dirty_) return;
+    storeRow(row_y_);
+    row_dirty_ = false;
+  }
+
+  // Decodes the specified row (in the raw buffer coordinates) into dst, which
+  // must have capacity of at least row_bytes(). Reflects the pending
+  // modifications.
+  void readRow(int16_t y, uint8_t *dst) const {
+    if (y == row_y_) {
+      memcpy(dst, row_.get(), row_bytes_);
+    } else {
+      Codec::Decode(rows_[y].data, row_bytes_, dst);
+    }
+  }
+
+  // Returns the size of a decompressed row, in bytes.
+  uint32_t row_bytes() const { return row_bytes_; }
+
+  // Returns the memory taken by the compressed rows, in bytes.
+  uint32_t compressed_size() const {
+    uint32_t size = 0;
+    for (int16_t y = 0; y < raw_height(); ++y) size += rows_[y].capacity;
+    return size;
+  }
+
+  ColorMode &color_mode() { return color_mode_; }
+  const ColorMode &color_mode() const { return color_mode_; }
+
+ private:
+  struct Row {
+    uint8_t *data;
+    uint16_t capacity;
+  };
+
+  // Maps the device (oriented) coordinates to the raw buffer coordinates.
+  void toRaw(int16_t &x, int16_t &y) {
+    int16_t *px = &x;
+    int16_t *py = &y;
+    orienter_.OrientPixels(px, py, 1);
+    int16_t raw_x = *px;
+    int16_t raw_y = *py;
+    x = raw_x;
+    y = raw_y;
+  }
+
+  // Returns the decompressed row y, to be modified.
+  uint8_t *loadRow(int16_t y) {
+    if (y != row_y_) {
+      flush();
+      Codec::Decode(rows_[y].data, row_bytes_, row_.get());
+      row_y_ = y;
+    }
+    row_dirty_ = true;
+    return row_.get();
+  }
+
+  // Compresses the scratch row into the storage of row y. The storage is
+  // reallocated when it is too small, or much too large.
+  void storeRow(int16_t y) {
+    uint32_t size = Codec::Encode(row_.get(), row_bytes_, encoded_.get());
+    Row &row = rows_[y];
+    if (size > row.capacity || size < row.capacity / 2) {
+      delete[] row.data;
+      row.data = new uint8_t[size];
+      row.capacity = size;
+    }
+    memcpy(row.data, encoded_.get(), size);
+  }
+
+  // Writes a run of pixels corresponding to a horizontal line in the device
+  // coordinates, starting at the specified raw coordinates. Depending on the
+  // orientation, the run goes left, right, up, or down in the buffer.
+  template <typename Writer>
+  void writeRun(Writer &write, int16_t x, int16_t y, uint32_t count) {
+    if (run_dx_ > 0) {
+      write(loadRow(y), x, count);
+    } else if (run_dx_ < 0) {
+      uint8_t *row = loadRow(y);
+      while (count-- > 0) write(row, x--);
+    } else {
+      while (count-- > 0) {
+        write(loadRow(y), x);
+        y += run_dy_;
+      }
+    }
+  }
+
+  template <typename Writer>
+  void writeToWindow(Writer &write, uint32_t count) {
+    while (count > 0) {
+      uint32_t n = window_.xMax() - cursor_x_ + 1;
+      if (n > count) n = count;
+      int16_t x = cursor_x_;
+      int16_t y = cursor_y_;
+      toRaw(x, y);
+      writeRun(write, x, y, n);
+      count -= n;
+      cursor_x_ += n;
+      if (cursor_x_ > window_.xMax()) {
+        cursor_x_ = window_.xMin();
+        ++cursor_y_;
+      }
+    }
+  }
+
+  template <typename Filler>
+  void fillRectsRaw(Filler &fill, int16_t *x0, int16_t *y0, int16_t *x1,
+                    int16_t *y1, uint16_t count) {
+    while (count-- > 0) {
+      for (int16_t y = *y0; y <= *y1; ++y) {
+        fill(loadRow(y), *x0, *x1 - *x0 + 1);
+      }
+      ++x0;
+      ++y0;
+      ++x1;
+      ++y1;
+    }
+  }
+
+  template <typename Op>
+  void applyToPixels(Op &op, int16_t *x, int16_t *y, uint16_t pixel_count) {
+    while (pixel_count-- > 0) {
+      op(loadRow(*y++), *x++);
+    }
+  }
+
+  void fillRectsAbsolute(BlendingMode mode, Color color, int16_t *x0,
+                         int16_t *y0, int16_t *x1, int16_t *y1,
+                         uint16_t count);
+
+  ColorMode color_mode_;
+  uint32_t row_bytes_;
+  std::unique_ptr<Row[]> rows_;
+
+  // The decompressed row, and the scratch buffer for its compression.
+  std::unique_ptr<uint8_t[]> row_;
+  std::unique_ptr<uint8_t[]> encoded_;
+  int16_t row_y_;
+  bool row_dirty_;
+
+  internal::Orienter orienter_;
+
+  // The address window, and the cursor, in the device coordinates.
+  Box window_;
+  int16_t cursor_x_;
+  int16_t cursor_y_;
+
+  // The direction in the buffer corresponding to the horizontal direction in
+  // the device coordinates.
+  int8_t run_dx_;
+  int8_t run_dy_;
+
+  BlendingMode blending_mode_;
+};
+
+// Stream of the pixels of a compressed offscreen, within the specified bounds
+// (in the raw buffer coordinates). Decompresses one row at a time.
+template <typename ColorMode, ColorPixelOrder pixel_order, ByteOrder byte_order>
+class CompressedPixelStream : public PixelStream {
+ public:
+  typedef CompressedOffscreenDevice<ColorMode, pixel_order, byte_order> Device;
+
+  CompressedPixelStream(const Device &device, const Box &bounds)
+      : device_(device),
+        bounds_(bounds),
+        row_(new uint8_t[device.row_bytes()]),
+        row_y_(-1),
+        x_(bounds.xMin()),
+        y_(bounds.yMin()) {}
+
+  void Read(Color *buf, uint16_t size) override {
+    internal::Reader<ColorMode, pixel_order, byte_order> read;
+    const ColorMode &color_mode = device_.color_mode();
+    while (size > 0) {
+      uint16_t n = run(size);
+      for (uint16_t i = 0; i < n; ++i) {
+        *buf++ = color_mode.toArgbColor(read(row_.get(), x_ + i));
+      }
+      advance(n);
+      size -= n;
+    }
+  }
+
+  void Skip(uint32_t count) override {
+    uint32_t width = bounds_.width();
+    uint32_t pos = (uint32_t)(y_ - bounds_.yMin()) * width + x_ -
+                   bounds_.xMin() + count;
+    x_ = bounds_.xMin() + pos % width;
+    y_ = bounds_.yMin() + pos / width;
+  }
+
+  RawPixelFormat rawFormat() const override {
+    return RawPixelFormatOf<ColorMode, byte_order>();
+  }
+
+  void ReadRaw(uint8_t *buf, uint16_t size) override {
+    const int8_t bytes_per_pixel = ColorTraits<ColorMode>::bytes_per_pixel;
+    while (size > 0) {
+      uint16_t n = run(size);
+      memcpy(buf, row_.get() + x_ * bytes_per_pixel, n * bytes_per_pixel);
+      buf += n * bytes_per_pixel;
+      advance(n);
+      size -= n;
+    }
+  }
+
+ private:
+  // Returns the number of pixels, up to max, remaining in the current row,
+  // making sure that the row is decompressed.
+  uint16_t run(uint16_t max) {
+    if (row_y_ != y_) {
+      device_.readRow(y_, row_.get());
+      row_y_ = y_;
+    }
+    uint16_t n = bounds_.xMax() - x_ + 1;
+    return n < max ? n : max;
+  }
+
+  void advance(uint16_t n) {
+    x_ += n;
+    if (x_ > bounds_.xMax()) {
+      x_ = bounds_.xMin();
+      ++y_;
+    }
+  }
+
+  const Device &device_;
+  Box bounds_;
+  std::unique_ptr<uint8_t[]> row_;
+  int16_t row_y_;
+  int16_t x_;
+  int16_t y_;
+};
+
+// Offscreen that keeps its content run-length encoded. Can be drawn to, using
+// the DrawingContext, and drawn as a Rasterizable. Useful for full-screen
+// buffering (e.g. flicker-free compositing, or alpha blending on panels that
+// can't be read from) when an uncompressed buffer would not fit in memory.
+//
+// CompressedOffscreen<Rgb565> offscreen(480, 320, color::White);
+// {
+//   DrawingContext dc(offscreen);
+//   dc.draw(...);
+// }
+// {
+//   DrawingContext dc(display);
+//   dc.draw(offscreen);
+// }
+template <typename ColorMode,
+          ColorPixelOrder pixel_order = COLOR_PIXEL_ORDER_MSB_FIRST,
+          ByteOrder byte_order = BYTE_ORDER_BIG_ENDIAN>
+class CompressedOffscreen : public Rasterizable {
+ public:
+  typedef CompressedOffscreenDevice<ColorMode, pixel_order, byte_order> Device;
+
+  // Creates an offscreen with specified geometry. The content is initialized to
+  // zero bits.
+  CompressedOffscreen(int16_t width, int16_t height,
+                      ColorMode color_mode = ColorMode())
+      : CompressedOffscreen(Box(0, 0, width - 1, height - 1), color_mode) {}
+
+  // Creates an offscreen with specified geometry. The content is initialized to
+  // zero bits.
+  CompressedOffscreen(Box extents, ColorMode color_mode = ColorMode())
+      : device_(extents.width(), extents.height(), color_mode),
+        extents_(extents),
+        anchor_extents_(extents) {}
+
+  // Creates an offscreen with specified geometry, pre-filled using the
+  // specified color.
+  CompressedOffscreen(int16_t width, int16_t height, Color fillColor,
+                      ColorMode color_mode = ColorMode())
+      : CompressedOffscreen(Box(0, 0, width - 1, height - 1), fillColor,
+                            color_mode) {}
+
+  // Creates an offscreen with specified geometry, pre-filled using the
+  // specified color.
+  CompressedOffscreen(Box extents, Color fillColor,
+                      ColorMode color_mode = ColorMode())
+      : CompressedOffscreen(extents, color_mode) {
+    device_.fillRect(0, 0, extents.width() - 1, extents.height() - 1,
+                     fillColor);
+    device_.flush();
+  }
+
+  Box extents() const override { return extents_; }
+  Box anchorExtents() const override { return anchor_extents_; }
+
+  void setAnchorExtents(Box anchor_extents) {
+    anchor_extents_ = anchor_extents;
+  }
+
+  TransparencyMode getTransparencyMode() const override {
+    return device_.color_mode().transparency();
+  }
+
+  void readColors(const int16_t *x, const int16_t *y, uint32_t count,
+                  Color *result) const override {
+    internal::Reader<ColorMode, pixel_order, byte_order> read;
+    const ColorMode &color_mode = device_.color_mode();
+    std::unique_ptr<uint8_t[]> row(new uint8_t[device_.row_bytes()]);
+    int16_t row_y = -1;
+    while (count-- > 0) {
+      int16_t ry = *y++ - extents_.yMin();
+      if (ry != row_y) {
+        device_.readRow(ry, row.get());
+        row_y = ry;
+      }
+      *result++ =
+          color_mode.toArgbColor(read(row.get(), *x++ - extents_.xMin()));
+    }
+  }
+
+  std::unique_ptr<PixelStream> createStream() const override {
+    return createStream(extents_);
+  }
+
+  std::unique_ptr<PixelStream> createStream(const Box &bounds) const override {
+    return std::unique_ptr<PixelStream>(
+        new CompressedPixelStream<ColorMode, pixel_order, byte_order>(
+            device_, bounds.translate(-extents_.xMin(), -extents_.yMin())));
+  }
+
+  const Device &output() const { return device_; }
+  Device &output() { return device_; }
+
+  // Returns the memory taken by the compressed content, in bytes.
+  uint32_t compressed_size() const { return device_.compressed_size(); }
+
+ private:
+  friend class DrawingContext;
+
+  // Streams the content, so that it can use the raw path when the target
+  // accepts it.
+  void drawTo(const Surface &s) const override {
+    Box bounds =
+        Box::Intersect(s.clip_box().translate(-s.dx(), -s.dy()), extents_);
+    if (bounds.empty()) return;
+    std::unique_ptr<PixelStream> stream = createStream(bounds);
+    internal::FillRectFromStream(s.out(), bounds.translate(s.dx(), s.dy()),
+                                 stream.get(), s.bgcolor(), s.fill_mode(),
+                                 s.blending_mode(), getTransparencyMode());
+  }
+
+  // For DrawingContext.
+  void nest() {}
+  void unnest() { device_.flush(); }
+  Color getBackgroundColor() const { return color::Transparent; }
+  const Rasterizable *getRasterizableBackground() const { return nullptr; }
+  DamageTracker *damage_tracker() const { return nullptr; }
+  int16_t dx() const { return -extents_.xMin(); }
+  int16_t dy() const { return -extents_.yMin(); }
+  bool is_write_once() const { return false; }
+
+  Device device_;
+  Box extents_;
+  Box anchor_extents_;
+};
+
+// Implementation details follow.
+
+template <typename ColorMode, ColorPixelOrder pixel_order, ByteOrder byte_order>
+CompressedOffscreenDevice<ColorMode, pixel_order, byte_order>::
+    CompressedOffscreenDevice(int16_t width, int16_t height,
+                              ColorMode color_mode)
+    : DisplayDevice(width, height),
+      color_mode_(color_mode),
+      row_bytes_(((uint32_t)width * ColorMode::bits_per_pixel + 7) / 8),
+      rows_(new Row[height]),
+      row_(new uint8_t[row_bytes_]),
+      encoded_(new uint8_t[Codec::MaxEncodedSize(row_bytes_)]),
+      row_y_(-1),
+      row_dirty_(false),
+      orienter_(width, height, Orientation::Default()),
+      window_(0, 0, -1, -1),
+      cursor_x_(0),
+      cursor_y_(0),
+      run_dx_(1),
+      run_dy_(0),
+      blending_mode_(BLENDING_MODE_SOURCE) {
+  assert(Codec::MaxEncodedSize(row_bytes_) <= 0xFFFF);
+  memset(row_.get(), 0, row_bytes_);
+  for (int16_t y = 0; y < height; ++y) {
+    rows_[y].data = nullptr;
+    rows_[y].capacity = 0;
+    storeRow(y);
+  }
+}
+
+template <typename ColorMode, ColorPixelOrder pixel_order, ByteOrder byte_order>
+CompressedOffscreenDevice<ColorMode, pixel_order,
+                          byte_order>::~CompressedOffscreenDevice() {
+  for (int16_t y = 0; y < raw_height(); ++y) delete[] rows_[y].data;
+}
+
+template <typename ColorMode, ColorPixelOrder pixel_order, ByteOrder byte_order>
+void CompressedOffscreenDevice<ColorMode, pixel_order,
+                               byte_order>::orientationUpdated() {
+  Orientation o = orientation();
+  orienter_.setOrientation(o);
+  if (!o.isXYswapped()) {
+    run_dx_ = o.isRightToLeft() ? -1 : 1;
+    run_dy_ = 0;
+  } else {
+    run_dx_ = 0;
+    run_dy_ = o.isBottomToTop() ? -1 : 1;
+  }
+}
+
+template <typename ColorMode, ColorPixelOrder pixel_order, ByteOrder byte_order>
+void CompressedOffscreenDevice<ColorMode, pixel_order, byte_order>::setAddress(
+    uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1,
+    BlendingMode blending_mode) {
+  window_ = Box(x0, y0, x1, y1);
+  cursor_x_ = x0;
+  cursor_y_ = y0;
+  if (blending_mode != BLENDING_MODE_SOURCE) {
+    blending_mode = internal::ResolveBlendingModeForWrite(
+        blending_mode, color_mode_.transparency());
+  }
+  blending_mode_ = blending_mode;
+}
+
+template <typename ColorMode, ColorPixelOrder pixel_order, ByteOrder byte_order>
+void CompressedOffscreenDevice<ColorMode, pixel_order, byte_order>::write(
+    Color *color, uint32_t pixel_count) {
+  if (blending_mode_ == BLENDING_MODE_SOURCE) {
+    typename internal::BlendingWriter<ColorMode, pixel_order, byte_order>::
+        template Operator<BLENDING_MODE_SOURCE>
+            writer(color_mode_, color);
+    writeToWindow(writer, pixel_count);
+  } else if (blending_mode_ == BLENDING_MODE_DESTINATION) {
+    return;
+  } else if (blending_mode_ == BLENDING_MODE_SOURCE_OVER_OPAQUE) {
+    typename internal::BlendingWriter<ColorMode, pixel_order, byte_order>::
+        template Operator<BLENDING_MODE_SOURCE_OVER_OPAQUE>
+            writer(color_mode_, color);
+    writeToWindow(writer, pixel_count);
+  } else if (blending_mode_ == BLENDING_MODE_SOURCE_OVER) {
+    typename internal::BlendingWriter<ColorMode, pixel_order, byte_order>::
+        template Operator<BLENDING_MODE_SOURCE_OVER>
+            writer(color_mode_, color);
+    writeToWindow(writer, pixel_count);
+  } else {
+    internal::GenericWriter<ColorMode, pixel_order, byte_order> writer(
+        color_mode_, blending_mode_, color);
+    writeToWindow(writer, pixel_count);
+  }
+}
+
+template <typename ColorMode, ColorPixelOrder pixel_order, ByteOrder byte_order>
+void CompressedOffscreenDevice<ColorMode, pixel_order, byte_order>::writeRaw(
+    const uint8_t *data, uint32_t pixel_count) {
+  internal::RawDataWriter<ColorTraits<ColorMode>::bytes_per_pixel> writer(
+      data);
+  writeToWindow(writer, pixel_count);
+}
+
+template <typename ColorMode, ColorPixelOrder pixel_order, ByteOrder byte_order>
+void CompressedOffscreenDevice<ColorMode, pixel_order, byte_order>::writePixels(
+    BlendingMode blending_mode, Color *color, int16_t *x, int16_t *y,
+    uint16_t pixel_count) {
+  orienter_.OrientPixels(x, y, pixel_count);
+  if (blending_mode != BLENDING_MODE_SOURCE) {
+    blending_mode = internal::ResolveBlendingModeForWrite(
+        blending_mode, color_mode_.transparency());
+    if (blending_mode == BLENDING_MODE_DESTINATION) return;
+  }
+  if (blending_mode == BLENDING_MODE_SOURCE) {
+    typename internal::BlendingWriter<ColorMode, pixel_order, byte_order>::
+        template Operator<BLENDING_MODE_SOURCE>
+            write(color_mode_, color);
+    applyToPixels(write, x, y, pixel_count);
+  } else if (blending_mode == BLENDING_MODE_SOURCE_OVER_OPAQUE) {
+    typename internal::BlendingWriter<ColorMode, pixel_order, byte_order>::
+        template Operator<BLENDING_MODE_SOURCE_OVER_OPAQUE>
+            write(color_mode_, color);
+    applyToPixels(write, x, y, pixel_count);
+  } else if (blending_mode == BLENDING_MODE_SOURCE_OVER) {
+    typename internal::BlendingWriter<ColorMode, pixel_order, byte_order>::
+        template Operator<BLENDING_MODE_SOURCE_OVER>
+            write(color_mode_, color);
+    applyToPixels(write, x, y, pixel_count);
+  } else {
+    internal::GenericWriter<ColorMode, pixel_order, byte_order> write(
+        color_mode_, blending_mode, color);
+    applyToPixels(write, x, y, pixel_count);
+  }
+}
+
+template <typename ColorMode, ColorPixelOrder pixel_order, ByteOrder byte_order>
+void CompressedOffscreenDevice<ColorMode, pixel_order, byte_order>::fillPixels(
+    BlendingMode blending_mode, Color color, int16_t *x, int16_t *y,
+    uint16_t pixel_count) {
+  orienter_.OrientPixels(x, y, pixel_count);
+  if (blending_mode != BLENDING_MODE_SOURCE) {
+    blending_mode = internal::ResolveBlendingModeForFill(
+        blending_mode, color_mode_.transparency(), color);
+    if (blending_mode == BLENDING_MODE_DESTINATION) return;
+  }
+  if (blending_mode == BLENDING_MODE_SOURCE) {
+    typename internal::BlendingFiller<ColorMode, pixel_order, byte_order>::
+        template Operator<BLENDING_MODE_SOURCE>
+            fill(color_mode_, color);
+    applyToPixels(fill, x, y, pixel_count);
+  } else if (blending_mode == BLENDING_MODE_SOURCE_OVER_OPAQUE) {
+    typename internal::BlendingFiller<ColorMode, pixel_order, byte_order>::
+        template Operator<BLENDING_MODE_SOURCE_OVER_OPAQUE>
+            fill(color_mode_, color);
+    applyToPixels(fill, x, y, pixel_count);
+  } else if (blending_mode == BLENDING_MODE_SOURCE_OVER) {
+    typename internal::BlendingFiller<ColorMode, pixel_order, byte_order>::
+        template Operator<BLENDING_MODE_SOURCE_OVER>
+            fill(color_mode_, color);
+    applyToPixels(fill, x, y, pixel_count);
+  } else {
+    internal::GenericFiller<ColorMode, pixel_order, byte_order> fill(
+        color_mode_, blending_mode, color);
+    applyToPixels(fill, x, y, pixel_count);
+  }
+}
+
+template <typename ColorMode, ColorPixelOrder pixel_order, ByteOrder byte_order>
+void CompressedOffscreenDevice<ColorMode, pixel_order, byte_order>::writeRects(
+    BlendingMode blending_mode, Color *color, int16_t *x0, int16_t *y0,
+    int16_t *x1, int16_t *y1, uint16_t count) {
+  orienter_.OrientRects(x0, y0, x1, y1, count);
+  while (count-- > 0) {
+    BlendingMode mode = blending_mode;
+    if (mode != BLENDING_MODE_SOURCE) {
+      mode = internal::ResolveBlendingModeForFill(
+          mode, color_mode_.transparency(), *color);
+    }
+    if (mode != BLENDING_MODE_DESTINATION) {
+      fillRectsAbsolute(mode, *color, x0, y0, x1, y1, 1);
+    }
+    ++color;
+    ++x0;
+    ++y0;
+    ++x1;
+    ++y1;
+  }
+}
+
+template <typename ColorMode, ColorPixelOrder pixel_order, ByteOrder byte_order>
+void CompressedOffscreenDevice<ColorMode, pixel_order, byte_order>::fillRects(
+    BlendingMode blending_mode, Color color, int16_t *x0, int16_t *y0,
+    int16_t *x1, int16_t *y1, uint16_t count) {
+  orienter_.OrientRects(x0, y0, x1, y1, count);
+  if (blending_mode != BLENDING_MODE_SOURCE) {
+    blending_mode = internal::ResolveBlendingModeForFill(
+        blending_mode, color_mode_.transparency(), color);
+    if (blending_mode == BLENDING_MODE_DESTINATION) return;
+  }
+  fillRectsAbsolute(blending_mode, color, x0, y0, x1, y1, count);
+}
+
+template <typename ColorMode, ColorPixelOrder pixel_order, ByteOrder byte_order>
+void CompressedOffscreenDevice<ColorMode, pixel_order, byte_order>::writeSpans(
+    BlendingMode blending_mode, Color *color, int16_t *x0, int16_t *y,
+    int16_t *x1, uint16_t count) {
+  while (count-- > 0) {
+    setAddress(*x0, *y, *x1, *y, blending_mode);
+    uint32_t n = *x1++ - *x0++ + 1;
+    ++y;
+    write(color, n);
+    color += n;
+  }
+}
+
+template <typename ColorMode, ColorPixelOrder pixel_order, ByteOrder byte_order>
+void CompressedOffscreenDevice<ColorMode, pixel_order, byte_order>::
+    fillRectsAbsolute(BlendingMode blending_mode, Color color, int16_t *x0,
+                      int16_t *y0, int16_t *x1, int16_t *y1, uint16_t count) {
+  if (blending_mode == BLENDING_MODE_SOURCE) {
+    typename internal::BlendingFiller<ColorMode, pixel_order, byte_order>::
+        template Operator<BLENDING_MODE_SOURCE>
+            fill(color_mode_, color);
+    fillRectsRaw(fill, x0, y0, x1, y1, count);
+  } else if (blending_mode == BLENDING_MODE_SOURCE_OVER_OPAQUE) {
+    typename internal::BlendingFiller<ColorMode, pixel_order, byte_order>::
+        template Operator<BLENDING_MODE_SOURCE_OVER_OPAQUE>
+            fill(color_mode_, color);
+    fillRectsRaw(fill, x0, y0, x1, y1, count);
+  } else if (blending_mode == BLENDING_MODE_SOURCE_OVER) {
+    typename internal::BlendingFiller<ColorMode, pixel_order, byte_order>::
+        template Operator<BLENDING_MODE_SOURCE_OVER>
+            fill(color_mode_, color);
+    fillRectsRaw(fill, x0, y0, x1, y1, count);
+  } else {
+    internal::GenericFiller<ColorMode, pixel_order, byte_order> fill(
+        color_mode_, blending_mode, color);
+    fillRectsRaw(fill, x0, y0, x1, y1, count);
+  }
+}
+
+}  // namespace roo_display
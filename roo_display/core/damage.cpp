@@ -0,0 +1,71 @@
+#include "roo_display/core/damage.h"
+
+namespace roo_display {
+
+void DamageTracker::add(const Box& box) {
+  if (box.empty()) return;
+  Box merged = box;
+  // Absorb all the rectangles that overlap with the new one. Since absorbing
+  // grows the new rectangle, we need to repeat until nothing changes.
+  bool changed;
+  do {
+    changed = false;
+    int i = 0;
+    while (i < count_) {
+      if (rects_[i].contains(merged)) return;
+      if (rects_[i].intersects(merged)) {
+        merged = Box::Extent(merged, rects_[i]);
+        remove(i);
+        changed = true;
+      } else {
+        ++i;
+      }
+    }
+  } while (changed);
+  if (count_ < kMaxRects) {
+    rects_[count_++] = merged;
+    return;
+  }
+  // Out of capacity. Merge with the rectangle that results in the smallest
+  // growth of the damaged area.
+  int best = 0;
+  int32_t best_growth = INT32_MAX;
+  for (int i = 0; i < count_; ++i) {
+    int32_t growth =
+        Box::Extent(merged, rects_[i]).area() - rects_[i].area();
+    if (growth < best_growth) {
+      best = i;
+      best_growth = growth;
+    }
+  }
+  merged = Box::Extent(merged, rects_[best]);
+  remove(best);
+  // The merged rectangle may now overlap with some other ones.
+  add(merged);
+}
+
+bool DamageTracker::intersects(const Box& box) const {
+  for (int i = 0; i < count_; ++i) {
+    if (rects_[i].intersects(box)) return true;
+  }
+  return false;
+}
+
+Box DamageTracker::bounds() const {
+  if (count_ == 0) return Box(0, 0, -1, -1);
+  Box result = rects_[0];
+  for (int i = 1; i < count_; ++i) {
+    result = Box::Extent(result, rects_[i]);
+  }
+  return result;
+}
+
+int32_t DamageTracker::area() const {
+  int32_t result = 0;
+  for (int i = 0; i < count_; ++i) {
+    result += rects_[i].area();
+  }
+  return result;
+}
+
+}  // namespace roo_display
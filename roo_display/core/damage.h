@@ -0,0 +1,68 @@
+#pragma once
+
+#include <inttypes.h>
+
+#include "roo_display/core/box.h"
+
+namespace roo_display {
+
+// Keeps track of the regions of a display that have been modified ('damaged')
+// since the last call to clear(). The damage is represented as a bounded list
+// of rectangles. Overlapping rectangles get merged into their bounding box.
+// When the list is full, the new rectangle gets merged with the one whose
+// bounding box grows the least as a result. The tracked region is thus always
+// a superset of the actual damage, but may overestimate it.
+//
+// Typical use: register the tracker with the Display (via
+// Display::setDamageTracker()), so that DrawingContext::draw() reports the
+// clipped extents of every drawn object. Then, use isDirty() or intersects()
+// to decide whether a frame needs to be refreshed at all, and iterate over
+// the rectangles to push only the damaged regions.
+class DamageTracker {
+ public:
+  static constexpr int kMaxRects = 8;
+
+  DamageTracker() : count_(0) {}
+
+  // Marks the specified rectangle as damaged.
+  void add(const Box& box);
+
+  // Convenience shortcut.
+  void add(int16_t x0, int16_t y0, int16_t x1, int16_t y1) {
+    add(Box(x0, y0, x1, y1));
+  }
+
+  // Forgets all the damage.
+  void clear() { count_ = 0; }
+
+  // Returns true if anything has been damaged since the last clear().
+  bool isDirty() const { return count_ > 0; }
+
+  // Returns true if any of the damaged rectangles intersects the specified
+  // box.
+  bool intersects(const Box& box) const;
+
+  // Returns the bounding box of all the damaged rectangles. Returns an empty
+  // box if nothing is damaged.
+  Box bounds() const;
+
+  // Returns the sum of the areas of the damaged rectangles. (Since the
+  // rectangles are disjoint, it is the total damaged area.)
+  int32_t area() const;
+
+  // Number of the (non-overlapping) damaged rectangles.
+  int size() const { return count_; }
+
+  const Box& operator[](int idx) const { return rects_[idx]; }
+
+  const Box* begin() const { return rects_; }
+  const Box* end() const { return rects_ + count_; }
+
+ private:
+  void remove(int idx) { rects_[idx] = rects_[--count_]; }
+
+  Box rects_[kMaxRects];
+  int count_;
+};
+
+}  // namespace roo_display
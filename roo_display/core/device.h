@@ -4,6 +4,7 @@
 
 #include "roo_display/color/blending.h"
 #include "roo_display/color/color.h"
+#include "roo_display/color/raw_pixel_format.h"
 #include "roo_display/core/box.h"
 #include "roo_display/core/orientation.h"
 
@@ -44,6 +45,19 @@ class DisplayOutput {
   // is undefined.
   virtual void write(Color *color, uint32_t pixel_count) = 0;
 
+  // Returns true if the output can take pixels in the specified raw format
+  // via writeRaw(), bypassing the conversion to and from Color. The default
+  // implementation returns false. Outputs that do return true must produce
+  // the same result as if the pixels were converted to Color and written
+  // using BLENDING_MODE_SOURCE.
+  virtual bool acceptsRaw(const RawPixelFormat &format) const { return false; }
+
+  // Writes raw pixels to the subsequent pixels in the address window. The
+  // address must have been set using setAddress, with BLENDING_MODE_SOURCE,
+  // and the format of the data must have been accepted by acceptsRaw().
+  // Otherwise, the behavior is undefined.
+  virtual void writeRaw(const uint8_t *data, uint32_t pixel_count) {}
+
   // virtual void fill(Color color, uint32_t pixel_count) = 0;
 
   // Draws the specified pixels. Invalidates the address window.
@@ -66,6 +80,39 @@ class DisplayOutput {
                          int16_t *y0, int16_t *x1, int16_t *y1,
                          uint16_t count) = 0;
 
+  // Draws the specified horizontal spans. The i-th span covers the pixels from
+  // (x0[i], y[i]) to (x1[i], y[i]), inclusive. The `color` array contains the
+  // colors of the subsequent pixels of all the spans, i.e. the first
+  // (x1[0] - x0[0] + 1) colors belong to the first span, and so on. The
+  // implementation may modify the contents of the arrays. Invalidates the
+  // address window.
+  //
+  // The default implementation writes each span using setAddress() and
+  // write(). Devices and filters that can handle horizontal runs more
+  // efficiently should override it.
+  virtual void writeSpans(BlendingMode blending_mode, Color *color,
+                          int16_t *x0, int16_t *y, int16_t *x1,
+                          uint16_t count) {
+    while (count-- > 0) {
+      uint32_t pixel_count = *x1 - *x0 + 1;
+      setAddress(*x0++, *y, *x1++, *y, blending_mode);
+      ++y;
+      write(color, pixel_count);
+      color += pixel_count;
+    }
+  }
+
+  // Draws the specified horizontal spans, using the same color. The i-th span
+  // covers the pixels from (x0[i], y[i]) to (x1[i], y[i]), inclusive. The
+  // implementation may modify the contents of the arrays. Invalidates the
+  // address window.
+  //
+  // The default implementation delegates to fillRects().
+  virtual void fillSpans(BlendingMode blending_mode, Color color, int16_t *x0,
+                         int16_t *y, int16_t *x1, uint16_t count) {
+    fillRects(blending_mode, color, x0, y, x1, y, count);
+  }
+
   // Convenience method to fill a single rectangle. Invalidates the address
   // window.
   inline void fillRect(BlendingMode blending_mode, const Box &rect,
@@ -6,6 +6,7 @@
 
 namespace roo_display {
 
+class DamageTracker;
 class DisplayOutput;
 class Drawable;
 
@@ -174,6 +175,7 @@ class Surface {
   void unnest() const {}
   const Rasterizable *getRasterizableBackground() const { return nullptr; }
   Color getBackgroundColor() const { return bgcolor_; }
+  DamageTracker *damage_tracker() const { return nullptr; }
 
   DisplayOutput *out_;
   int16_t dx_;
@@ -2,8 +2,13 @@
 
 // Support for drawing to in-memory buffers, using various color modes.
 
+#include <type_traits>
+
+#include "roo_display/color/blending_kernels.h"
 #include "roo_display/color/color.h"
+#include "roo_display/color/color_modes.h"
 #include "roo_display/core/raster.h"
+#include "roo_display/internal/bitcopy.h"
 #include "roo_display/internal/byte_order.h"
 #include "roo_display/internal/memfill.h"
 
@@ -63,8 +68,8 @@ class AddressWindow {
 
   const uint32_t offset() const { return offset_; }
   Orientation orientation() const { return orientation_; }
-  int16_t advance_x() const { return advance_x_; }
-  int16_t advance_y() const { return advance_y_; }
+  int32_t advance_x() const { return advance_x_; }
+  int32_t advance_y() const { return advance_y_; }
 
   void advance();
   void advance(uint32_t count);
@@ -79,7 +84,7 @@ class AddressWindow {
   Orientation orientation_;
   uint32_t offset_;
   uint16_t x0_, x1_, y0_, y1_;
-  int16_t advance_x_, advance_y_;
+  int32_t advance_x_, advance_y_;
   uint16_t cursor_x_, cursor_y_;
 };
 
@@ -151,6 +156,12 @@ class OffscreenDevice : public DisplayDevice {
 
   void write(Color *color, uint32_t pixel_count) override;
 
+  bool acceptsRaw(const RawPixelFormat &format) const override {
+    return format == RawPixelFormatOf<ColorMode, byte_order>();
+  }
+
+  void writeRaw(const uint8_t *data, uint32_t pixel_count) override;
+
   void writePixels(BlendingMode mode, Color *color, int16_t *x, int16_t *y,
                    uint16_t pixel_count) override;
 
@@ -163,6 +174,20 @@ class OffscreenDevice : public DisplayDevice {
   void fillRects(BlendingMode mode, Color color, int16_t *x0, int16_t *y0,
                  int16_t *x1, int16_t *y1, uint16_t count) override;
 
+  void writeSpans(BlendingMode mode, Color *color, int16_t *x0, int16_t *y,
+                  int16_t *x1, uint16_t count) override;
+
+  void fillSpans(BlendingMode mode, Color color, int16_t *x0, int16_t *y,
+                 int16_t *x1, uint16_t count) override;
+
+  // Copies the pixels of the src rectangle so that its top-left corner lands
+  // at (dst_x, dst_y), with memmove semantics: the source and the destination
+  // may overlap, which makes it suitable for in-place scrolling. Coordinates
+  // are in the device (oriented) space, and the rectangle is clipped to the
+  // device bounds. Raw pixel values are copied verbatim, so that it works in
+  // all color modes, including sub-byte ones.
+  void copyRect(const Box &src, int16_t dst_x, int16_t dst_y);
+
   ColorMode &color_mode() { return color_mode_; }
   const ColorMode &color_mode() const { return color_mode_; }
 
@@ -215,6 +240,29 @@ class OffscreenDevice : public DisplayDevice {
     }
   }
 
+  // Writes the spans, specified in the device (oriented) coordinates. In the
+  // default orientation, each span is a contiguous run in the buffer, and it
+  // is written in bulk. Otherwise, the address window is used to step through
+  // the pixels.
+  template <typename Writer>
+  void writeSpansImpl(Writer &write, int16_t *x0, int16_t *y, int16_t *x1,
+                      uint16_t count) {
+    if (orienter_.orientation() == Orientation::Default()) {
+      int16_t w = raw_width();
+      while (count-- > 0) {
+        uint32_t n = *x1++ - *x0 + 1;
+        write(buffer_, *x0++ + *y++ * w, n);
+      }
+    } else {
+      while (count-- > 0) {
+        window_.setAddress(*x0, *y, *x1, *y, raw_width(), raw_height(),
+                           orienter_.orientation());
+        writeToWindow(write, *x1++ - *x0++ + 1);
+        ++y;
+      }
+    }
+  }
+
   void fillRectsAbsolute(BlendingMode mode, Color color, int16_t *x0,
                          int16_t *y0, int16_t *x1, int16_t *y1, uint16_t count);
 
@@ -336,6 +384,11 @@ class Offscreen : public Rasterizable {
     return raster().readColors(x, y, count, result);
   }
 
+  void readColorRow(int16_t y, int16_t x0, int16_t x1,
+                    Color *result) const override {
+    raster().readColorRow(y, x0, x1, result);
+  }
+
   const OffscreenDevice<ColorMode, pixel_order, byte_order, pixels_per_byte,
                         storage_type> &
   output() const {
@@ -368,6 +421,7 @@ class Offscreen : public Rasterizable {
   void unnest() const {}
   Color getBackgroundColor() const { return color::Transparent; }
   const Rasterizable *getRasterizableBackground() const { return nullptr; }
+  DamageTracker *damage_tracker() const { return nullptr; }
   int16_t dx() const { return -raster_.extents().xMin(); }
   int16_t dy() const { return -raster_.extents().yMin(); }
   bool is_write_once() const { return false; }
@@ -423,6 +477,50 @@ class BitMaskOffscreen : public Offscreen<Monochrome> {
   BitMaskOffscreen(Box extents, Color fillColor);
 };
 
+// Copies the src_rect region of the source offscreen (specified in the
+// coordinates of the offscreen) to the output, so that the top-left corner of
+// the region lands at (dx, dy). The region is clipped to the extents of the
+// offscreen. The caller must ensure that the target rectangle fits within the
+// output.
+//
+// If no blending is needed (i.e. blending_mode is BLENDING_MODE_SOURCE, or the
+// source is opaque), and the output accepts the raw format of the source (see
+// DisplayOutput::acceptsRaw()), the rows are copied verbatim. Otherwise, the
+// pixels are converted in bulk, and written using a single address window.
+template <typename ColorMode, ColorPixelOrder pixel_order, ByteOrder byte_order,
+          int8_t pixels_per_byte, typename storage_type>
+void Blit(const Offscreen<ColorMode, pixel_order, byte_order, pixels_per_byte,
+                          storage_type> &src,
+          Box src_rect, DisplayOutput &dst, int16_t dx, int16_t dy,
+          BlendingMode blending_mode = BLENDING_MODE_SOURCE_OVER);
+
+// Copies the src_rect region of the source offscreen to the destination
+// offscreen, so that the top-left corner of the region lands at (dx, dy). Both
+// are specified in the coordinates of the respective offscreens. The region is
+// clipped to the extents of both offscreens.
+//
+// If both offscreens use the same color mode, pixel order, and byte order, the
+// destination has the default orientation, and no blending is needed, the raw
+// pixels are copied row by row, using memmove, or, in sub-byte color modes,
+// using bit_copy. In this case, the source and the destination can be the same
+// offscreen, and the regions can overlap (e.g. when scrolling). Note that the
+// raw values are copied as-is; the parameters of the color modes (e.g. the
+// color of Alpha4, or the palette of Indexed) are assumed to be the same.
+//
+// Otherwise, the region is blitted to the destination's output, as above.
+template <typename SrcColorMode, ColorPixelOrder src_pixel_order,
+          ByteOrder src_byte_order, int8_t src_pixels_per_byte,
+          typename src_storage_type, typename DstColorMode,
+          ColorPixelOrder dst_pixel_order, ByteOrder dst_byte_order,
+          int8_t dst_pixels_per_byte, typename dst_storage_type>
+void Blit(const Offscreen<SrcColorMode, src_pixel_order, src_byte_order,
+                          src_pixels_per_byte, src_storage_type> &src,
+          Box src_rect,
+          Offscreen<DstColorMode, dst_pixel_order, dst_byte_order,
+                    dst_pixels_per_byte, dst_storage_type> &dst,
+          int16_t dx, int16_t dy,
+          BlendingMode blending_mode = BLENDING_MODE_SOURCE_OVER);
+
 // Implementation details follow.
 
 // Writer template contract specifies how to write pixel, or a sequence of
@@ -509,6 +607,105 @@ class RawIterator<24, BYTE_ORDER_LITTLE_ENDIAN> {
   uint8_t *ptr_;
 };
 
+// Blends a sequence of colors (write), or a single color (fill), into a
+// contiguous run of 'count' pixels, starting at the specified pixel offset.
+// Used by writers and fillers for color modes in which a pixel takes up at
+// least 1 byte. The generic implementation goes pixel by pixel; the
+// specializations below delegate the most common cases to the vectorized
+// kernels (see blending_kernels.h).
+template <typename ColorMode, ByteOrder byte_order, BlendingMode blending_mode>
+struct BulkBlender {
+  void write(const ColorMode &color_mode, uint8_t *p, uint32_t offset,
+             const Color *color, uint32_t count) const {
+    internal::RawIterator<ColorMode::bits_per_pixel, byte_order> itr(p, offset);
+    RawBlender<ColorMode, blending_mode> blender;
+    while (count-- > 0) {
+      itr.write(blender(itr.read(), *color++, color_mode));
+      ++itr;
+    }
+  }
+
+  void fill(const ColorMode &color_mode, uint8_t *p, uint32_t offset,
+            Color color, uint32_t count) const {
+    internal::RawIterator<ColorMode::bits_per_pixel, byte_order> itr(p, offset);
+    RawBlender<ColorMode, blending_mode> blender;
+    while (count-- > 0) {
+      itr.write(blender(itr.read(), color, color_mode));
+      ++itr;
+    }
+  }
+};
+
+template <ByteOrder byte_order>
+struct BulkBlender<Rgb565, byte_order, BLENDING_MODE_SOURCE> {
+  void write(const Rgb565 &color_mode, uint8_t *p, uint32_t offset,
+             const Color *color, uint32_t count) const {
+    Rgb565WriteSource((uint16_t *)p + offset, color, count,
+                      byte_order != BYTE_ORDER_NATIVE);
+  }
+};
+
+// Rgb565 is opaque, so BLENDING_MODE_SOURCE_OVER is the same as
+// BLENDING_MODE_SOURCE_OVER_OPAQUE.
+template <ByteOrder byte_order>
+struct BulkBlender<Rgb565, byte_order, BLENDING_MODE_SOURCE_OVER_OPAQUE> {
+  void write(const Rgb565 &color_mode, uint8_t *p, uint32_t offset,
+             const Color *color, uint32_t count) const {
+    Rgb565WriteSourceOverOpaque((uint16_t *)p + offset, color, count,
+                                byte_order != BYTE_ORDER_NATIVE);
+  }
+
+  void fill(const Rgb565 &color_mode, uint8_t *p, uint32_t offset, Color color,
+            uint32_t count) const {
+    Rgb565FillSourceOverOpaque((uint16_t *)p + offset, color, count,
+                               byte_order != BYTE_ORDER_NATIVE);
+  }
+};
+
+template <ByteOrder byte_order>
+struct BulkBlender<Rgb565, byte_order, BLENDING_MODE_SOURCE_OVER>
+    : public BulkBlender<Rgb565, byte_order,
+                         BLENDING_MODE_SOURCE_OVER_OPAQUE> {};
+
+template <ByteOrder byte_order>
+struct BulkBlender<Argb8888, byte_order, BLENDING_MODE_SOURCE> {
+  void write(const Argb8888 &color_mode, uint8_t *p, uint32_t offset,
+             const Color *color, uint32_t count) const {
+    Argb8888WriteSource((uint32_t *)p + offset, color, count,
+                        byte_order != BYTE_ORDER_NATIVE);
+  }
+};
+
+template <ByteOrder byte_order>
+struct BulkBlender<Argb8888, byte_order, BLENDING_MODE_SOURCE_OVER_OPAQUE> {
+  void write(const Argb8888 &color_mode, uint8_t *p, uint32_t offset,
+             const Color *color, uint32_t count) const {
+    Argb8888WriteSourceOverOpaque((uint32_t *)p + offset, color, count,
+                                  byte_order != BYTE_ORDER_NATIVE);
+  }
+
+  void fill(const Argb8888 &color_mode, uint8_t *p, uint32_t offset,
+            Color color, uint32_t count) const {
+    Argb8888FillSourceOverOpaque((uint32_t *)p + offset, color, count,
+                                 byte_order != BYTE_ORDER_NATIVE);
+  }
+};
+
+template <ByteOrder byte_order>
+struct BulkBlender<Argb8888, byte_order, BLENDING_MODE_SOURCE_OVER> {
+  void write(const Argb8888 &color_mode, uint8_t *p, uint32_t offset,
+             const Color *color, uint32_t count) const {
+    Argb8888WriteSourceOver((uint32_t *)p + offset, color, count,
+                            byte_order != BYTE_ORDER_NATIVE);
+  }
+
+  void fill(const Argb8888 &color_mode, uint8_t *p, uint32_t offset,
+            Color color, uint32_t count) const {
+    Argb8888FillSourceOver((uint32_t *)p + offset, color, count,
+                           byte_order != BYTE_ORDER_NATIVE);
+  }
+};
+
 // For sub-byte color modes.
 template <typename ColorMode, ColorPixelOrder pixel_order, ByteOrder byte_order,
           BlendingMode blending_mode,
@@ -566,12 +763,9 @@ class BlendingWriterOperator<ColorMode, pixel_order, byte_order, blending_mode,
   }
 
   void operator()(uint8_t *p, uint32_t offset, uint32_t count) {
-    internal::RawIterator<ColorMode::bits_per_pixel, byte_order> itr(p, offset);
-    RawBlender<ColorMode, blending_mode> blender;
-    while (count-- > 0) {
-      itr.write(blender(itr.read(), *color_++, color_mode_));
-      ++itr;
-    }
+    BulkBlender<ColorMode, byte_order, blending_mode>().write(
+        color_mode_, p, offset, color_, count);
+    color_ += count;
   }
 
  private:
@@ -720,7 +914,8 @@ class GenericWriter<ColorMode, pixel_order, byte_order, 1, storage_type> {
   void operator()(uint8_t *p, uint32_t offset, uint32_t count) {
     internal::RawIterator<ColorMode::bits_per_pixel, byte_order> itr(p, offset);
     while (count-- > 0) {
-      itr.write(ApplyRawBlending(blending_mode_, itr.read(), *color_++));
+      itr.write(ApplyRawBlending(blending_mode_, itr.read(), *color_++,
+                                 color_mode_));
       ++itr;
     }
   }
@@ -731,6 +926,26 @@ class GenericWriter<ColorMode, pixel_order, byte_order, 1, storage_type> {
   BlendingMode blending_mode_;
 };
 
+// Writer that copies raw pixels from the specified data buffer.
+template <int8_t bytes_per_pixel>
+class RawDataWriter {
+ public:
+  RawDataWriter(const uint8_t *data) : data_(data) {}
+
+  void operator()(uint8_t *p, uint32_t offset) {
+    memcpy(p + offset * bytes_per_pixel, data_, bytes_per_pixel);
+    data_ += bytes_per_pixel;
+  }
+
+  void operator()(uint8_t *p, uint32_t offset, uint32_t count) {
+    memcpy(p + offset * bytes_per_pixel, data_, count * bytes_per_pixel);
+    data_ += count * bytes_per_pixel;
+  }
+
+ private:
+  const uint8_t *data_;
+};
+
 // Filler template constract is similar to the writer template contract, except
 // that filler uses a single color.
 
@@ -794,12 +1009,9 @@ class BlendingFillerOperator<ColorMode, pixel_order, byte_order, blending_mode,
   }
 
   void operator()(uint8_t *p, uint32_t offset, uint32_t count) const {
-    internal::RawIterator<ColorMode::bits_per_pixel, byte_order> itr(p, offset);
-    RawBlender<ColorMode, blending_mode> blender;
-    while (count-- > 0) {
-      itr.write(blender(itr.read(), color_, color_mode_));
-      ++itr;
-    }
+    BulkBlender<ColorMode, byte_order, blending_mode>().fill(color_mode_, p,
+                                                             offset, color_,
+                                                             count);
   }
 
  private:
@@ -1284,6 +1496,31 @@ void OffscreenDevice<ColorMode, pixel_order, byte_order, pixels_per_byte,
   //     blending_mode_, *this, color_mode(), color, pixel_count);
 }
 
+template <typename ColorMode, ColorPixelOrder pixel_order, ByteOrder byte_order,
+          int8_t pixels_per_byte, typename storage_type>
+void OffscreenDevice<ColorMode, pixel_order, byte_order, pixels_per_byte,
+                     storage_type>::writeRaw(const uint8_t *data,
+                                             uint32_t pixel_count) {
+  const int8_t bpp = ColorTraits<ColorMode>::bytes_per_pixel;
+  if (orienter_.orientation() == Orientation::Default()) {
+    // Each row of the address window is a contiguous run in the buffer.
+    while (pixel_count > 0) {
+      uint32_t n = window_.remaining_in_row();
+      if (n > pixel_count) n = pixel_count;
+      memcpy(buffer_ + window_.offset() * bpp, data, n * bpp);
+      window_.advance(n);
+      data += n * bpp;
+      pixel_count -= n;
+    }
+  } else {
+    while (pixel_count-- > 0) {
+      memcpy(buffer_ + window_.offset() * bpp, data, bpp);
+      window_.advance();
+      data += bpp;
+    }
+  }
+}
+
 // template <typename ColorMode, ColorPixelOrder pixel_order, ByteOrder
 // byte_order> struct WritePixelsOp {
 //   template <BlendingMode blending_mode>
@@ -1445,6 +1682,64 @@ void OffscreenDevice<ColorMode, pixel_order, byte_order, pixels_per_byte,
   }
 }
 
+template <typename ColorMode, ColorPixelOrder pixel_order, ByteOrder byte_order,
+          int8_t pixels_per_byte, typename storage_type>
+void OffscreenDevice<ColorMode, pixel_order, byte_order, pixels_per_byte,
+                     storage_type>::writeSpans(BlendingMode blending_mode,
+                                               Color *color, int16_t *x0,
+                                               int16_t *y, int16_t *x1,
+                                               uint16_t count) {
+  if (blending_mode == BLENDING_MODE_SOURCE) {
+    typename internal::BlendingWriter<ColorMode, pixel_order, byte_order>::
+        template Operator<BLENDING_MODE_SOURCE>
+            write(color_mode_, color);
+    writeSpansImpl(write, x0, y, x1, count);
+  } else {
+    blending_mode = internal::ResolveBlendingModeForWrite(
+        blending_mode, color_mode_.transparency());
+    if (blending_mode == BLENDING_MODE_DESTINATION) return;
+    if (blending_mode == BLENDING_MODE_SOURCE_OVER_OPAQUE) {
+      typename internal::BlendingWriter<ColorMode, pixel_order, byte_order>::
+          template Operator<BLENDING_MODE_SOURCE_OVER_OPAQUE>
+              write(color_mode_, color);
+      writeSpansImpl(write, x0, y, x1, count);
+    } else if (blending_mode == BLENDING_MODE_SOURCE_OVER) {
+      typename internal::BlendingWriter<ColorMode, pixel_order, byte_order>::
+          template Operator<BLENDING_MODE_SOURCE_OVER>
+              write(color_mode_, color);
+      writeSpansImpl(write, x0, y, x1, count);
+    } else {
+      internal::GenericWriter<ColorMode, pixel_order, byte_order> write(
+          color_mode_, blending_mode, color);
+      writeSpansImpl(write, x0, y, x1, count);
+    }
+  }
+}
+
+template <typename ColorMode, ColorPixelOrder pixel_order, ByteOrder byte_order,
+          int8_t pixels_per_byte, typename storage_type>
+void OffscreenDevice<ColorMode, pixel_order, byte_order, pixels_per_byte,
+                     storage_type>::fillSpans(BlendingMode blending_mode,
+                                              Color color, int16_t *x0,
+                                              int16_t *y, int16_t *x1,
+                                              uint16_t count) {
+  // Spans are rects with y0 == y1. After orienting, they become either
+  // horizontal or vertical lines in the buffer.
+  int16_t *y0 = y;
+  int16_t *y1 = y;
+  orienter_.OrientRects(x0, y0, x1, y1, count);
+  if (blending_mode != BLENDING_MODE_SOURCE) {
+    blending_mode = internal::ResolveBlendingModeForFill(
+        blending_mode, color_mode_.transparency(), color);
+    if (blending_mode == BLENDING_MODE_DESTINATION) return;
+  }
+  if (y0 == y1) {
+    fillHlinesAbsolute(blending_mode, color, x0, y0, x1, count);
+  } else {
+    fillVlinesAbsolute(blending_mode, color, x0, y0, y1, count);
+  }
+}
+
 template <typename Filler>
 void fillRectsAbsoluteImpl(Filler &fill, uint8_t *buffer, int16_t width,
                            int16_t *x0, int16_t *y0, int16_t *x1, int16_t *y1,
@@ -1645,6 +1940,225 @@ void OffscreenDevice<ColorMode, pixel_order, byte_order, pixels_per_byte,
 
 namespace internal {
 
+// Clips the blit of src_rect to (dx, dy) so that the source region is within
+// src_bounds, and the target region is within dst_bounds. Returns the clipped
+// source region, and adjusts (dx, dy) accordingly.
+inline Box ClipBlit(Box src_rect, const Box &src_bounds, const Box &dst_bounds,
+                    int16_t &dx, int16_t &dy) {
+  int16_t offset_x = dx - src_rect.xMin();
+  int16_t offset_y = dy - src_rect.yMin();
+  src_rect = Box::Intersect(src_rect, src_bounds);
+  src_rect = Box::Intersect(src_rect,
+                            dst_bounds.translate(-offset_x, -offset_y));
+  dx = src_rect.xMin() + offset_x;
+  dy = src_rect.yMin() + offset_y;
+  return src_rect;
+}
+
+// Copies a run of raw pixels, given as pixel offsets relative to the dst and
+// src buffers. If may_overlap is true, dst and src point to the same buffer,
+// and the ranges may overlap.
+template <int8_t bits_per_pixel, ColorPixelOrder pixel_order,
+          bool sub_byte = (bits_per_pixel < 8)>
+struct RawRowCopy {
+  void operator()(uint8_t *dst, uint32_t dst_offset, const uint8_t *src,
+                  uint32_t src_offset, uint32_t count, bool may_overlap) const {
+    const int bytes_per_pixel = bits_per_pixel / 8;
+    memmove(dst + dst_offset * bytes_per_pixel,
+            src + src_offset * bytes_per_pixel, count * bytes_per_pixel);
+  }
+};
+
+template <int8_t bits_per_pixel, ColorPixelOrder pixel_order>
+struct RawRowCopy<bits_per_pixel, pixel_order, true> {
+  void operator()(uint8_t *dst, uint32_t dst_offset, const uint8_t *src,
+                  uint32_t src_offset, uint32_t count, bool may_overlap) const {
+    const bool msb_first = (pixel_order == COLOR_PIXEL_ORDER_MSB_FIRST);
+    uint32_t dst_bit = dst_offset * bits_per_pixel;
+    uint32_t src_bit = src_offset * bits_per_pixel;
+    uint32_t bits = count * bits_per_pixel;
+    if (!may_overlap || dst_bit + bits <= src_bit ||
+        src_bit + bits <= dst_bit) {
+      bit_copy<msb_first>(dst, dst_bit, src, src_bit, bits);
+      return;
+    }
+    // Overlapping ranges; copy through a temporary buffer, in chunks, in the
+    // direction that reads the source before it is overwritten.
+    uint8_t tmp[32];
+    const uint32_t chunk = sizeof(tmp) * 8;
+    if (dst_bit < src_bit) {
+      for (uint32_t pos = 0; pos < bits; pos += chunk) {
+        uint32_t n = bits - pos;
+        if (n > chunk) n = chunk;
+        bit_copy<msb_first>(tmp, 0, src, src_bit + pos, n);
+        bit_copy<msb_first>(dst, dst_bit + pos, tmp, 0, n);
+      }
+    } else {
+      uint32_t pos = bits;
+      while (pos > 0) {
+        uint32_t n = pos;
+        if (n > chunk) n = chunk;
+        pos -= n;
+        bit_copy<msb_first>(tmp, 0, src, src_bit + pos, n);
+        bit_copy<msb_first>(dst, dst_bit + pos, tmp, 0, n);
+      }
+    }
+  }
+};
+
+// Copies the src_rect region of the src buffer (of the src_extents geometry)
+// to the dst buffer (of the dst_extents geometry), at (dx, dy), verbatim.
+template <typename ColorMode, ColorPixelOrder pixel_order>
+void BlitRaw(const uint8_t *src, const Box &src_extents, const Box &src_rect,
+             uint8_t *dst, const Box &dst_extents, int16_t dx, int16_t dy) {
+  uint32_t src_width = src_extents.width();
+  uint32_t dst_width = dst_extents.width();
+  uint32_t src_offset = (src_rect.yMin() - src_extents.yMin()) * src_width +
+                        src_rect.xMin() - src_extents.xMin();
+  uint32_t dst_offset =
+      (dy - dst_extents.yMin()) * dst_width + dx - dst_extents.xMin();
+  uint32_t width = src_rect.width();
+  int16_t height = src_rect.height();
+  bool same_buffer = (src == dst);
+  RawRowCopy<ColorMode::bits_per_pixel, pixel_order> copy;
+  if (!same_buffer && width == src_width && width == dst_width) {
+    copy(dst, dst_offset, src, src_offset, width * height, false);
+    return;
+  }
+  if (same_buffer && dst_offset > src_offset) {
+    // Bottom-up, so that the rows are read before they are overwritten.
+    src_offset += (height - 1) * src_width;
+    dst_offset += (height - 1) * dst_width;
+    while (height-- > 0) {
+      copy(dst, dst_offset, src, src_offset, width, true);
+      src_offset -= src_width;
+      dst_offset -= dst_width;
+    }
+    return;
+  }
+  while (height-- > 0) {
+    copy(dst, dst_offset, src, src_offset, width, same_buffer);
+    src_offset += src_width;
+    dst_offset += dst_width;
+  }
+}
+
+}  // namespace internal
+
+template <typename ColorMode, ColorPixelOrder pixel_order, ByteOrder byte_order,
+          int8_t pixels_per_byte, typename storage_type>
+void Blit(const Offscreen<ColorMode, pixel_order, byte_order, pixels_per_byte,
+                          storage_type> &src,
+          Box src_rect, DisplayOutput &dst, int16_t dx, int16_t dy,
+          BlendingMode blending_mode) {
+  src_rect = internal::ClipBlit(src_rect, src.extents(), Box::MaximumBox(), dx,
+                                dy);
+  if (src_rect.empty()) return;
+  const auto &raster = src.raster();
+  const Box &raster_extents = raster.extents();
+  uint32_t width = raster_extents.width();
+  uint32_t offset = (src_rect.yMin() - raster_extents.yMin()) * width +
+                    src_rect.xMin() - raster_extents.xMin();
+  const uint8_t *data = src.buffer();
+  Box dst_rect =
+      src_rect.translate(dx - src_rect.xMin(), dy - src_rect.yMin());
+  if (internal::IsRawCopyEquivalent(color::Transparent, FILL_MODE_RECTANGLE,
+                                    blending_mode, raster.transparency()) &&
+      dst.acceptsRaw(RawPixelFormatOf<ColorMode, byte_order>())) {
+    const int8_t bytes_per_pixel = ColorTraits<ColorMode>::bytes_per_pixel;
+    dst.setAddress(dst_rect, BLENDING_MODE_SOURCE);
+    if ((uint32_t)src_rect.width() == width) {
+      dst.writeRaw(data + offset * bytes_per_pixel, src_rect.area());
+      return;
+    }
+    for (int16_t y = src_rect.yMin(); y <= src_rect.yMax(); ++y) {
+      dst.writeRaw(data + offset * bytes_per_pixel, src_rect.width());
+      offset += width;
+    }
+    return;
+  }
+  const ColorMode &color_mode = raster.color_mode();
+  internal::Reader<ColorMode, pixel_order, byte_order> read;
+  Color buf[kPixelWritingBufferSize];
+  dst.setAddress(dst_rect, blending_mode);
+  for (int16_t y = src_rect.yMin(); y <= src_rect.yMax(); ++y) {
+    uint32_t pos = offset;
+    uint32_t remaining = src_rect.width();
+    while (remaining > 0) {
+      uint32_t n = remaining;
+      if (n > kPixelWritingBufferSize) n = kPixelWritingBufferSize;
+      for (uint32_t i = 0; i < n; ++i) {
+        buf[i] = color_mode.toArgbColor(read(data, pos++));
+      }
+      dst.write(buf, n);
+      remaining -= n;
+    }
+    offset += width;
+  }
+}
+
+template <typename SrcColorMode, ColorPixelOrder src_pixel_order,
+          ByteOrder src_byte_order, int8_t src_pixels_per_byte,
+          typename src_storage_type, typename DstColorMode,
+          ColorPixelOrder dst_pixel_order, ByteOrder dst_byte_order,
+          int8_t dst_pixels_per_byte, typename dst_storage_type>
+void Blit(const Offscreen<SrcColorMode, src_pixel_order, src_byte_order,
+                          src_pixels_per_byte, src_storage_type> &src,
+          Box src_rect,
+          Offscreen<DstColorMode, dst_pixel_order, dst_byte_order,
+                    dst_pixels_per_byte, dst_storage_type> &dst,
+          int16_t dx, int16_t dy, BlendingMode blending_mode) {
+  src_rect =
+      internal::ClipBlit(src_rect, src.extents(), dst.extents(), dx, dy);
+  if (src_rect.empty()) return;
+  const bool same_format =
+      std::is_same<SrcColorMode, DstColorMode>::value &&
+      (SrcColorMode::bits_per_pixel >= 8 ||
+       src_pixel_order == dst_pixel_order) &&
+      (SrcColorMode::bits_per_pixel <= 8 || src_byte_order == dst_byte_order);
+  if (same_format && dst.output().orientation() == Orientation::Default() &&
+      internal::IsRawCopyEquivalent(color::Transparent, FILL_MODE_RECTANGLE,
+                                    blending_mode,
+                                    src.raster().transparency())) {
+    internal::BlitRaw<SrcColorMode, src_pixel_order>(
+        src.buffer(), src.raster().extents(), src_rect, dst.buffer(),
+        dst.raster().extents(), dx, dy);
+    return;
+  }
+  const Box &dst_extents = dst.raster().extents();
+  Blit(src, src_rect, dst.output(), dx - dst_extents.xMin(),
+       dy - dst_extents.yMin(), blending_mode);
+}
+
+template <typename ColorMode, ColorPixelOrder pixel_order, ByteOrder byte_order,
+          int8_t pixels_per_byte, typename storage_type>
+void OffscreenDevice<ColorMode, pixel_order, byte_order, pixels_per_byte,
+                     storage_type>::copyRect(const Box &src, int16_t dst_x,
+                                             int16_t dst_y) {
+  Box bounds(0, 0, effective_width() - 1, effective_height() - 1);
+  Box src_rect = internal::ClipBlit(src, bounds, bounds, dst_x, dst_y);
+  if (src_rect.empty()) return;
+  // Orientation maps both rectangles consistently, so that the copy becomes a
+  // translation in the raw buffer space.
+  int16_t x0_buf[] = {src_rect.xMin(), dst_x};
+  int16_t y0_buf[] = {src_rect.yMin(), dst_y};
+  int16_t x1_buf[] = {src_rect.xMax(),
+                      (int16_t)(dst_x + src_rect.width() - 1)};
+  int16_t y1_buf[] = {src_rect.yMax(),
+                      (int16_t)(dst_y + src_rect.height() - 1)};
+  int16_t *x0 = x0_buf;
+  int16_t *y0 = y0_buf;
+  int16_t *x1 = x1_buf;
+  int16_t *y1 = y1_buf;
+  orienter_.OrientRects(x0, y0, x1, y1, 2);
+  Box raw_extents(0, 0, raw_width() - 1, raw_height() - 1);
+  internal::BlitRaw<ColorMode, pixel_order>(
+      buffer_, raw_extents, Box(x0[0], y0[0], x1[0], y1[0]), buffer_,
+      raw_extents, x0[1], y0[1]);
+}
+
+namespace internal {
+
 inline void Orienter::OrientPixels(int16_t *&x, int16_t *&y, int16_t count) {
   if (orientation_ != Orientation::Default()) {
     if (orientation_.isXYswapped()) {
@@ -81,6 +81,23 @@ class RasterPixelStream : public PixelStream {
   Color cache_[ColorTraits<ColorMode>::pixels_per_byte];
 };
 
+namespace internal {
+
+// Reads the specified number of bytes from the byte stream.
+template <typename ByteStream>
+inline void ReadBytes(ByteStream& in, uint8_t* buf, uint32_t count) {
+  while (count-- > 0) *buf++ = in.read();
+}
+
+template <typename PtrType>
+inline void ReadBytes(MemoryPtrStream<PtrType>& in, uint8_t* buf,
+                      uint32_t count) {
+  memcpy(buf, in.ptr(), count);
+  in.skip(count);
+}
+
+}  // namespace internal
+
 template <typename ByteStream, typename ColorMode, ColorPixelOrder pixel_order,
           ByteOrder byte_order,
           int bytes_per_pixel = ColorTraits<ColorMode>::bytes_per_pixel>
@@ -151,6 +168,15 @@ class RasterPixelStream<Resource, ColorMode, pixel_order, byte_order, 1>
     stream_.skip(count * ColorMode::bits_per_pixel / 8);
   }
 
+  RawPixelFormat rawFormat() const override {
+    return RawPixelFormatOf<ColorMode, byte_order>();
+  }
+
+  void ReadRaw(uint8_t* buf, uint16_t size) override {
+    internal::ReadBytes(stream_, buf,
+                        size * ColorTraits<ColorMode>::bytes_per_pixel);
+  }
+
   TransparencyMode transparency() const { return color_mode_.transparency(); }
 
   const ColorMode& color_mode() const { return color_mode_; }
@@ -277,6 +303,15 @@ class Raster : public Rasterizable {
     }
   }
 
+  void readColorRow(int16_t y, int16_t x0, int16_t x1,
+                    Color* result) const override {
+    internal::Reader<ColorMode, pixel_order, byte_order> read;
+    uint32_t offset = x0 - extents_.xMin() + (y - extents_.yMin()) * width_;
+    for (int16_t x = x0; x <= x1; ++x) {
+      *result++ = color_mode_.toArgbColor(read(ptr_, offset++));
+    }
+  }
+
   TransparencyMode getTransparencyMode() const override {
     return transparency();
   }
@@ -296,6 +331,13 @@ class Raster : public Rasterizable {
     Box bounds =
         Box::Intersect(s.clip_box().translate(-s.dx(), -s.dy()), extents_);
     if (bounds.empty()) return;
+    if (internal::IsRawCopyEquivalent(s.bgcolor(), s.fill_mode(),
+                                      s.blending_mode(),
+                                      getTransparencyMode()) &&
+        s.out().acceptsRaw(RawPixelFormatOf<ColorMode, byte_order>())) {
+      drawRawTo(s.out(), bounds, s.dx(), s.dy());
+      return;
+    }
     if (extents_.width() == bounds.width() &&
         extents_.height() == bounds.height()) {
       StreamType stream(internal::MemoryPtrStream<PtrType>(ptr_), color_mode_);
@@ -312,6 +354,25 @@ class Raster : public Rasterizable {
     }
   }
 
+  // Copies the rows of the raster, as stored, directly to the output.
+  void drawRawTo(DisplayOutput& out, const Box& bounds, int16_t dx,
+                 int16_t dy) const {
+    const int8_t bytes_per_pixel = ColorTraits<ColorMode>::bytes_per_pixel;
+    out.setAddress(bounds.translate(dx, dy), BLENDING_MODE_SOURCE);
+    const uint8_t* row =
+        (const uint8_t*)ptr_ + ((bounds.yMin() - extents_.yMin()) * width_ +
+                                bounds.xMin() - extents_.xMin()) *
+                                   bytes_per_pixel;
+    if (bounds.width() == width_) {
+      out.writeRaw(row, bounds.area());
+      return;
+    }
+    for (int16_t y = bounds.yMin(); y <= bounds.yMax(); ++y) {
+      out.writeRaw(row, bounds.width());
+      row += width_ * bytes_per_pixel;
+    }
+  }
+
   Box extents_;
   Box anchor_extents_;
   PtrType ptr_;
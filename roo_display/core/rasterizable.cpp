@@ -13,26 +13,22 @@ class Stream : public PixelStream {
         y_(bounds_.yMin()) {}
 
   void Read(Color *buf, uint16_t size) override {
-    int16_t x[size];
-    int16_t y[size];
-    for (int i = 0; i < size; ++i) {
-      x[i] = x_;
-      y[i] = y_;
-      if (x_ < bounds_.xMax()) {
-        ++x_;
-      } else {
-        x_ = bounds_.xMin();
-        ++y_;
-      }
-    }
-    if (y[0] == y[size - 1]) {
-      if (data_->readColorRect(x[0], y[0], x[size - 1], y[0], buf)) {
-        for (int i = 1; i < size; ++i) {
+    while (size > 0) {
+      // Read up to the end of the current row.
+      uint16_t n = bounds_.xMax() - x_ + 1;
+      if (n > size) n = size;
+      if (data_->readColorRect(x_, y_, x_ + n - 1, y_, buf)) {
+        for (int i = 1; i < n; ++i) {
           buf[i] = buf[0];
         }
       }
-    } else {
-      data_->readColors(x, y, size, buf);
+      buf += n;
+      size -= n;
+      x_ += n;
+      if (x_ > bounds_.xMax()) {
+        x_ = bounds_.xMin();
+        ++y_;
+      }
     }
   }
 
@@ -52,7 +48,7 @@ class Stream : public PixelStream {
   int16_t x_, y_;
 };
 
-static const int kMaxBufSize = 32;
+static const int kMaxBufSize = ROO_DISPLAY_RASTERIZABLE_CHUNK_SIZE;
 
 }  // namespace
 
@@ -110,20 +106,28 @@ void Rasterizable::readColorsMaybeOutOfBounds(const int16_t *x,
   }
 }
 
+void Rasterizable::readColorRow(int16_t y, int16_t x0, int16_t x1,
+                                Color *result) const {
+  int16_t x[kMaxBufSize];
+  int16_t ys[kMaxBufSize];
+  for (int i = 0; i < kMaxBufSize; ++i) ys[i] = y;
+  while (x0 <= x1) {
+    int n = 0;
+    while (n < kMaxBufSize && x0 <= x1) x[n++] = x0++;
+    readColors(x, ys, n, result);
+    result += n;
+  }
+}
+
 bool Rasterizable::readColorRect(int16_t xMin, int16_t yMin, int16_t xMax,
                                  int16_t yMax, Color *result) const {
-  uint32_t pixel_count = (xMax - xMin + 1) * (yMax - yMin + 1);
-  int16_t x[pixel_count];
-  int16_t y[pixel_count];
-  int16_t *cx = x;
-  int16_t *cy = y;
-  for (int16_t y_cursor = yMin; y_cursor <= yMax; ++y_cursor) {
-    for (int16_t x_cursor = xMin; x_cursor <= xMax; ++x_cursor) {
-      *cx++ = x_cursor;
-      *cy++ = y_cursor;
-    }
+  int16_t width = xMax - xMin + 1;
+  Color *row = result;
+  for (int16_t y = yMin; y <= yMax; ++y) {
+    readColorRow(y, xMin, xMax, row);
+    row += width;
   }
-  readColors(x, y, pixel_count, result);
+  uint32_t pixel_count = (uint32_t)width * (yMax - yMin + 1);
   Color c = result[0];
   for (uint32_t i = 1; i < pixel_count; i++) {
     if (result[i] != c) return false;
@@ -152,250 +156,299 @@ std::unique_ptr<PixelStream> Rasterizable::createStream(
 
 namespace {
 
-inline void FillReplaceRect(DisplayOutput &output, const Box &extents,
-                            int16_t dx, int16_t dy, const Rasterizable &object,
-                            BlendingMode mode) {
-  uint32_t count = extents.area();
-  Color buf[count];
-  bool same =
-      object.readColorRect(extents.xMin() - dx, extents.yMin() - dy,
-                           extents.xMax() - dx, extents.yMax() - dy, buf);
-  if (same) {
-    output.fillRect(mode, extents, buf[0]);
-  } else {
-    output.setAddress(extents, mode);
-    output.write(buf, count);
+// Tiles, in which the rasterizable is read, are kTileSize x kTileSize pixels.
+static const int16_t kTileSize = 8;
+
+// Non-uniform tiles get subdivided (recursively) down to this size, so that
+// their uniform parts can be filled, rather than written pixel-by-pixel.
+static const int16_t kMinSubtileSize = 4;
+
+// Maximum number of uniform rectangles that are being held, waiting to get
+// merged with their neighbors.
+static const int kMaxPendingRects = 16;
+
+// Collects uniformly colored rectangles, merging the ones that have the same
+// color and share a full edge into larger rectangles. Rectangles are filled
+// when they can no longer grow (i.e., when the row of tiles ends without
+// extending them), or when the capacity is exceeded. The rectangles are
+// expected to be disjoint (with each other and with any other pixels being
+// written), so that the order in which they are filled does not matter.
+class RectMerger {
+ public:
+  RectMerger(DisplayOutput &output, BlendingMode mode)
+      : output_(output), mode_(mode), count_(0) {}
+
+  RectMerger(const RectMerger &) = delete;
+  RectMerger &operator=(const RectMerger &) = delete;
+
+  ~RectMerger() {
+    for (int i = 0; i < count_; ++i) fill(i);
   }
-}
 
-inline void FillPaintRectOverOpaqueBg(DisplayOutput &output, const Box &extents,
-                                      int16_t dx, int16_t dy, Color bgcolor,
-                                      const Rasterizable &object,
-                                      BlendingMode mode) {
-  uint32_t count = extents.area();
-  Color buf[count];
-  bool same =
-      object.readColorRect(extents.xMin() - dx, extents.yMin() - dy,
-                           extents.xMax() - dx, extents.yMax() - dy, buf);
-  if (same) {
-    output.fillRect(mode, extents, AlphaBlendOverOpaque(bgcolor, buf[0]));
-  } else {
-    for (int i = 0; i < count; i++) {
-      buf[i] = AlphaBlendOverOpaque(bgcolor, buf[i]);
+  void add(Box box, Color color) {
+    int i = 0;
+    while (i < count_) {
+      if (color_[i] == color && merge(box_[i], box)) {
+        // The enlarged rectangle may now be mergeable with another one.
+        remove(i);
+        i = 0;
+      } else {
+        ++i;
+      }
+    }
+    if (count_ == kMaxPendingRects) {
+      fill(0);
+      remove(0);
     }
-    output.setAddress(extents, mode);
-    output.write(buf, count);
+    box_[count_] = box;
+    color_[count_] = color;
+    ++count_;
   }
-}
 
-inline void FillPaintRectOverBg(DisplayOutput &output, const Box &extents,
-                                int16_t dx, int16_t dy, Color bgcolor,
-                                const Rasterizable &object, BlendingMode mode) {
-  uint32_t count = extents.area();
-  Color buf[count];
-  bool same =
-      object.readColorRect(extents.xMin() - dx, extents.yMin() - dy,
-                           extents.xMax() - dx, extents.yMax() - dy, buf);
-  if (same) {
-    output.fillRect(mode, extents, AlphaBlend(bgcolor, buf[0]));
-  } else {
-    for (int i = 0; i < count; i++) {
-      buf[i] = AlphaBlend(bgcolor, buf[i]);
+  // Fills the rectangles that do not extend to the specified y coordinate,
+  // which is the bottom edge of the row of tiles just processed. They can no
+  // longer be merged with anything.
+  void endRow(int16_t yMax) {
+    int kept = 0;
+    for (int i = 0; i < count_; ++i) {
+      if (box_[i].yMax() < yMax) {
+        fill(i);
+      } else {
+        box_[kept] = box_[i];
+        color_[kept] = color_[i];
+        ++kept;
+      }
     }
-    output.setAddress(extents, mode);
-    output.write(buf, count);
+    count_ = kept;
   }
-}
 
-// Assumes no bgcolor.
-inline void WriteRectVisible(DisplayOutput &output, const Box &extents,
-                             int16_t dx, int16_t dy, const Rasterizable &object,
-                             BlendingMode mode) {
-  uint32_t count = extents.area();
-  Color buf[count];
-  bool same =
-      object.readColorRect(extents.xMin() - dx, extents.yMin() - dy,
-                           extents.xMax() - dx, extents.yMax() - dy, buf);
-  if (same) {
-    if (buf[0] != color::Transparent) {
-      output.fillRect(mode, extents, buf[0]);
-    }
-  } else {
-    BufferedPixelWriter writer(output, mode);
-    Color *ptr = buf;
-    for (int16_t j = extents.yMin(); j <= extents.yMax(); ++j) {
-      for (int16_t i = extents.xMin(); i <= extents.xMax(); ++i) {
-        if (*ptr != color::Transparent) writer.writePixel(i, j, *ptr);
-        ++ptr;
+ private:
+  // If the specified rectangles share a full edge, sets 'b' to their union and
+  // returns true. Otherwise, returns false.
+  static bool merge(const Box &a, Box &b) {
+    if (a.yMin() == b.yMin() && a.yMax() == b.yMax()) {
+      if (a.xMax() + 1 == b.xMin() || b.xMax() + 1 == a.xMin()) {
+        b = Box(std::min(a.xMin(), b.xMin()), a.yMin(),
+                std::max(a.xMax(), b.xMax()), a.yMax());
+        return true;
+      }
+    } else if (a.xMin() == b.xMin() && a.xMax() == b.xMax()) {
+      if (a.yMax() + 1 == b.yMin() || b.yMax() + 1 == a.yMin()) {
+        b = Box(a.xMin(), std::min(a.yMin(), b.yMin()), a.xMax(),
+                std::max(a.yMax(), b.yMax()));
+        return true;
       }
     }
+    return false;
   }
-}
 
-inline void WriteRectVisibleOverOpaqueBg(DisplayOutput &output,
-                                         const Box &extents, int16_t dx,
-                                         int16_t dy, Color bgcolor,
-                                         const Rasterizable &object,
-                                         BlendingMode mode) {
-  uint32_t count = extents.area();
-  Color buf[count];
-  bool same =
-      object.readColorRect(extents.xMin() - dx, extents.yMin() - dy,
-                           extents.xMax() - dx, extents.yMax() - dy, buf);
-  if (same) {
-    if (buf[0] != color::Transparent) {
-      output.fillRect(mode, extents, AlphaBlendOverOpaque(bgcolor, buf[0]));
+  void fill(int i) { output_.fillRect(mode_, box_[i], color_[i]); }
+
+  void remove(int i) {
+    --count_;
+    for (; i < count_; ++i) {
+      box_[i] = box_[i + 1];
+      color_[i] = color_[i + 1];
     }
-  } else {
-    BufferedPixelWriter writer(output, mode);
-    Color *ptr = buf;
-    for (int16_t j = extents.yMin(); j <= extents.yMax(); ++j) {
-      for (int16_t i = extents.xMin(); i <= extents.xMax(); ++i) {
-        if (*ptr != color::Transparent)
-          writer.writePixel(i, j, AlphaBlendOverOpaque(bgcolor, *ptr));
-        ++ptr;
-      }
+  }
+
+  DisplayOutput &output_;
+  BlendingMode mode_;
+  int count_;
+  Box box_[kMaxPendingRects];
+  Color color_[kMaxPendingRects];
+};
+
+struct NoBlend {
+  Color operator()(Color c) const { return c; }
+};
+
+struct BlendOverOpaqueBg {
+  Color operator()(Color c) const { return AlphaBlendOverOpaque(bgcolor, c); }
+  Color bgcolor;
+};
+
+struct BlendOverBg {
+  Color operator()(Color c) const { return AlphaBlend(bgcolor, c); }
+  Color bgcolor;
+};
+
+// Returns true if all colors in the specified rectangle of the buffer are the
+// same.
+inline bool IsUniform(const Color *buf, int16_t stride, int16_t width,
+                      int16_t height) {
+  Color c = *buf;
+  for (int16_t j = 0; j < height; ++j) {
+    for (int16_t i = 0; i < width; ++i) {
+      if (buf[i] != c) return false;
     }
+    buf += stride;
   }
+  return true;
 }
 
-inline void WriteRectVisibleOverBg(DisplayOutput &output, const Box &extents,
-                                   int16_t dx, int16_t dy, Color bgcolor,
-                                   const Rasterizable &object, BlendingMode mode) {
-  uint32_t count = extents.area();
-  Color buf[count];
-  bool same =
-      object.readColorRect(extents.xMin() - dx, extents.yMin() - dy,
-                           extents.xMax() - dx, extents.yMax() - dy, buf);
-  if (same) {
-    if (buf[0] != color::Transparent) {
-      output.fillRect(mode, extents, AlphaBlend(bgcolor, buf[0]));
+// Draws the rasterizable, tile by tile. Uniform tiles, as well as uniform parts
+// of non-uniform tiles, are merged with their same-colored neighbors, and
+// filled as larger rectangles. The remaining pixels are written: when
+// visible_only is false, via setAddress() and write(), and otherwise, skipping
+// transparent pixels, via BufferedSpanWriter. In both cases, colors get
+// transformed by the blender (e.g. blended over the background) before being
+// sent to the output.
+template <typename Blender, bool visible_only>
+class TilePainter {
+ public:
+  TilePainter(DisplayOutput &output, int16_t dx, int16_t dy,
+              const Rasterizable &object, BlendingMode mode, Blender blender)
+      : output_(output),
+        dx_(dx),
+        dy_(dy),
+        object_(object),
+        mode_(mode),
+        blender_(blender),
+        merger_(output, mode),
+        writer_(output, mode) {}
+
+  // Paints the specified rectangle, which must not exceed kTileSize *
+  // kTileSize pixels.
+  void paint(const Box &extents) {
+    Color buf[kTileSize * kTileSize];
+    if (object_.readColorRect(extents.xMin() - dx_, extents.yMin() - dy_,
+                              extents.xMax() - dx_, extents.yMax() - dy_,
+                              buf)) {
+      fill(extents, buf[0]);
+      return;
     }
-  } else {
-    BufferedPixelWriter writer(output, mode);
-    Color *ptr = buf;
-    for (int16_t j = extents.yMin(); j <= extents.yMax(); ++j) {
-      for (int16_t i = extents.xMin(); i <= extents.xMax(); ++i) {
-        if (*ptr != color::Transparent)
-          writer.writePixel(i, j, AlphaBlend(bgcolor, *ptr));
-        ++ptr;
+    paint(extents, buf, extents.width());
+  }
+
+  void endRow(int16_t yMax) { merger_.endRow(yMax); }
+
+ private:
+  void fill(const Box &box, Color color) {
+    if (visible_only && color == color::Transparent) return;
+    merger_.add(box, blender_(color));
+  }
+
+  // Paints the rectangle, whose colors begin at buf, with the specified stride.
+  void paint(const Box &box, Color *buf, int16_t stride) {
+    int16_t w = box.width();
+    int16_t h = box.height();
+    if (IsUniform(buf, stride, w, h)) {
+      fill(box, buf[0]);
+      return;
+    }
+    // Split in half along the dimensions that allow it.
+    int16_t w0 = (w >= 2 * kMinSubtileSize) ? w / 2 : w;
+    int16_t h0 = (h >= 2 * kMinSubtileSize) ? h / 2 : h;
+    if (w0 == w && h0 == h) {
+      write(box, buf, stride);
+      return;
+    }
+    Box sub[4];
+    Color *sub_buf[4];
+    int count = 0;
+    for (int16_t y = 0; y < h; y += h0) {
+      for (int16_t x = 0; x < w; x += w0) {
+        sub[count] =
+            Box(box.xMin() + x, box.yMin() + y,
+                box.xMin() + std::min<int16_t>(x + w0, w) - 1,
+                box.yMin() + std::min<int16_t>(y + h0, h) - 1);
+        sub_buf[count] = buf + y * stride + x;
+        ++count;
+      }
+    }
+    bool any_uniform = false;
+    for (int i = 0; i < count && !any_uniform; ++i) {
+      any_uniform = IsUniform(sub_buf[i], stride, sub[i].width(),
+                              sub[i].height());
+    }
+    if (!any_uniform) {
+      // Splitting would not save anything; write the whole rectangle at once.
+      write(box, buf, stride);
+      return;
+    }
+    for (int i = 0; i < count; ++i) paint(sub[i], sub_buf[i], stride);
+  }
+
+  void write(const Box &box, Color *buf, int16_t stride) {
+    int16_t w = box.width();
+    if (visible_only) {
+      for (int16_t j = box.yMin(); j <= box.yMax(); ++j) {
+        for (int16_t i = 0; i < w; ++i) {
+          if (buf[i] != color::Transparent) {
+            writer_.writePixel(box.xMin() + i, j, blender_(buf[i]));
+          }
+        }
+        buf += stride;
+      }
+    } else {
+      output_.setAddress(box.xMin(), box.yMin(), box.xMax(), box.yMax(),
+                         mode_);
+      for (int16_t j = box.yMin(); j <= box.yMax(); ++j) {
+        for (int16_t i = 0; i < w; ++i) buf[i] = blender_(buf[i]);
+        output_.write(buf, w);
+        buf += stride;
       }
     }
   }
+
+  DisplayOutput &output_;
+  int16_t dx_;
+  int16_t dy_;
+  const Rasterizable &object_;
+  BlendingMode mode_;
+  Blender blender_;
+  RectMerger merger_;
+  BufferedSpanWriter writer_;
+};
+
+template <typename Blender, bool visible_only>
+void PaintTiles(const Surface &s, const Rasterizable &object, Blender blender) {
+  TilePainter<Blender, visible_only> painter(s.out(), s.dx(), s.dy(), object,
+                                             s.blending_mode(), blender);
+  const Box &box = s.clip_box();
+  if (box.area() <= kTileSize * kTileSize) {
+    painter.paint(box);
+    return;
+  }
+  // Tiles are aligned to multiples of kTileSize.
+  const int16_t xMinOuter = (box.xMin() / kTileSize) * kTileSize;
+  const int16_t yMinOuter = (box.yMin() / kTileSize) * kTileSize;
+  for (int16_t y = yMinOuter; y <= box.yMax(); y += kTileSize) {
+    int16_t yMin = std::max(y, box.yMin());
+    int16_t yMax = std::min<int16_t>(y + kTileSize - 1, box.yMax());
+    for (int16_t x = xMinOuter; x <= box.xMax(); x += kTileSize) {
+      painter.paint(Box(std::max(x, box.xMin()), yMin,
+                        std::min<int16_t>(x + kTileSize - 1, box.xMax()),
+                        yMax));
+    }
+    painter.endRow(yMax);
+  }
 }
 
 }  // namespace
 
 void Rasterizable::drawTo(const Surface &s) const {
-  Box box = s.clip_box();
-  int16_t xMin = box.xMin();
-  int16_t xMax = box.xMax();
-  int16_t yMin = box.yMin();
-  int16_t yMax = box.yMax();
-  uint32_t pixel_count = box.area();
-  const int16_t xMinOuter = (xMin / 8) * 8;
-  const int16_t yMinOuter = (yMin / 8) * 8;
-  const int16_t xMaxOuter = (xMax / 8) * 8 + 7;
-  const int16_t yMaxOuter = (yMax / 8) * 8 + 7;
-  FillMode fill_mode = s.fill_mode();
   TransparencyMode transparency = getTransparencyMode();
   Color bgcolor = s.bgcolor();
-  DisplayOutput &output = s.out();
-  BlendingMode mode = s.blending_mode();
-  if (fill_mode == FILL_MODE_RECTANGLE || transparency == TRANSPARENCY_NONE) {
-    if (pixel_count <= 64) {
-      FillReplaceRect(output, box, s.dx(), s.dy(), *this, mode);
-      return;
-    }
+  if (s.fill_mode() == FILL_MODE_RECTANGLE ||
+      transparency == TRANSPARENCY_NONE) {
     if (bgcolor.a() == 0 || transparency == TRANSPARENCY_NONE) {
-      for (int16_t y = yMinOuter; y < yMaxOuter; y += 8) {
-        for (int16_t x = xMinOuter; x < xMaxOuter; x += 8) {
-          FillReplaceRect(output,
-                          Box(std::max(x, box.xMin()), std::max(y, box.yMin()),
-                              std::min((int16_t)(x + 7), box.xMax()),
-                              std::min((int16_t)(y + 7), box.yMax())),
-                          s.dx(), s.dy(), *this, mode);
-        }
-      }
+      PaintTiles<NoBlend, false>(s, *this, NoBlend());
     } else if (bgcolor.a() == 0xFF) {
-      if (pixel_count <= 64) {
-        FillPaintRectOverOpaqueBg(output, box, s.dx(), s.dy(), bgcolor, *this,
-                                  mode);
-        return;
-      }
-      for (int16_t y = yMinOuter; y < yMaxOuter; y += 8) {
-        for (int16_t x = xMinOuter; x < xMaxOuter; x += 8) {
-          FillPaintRectOverOpaqueBg(
-              output,
-              Box(std::max(x, box.xMin()), std::max(y, box.yMin()),
-                  std::min((int16_t)(x + 7), box.xMax()),
-                  std::min((int16_t)(y + 7), box.yMax())),
-              s.dx(), s.dy(), bgcolor, *this, mode);
-        }
-      }
+      PaintTiles<BlendOverOpaqueBg, false>(s, *this,
+                                           BlendOverOpaqueBg{bgcolor});
     } else {
-      if (pixel_count <= 64) {
-        FillPaintRectOverBg(output, box, s.dx(), s.dy(), bgcolor, *this, mode);
-        return;
-      }
-      for (int16_t y = yMinOuter; y < yMaxOuter; y += 8) {
-        for (int16_t x = xMinOuter; x < xMaxOuter; x += 8) {
-          FillPaintRectOverBg(
-              output,
-              Box(std::max(x, box.xMin()), std::max(y, box.yMin()),
-                  std::min((int16_t)(x + 7), box.xMax()),
-                  std::min((int16_t)(y + 7), box.yMax())),
-              s.dx(), s.dy(), bgcolor, *this, mode);
-        }
-      }
+      PaintTiles<BlendOverBg, false>(s, *this, BlendOverBg{bgcolor});
     }
   } else {
     if (bgcolor.a() == 0) {
-      if (pixel_count <= 64) {
-        WriteRectVisible(output, box, s.dx(), s.dy(), *this, mode);
-        return;
-      }
-      for (int16_t y = yMinOuter; y < yMaxOuter; y += 8) {
-        for (int16_t x = xMinOuter; x < xMaxOuter; x += 8) {
-          WriteRectVisible(output,
-                           Box(std::max(x, box.xMin()), std::max(y, box.yMin()),
-                               std::min((int16_t)(x + 7), box.xMax()),
-                               std::min((int16_t)(y + 7), box.yMax())),
-                           s.dx(), s.dy(), *this, mode);
-        }
-      }
+      PaintTiles<NoBlend, true>(s, *this, NoBlend());
     } else if (bgcolor.a() == 0xFF) {
-      if (pixel_count <= 64) {
-        WriteRectVisibleOverOpaqueBg(output, box, s.dx(), s.dy(), bgcolor,
-                                     *this, mode);
-        return;
-      }
-      for (int16_t y = yMinOuter; y < yMaxOuter; y += 8) {
-        for (int16_t x = xMinOuter; x < xMaxOuter; x += 8) {
-          WriteRectVisibleOverOpaqueBg(
-              output,
-              Box(std::max(x, box.xMin()), std::max(y, box.yMin()),
-                  std::min((int16_t)(x + 7), box.xMax()),
-                  std::min((int16_t)(y + 7), box.yMax())),
-              s.dx(), s.dy(), bgcolor, *this, mode);
-        }
-      }
+      PaintTiles<BlendOverOpaqueBg, true>(s, *this,
+                                          BlendOverOpaqueBg{bgcolor});
     } else {
-      if (pixel_count <= 64) {
-        WriteRectVisibleOverBg(output, box, s.dx(), s.dy(), bgcolor, *this,
-                               mode);
-        return;
-      }
-      for (int16_t y = yMinOuter; y < yMaxOuter; y += 8) {
-        for (int16_t x = xMinOuter; x < xMaxOuter; x += 8) {
-          WriteRectVisibleOverBg(
-              output,
-              Box(std::max(x, box.xMin()), std::max(y, box.yMin()),
-                  std::min((int16_t)(x + 7), box.xMax()),
-                  std::min((int16_t)(y + 7), box.yMax())),
-              s.dx(), s.dy(), bgcolor, *this, mode);
-        }
-      }
+      PaintTiles<BlendOverBg, true>(s, *this, BlendOverBg{bgcolor});
     }
   }
 }
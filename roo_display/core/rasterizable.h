@@ -8,6 +8,14 @@
 
 namespace roo_display {
 
+// Maximum number of pixels that the default implementations of Rasterizable
+// methods process at once, when they need to generate coordinate arrays for
+// readColors(). Bounds their stack usage (4 bytes per pixel, plus the result
+// colors where applicable), regardless of the size of the requested area.
+#ifndef ROO_DISPLAY_RASTERIZABLE_CHUNK_SIZE
+#define ROO_DISPLAY_RASTERIZABLE_CHUNK_SIZE 32
+#endif
+
 // Drawable that can provide a color of any point within the extents, given the
 // coordinates. Rasterizables can be used as overlays, backgrounds, and filters.
 //
@@ -35,11 +43,22 @@ class Rasterizable : public virtual Streamable {
       const int16_t* x, const int16_t* y, uint32_t count, Color* result,
       Color out_of_bounds_color = color::Transparent) const;
 
+  // Read colors corresponding to the horizontal segment [x0, x1] of the row y,
+  // and store the results in the result array. The caller must ensure that the
+  // points are within this rasterizable's bounds. The default implementation
+  // calls readColors(), in chunks of ROO_DISPLAY_RASTERIZABLE_CHUNK_SIZE
+  // pixels. Override it if the colors can be computed without the coordinate
+  // arrays, e.g. incrementally along the row.
+  virtual void readColorRow(int16_t y, int16_t x0, int16_t x1,
+                            Color* result) const;
+
   // Read colors corresponding to the specified rectangle. Returns true if all
   // colors are known to be the same. In this case, only the result[0] is
   // supposed to be read. Otherwise, the result array is filled with colors
   // corresponding to all the pixels corresponding to the rectangle. The caller
-  // must ensure that the points are within this rasterizable's bounds.
+  // must ensure that the points are within this rasterizable's bounds. The
+  // default implementation reads the rectangle row by row, using
+  // readColorRow().
   virtual bool readColorRect(int16_t xMin, int16_t yMin, int16_t xMax,
                              int16_t yMax, Color* result) const;
 
@@ -21,6 +21,16 @@ class PixelStream {
     Read(buf, count);
   }
 
+  // Returns the format of the raw pixels underlying this stream, if the stream
+  // supports reading them via ReadRaw(). The default implementation returns
+  // an invalid format, meaning that raw reads are not supported.
+  virtual RawPixelFormat rawFormat() const { return RawPixelFormat(); }
+
+  // Reads the subsequent pixels in their raw format. Can be called only if
+  // rawFormat() is valid. Calls to Read() and ReadRaw() on the same stream
+  // should not be mixed.
+  virtual void ReadRaw(uint8_t *buf, uint16_t size) {}
+
   virtual ~PixelStream() {}
 };
 
@@ -79,7 +89,7 @@ inline void writeRectVisible(DisplayOutput &output, const Box &extents,
                              PixelStream *stream, BlendingMode mode) {
   // TODO(dawidk): need to optimize this.
   Color buf[kPixelWritingBufferSize];
-  BufferedPixelWriter writer(output, mode);
+  BufferedSpanWriter writer(output, mode);
   uint32_t remaining = extents.area();
   int idx = kPixelWritingBufferSize;
   for (int16_t j = extents.yMin(); j <= extents.yMax(); ++j) {
@@ -105,7 +115,7 @@ inline void writeRectVisibleOverOpaqueBg(DisplayOutput &output,
                                          BlendingMode mode) {
   // TODO(dawidk): need to optimize this.
   Color buf[kPixelWritingBufferSize];
-  BufferedPixelWriter writer(output, mode);
+  BufferedSpanWriter writer(output, mode);
   uint32_t remaining = extents.area();
   int idx = kPixelWritingBufferSize;
   for (int16_t j = extents.yMin(); j <= extents.yMax(); ++j) {
@@ -129,7 +139,7 @@ inline void writeRectVisibleOverBg(DisplayOutput &output, const Box &extents,
                                    BlendingMode mode) {
   // TODO(dawidk): need to optimize this.
   Color buf[kPixelWritingBufferSize];
-  BufferedPixelWriter writer(output, mode);
+  BufferedSpanWriter writer(output, mode);
   uint32_t remaining = extents.area();
   int idx = kPixelWritingBufferSize;
   for (int16_t j = extents.yMin(); j <= extents.yMax(); ++j) {
@@ -148,12 +158,52 @@ inline void writeRectVisibleOverBg(DisplayOutput &output, const Box &extents,
   }
 }
 
+// Returns true if writing the content verbatim, using BLENDING_MODE_SOURCE,
+// gives the same result as drawing it with the specified parameters. This is
+// the case for opaque content and the 'source-over' blending modes, as well as
+// for any content replacing a rectangle without a background.
+inline bool IsRawCopyEquivalent(Color bgcolor, FillMode fill_mode,
+                                BlendingMode blending_mode,
+                                TransparencyMode transparency) {
+  if (transparency == TRANSPARENCY_NONE) {
+    return blending_mode == BLENDING_MODE_SOURCE ||
+           blending_mode == BLENDING_MODE_SOURCE_OVER ||
+           blending_mode == BLENDING_MODE_SOURCE_OVER_OPAQUE;
+  }
+  return blending_mode == BLENDING_MODE_SOURCE &&
+         fill_mode == FILL_MODE_RECTANGLE && bgcolor.a() == 0;
+}
+
+inline void fillRawRect(DisplayOutput &output, const Box &extents,
+                        PixelStream *stream) {
+  // Fits kPixelWritingBufferSize pixels in any format, and is word-aligned.
+  uint32_t buf[kPixelWritingBufferSize];
+  output.setAddress(extents, BLENDING_MODE_SOURCE);
+  uint32_t count = extents.area();
+  while (count > 0) {
+    uint32_t n = count;
+    if (n > kPixelWritingBufferSize) n = kPixelWritingBufferSize;
+    stream->ReadRaw((uint8_t *)buf, n);
+    output.writeRaw((const uint8_t *)buf, n);
+    count -= n;
+  }
+}
+
 // This function will fill in the specified rectangle using the most appropriate
-// method given the stream's transparency mode.
+// method given the stream's transparency mode. If the stream's raw format is
+// accepted by the output, and no blending is needed, the raw pixels are copied
+// without conversion.
 inline void FillRectFromStream(DisplayOutput &output, const Box &extents,
                                PixelStream *stream, Color bgcolor,
                                FillMode fill_mode, BlendingMode blending_mode,
                                TransparencyMode transparency) {
+  if (IsRawCopyEquivalent(bgcolor, fill_mode, blending_mode, transparency)) {
+    RawPixelFormat format = stream->rawFormat();
+    if (format.valid() && output.acceptsRaw(format)) {
+      fillRawRect(output, extents, stream);
+      return;
+    }
+  }
   if (fill_mode == FILL_MODE_RECTANGLE || transparency == TRANSPARENCY_NONE) {
     if (bgcolor.a() == 0 || transparency == TRANSPARENCY_NONE) {
       fillReplaceRect(output, extents, stream, blending_mode);
@@ -320,6 +370,24 @@ class SubRectangleStream : public PixelStream {
     } while (count > 0);
   }
 
+  RawPixelFormat rawFormat() const override { return stream_.rawFormat(); }
+
+  void ReadRaw(uint8_t *buf, uint16_t count) override {
+    const int8_t bytes_per_pixel = stream_.rawFormat().bytes_per_pixel();
+    do {
+      if (x_ >= width_) {
+        stream_.Skip(width_skip_);
+        x_ = 0;
+      }
+      uint16_t n = width_ - x_;
+      if (n > count) n = count;
+      stream_.ReadRaw(buf, n);
+      buf += n * bytes_per_pixel;
+      count -= n;
+      x_ += n;
+    } while (count > 0);
+  }
+
   // void skip(uint32_t count) {
   //   // TODO: optimize
   //   for (int i = 0; i < count; i++) next();
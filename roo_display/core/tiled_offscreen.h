@@ -0,0 +1,724 @@
+#pragma once
+
+// Offscreens with a tiled (blocked) memory layout.
+//
+// In a regular offscreen, pixels are stored row by row. When the offscreen is
+// used with an XY-swapped orientation, horizontal writes turn into column
+// walks, with a stride of a full row, touching a new cache line with every
+// pixel. In the tiled layout, the buffer is divided into small rectangular
+// tiles (e.g. 8x8 pixels), each stored contiguously, so that writes in either
+// direction stay mostly within a few cache lines.
+//
+// The tiled offscreen is a Rasterizable, and it can be drawn to other outputs
+// like any other. Its pixel stream de-tiles the content on the fly, copying
+// whole tile rows at a time, and supports the raw (zero-conversion) path, so
+// that it can be flushed to a linear-scan panel efficiently.
+
+#include <memory>
+
+#include "roo_display/color/raw_pixel_format.h"
+#include "roo_display/core/offscreen.h"
+#include "roo_display/core/rasterizable.h"
+
+namespace roo_display {
+
+namespace internal {
+
+// Geometry of a tiled buffer. The buffer is divided into tiles of tile_width x
+// tile_height pixels, stored one after another, row by row. Within each tile,
+// the pixels are also stored row by row. The buffer is padded to the whole
+// number of tiles in both directions.
+template <int8_t tile_width, int8_t tile_height>
+class TileLayout {
+ public:
+  static_assert((tile_width & (tile_width - 1)) == 0 &&
+                    (tile_height & (tile_height - 1)) == 0,
+                "Tile dimensions must be powers of two");
+
+  TileLayout(int16_t width, int16_t height)
+      : tiles_per_row_((width + tile_width - 1) / tile_width),
+        tile_rows_((height + tile_height - 1) / tile_height) {}
+
+  // Returns the number of pixels in the buffer, including the padding.
+  uint32_t pixel_count() const {
+    return (uint32_t)tiles_per_row_ * tile_rows_ * tile_width * tile_height;
+  }
+
+  // Returns the index of the pixel at (x, y) in the buffer.
+  uint32_t index(int16_t x, int16_t y) const {
+    uint16_t ux = x;
+    uint16_t uy = y;
+    return ((uint32_t)(uy / tile_height) * tiles_per_row_ + ux / tile_width) *
+               (tile_width * tile_height) +
+           (uy % tile_height) * tile_width + ux % tile_width;
+  }
+
+ private:
+  int16_t tiles_per_row_;
+  int16_t tile_rows_;
+};
+
+}  // namespace internal
+
+// Display device that draws to an in-memory buffer, using the tiled layout.
+// The tile dimensions must be powers of two, and the rows of the tiles must
+// be byte-aligned. See OffscreenDevice for the general contract.
+template <typename ColorMode, int8_t tile_width = 8, int8_t tile_height = 8,
+          ColorPixelOrder pixel_order = COLOR_PIXEL_ORDER_MSB_FIRST,
+          ByteOrder byte_order = BYTE_ORDER_BIG_ENDIAN>
+class TiledOffscreenDevice : public DisplayDevice {
+ public:
+  static_assert((tile_width * ColorMode::bits_per_pixel) % 8 == 0,
+                "Tile rows must be byte-aligned");
+
+  typedef internal::TileLayout<tile_width, tile_height> Layout;
+
+  // Returns the buffer capacity, in bytes, needed for the specified geometry.
+  static uint32_t BufferSize(int16_t width, int16_t height) {
+    return (Layout(width, height).pixel_count() * ColorMode::bits_per_pixel +
+            7) /
+           8;
+  }
+
+  // Creates a tiled offscreen device with specified geometry, using the
+  // designated buffer. The buffer must have sufficient capacity, determined by
+  // BufferSize(width, height). The buffer is not modified; it can contain
+  // pre-existing content.
+  TiledOffscreenDevice(int16_t width, int16_t height, uint8_t *buffer,
+                       ColorMode color_mode)
+      : DisplayDevice(width, height),
+        color_mode_(color_mode),
+        buffer_(buffer),
+        layout_(width, height),
+        orienter_(width, height, Orientation::Default()),
+        window_(0, 0, -1, -1),
+        cursor_x_(0),
+        cursor_y_(0),
+        run_dx_(1),
+        run_dy_(0),
+        blending_mode_(BLENDING_MODE_SOURCE) {}
+
+  TiledOffscreenDevice(TiledOffscreenDevice &&other) = delete;
+
+  void orientationUpdated() override;
+
+  void setAddress(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1,
+                  BlendingMode mode) override;
+
+  void write(Color *color, uint32_t pixel_count) override;
+
+  bool acceptsRaw(const RawPixelFormat &format) const override {
+    return format == RawPixelFormatOf<ColorMode, byte_order>();
+  }
+
+  void writeRaw(const uint8_t *data, uint32_t pixel_count) override;
+
+  void writePixels(BlendingMode mode, Color *color, int16_t *x, int16_t *y,
+                   uint16_t pixel_count) override;
+
+  void fillPixels(BlendingMode mode, Color color, int16_t *x, int16_t *y,
+                  uint16_t pixel_count) override;
+
+  void writeRects(BlendingMode mode, Color *color, int16_t *x0, int16_t *y0,
+                  int16_t *x1, int16_t *y1, uint16_t count) override;
+
+  void fillRects(BlendingMode mode, Color color, int16_t *x0, int16_t *y0,
+                 int16_t *x1, int16_t *y1, uint16_t count) override;
+
+  void writeSpans(BlendingMode mode, Color *color, int16_t *x0, int16_t *y,
+                  int16_t *x1, uint16_t count) override;
+
+  ColorMode &color_mode() { return color_mode_; }
+  const ColorMode &color_mode() const { return color_mode_; }
+
+  const Layout &layout() const { return layout_; }
+
+  // Allows direct access to the underlying buffer.
+  uint8_t *buffer() { return buffer_; }
+  const uint8_t *buffer() const { return buffer_; }
+
+ private:
+  // Maps the device (oriented) coordinates to the raw buffer coordinates.
+  void toRaw(int16_t &x, int16_t &y) {
+    int16_t *px = &x;
+    int16_t *py = &y;
+    orienter_.OrientPixels(px, py, 1);
+    int16_t raw_x = *px;
+    int16_t raw_y = *py;
+    x = raw_x;
+    y = raw_y;
+  }
+
+  // Writes a run of pixels corresponding to a horizontal line in the device
+  // coordinates, starting at the specified raw coordinates. Depending on the
+  // orientation, the run goes left, right, up, or down in the buffer. Runs
+  // going right are written in bulk, a tile row at a time; otherwise, the
+  // pixels are written one by one, but stay within the tile as long as
+  // possible.
+  template <typename Writer>
+  void writeRun(Writer &write, int16_t x, int16_t y, uint32_t count) {
+    while (count > 0) {
+      uint32_t index = layout_.index(x, y);
+      uint32_t n;
+      if (run_dx_ > 0) {
+        n = tile_width - (uint16_t)x % tile_width;
+      } else if (run_dx_ < 0) {
+        n = (uint16_t)x % tile_width + 1;
+      } else if (run_dy_ > 0) {
+        n = tile_height - (uint16_t)y % tile_height;
+      } else {
+        n = (uint16_t)y % tile_height + 1;
+      }
+      if (n > count) n = count;
+      if (run_dx_ > 0) {
+        write(buffer_, index, n);
+      } else {
+        int16_t delta = run_dx_ + run_dy_ * tile_width;
+        for (uint32_t i = 0; i < n; ++i) {
+          write(buffer_, index);
+          index += delta;
+        }
+      }
+      x += run_dx_ * (int16_t)n;
+      y += run_dy_ * (int16_t)n;
+      count -= n;
+    }
+  }
+
+  template <typename Writer>
+  void writeToWindow(Writer &write, uint32_t count) {
+    while (count > 0) {
+      uint32_t n = window_.xMax() - cursor_x_ + 1;
+      if (n > count) n = count;
+      int16_t x = cursor_x_;
+      int16_t y = cursor_y_;
+      toRaw(x, y);
+      writeRun(write, x, y, n);
+      count -= n;
+      cursor_x_ += n;
+      if (cursor_x_ > window_.xMax()) {
+        cursor_x_ = window_.xMin();
+        ++cursor_y_;
+      }
+    }
+  }
+
+  // Fills the rectangle, specified in the raw coordinates, tile by tile.
+  template <typename Filler>
+  void fillRectRaw(Filler &fill, int16_t x0, int16_t y0, int16_t x1,
+                   int16_t y1) {
+    int16_t ty0 = y0;
+    while (ty0 <= y1) {
+      int16_t ty1 = (ty0 / tile_height) * tile_height + tile_height - 1;
+      if (ty1 > y1) ty1 = y1;
+      int16_t tx0 = x0;
+      while (tx0 <= x1) {
+        int16_t tx1 = (tx0 / tile_width) * tile_width + tile_width - 1;
+        if (tx1 > x1) tx1 = x1;
+        uint32_t index = layout_.index(tx0, ty0);
+        int16_t n = tx1 - tx0 + 1;
+        if (n == tile_width) {
+          // Full tile rows are contiguous.
+          fill(buffer_, index, n * (ty1 - ty0 + 1));
+        } else {
+          for (int16_t y = ty0; y <= ty1; ++y) {
+            fill(buffer_, index, n);
+            index += tile_width;
+          }
+        }
+        tx0 = tx1 + 1;
+      }
+      ty0 = ty1 + 1;
+    }
+  }
+
+  template <typename Filler>
+  void fillRectsRaw(Filler &fill, int16_t *x0, int16_t *y0, int16_t *x1,
+                    int16_t *y1, uint16_t count) {
+    while (count-- > 0) {
+      fillRectRaw(fill, *x0++, *y0++, *x1++, *y1++);
+    }
+  }
+
+  void fillRectsAbsolute(BlendingMode mode, Color color, int16_t *x0,
+                         int16_t *y0, int16_t *x1, int16_t *y1,
+                         uint16_t count);
+
+  ColorMode color_mode_;
+  uint8_t *buffer_;
+  Layout layout_;
+  internal::Orienter orienter_;
+
+  // The address window, and the cursor, in the device coordinates.
+  Box window_;
+  int16_t cursor_x_;
+  int16_t cursor_y_;
+
+  // The direction in the buffer corresponding to the horizontal direction in
+  // the device coordinates.
+  int8_t run_dx_;
+  int8_t run_dy_;
+
+  BlendingMode blending_mode_;
+};
+
+// Stream of the pixels of a tiled buffer, in the regular (row-by-row) order,
+// within the specified bounds (in the buffer coordinates).
+template <typename ColorMode, int8_t tile_width, int8_t tile_height,
+          ColorPixelOrder pixel_order, ByteOrder byte_order>
+class TiledPixelStream : public PixelStream {
+ public:
+  typedef internal::TileLayout<tile_width, tile_height> Layout;
+
+  TiledPixelStream(const uint8_t *buffer, const Layout &layout,
+                   const ColorMode &color_mode, const Box &bounds)
+      : buffer_(buffer),
+        layout_(layout),
+        color_mode_(color_mode),
+        bounds_(bounds),
+        x_(bounds.xMin()),
+        y_(bounds.yMin()),
+        index_(layout.index(bounds.xMin(), bounds.yMin())) {}
+
+  void Read(Color *buf, uint16_t size) override {
+    internal::Reader<ColorMode, pixel_order, byte_order> read;
+    while (size > 0) {
+      uint16_t n = run(size);
+      for (uint16_t i = 0; i < n; ++i) {
+        *buf++ = color_mode_.toArgbColor(read(buffer_, index_ + i));
+      }
+      advance(n);
+      size -= n;
+    }
+  }
+
+  void Skip(uint32_t count) override {
+    uint32_t width = bounds_.width();
+    uint32_t pos = (uint32_t)(y_ - bounds_.yMin()) * width + x_ -
+                   bounds_.xMin() + count;
+    x_ = bounds_.xMin() + pos % width;
+    y_ = bounds_.yMin() + pos / width;
+    index_ = layout_.index(x_, y_);
+  }
+
+  RawPixelFormat rawFormat() const override {
+    return RawPixelFormatOf<ColorMode, byte_order>();
+  }
+
+  void ReadRaw(uint8_t *buf, uint16_t size) override {
+    const int8_t bytes_per_pixel = ColorTraits<ColorMode>::bytes_per_pixel;
+    while (size > 0) {
+      uint16_t n = run(size);
+      memcpy(buf, buffer_ + index_ * bytes_per_pixel, n * bytes_per_pixel);
+      buf += n * bytes_per_pixel;
+      advance(n);
+      size -= n;
+    }
+  }
+
+ private:
+  // Returns the number of pixels, up to max, that can be read contiguously
+  // from the current position.
+  uint16_t run(uint16_t max) const {
+    uint16_t n = tile_width - (uint16_t)x_ % tile_width;
+    if (n > bounds_.xMax() - x_ + 1) n = bounds_.xMax() - x_ + 1;
+    return n < max ? n : max;
+  }
+
+  void advance(uint16_t n) {
+    x_ += n;
+    if (x_ > bounds_.xMax()) {
+      x_ = bounds_.xMin();
+      ++y_;
+      index_ = layout_.index(x_, y_);
+    } else if ((uint16_t)x_ % tile_width == 0) {
+      index_ = layout_.index(x_, y_);
+    } else {
+      index_ += n;
+    }
+  }
+
+  const uint8_t *buffer_;
+  Layout layout_;
+  ColorMode color_mode_;
+  Box bounds_;
+  int16_t x_;
+  int16_t y_;
+  uint32_t index_;
+};
+
+// Offscreen that uses the tiled layout. Can be drawn to, using the
+// DrawingContext, and drawn as a Rasterizable.
+//
+// TiledOffscreen<Rgb565, 8, 8> offscreen(240, 320);
+// offscreen.output().setOrientation(Orientation::RightDown().swapXY());
+// {
+//   DrawingContext dc(offscreen);
+//   dc.draw(...);
+// }
+template <typename ColorMode, int8_t tile_width = 8, int8_t tile_height = 8,
+          ColorPixelOrder pixel_order = COLOR_PIXEL_ORDER_MSB_FIRST,
+          ByteOrder byte_order = BYTE_ORDER_BIG_ENDIAN>
+class TiledOffscreen : public Rasterizable {
+ public:
+  typedef TiledOffscreenDevice<ColorMode, tile_width, tile_height, pixel_order,
+                               byte_order>
+      Device;
+
+  // Creates an offscreen with specified geometry, using the designated buffer.
+  // The buffer must have sufficient capacity, determined by
+  // Device::BufferSize(width, height). The buffer is not modified; it can
+  // contain pre-existing content.
+  TiledOffscreen(int16_t width, int16_t height, uint8_t *buffer,
+                 ColorMode color_mode = ColorMode())
+      : TiledOffscreen(Box(0, 0, width - 1, height - 1), buffer, color_mode) {}
+
+  // Creates an offscreen with specified geometry, using the designated buffer.
+  // The buffer must have sufficient capacity, determined by
+  // Device::BufferSize(extents.width(), extents.height()). The buffer is not
+  // modified; it can contain pre-existing content.
+  TiledOffscreen(Box extents, uint8_t *buffer,
+                 ColorMode color_mode = ColorMode())
+      : device_(extents.width(), extents.height(), buffer, color_mode),
+        extents_(extents),
+        anchor_extents_(extents),
+        owns_buffer_(false) {}
+
+  // Creates an offscreen with specified geometry, using an internally
+  // allocated buffer. The buffer is not pre-initialized; it contains random
+  // bytes.
+  TiledOffscreen(int16_t width, int16_t height,
+                 ColorMode color_mode = ColorMode())
+      : TiledOffscreen(Box(0, 0, width - 1, height - 1), color_mode) {}
+
+  // Creates an offscreen with specified geometry, using an internally
+  // allocated buffer. The buffer is not pre-initialized; it contains random
+  // bytes.
+  TiledOffscreen(Box extents, ColorMode color_mode = ColorMode())
+      : device_(extents.width(), extents.height(),
+                new uint8_t[Device::BufferSize(extents.width(),
+                                               extents.height())],
+                color_mode),
+        extents_(extents),
+        anchor_extents_(extents),
+        owns_buffer_(true) {}
+
+  // Creates an offscreen with specified geometry, using an internally
+  // allocated buffer. The buffer is pre-filled using the specified color.
+  TiledOffscreen(int16_t width, int16_t height, Color fillColor,
+                 ColorMode color_mode = ColorMode())
+      : TiledOffscreen(Box(0, 0, width - 1, height - 1), fillColor,
+                       color_mode) {}
+
+  // Creates an offscreen with specified geometry, using an internally
+  // allocated buffer. The buffer is pre-filled using the specified color.
+  TiledOffscreen(Box extents, Color fillColor,
+                 ColorMode color_mode = ColorMode())
+      : TiledOffscreen(extents, color_mode) {
+    device_.fillRect(0, 0, extents.width() - 1, extents.height() - 1,
+                     fillColor);
+  }
+
+  virtual ~TiledOffscreen() {
+    if (owns_buffer_) delete[] device_.buffer();
+  }
+
+  Box extents() const override { return extents_; }
+  Box anchorExtents() const override { return anchor_extents_; }
+
+  void setAnchorExtents(Box anchor_extents) {
+    anchor_extents_ = anchor_extents;
+  }
+
+  TransparencyMode getTransparencyMode() const override {
+    return device_.color_mode().transparency();
+  }
+
+  void readColors(const int16_t *x, const int16_t *y, uint32_t count,
+                  Color *result) const override {
+    internal::Reader<ColorMode, pixel_order, byte_order> read;
+    const ColorMode &color_mode = device_.color_mode();
+    while (count-- > 0) {
+      *result++ = color_mode.toArgbColor(
+          read(device_.buffer(), device_.layout().index(
+                                     *x++ - extents_.xMin(),
+                                     *y++ - extents_.yMin())));
+    }
+  }
+
+  std::unique_ptr<PixelStream> createStream() const override {
+    return createStream(extents_);
+  }
+
+  std::unique_ptr<PixelStream> createStream(const Box &bounds) const override {
+    return std::unique_ptr<PixelStream>(
+        new TiledPixelStream<ColorMode, tile_width, tile_height, pixel_order,
+                             byte_order>(
+            device_.buffer(), device_.layout(), device_.color_mode(),
+            bounds.translate(-extents_.xMin(), -extents_.yMin())));
+  }
+
+  const Device &output() const { return device_; }
+  Device &output() { return device_; }
+
+  uint8_t *buffer() { return device_.buffer(); }
+  const uint8_t *buffer() const { return device_.buffer(); }
+
+ private:
+  friend class DrawingContext;
+
+  // Streams the content, so that it can use the raw path when the target
+  // accepts it.
+  void drawTo(const Surface &s) const override {
+    Box bounds =
+        Box::Intersect(s.clip_box().translate(-s.dx(), -s.dy()), extents_);
+    if (bounds.empty()) return;
+    std::unique_ptr<PixelStream> stream = createStream(bounds);
+    internal::FillRectFromStream(s.out(), bounds.translate(s.dx(), s.dy()),
+                                 stream.get(), s.bgcolor(), s.fill_mode(),
+                                 s.blending_mode(), getTransparencyMode());
+  }
+
+  // For DrawingContext.
+  void nest() const {}
+  void unnest() const {}
+  Color getBackgroundColor() const { return color::Transparent; }
+  const Rasterizable *getRasterizableBackground() const { return nullptr; }
+  DamageTracker *damage_tracker() const { return nullptr; }
+  int16_t dx() const { return -extents_.xMin(); }
+  int16_t dy() const { return -extents_.yMin(); }
+  bool is_write_once() const { return false; }
+
+  Device device_;
+  Box extents_;
+  Box anchor_extents_;
+  bool owns_buffer_;
+};
+
+// Implementation details follow.
+
+template <typename ColorMode, int8_t tile_width, int8_t tile_height,
+          ColorPixelOrder pixel_order, ByteOrder byte_order>
+void TiledOffscreenDevice<ColorMode, tile_width, tile_height, pixel_order,
+                          byte_order>::orientationUpdated() {
+  Orientation o = orientation();
+  orienter_.setOrientation(o);
+  if (!o.isXYswapped()) {
+    run_dx_ = o.isRightToLeft() ? -1 : 1;
+    run_dy_ = 0;
+  } else {
+    run_dx_ = 0;
+    run_dy_ = o.isBottomToTop() ? -1 : 1;
+  }
+}
+
+template <typename ColorMode, int8_t tile_width, int8_t tile_height,
+          ColorPixelOrder pixel_order, ByteOrder byte_order>
+void TiledOffscreenDevice<ColorMode, tile_width, tile_height, pixel_order,
+                          byte_order>::setAddress(uint16_t x0, uint16_t y0,
+                                                  uint16_t x1, uint16_t y1,
+                                                  BlendingMode blending_mode) {
+  window_ = Box(x0, y0, x1, y1);
+  cursor_x_ = x0;
+  cursor_y_ = y0;
+  if (blending_mode != BLENDING_MODE_SOURCE) {
+    blending_mode = internal::ResolveBlendingModeForWrite(
+        blending_mode, color_mode_.transparency());
+  }
+  blending_mode_ = blending_mode;
+}
+
+template <typename ColorMode, int8_t tile_width, int8_t tile_height,
+          ColorPixelOrder pixel_order, ByteOrder byte_order>
+void TiledOffscreenDevice<ColorMode, tile_width, tile_height, pixel_order,
+                          byte_order>::write(Color *color,
+                                             uint32_t pixel_count) {
+  if (blending_mode_ == BLENDING_MODE_SOURCE) {
+    typename internal::BlendingWriter<ColorMode, pixel_order, byte_order>::
+        template Operator<BLENDING_MODE_SOURCE>
+            writer(color_mode_, color);
+    writeToWindow(writer, pixel_count);
+  } else if (blending_mode_ == BLENDING_MODE_DESTINATION) {
+    return;
+  } else if (blending_mode_ == BLENDING_MODE_SOURCE_OVER_OPAQUE) {
+    typename internal::BlendingWriter<ColorMode, pixel_order, byte_order>::
+        template Operator<BLENDING_MODE_SOURCE_OVER_OPAQUE>
+            writer(color_mode_, color);
+    writeToWindow(writer, pixel_count);
+  } else if (blending_mode_ == BLENDING_MODE_SOURCE_OVER) {
+    typename internal::BlendingWriter<ColorMode, pixel_order, byte_order>::
+        template Operator<BLENDING_MODE_SOURCE_OVER>
+            writer(color_mode_, color);
+    writeToWindow(writer, pixel_count);
+  } else {
+    internal::GenericWriter<ColorMode, pixel_order, byte_order> writer(
+        color_mode_, blending_mode_, color);
+    writeToWindow(writer, pixel_count);
+  }
+}
+
+template <typename ColorMode, int8_t tile_width, int8_t tile_height,
+          ColorPixelOrder pixel_order, ByteOrder byte_order>
+void TiledOffscreenDevice<ColorMode, tile_width, tile_height, pixel_order,
+                          byte_order>::writeRaw(const uint8_t *data,
+                                                uint32_t pixel_count) {
+  internal::RawDataWriter<ColorTraits<ColorMode>::bytes_per_pixel> writer(
+      data);
+  writeToWindow(writer, pixel_count);
+}
+
+template <typename ColorMode, int8_t tile_width, int8_t tile_height,
+          ColorPixelOrder pixel_order, ByteOrder byte_order>
+void TiledOffscreenDevice<ColorMode, tile_width, tile_height, pixel_order,
+                          byte_order>::writePixels(BlendingMode blending_mode,
+                                                   Color *color, int16_t *x,
+                                                   int16_t *y,
+                                                   uint16_t pixel_count) {
+  orienter_.OrientPixels(x, y, pixel_count);
+  if (blending_mode == BLENDING_MODE_SOURCE) {
+    typename internal::BlendingWriter<ColorMode, pixel_order, byte_order>::
+        template Operator<BLENDING_MODE_SOURCE>
+            write(color_mode_, color);
+    while (pixel_count-- > 0) write(buffer_, layout_.index(*x++, *y++));
+    return;
+  }
+  blending_mode = internal::ResolveBlendingModeForWrite(
+      blending_mode, color_mode_.transparency());
+  if (blending_mode == BLENDING_MODE_DESTINATION) return;
+  if (blending_mode == BLENDING_MODE_SOURCE_OVER_OPAQUE) {
+    typename internal::BlendingWriter<ColorMode, pixel_order, byte_order>::
+        template Operator<BLENDING_MODE_SOURCE_OVER_OPAQUE>
+            write(color_mode_, color);
+    while (pixel_count-- > 0) write(buffer_, layout_.index(*x++, *y++));
+  } else if (blending_mode == BLENDING_MODE_SOURCE_OVER) {
+    typename internal::BlendingWriter<ColorMode, pixel_order, byte_order>::
+        template Operator<BLENDING_MODE_SOURCE_OVER>
+            write(color_mode_, color);
+    while (pixel_count-- > 0) write(buffer_, layout_.index(*x++, *y++));
+  } else {
+    internal::GenericWriter<ColorMode, pixel_order, byte_order> write(
+        color_mode_, blending_mode, color);
+    while (pixel_count-- > 0) write(buffer_, layout_.index(*x++, *y++));
+  }
+}
+
+template <typename ColorMode, int8_t tile_width, int8_t tile_height,
+          ColorPixelOrder pixel_order, ByteOrder byte_order>
+void TiledOffscreenDevice<ColorMode, tile_width, tile_height, pixel_order,
+                          byte_order>::fillPixels(BlendingMode blending_mode,
+                                                  Color color, int16_t *x,
+                                                  int16_t *y,
+                                                  uint16_t pixel_count) {
+  orienter_.OrientPixels(x, y, pixel_count);
+  if (blending_mode != BLENDING_MODE_SOURCE) {
+    blending_mode = internal::ResolveBlendingModeForFill(
+        blending_mode, color_mode_.transparency(), color);
+    if (blending_mode == BLENDING_MODE_DESTINATION) return;
+  }
+  if (blending_mode == BLENDING_MODE_SOURCE) {
+    typename internal::BlendingFiller<ColorMode, pixel_order, byte_order>::
+        template Operator<BLENDING_MODE_SOURCE>
+            fill(color_mode_, color);
+    while (pixel_count-- > 0) fill(buffer_, layout_.index(*x++, *y++));
+  } else if (blending_mode == BLENDING_MODE_SOURCE_OVER_OPAQUE) {
+    typename internal::BlendingFiller<ColorMode, pixel_order, byte_order>::
+        template Operator<BLENDING_MODE_SOURCE_OVER_OPAQUE>
+            fill(color_mode_, color);
+    while (pixel_count-- > 0) fill(buffer_, layout_.index(*x++, *y++));
+  } else if (blending_mode == BLENDING_MODE_SOURCE_OVER) {
+    typename internal::BlendingFiller<ColorMode, pixel_order, byte_order>::
+        template Operator<BLENDING_MODE_SOURCE_OVER>
+            fill(color_mode_, color);
+    while (pixel_count-- > 0) fill(buffer_, layout_.index(*x++, *y++));
+  } else {
+    internal::GenericFiller<ColorMode, pixel_order, byte_order> fill(
+        color_mode_, blending_mode, color);
+    while (pixel_count-- > 0) fill(buffer_, layout_.index(*x++, *y++));
+  }
+}
+
+template <typename ColorMode, int8_t tile_width, int8_t tile_height,
+          ColorPixelOrder pixel_order, ByteOrder byte_order>
+void TiledOffscreenDevice<ColorMode, tile_width, tile_height, pixel_order,
+                          byte_order>::writeRects(BlendingMode blending_mode,
+                                                  Color *color, int16_t *x0,
+                                                  int16_t *y0, int16_t *x1,
+                                                  int16_t *y1,
+                                                  uint16_t count) {
+  orienter_.OrientRects(x0, y0, x1, y1, count);
+  if (blending_mode != BLENDING_MODE_SOURCE) {
+    blending_mode = internal::ResolveBlendingModeForWrite(
+        blending_mode, color_mode_.transparency());
+    if (blending_mode == BLENDING_MODE_DESTINATION) return;
+  }
+  while (count-- > 0) {
+    fillRectsAbsolute(blending_mode, *color++, x0++, y0++, x1++, y1++, 1);
+  }
+}
+
+template <typename ColorMode, int8_t tile_width, int8_t tile_height,
+          ColorPixelOrder pixel_order, ByteOrder byte_order>
+void TiledOffscreenDevice<ColorMode, tile_width, tile_height, pixel_order,
+                          byte_order>::fillRects(BlendingMode blending_mode,
+                                                 Color color, int16_t *x0,
+                                                 int16_t *y0, int16_t *x1,
+                                                 int16_t *y1, uint16_t count) {
+  orienter_.OrientRects(x0, y0, x1, y1, count);
+  if (blending_mode != BLENDING_MODE_SOURCE) {
+    blending_mode = internal::ResolveBlendingModeForFill(
+        blending_mode, color_mode_.transparency(), color);
+    if (blending_mode == BLENDING_MODE_DESTINATION) return;
+  }
+  fillRectsAbsolute(blending_mode, color, x0, y0, x1, y1, count);
+}
+
+template <typename ColorMode, int8_t tile_width, int8_t tile_height,
+          ColorPixelOrder pixel_order, ByteOrder byte_order>
+void TiledOffscreenDevice<ColorMode, tile_width, tile_height, pixel_order,
+                          byte_order>::writeSpans(BlendingMode blending_mode,
+                                                  Color *color, int16_t *x0,
+                                                  int16_t *y, int16_t *x1,
+                                                  uint16_t count) {
+  while (count-- > 0) {
+    setAddress(*x0, *y, *x1, *y, blending_mode);
+    uint32_t n = *x1++ - *x0++ + 1;
+    ++y;
+    write(color, n);
+    color += n;
+  }
+}
+
+template <typename ColorMode, int8_t tile_width, int8_t tile_height,
+          ColorPixelOrder pixel_order, ByteOrder byte_order>
+void TiledOffscreenDevice<ColorMode, tile_width, tile_height, pixel_order,
+                          byte_order>::fillRectsAbsolute(BlendingMode
+                                                             blending_mode,
+                                                         Color color,
+                                                         int16_t *x0,
+                                                         int16_t *y0,
+                                                         int16_t *x1,
+                                                         int16_t *y1,
+                                                         uint16_t count) {
+  if (blending_mode == BLENDING_MODE_SOURCE) {
+    typename internal::BlendingFiller<ColorMode, pixel_order, byte_order>::
+        template Operator<BLENDING_MODE_SOURCE>
+            fill(color_mode_, color);
+    fillRectsRaw(fill, x0, y0, x1, y1, count);
+  } else if (blending_mode == BLENDING_MODE_SOURCE_OVER_OPAQUE) {
+    typename internal::BlendingFiller<ColorMode, pixel_order, byte_order>::
+        template Operator<BLENDING_MODE_SOURCE_OVER_OPAQUE>
+            fill(color_mode_, color);
+    fillRectsRaw(fill, x0, y0, x1, y1, count);
+  } else if (blending_mode == BLENDING_MODE_SOURCE_OVER) {
+    typename internal::BlendingFiller<ColorMode, pixel_order, byte_order>::
+        template Operator<BLENDING_MODE_SOURCE_OVER>
+            fill(color_mode_, color);
+    fillRectsRaw(fill, x0, y0, x1, y1, count);
+  } else {
+    internal::GenericFiller<ColorMode, pixel_order, byte_order> fill(
+        color_mode_, blending_mode, color);
+    fillRectsRaw(fill, x0, y0, x1, y1, count);
+  }
+}
+
+}  // namespace roo_display
@@ -14,7 +14,9 @@ namespace roo_display {
 // and ST devices, belong in this category. This class implements the entire
 // contract of a display device, providing an optimized implementation for pixel
 // write, using a Compactor class that detects writes to adjacent pixels and
-// minimizes the number of address window commands.
+// minimizes the number of address window commands. Horizontal spans
+// (writeSpans / fillSpans) map directly to single-row address windows, and
+// bypass the compactor.
 //
 // To implement a driver for a particular device on the basis of this class, you
 // need to provide an implementation of the 'Target' class, with the following
@@ -126,6 +128,33 @@ class AddrWindowDevice : public DisplayDevice {
     target_.ramWrite(buffer, pixel_count);
   }
 
+  // Raw pixels in the target's native format are sent to the device as-is.
+  bool acceptsRaw(const RawPixelFormat& format) const override {
+    return sizeof(raw_color_type) ==
+               ColorTraits<typename Target::ColorMode>::bytes_per_pixel &&
+           format == RawPixelFormatOf<typename Target::ColorMode,
+                                      Target::byte_order>();
+  }
+
+  void writeRaw(const uint8_t* data, uint32_t pixel_count) override {
+    // Transports may read the data in 32-bit words; unaligned data is staged
+    // through an aligned buffer.
+    if (((uintptr_t)data & 3) == 0) {
+      target_.ramWrite((raw_color_type*)data, pixel_count);
+      return;
+    }
+    const uint32_t kBufferBytes = 128;
+    uint32_t buffer[kBufferBytes / 4];
+    const uint32_t capacity = kBufferBytes / sizeof(raw_color_type);
+    while (pixel_count > 0) {
+      uint32_t n = pixel_count < capacity ? pixel_count : capacity;
+      memcpy(buffer, data, n * sizeof(raw_color_type));
+      target_.ramWrite((raw_color_type*)buffer, n);
+      data += n * sizeof(raw_color_type);
+      pixel_count -= n;
+    }
+  }
+
   void writeRects(BlendingMode blending_mode, Color* color, int16_t* x0,
                   int16_t* y0, int16_t* x1, int16_t* y1,
                   uint16_t count) override {
@@ -162,6 +191,34 @@ class AddrWindowDevice : public DisplayDevice {
     }
   }
 
+  void writeSpans(BlendingMode blending_mode, Color* color, int16_t* x0,
+                  int16_t* y, int16_t* x1, uint16_t count) override {
+    while (count-- > 0) {
+      uint32_t pixel_count = *x1 - *x0 + 1;
+      AddrWindowDevice::setAddress(*x0++, *y, *x1++, *y, blending_mode);
+      ++y;
+      AddrWindowDevice::write(color, pixel_count);
+      color += pixel_count;
+    }
+  }
+
+  void fillSpans(BlendingMode blending_mode, Color color, int16_t* x0,
+                 int16_t* y, int16_t* x1, uint16_t count) override {
+    if (blending_mode == BLENDING_MODE_SOURCE_OVER) {
+      color = AlphaBlend(bgcolor_, color);
+    } else if (blending_mode == BLENDING_MODE_SOURCE_OVER_OPAQUE) {
+      color = AlphaBlendOverOpaque(bgcolor_, color);
+    }
+    raw_color_type raw_color = to_raw_color(color);
+
+    while (count-- > 0) {
+      uint32_t pixel_count = *x1 - *x0 + 1;
+      AddrWindowDevice::setAddress(*x0++, *y, *x1++, *y, BLENDING_MODE_SOURCE);
+      ++y;
+      target_.ramFill(raw_color, pixel_count);
+    }
+  }
+
   void writePixels(BlendingMode mode, Color* colors, int16_t* xs, int16_t* ys,
                    uint16_t pixel_count) override {
     compactor_.drawPixels(
@@ -2,12 +2,34 @@
 
 #include <memory>
 
+#include "roo_display/core/damage.h"
 #include "roo_display/core/offscreen.h"
 #include "roo_display/driver/common/compactor.h"
+#include "roo_display/internal/memdiff.h"
 
 namespace roo_display {
 
-template <typename Target>
+enum BufferedFlushMode {
+  // Flushes the (merged) bounding rectangles of everything that has been
+  // drawn.
+  BUFFERED_FLUSH_DAMAGE = 0,
+
+  // Compares the drawn pixels against the previous buffer content, tracks the
+  // span of actually changed pixels in each row, and flushes only those. Costs
+  // a comparison per write, and 4 bytes of memory per row, but redrawing
+  // unchanged content (e.g. a label that didn't change, drawn with
+  // FILL_MODE_RECTANGLE) generates no panel traffic at all. (Pixels that get
+  // changed and then restored within the same transaction are still
+  // flushed, though.)
+  BUFFERED_FLUSH_DIFF = 1,
+};
+
+// Display device that keeps a full copy of the framebuffer in memory, and
+// pushes modified regions to the underlying address-window Target. The writes
+// go to the in-memory buffer first; the damaged regions are tracked, and
+// flushed to the panel in end(). Overlapping writes within a single
+// transaction are thus pushed only once.
+template <typename Target, BufferedFlushMode flush_mode = BUFFERED_FLUSH_DAMAGE>
 class BufferedAddrWindowDevice : public DisplayDevice {
  public:
   typedef ColorStorageType<typename Target::ColorMode> raw_color_type;
@@ -19,11 +41,29 @@ class BufferedAddrWindowDevice : public DisplayDevice {
         buffer_(new uint8_t[(Target::ColorMode::bits_per_pixel *
                                  target.width() * target.height() +
                              7) /
-                            8]),
+                            8]()),
         buffer_dev_(target_.width(), target_.height(), buffer_.get(),
                     typename Target::ColorMode()),
         buffer_raster_(buffer_dev_.raster()),
-        compactor_() {}
+        compactor_(),
+        window_(0, 0, -1, -1),
+        cursor_x_(0),
+        cursor_y_(0) {
+    if (flush_mode == BUFFERED_FLUSH_DIFF) {
+      int16_t height = target_.height();
+      changed_x0_.reset(new int16_t[height]);
+      changed_x1_.reset(new int16_t[height]);
+      // The panel content is unknown, so the first flush sends the entire
+      // (zero-initialized) buffer.
+      for (int16_t y = 0; y < height; ++y) {
+        clearChanged(y);
+        addChanged(y, 0, target_.width() - 1);
+      }
+      row_snapshot_.reset(
+          new uint8_t[(Target::ColorMode::bits_per_pixel * target_.width() +
+                       7) / 8 + 1]);
+    }
+  }
 
   ~BufferedAddrWindowDevice() override {}
 
@@ -32,42 +72,127 @@ class BufferedAddrWindowDevice : public DisplayDevice {
   void begin() override { target_.begin(); }
 
   void end() override {
-    flushRectCache();
+    if (flush_mode == BUFFERED_FLUSH_DIFF) {
+      flushChanged();
+    } else {
+      flushRectCache();
+      flushDamage();
+    }
     target_.end();
   }
 
   void setAddress(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1,
                   BlendingMode mode) override {
+    if (flush_mode == BUFFERED_FLUSH_DIFF) {
+      buffer_dev_.setAddress(x0, y0, x1, y1, mode);
+      window_ = Box(x0, y0, x1, y1);
+      cursor_x_ = x0;
+      cursor_y_ = y0;
+      return;
+    }
     flushRectCache();
     buffer_dev_.setAddress(x0, y0, x1, y1, mode);
     rect_cache_.setWindow(x0, y0, x1, y1);
   }
 
   void write(Color* color, uint32_t pixel_count) override {
+    if (flush_mode == BUFFERED_FLUSH_DIFF) {
+      // Written, and compared, a row of the address window at a time.
+      while (pixel_count > 0) {
+        uint32_t n = window_.xMax() - cursor_x_ + 1;
+        if (n > pixel_count) n = pixel_count;
+        diffRow(cursor_y_, cursor_x_, cursor_x_ + n - 1,
+                [this, color, n]() { buffer_dev_.write(color, n); });
+        color += n;
+        pixel_count -= n;
+        cursor_x_ += n;
+        if (cursor_x_ > window_.xMax()) {
+          cursor_x_ = window_.xMin();
+          ++cursor_y_;
+        }
+      }
+      return;
+    }
     buffer_dev_.write(color, pixel_count);
     rect_cache_.pixelsWritten(pixel_count);
   }
 
   void writeRects(BlendingMode mode, Color* color, int16_t* x0, int16_t* y0,
                   int16_t* x1, int16_t* y1, uint16_t count) override {
+    if (flush_mode == BUFFERED_FLUSH_DIFF) {
+      while (count-- > 0) {
+        fillRectDiff(mode, Box(*x0++, *y0++, *x1++, *y1++), *color++);
+      }
+      return;
+    }
     flushRectCache();
     buffer_dev_.writeRects(mode, color, x0, y0, x1, y1, count);
     while (count-- > 0) {
-      target_.flushRect(buffer_raster_, *x0++, *y0++, *x1++, *y1++);
+      damage_.add(*x0++, *y0++, *x1++, *y1++);
     }
   }
 
   void fillRects(BlendingMode mode, Color color, int16_t* x0, int16_t* y0,
                  int16_t* x1, int16_t* y1, uint16_t count) override {
+    if (flush_mode == BUFFERED_FLUSH_DIFF) {
+      while (count-- > 0) {
+        fillRectDiff(mode, Box(*x0++, *y0++, *x1++, *y1++), color);
+      }
+      return;
+    }
     flushRectCache();
     buffer_dev_.fillRects(mode, color, x0, y0, x1, y1, count);
     while (count-- > 0) {
-      target_.flushRect(buffer_raster_, *x0++, *y0++, *x1++, *y1++);
+      damage_.add(*x0++, *y0++, *x1++, *y1++);
+    }
+  }
+
+  void writeSpans(BlendingMode mode, Color* color, int16_t* x0, int16_t* y,
+                  int16_t* x1, uint16_t count) override {
+    if (flush_mode == BUFFERED_FLUSH_DIFF) {
+      while (count-- > 0) {
+        int16_t sx0 = *x0++;
+        int16_t sy = *y++;
+        int16_t sx1 = *x1++;
+        diffRow(sy, sx0, sx1, [this, mode, color, sx0, sy, sx1]() {
+          buffer_dev_.setAddress(sx0, sy, sx1, sy, mode);
+          buffer_dev_.write(color, sx1 - sx0 + 1);
+        });
+        color += sx1 - sx0 + 1;
+      }
+      return;
+    }
+    flushRectCache();
+    buffer_dev_.writeSpans(mode, color, x0, y, x1, count);
+    while (count-- > 0) {
+      damage_.add(*x0++, *y, *x1++, *y);
+      ++y;
+    }
+  }
+
+  void fillSpans(BlendingMode mode, Color color, int16_t* x0, int16_t* y,
+                 int16_t* x1, uint16_t count) override {
+    if (flush_mode == BUFFERED_FLUSH_DIFF) {
+      while (count-- > 0) {
+        fillRectDiff(mode, Box(*x0++, *y, *x1++, *y), color);
+        ++y;
+      }
+      return;
+    }
+    flushRectCache();
+    buffer_dev_.fillSpans(mode, color, x0, y, x1, count);
+    while (count-- > 0) {
+      damage_.add(*x0++, *y, *x1++, *y);
+      ++y;
     }
   }
 
   void writePixels(BlendingMode mode, Color* colors, int16_t* xs, int16_t* ys,
                    uint16_t pixel_count) override {
+    if (flush_mode == BUFFERED_FLUSH_DIFF) {
+      writePixelsDiff(mode, colors, xs, ys, pixel_count);
+      return;
+    }
     compactor_.drawPixels(
         xs, ys, pixel_count,
         [this, mode, colors](int16_t offset, int16_t x, int16_t y,
@@ -77,27 +202,27 @@ class BufferedAddrWindowDevice : public DisplayDevice {
             case Compactor::RIGHT: {
               buffer_dev_.setAddress(x, y, x + count - 1, y, mode);
               buffer_dev_.write(colors + offset, count);
-              target_.flushRect(buffer_raster_, x, y, x + count - 1, y);
+              damage_.add(x, y, x + count - 1, y);
               break;
             }
             case Compactor::DOWN: {
               buffer_dev_.setAddress(x, y, x, y + count - 1, mode);
               buffer_dev_.write(colors + offset, count);
-              target_.flushRect(buffer_raster_, x, y, x, y + count - 1);
+              damage_.add(x, y, x, y + count - 1);
               break;
             }
             case Compactor::LEFT: {
               buffer_dev_.setAddress(x - count + 1, y, x, y, mode);
               std::reverse(colors + offset, colors + offset + count);
               buffer_dev_.write(colors + offset, count);
-              target_.flushRect(buffer_raster_, x - count + 1, y, x, y);
+              damage_.add(x - count + 1, y, x, y);
               break;
             }
             case Compactor::UP: {
               buffer_dev_.setAddress(x, y - count + 1, x, y, mode);
               std::reverse(colors + offset, colors + offset + count);
               buffer_dev_.write(colors + offset, count);
-              target_.flushRect(buffer_raster_, x, y - count + 1, x, y);
+              damage_.add(x, y - count + 1, x, y);
               break;
             }
           }
@@ -106,6 +231,10 @@ class BufferedAddrWindowDevice : public DisplayDevice {
 
   void fillPixels(BlendingMode mode, Color color, int16_t* xs, int16_t* ys,
                   uint16_t pixel_count) override {
+    if (flush_mode == BUFFERED_FLUSH_DIFF) {
+      fillPixelsDiff(mode, color, xs, ys, pixel_count);
+      return;
+    }
     compactor_.drawPixels(
         xs, ys, pixel_count,
         [this, mode, color](int16_t offset, int16_t x, int16_t y,
@@ -114,28 +243,49 @@ class BufferedAddrWindowDevice : public DisplayDevice {
           switch (direction) {
             case Compactor::RIGHT: {
               buffer_dev_.fillRect(mode, Box(x, y, x + count - 1, y), color);
-              target_.flushRect(buffer_raster_, x, y, x + count - 1, y);
+              damage_.add(x, y, x + count - 1, y);
               break;
             }
             case Compactor::DOWN: {
               buffer_dev_.fillRect(mode, Box(x, y, x, y + count - 1), color);
-              target_.flushRect(buffer_raster_, x, y, x, y + count - 1);
+              damage_.add(x, y, x, y + count - 1);
               break;
             }
             case Compactor::LEFT: {
               buffer_dev_.fillRect(mode, Box(x - count + 1, y, x, y), color);
-              target_.flushRect(buffer_raster_, x - count + 1, y, x, y);
+              damage_.add(x - count + 1, y, x, y);
               break;
             }
             case Compactor::UP: {
               buffer_dev_.fillRect(mode, Box(x, y - count + 1, x, y), color);
-              target_.flushRect(buffer_raster_, x, y - count + 1, x, y);
+              damage_.add(x, y - count + 1, x, y);
               break;
             }
           }
         });
   }
 
+  // Moves the src rectangle so that its top-left corner lands at (dst_x,
+  // dst_y), in place, with memmove semantics (see OffscreenDevice::copyRect).
+  // Only the destination rectangle is marked as damaged; the caller is then
+  // expected to draw the newly exposed strip.
+  void copyRect(const Box& src, int16_t dst_x, int16_t dst_y) {
+    flushRectCache();
+    buffer_dev_.copyRect(src, dst_x, dst_y);
+    Box dst = Box::Intersect(
+        src.translate(dst_x - src.xMin(), dst_y - src.yMin()),
+        Box(0, 0, effective_width() - 1, effective_height() - 1));
+    if (dst.empty()) return;
+    if (flush_mode == BUFFERED_FLUSH_DIFF) {
+      // Not compared; the whole destination is considered changed.
+      for (int16_t y = dst.yMin(); y <= dst.yMax(); ++y) {
+        addChanged(y, dst.xMin(), dst.xMax());
+      }
+    } else {
+      damage_.add(dst);
+    }
+  }
+
   void orientationUpdated() override { target_.setOrientation(orientation()); }
 
   static inline raw_color_type to_raw_color(Color color) {
@@ -146,6 +296,8 @@ class BufferedAddrWindowDevice : public DisplayDevice {
  private:
   class RectCache {
    public:
+    RectCache() : window_(0, 0, -1, -1), begin_(0), end_(0) {}
+
     void setWindow(int16_t x0, int16_t y0, int16_t x1, int16_t y1)
         __attribute__((always_inline)) {
       window_ = Box(x0, y0, x1, y1);
@@ -218,6 +370,163 @@ class BufferedAddrWindowDevice : public DisplayDevice {
     while (true) {
       Box box = rect_cache_.consume();
       if (box.empty()) return;
+      damage_.add(box);
+    }
+  }
+
+  void flushDamage() {
+    for (const Box& box : damage_) {
+      target_.flushRect(buffer_raster_, box.xMin(), box.yMin(), box.xMax(),
+                        box.yMax());
+    }
+    damage_.clear();
+  }
+
+  // Cost of opening a new address window, expressed in the number of pixels
+  // that could be transferred instead. Adjacent rows get flushed in a single
+  // window if it doesn't waste more than that.
+  static constexpr int32_t kWindowOverheadPixels = 16;
+
+  void clearChanged(int16_t y) {
+    changed_x0_[y] = target_.width();
+    changed_x1_[y] = -1;
+  }
+
+  bool isChanged(int16_t y) const { return changed_x0_[y] <= changed_x1_[y]; }
+
+  void addChanged(int16_t y, int16_t x0, int16_t x1) {
+    if (x0 < changed_x0_[y]) changed_x0_[y] = x0;
+    if (x1 > changed_x1_[y]) changed_x1_[y] = x1;
+  }
+
+  // Applies op, which modifies the pixels [x0, x1] of the row y, comparing
+  // the row segment before and after, and registering the changed span.
+  template <typename Op>
+  void diffRow(int16_t y, int16_t x0, int16_t x1, const Op& op) {
+    const int bits_per_pixel = Target::ColorMode::bits_per_pixel;
+    uint32_t row_start = (uint32_t)y * target_.width();
+    uint32_t begin = (row_start + x0) * bits_per_pixel / 8;
+    uint32_t end = ((row_start + x1 + 1) * bits_per_pixel + 7) / 8;
+    const uint8_t* data = buffer_.get() + begin;
+    memcpy(row_snapshot_.get(), data, end - begin);
+    op();
+    uint32_t first, last;
+    if (!mem_diff(row_snapshot_.get(), data, end - begin, &first, &last)) {
+      return;
+    }
+    // Map the changed bytes back to pixels. (For sub-byte color modes, a
+    // byte may cover pixels outside of the segment).
+    int32_t changed_x0 =
+        (int32_t)((begin + first) * 8 / bits_per_pixel) - (int32_t)row_start;
+    int32_t changed_x1 = (int32_t)(((begin + last) * 8 + 7) / bits_per_pixel) -
+                         (int32_t)row_start;
+    addChanged(y, changed_x0 > x0 ? changed_x0 : x0,
+               changed_x1 < x1 ? changed_x1 : x1);
+  }
+
+  void fillRectDiff(BlendingMode mode, const Box& box, Color color) {
+    for (int16_t y = box.yMin(); y <= box.yMax(); ++y) {
+      diffRow(y, box.xMin(), box.xMax(), [this, mode, &box, y, color]() {
+        buffer_dev_.fillRect(mode, Box(box.xMin(), y, box.xMax(), y), color);
+      });
+    }
+  }
+
+  void writePixelsDiff(BlendingMode mode, Color* colors, int16_t* xs,
+                       int16_t* ys, uint16_t pixel_count) {
+    compactor_.drawPixels(
+        xs, ys, pixel_count,
+        [this, mode, colors](int16_t offset, int16_t x, int16_t y,
+                             Compactor::WriteDirection direction,
+                             int16_t count) {
+          switch (direction) {
+            case Compactor::RIGHT: {
+              diffRow(y, x, x + count - 1, [this, mode, colors, offset, x, y,
+                                            count]() {
+                buffer_dev_.setAddress(x, y, x + count - 1, y, mode);
+                buffer_dev_.write(colors + offset, count);
+              });
+              break;
+            }
+            case Compactor::LEFT: {
+              std::reverse(colors + offset, colors + offset + count);
+              diffRow(y, x - count + 1, x, [this, mode, colors, offset, x, y,
+                                            count]() {
+                buffer_dev_.setAddress(x - count + 1, y, x, y, mode);
+                buffer_dev_.write(colors + offset, count);
+              });
+              break;
+            }
+            case Compactor::DOWN:
+            case Compactor::UP: {
+              int16_t dy = (direction == Compactor::DOWN ? 1 : -1);
+              for (int16_t i = 0; i < count; ++i) {
+                int16_t py = y + i * dy;
+                Color* color = colors + offset + i;
+                diffRow(py, x, x, [this, mode, color, x, py]() {
+                  buffer_dev_.setAddress(x, py, x, py, mode);
+                  buffer_dev_.write(color, 1);
+                });
+              }
+              break;
+            }
+          }
+        });
+  }
+
+  void fillPixelsDiff(BlendingMode mode, Color color, int16_t* xs,
+                      int16_t* ys, uint16_t pixel_count) {
+    compactor_.drawPixels(
+        xs, ys, pixel_count,
+        [this, mode, color](int16_t offset, int16_t x, int16_t y,
+                            Compactor::WriteDirection direction,
+                            int16_t count) {
+          switch (direction) {
+            case Compactor::RIGHT: {
+              fillRectDiff(mode, Box(x, y, x + count - 1, y), color);
+              break;
+            }
+            case Compactor::DOWN: {
+              fillRectDiff(mode, Box(x, y, x, y + count - 1), color);
+              break;
+            }
+            case Compactor::LEFT: {
+              fillRectDiff(mode, Box(x - count + 1, y, x, y), color);
+              break;
+            }
+            case Compactor::UP: {
+              fillRectDiff(mode, Box(x, y - count + 1, x, y), color);
+              break;
+            }
+          }
+        });
+  }
+
+  // Flushes the changed spans, merging adjacent rows into common windows as
+  // long as it doesn't cost more than opening separate windows.
+  void flushChanged() {
+    int16_t height = target_.height();
+    int16_t y = 0;
+    while (y < height) {
+      if (!isChanged(y)) {
+        ++y;
+        continue;
+      }
+      Box box(changed_x0_[y], y, changed_x1_[y], y);
+      int32_t changed_area = box.area();
+      clearChanged(y);
+      ++y;
+      while (y < height && isChanged(y)) {
+        Box row(changed_x0_[y], y, changed_x1_[y], y);
+        Box merged = Box::Extent(box, row);
+        if (merged.area() > changed_area + row.area() + kWindowOverheadPixels) {
+          break;
+        }
+        box = merged;
+        changed_area += row.area();
+        clearChanged(y);
+        ++y;
+      }
       target_.flushRect(buffer_raster_, box.xMin(), box.yMin(), box.xMax(),
                         box.yMax());
     }
@@ -228,7 +537,22 @@ class BufferedAddrWindowDevice : public DisplayDevice {
   OffscreenDevice<typename Target::ColorMode> buffer_dev_;
   ConstDramRaster<typename Target::ColorMode> buffer_raster_;
   RectCache rect_cache_;
+  DamageTracker damage_;
   Compactor compactor_;
+
+  // Used in BUFFERED_FLUSH_DIFF mode only.
+
+  // Per row, the span of the pixels changed since the last flush.
+  std::unique_ptr<int16_t[]> changed_x0_;
+  std::unique_ptr<int16_t[]> changed_x1_;
+
+  // Previous content of the row segment being modified.
+  std::unique_ptr<uint8_t[]> row_snapshot_;
+
+  // The address window, and the cursor.
+  Box window_;
+  int16_t cursor_x_;
+  int16_t cursor_y_;
 };
 
 }  // namespace roo_display
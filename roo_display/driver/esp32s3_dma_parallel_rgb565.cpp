@@ -202,6 +202,23 @@ void ParallelRgb565<FLUSH_MODE_AGGRESSIVE>::fillRects(BlendingMode mode,
   buffer_->fillRects(mode, color, x0, y0, x1, y1, count);
 }
 
+template <>
+void ParallelRgb565<FLUSH_MODE_AGGRESSIVE>::writeSpans(BlendingMode mode,
+                                                       Color *color,
+                                                       int16_t *x0, int16_t *y,
+                                                       int16_t *x1,
+                                                       uint16_t count) {
+  buffer_->writeSpans(mode, color, x0, y, x1, count);
+}
+
+template <>
+void ParallelRgb565<FLUSH_MODE_AGGRESSIVE>::fillSpans(BlendingMode mode,
+                                                      Color color, int16_t *x0,
+                                                      int16_t *y, int16_t *x1,
+                                                      uint16_t count) {
+  buffer_->fillSpans(mode, color, x0, y, x1, count);
+}
+
 namespace {
 
 struct FlushRange {
@@ -232,8 +249,47 @@ inline FlushRange ResolveFlushRangeForRects(const Config &cfg,
   };
 }
 
+// Returns the target rectangle of copyRect(), clipped to the screen.
+inline Box CopyRectTarget(const Box &src, int16_t dst_x, int16_t dst_y,
+                          int16_t width, int16_t height) {
+  return Box::Intersect(src.translate(dst_x - src.xMin(), dst_y - src.yMin()),
+                        Box(0, 0, width - 1, height - 1));
+}
+
+// Returns the bounding box of the specified rectangles, or an empty box if
+// count is zero.
+inline Box BoundingBox(const int16_t *x0, const int16_t *y0, const int16_t *x1,
+                       const int16_t *y1, uint16_t count) {
+  if (count == 0) return Box(0, 0, -1, -1);
+  Box result(*x0++, *y0++, *x1++, *y1++);
+  while (--count > 0) {
+    result = Box::Extent(result, Box(*x0++, *y0++, *x1++, *y1++));
+  }
+  return result;
+}
+
 }  // namespace
 
+template <>
+void ParallelRgb565<FLUSH_MODE_AGGRESSIVE>::copyRect(const Box &src,
+                                                     int16_t dst_x,
+                                                     int16_t dst_y) {
+  // The copy bypasses the color mode's writers, so the cache needs to be
+  // written back explicitly.
+  Box dst = CopyRectTarget(src, dst_x, dst_y, effective_width(),
+                           effective_height());
+  if (dst.empty()) return;
+  buffer_->copyRect(src, dst_x, dst_y);
+  int16_t x0 = dst.xMin();
+  int16_t y0 = dst.yMin();
+  int16_t x1 = dst.xMax();
+  int16_t y1 = dst.yMax();
+  FlushRange range =
+      ResolveFlushRangeForRects(cfg_, orientation(), &x0, &y0, &x1, &y1, 1);
+  Cache_WriteBack_Addr((uint32_t)buffer_->buffer() + range.offset,
+                       range.length);
+}
+
 template <>
 void ParallelRgb565<FLUSH_MODE_BUFFERED>::init() {
   uint8_t *buffer = AllocateBuffer(cfg_);
@@ -313,6 +369,48 @@ void ParallelRgb565<FLUSH_MODE_BUFFERED>::fillRects(BlendingMode mode, Color col
                        range.length);
 }
 
+template <>
+void ParallelRgb565<FLUSH_MODE_BUFFERED>::writeSpans(BlendingMode mode,
+                                                     Color *color, int16_t *x0,
+                                                     int16_t *y, int16_t *x1,
+                                                     uint16_t count) {
+  FlushRange range =
+      ResolveFlushRangeForRects(cfg_, orientation(), x0, y, x1, y, count);
+  buffer_->writeSpans(mode, color, x0, y, x1, count);
+  Cache_WriteBack_Addr((uint32_t)buffer_->buffer() + range.offset,
+                       range.length);
+}
+
+template <>
+void ParallelRgb565<FLUSH_MODE_BUFFERED>::fillSpans(BlendingMode mode,
+                                                    Color color, int16_t *x0,
+                                                    int16_t *y, int16_t *x1,
+                                                    uint16_t count) {
+  FlushRange range =
+      ResolveFlushRangeForRects(cfg_, orientation(), x0, y, x1, y, count);
+  buffer_->fillSpans(mode, color, x0, y, x1, count);
+  Cache_WriteBack_Addr((uint32_t)buffer_->buffer() + range.offset,
+                       range.length);
+}
+
+template <>
+void ParallelRgb565<FLUSH_MODE_BUFFERED>::copyRect(const Box &src,
+                                                   int16_t dst_x,
+                                                   int16_t dst_y) {
+  Box dst = CopyRectTarget(src, dst_x, dst_y, effective_width(),
+                           effective_height());
+  if (dst.empty()) return;
+  buffer_->copyRect(src, dst_x, dst_y);
+  int16_t x0 = dst.xMin();
+  int16_t y0 = dst.yMin();
+  int16_t x1 = dst.xMax();
+  int16_t y1 = dst.yMax();
+  FlushRange range =
+      ResolveFlushRangeForRects(cfg_, orientation(), &x0, &y0, &x1, &y1, 1);
+  Cache_WriteBack_Addr((uint32_t)buffer_->buffer() + range.offset,
+                       range.length);
+}
+
 template <>
 void ParallelRgb565<FLUSH_MODE_LAZY>::init() {
   uint8_t *buffer = AllocateBuffer(cfg_);
@@ -323,9 +421,18 @@ void ParallelRgb565<FLUSH_MODE_LAZY>::init() {
 template <>
 void ParallelRgb565<FLUSH_MODE_LAZY>::end() {
   if (buffer_ != nullptr) {
-    Cache_WriteBack_Addr((uint32_t)(buffer_->buffer()),
-                         cfg_.width * cfg_.height * 2);
+    for (const Box &box : damage_) {
+      int16_t x0 = box.xMin();
+      int16_t y0 = box.yMin();
+      int16_t x1 = box.xMax();
+      int16_t y1 = box.yMax();
+      FlushRange range =
+          ResolveFlushRangeForRects(cfg_, orientation(), &x0, &y0, &x1, &y1, 1);
+      Cache_WriteBack_Addr((uint32_t)buffer_->buffer() + range.offset,
+                           range.length);
+    }
   }
+  damage_.clear();
 }
 
 template <>
@@ -338,6 +445,7 @@ template <>
 void ParallelRgb565<FLUSH_MODE_LAZY>::writePixels(BlendingMode mode, Color *color,
                                                   int16_t *x, int16_t *y,
                                                   uint16_t pixel_count) {
+  damage_.add(BoundingBox(x, y, x, y, pixel_count));
   buffer_->writePixels(mode, color, x, y, pixel_count);
 }
 
@@ -345,6 +453,7 @@ template <>
 void ParallelRgb565<FLUSH_MODE_LAZY>::fillPixels(BlendingMode mode, Color color,
                                                  int16_t *x, int16_t *y,
                                                  uint16_t pixel_count) {
+  damage_.add(BoundingBox(x, y, x, y, pixel_count));
   buffer_->fillPixels(mode, color, x, y, pixel_count);
 }
 
@@ -353,6 +462,7 @@ void ParallelRgb565<FLUSH_MODE_LAZY>::writeRects(BlendingMode mode, Color *color
                                                  int16_t *x0, int16_t *y0,
                                                  int16_t *x1, int16_t *y1,
                                                  uint16_t count) {
+  damage_.add(BoundingBox(x0, y0, x1, y1, count));
   buffer_->writeRects(mode, color, x0, y0, x1, y1, count);
 }
 
@@ -361,9 +471,36 @@ void ParallelRgb565<FLUSH_MODE_LAZY>::fillRects(BlendingMode mode, Color color,
                                                 int16_t *x0, int16_t *y0,
                                                 int16_t *x1, int16_t *y1,
                                                 uint16_t count) {
+  damage_.add(BoundingBox(x0, y0, x1, y1, count));
   buffer_->fillRects(mode, color, x0, y0, x1, y1, count);
 }
 
+template <>
+void ParallelRgb565<FLUSH_MODE_LAZY>::writeSpans(BlendingMode mode, Color *color,
+                                                 int16_t *x0, int16_t *y,
+                                                 int16_t *x1, uint16_t count) {
+  damage_.add(BoundingBox(x0, y, x1, y, count));
+  buffer_->writeSpans(mode, color, x0, y, x1, count);
+}
+
+template <>
+void ParallelRgb565<FLUSH_MODE_LAZY>::fillSpans(BlendingMode mode, Color color,
+                                                int16_t *x0, int16_t *y,
+                                                int16_t *x1, uint16_t count) {
+  damage_.add(BoundingBox(x0, y, x1, y, count));
+  buffer_->fillSpans(mode, color, x0, y, x1, count);
+}
+
+template <>
+void ParallelRgb565<FLUSH_MODE_LAZY>::copyRect(const Box &src, int16_t dst_x,
+                                               int16_t dst_y) {
+  Box dst = CopyRectTarget(src, dst_x, dst_y, effective_width(),
+                           effective_height());
+  if (dst.empty()) return;
+  damage_.add(dst);
+  buffer_->copyRect(src, dst_x, dst_y);
+}
+
 // #if FLUSH_MODE == FLUSH_MODE_HARDCODED
 
 // void ParallelRgb565::setAddress(uint16_t x0, uint16_t y0, uint16_t x1,
@@ -10,6 +10,7 @@
 
 #include "rom/cache.h"
 #include "roo_display/color/blending.h"
+#include "roo_display/core/damage.h"
 #include "roo_display/core/device.h"
 #include "roo_display/core/offscreen.h"
 
@@ -48,7 +49,8 @@ class Rgb565DmaBlendingWriterOperator {
   void operator()(uint8_t *p, uint32_t offset, uint32_t count) {
     internal::RawIterator<16, BYTE_ORDER_LITTLE_ENDIAN> itr(p, offset);
     RawBlender<Rgb565Dma, blending_mode> blender;
-    while (count-- > 0) {
+    uint32_t n = count;
+    while (n-- > 0) {
       itr.write(blender(itr.read(), *color_++, color_mode_));
       ++itr;
     }
@@ -110,7 +112,8 @@ class Rgb565DmaBlendingFillerOperator {
   void operator()(uint8_t *p, uint32_t offset, uint32_t count) const {
     internal::RawIterator<16, BYTE_ORDER_LITTLE_ENDIAN> itr(p, offset);
     RawBlender<Rgb565Dma, blending_mode> blender;
-    while (count-- > 0) {
+    uint32_t n = count;
+    while (n-- > 0) {
       itr.write(blender(itr.read(), color_, Rgb565Dma()));
       ++itr;
     }
@@ -173,8 +176,8 @@ enum FlushMode {
   // rectangles.
   FLUSH_MODE_BUFFERED = 1,
 
-  // Only writes back at the end of transaction (in device.end()). In theory,
-  // that sounds like good
+  // Only writes back at the end of transaction (in device.end()), limited to
+  // the regions that have been modified. In theory, that sounds like good
   // idea. And indeed, it seems the fastest. In practice, for some reason it
   // causes displays to lose synchronization quite a lot.
   FLUSH_MODE_LAZY = 2,
@@ -248,6 +251,7 @@ class ParallelRgb565 : public DisplayDevice {
   void setAddress(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1,
                   BlendingMode mode) override {
     buffer_->setAddress(x0, y0, x1, y1, mode);
+    if (flush_mode == FLUSH_MODE_LAZY) damage_.add(x0, y0, x1, y1);
   }
 
   void write(Color *color, uint32_t pixel_count) override;
@@ -264,6 +268,18 @@ class ParallelRgb565 : public DisplayDevice {
   void fillRects(BlendingMode mode, Color color, int16_t *x0, int16_t *y0,
                  int16_t *x1, int16_t *y1, uint16_t count) override;
 
+  void writeSpans(BlendingMode mode, Color *color, int16_t *x0, int16_t *y,
+                  int16_t *x1, uint16_t count) override;
+
+  void fillSpans(BlendingMode mode, Color color, int16_t *x0, int16_t *y,
+                 int16_t *x1, uint16_t count) override;
+
+  // Moves the src rectangle so that its top-left corner lands at (dst_x,
+  // dst_y), in place, with memmove semantics (see OffscreenDevice::copyRect).
+  // The destination rectangle is written back to the framebuffer memory
+  // according to the flush mode.
+  void copyRect(const Box &src, int16_t dst_x, int16_t dst_y);
+
   void orientationUpdated() override {
     if (buffer_ != nullptr) {
       buffer_->orientationUpdated();
@@ -277,6 +293,9 @@ class ParallelRgb565 : public DisplayDevice {
 
   Config cfg_;
   std::unique_ptr<Dev> buffer_;
+
+  // Used in FLUSH_MODE_LAZY, to only write back the modified regions in end().
+  DamageTracker damage_;
 };
 
 using ParallelRgb565Buffered = ParallelRgb565<FLUSH_MODE_BUFFERED>;
@@ -94,7 +94,7 @@ void BackgroundFillOptimizer::setAddress(uint16_t x0, uint16_t y0, uint16_t x1,
 
 void BackgroundFillOptimizer::write(Color* color, uint32_t pixel_count) {
   // Naive implementation, for now.
-  BufferedPixelWriter writer(output_, blending_mode_);
+  BufferedSpanWriter writer(output_, blending_mode_);
   while (pixel_count-- > 0) {
     writePixel(cursor_x_, cursor_y_, *color++, &writer);
     if (++cursor_x_ > address_window_.xMax()) {
@@ -155,6 +155,42 @@ void BackgroundFillOptimizer::fillRects(BlendingMode mode, Color color,
   }
 }
 
+void BackgroundFillOptimizer::writeSpans(BlendingMode mode, Color* color,
+                                         int16_t* x0, int16_t* y, int16_t* x1,
+                                         uint16_t count) {
+  BufferedSpanWriter writer(output_, mode);
+  while (count-- > 0) {
+    int16_t yc = *y++;
+    for (int16_t x = *x0++; x <= *x1; ++x) {
+      writePixel(x, yc, *color++, &writer);
+    }
+    ++x1;
+  }
+}
+
+void BackgroundFillOptimizer::fillSpans(BlendingMode mode, Color color,
+                                        int16_t* x0, int16_t* y, int16_t* x1,
+                                        uint16_t count) {
+  uint8_t palette_idx = getIdxInPalette(color);
+  if (palette_idx != 0) {
+    BufferedRectFiller filler(output_, color, mode);
+    while (count-- > 0) {
+      int16_t yc = *y++;
+      fillRectBg(*x0++, yc, *x1++, yc, &filler, palette_idx);
+    }
+  } else {
+    for (int i = 0; i < count; ++i) {
+      // Not a background color -> clear the nibbles covering the span.
+      background_mask_->fillRect(Box(x0[i] / kBgFillOptimizerWindowSize,
+                                     y[i] / kBgFillOptimizerWindowSize,
+                                     x1[i] / kBgFillOptimizerWindowSize,
+                                     y[i] / kBgFillOptimizerWindowSize),
+                                 0);
+    }
+    output_.fillSpans(mode, color, x0, y, x1, count);
+  }
+}
+
 void BackgroundFillOptimizer::writePixels(BlendingMode mode, Color* color,
                                           int16_t* x, int16_t* y,
                                           uint16_t pixel_count) {
@@ -230,7 +266,7 @@ inline uint8_t BackgroundFillOptimizer::getIdxInPalette(Color color) {
 }
 
 void BackgroundFillOptimizer::writePixel(int16_t x, int16_t y, Color c,
-                                         BufferedPixelWriter* writer) {
+                                         BufferedSpanWriter* writer) {
   uint8_t palette_idx = getIdxInPalette(c);
   if (palette_idx != 0) {
     // Skip writing if the containing bit-mask mapped rectangle
@@ -130,6 +130,12 @@ class BackgroundFillOptimizer : public DisplayOutput {
   void fillRects(BlendingMode mode, Color color, int16_t* x0, int16_t* y0,
                  int16_t* x1, int16_t* y1, uint16_t count) override;
 
+  void writeSpans(BlendingMode mode, Color* color, int16_t* x0, int16_t* y,
+                  int16_t* x1, uint16_t count) override;
+
+  void fillSpans(BlendingMode mode, Color color, int16_t* x0, int16_t* y,
+                 int16_t* x1, uint16_t count) override;
+
   void writePixels(BlendingMode mode, Color* color, int16_t* x, int16_t* y,
                    uint16_t pixel_count) override;
 
@@ -148,7 +154,7 @@ class BackgroundFillOptimizer : public DisplayOutput {
   // the background palette, and 0 otherwise.
   inline uint8_t getIdxInPalette(Color color);
 
-  void writePixel(int16_t x, int16_t y, Color c, BufferedPixelWriter* writer);
+  void writePixel(int16_t x, int16_t y, Color c, BufferedSpanWriter* writer);
 
   template <typename Filler>
   void fillRectBg(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
@@ -207,6 +213,16 @@ class BackgroundFillOptimizerDevice : public DisplayDevice {
     optimizer_.fillRects(mode, color, x0, y0, x1, y1, count);
   }
 
+  void writeSpans(BlendingMode mode, Color* color, int16_t* x0, int16_t* y,
+                  int16_t* x1, uint16_t count) override {
+    optimizer_.writeSpans(mode, color, x0, y, x1, count);
+  }
+
+  void fillSpans(BlendingMode mode, Color color, int16_t* x0, int16_t* y,
+                 int16_t* x1, uint16_t count) override {
+    optimizer_.fillSpans(mode, color, x0, y, x1, count);
+  }
+
   void writePixels(BlendingMode mode, Color* color, int16_t* x, int16_t* y,
                    uint16_t pixel_count) override {
     optimizer_.writePixels(mode, color, x, y, pixel_count);
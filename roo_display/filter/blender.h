@@ -58,28 +58,31 @@ class BlendingFilter : public DisplayOutput {
   }
 
   void write(Color* color, uint32_t pixel_count) override {
-    int16_t x[pixel_count];
-    int16_t y[pixel_count];
-    Color newcolor[pixel_count];
-
-    for (uint32_t i = 0; i < pixel_count; ++i) {
-      x[i] = cursor_x_++;
-      y[i] = cursor_y_;
+    Color newcolor[kMaxSpanChunk];
+    while (pixel_count > 0) {
+      // Process up to the end of the current row of the address window, in
+      // chunks, so that the stack buffer stays bounded.
+      uint32_t n = address_window_.xMax() - cursor_x_ + 1;
+      if (n > kMaxSpanChunk) n = kMaxSpanChunk;
+      if (n > pixel_count) n = pixel_count;
+      readRow(cursor_x_, cursor_y_, cursor_x_ + n - 1, newcolor);
+      for (uint32_t i = 0; i < n; ++i) {
+        newcolor[i] = blender_(newcolor[i], color[i]);
+      }
+      if (bgcolor_ != color::Transparent) {
+        for (uint32_t i = 0; i < n; ++i) {
+          newcolor[i] = AlphaBlend(bgcolor_, newcolor[i]);
+        }
+      }
+      output_->write(newcolor, n);
+      color += n;
+      pixel_count -= n;
+      cursor_x_ += n;
       if (cursor_x_ > address_window_.xMax()) {
         cursor_y_++;
         cursor_x_ = address_window_.xMin();
       }
     }
-    raster_->readColorsMaybeOutOfBounds(x, y, pixel_count, newcolor);
-    for (uint32_t i = 0; i < pixel_count; ++i) {
-      newcolor[i] = blender_(newcolor[i], color[i]);
-    }
-    if (bgcolor_ != color::Transparent) {
-      for (uint32_t i = 0; i < pixel_count; ++i) {
-        newcolor[i] = AlphaBlend(bgcolor_, newcolor[i]);
-      }
-    }
-    output_->write(newcolor, pixel_count);
   }
 
   // void fill(BlendingMode mode, Color color, uint32_t pixel_count) override {
@@ -112,6 +115,46 @@ class BlendingFilter : public DisplayOutput {
     }
   }
 
+  void writeSpans(BlendingMode mode, Color* color, int16_t* x0, int16_t* y,
+                  int16_t* x1, uint16_t count) override {
+    Color newcolor[kMaxSpanChunk];
+    while (count-- > 0) {
+      int16_t yc = *y++;
+      int16_t xMin = *x0++;
+      int16_t xMax = *x1++;
+      // Process in chunks, so that the stack buffer stays bounded.
+      while (xMin <= xMax) {
+        int16_t xEnd = xMax;
+        if (xEnd - xMin >= kMaxSpanChunk) xEnd = xMin + kMaxSpanChunk - 1;
+        uint16_t pixel_count = xEnd - xMin + 1;
+        readSpan(xMin, yc, xEnd, newcolor);
+        for (uint16_t i = 0; i < pixel_count; ++i) {
+          newcolor[i] = blender_(newcolor[i], color[i]);
+        }
+        if (bgcolor_ != color::Transparent) {
+          for (uint16_t i = 0; i < pixel_count; ++i) {
+            newcolor[i] = AlphaBlend(bgcolor_, newcolor[i]);
+          }
+        }
+        // The output may modify the coordinates; pass copies.
+        int16_t sx0 = xMin;
+        int16_t sy = yc;
+        int16_t sx1 = xEnd;
+        output_->writeSpans(mode, newcolor, &sx0, &sy, &sx1, 1);
+        color += pixel_count;
+        xMin = xEnd + 1;
+      }
+    }
+  }
+
+  void fillSpans(BlendingMode mode, Color color, int16_t* x0, int16_t* y,
+                 int16_t* x1, uint16_t count) override {
+    while (count-- > 0) {
+      int16_t yc = *y++;
+      fillRect(mode, *x0++, yc, *x1++, yc, color);
+    }
+  }
+
   void writePixels(BlendingMode mode, Color* color, int16_t* x, int16_t* y,
                    uint16_t pixel_count) override {
     Color newcolor[pixel_count];
@@ -143,6 +186,38 @@ class BlendingFilter : public DisplayOutput {
   }
 
  private:
+  static constexpr int16_t kMaxSpanChunk = 64;
+
+  // Reads the raster colors for the horizontal span [xMin, xMax] at row y,
+  // expressed in the output coordinates. The span must not be longer than
+  // kMaxSpanChunk.
+  void readSpan(int16_t xMin, int16_t y, int16_t xMax, Color* result) {
+    readRow(xMin - dx_, y - dy_, xMax - dx_, result);
+  }
+
+  // Reads the raster colors for the horizontal span [xMin, xMax] at row y,
+  // expressed in the raster coordinates. Pixels out of the raster's bounds
+  // are transparent.
+  void readRow(int16_t xMin, int16_t y, int16_t xMax, Color* result) {
+    const Box extents = raster_->extents();
+    if (y < extents.yMin() || y > extents.yMax() || xMax < extents.xMin() ||
+        xMin > extents.xMax()) {
+      FillColor(result, xMax - xMin + 1, color::Transparent);
+      return;
+    }
+    if (xMin < extents.xMin()) {
+      FillColor(result, extents.xMin() - xMin, color::Transparent);
+      result += extents.xMin() - xMin;
+      xMin = extents.xMin();
+    }
+    if (xMax > extents.xMax()) {
+      FillColor(result + (extents.xMax() - xMin + 1), xMax - extents.xMax(),
+                color::Transparent);
+      xMax = extents.xMax();
+    }
+    raster_->readColorRow(y, xMin, xMax, result);
+  }
+
   void read(int16_t* x, int16_t* y, uint16_t pixel_count, Color* result) {
     if (dx_ == 0 && dy_ == 0) {
       raster_->readColorsMaybeOutOfBounds(x, y, pixel_count, result);
@@ -67,7 +67,7 @@ class RectUnionFilter : public DisplayOutput {
   void write(Color* color, uint32_t pixel_count) override {
     // Naive implementation, for now.
     uint32_t i = 0;
-    BufferedPixelWriter writer(*output_, blending_mode_);
+    BufferedSpanWriter writer(*output_, blending_mode_);
     while (i < pixel_count) {
       if (!exclusion_->contains(cursor_x_, cursor_y_)) {
         writer.writePixel(cursor_x_, cursor_y_, color[i]);
@@ -107,7 +107,7 @@ class ClipMaskFilter : public DisplayOutput {
   void write(Color* color, uint32_t pixel_count) override {
     // Naive implementation, for now.
     uint32_t i = 0;
-    BufferedPixelWriter writer(output_, blending_mode_);
+    BufferedSpanWriter writer(output_, blending_mode_);
     while (i < pixel_count) {
       if (!clip_mask_->isMasked(cursor_x_, cursor_y_)) {
         writer.writePixel(cursor_x_, cursor_y_, color[i]);
@@ -134,6 +134,29 @@ class ClipMaskFilter : public DisplayOutput {
     }
   }
 
+  void writeSpans(BlendingMode mode, Color* color, int16_t* x0, int16_t* y,
+                  int16_t* x1, uint16_t count) override {
+    BufferedSpanWriter writer(output_, mode);
+    while (count-- > 0) {
+      int16_t yc = *y++;
+      for (int16_t x = *x0++; x <= *x1; ++x) {
+        if (!clip_mask_->isMasked(x, yc)) {
+          writer.writePixel(x, yc, *color);
+        }
+        ++color;
+      }
+      ++x1;
+    }
+  }
+
+  void fillSpans(BlendingMode mode, Color color, int16_t* x0, int16_t* y,
+                 int16_t* x1, uint16_t count) override {
+    while (count-- > 0) {
+      int16_t yc = *y++;
+      fillSingleRect(mode, color, *x0++, yc, *x1++, yc);
+    }
+  }
+
   void writePixels(BlendingMode mode, Color* color, int16_t* x, int16_t* y,
                    uint16_t pixel_count) override {
     int16_t* x_out = x;
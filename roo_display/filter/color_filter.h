@@ -42,6 +42,23 @@ class ColorFilter : public DisplayOutput {
     output_.fillRects(mode, transform(color), x0, y0, x1, y1, count);
   }
 
+  void writeSpans(BlendingMode mode, Color* color, int16_t* x0, int16_t* y,
+                  int16_t* x1, uint16_t count) override {
+    uint32_t pixel_count = 0;
+    for (uint16_t i = 0; i < count; ++i) {
+      pixel_count += x1[i] - x0[i] + 1;
+    }
+    for (uint32_t i = 0; i < pixel_count; ++i) {
+      color[i] = transform(color[i]);
+    }
+    output_.writeSpans(mode, color, x0, y, x1, count);
+  }
+
+  void fillSpans(BlendingMode mode, Color color, int16_t* x0, int16_t* y,
+                 int16_t* x1, uint16_t count) override {
+    output_.fillSpans(mode, transform(color), x0, y, x1, count);
+  }
+
   void writePixels(BlendingMode mode, Color* color, int16_t* x, int16_t* y,
                    uint16_t pixel_count) override {
     transform(color, pixel_count);
@@ -145,6 +162,16 @@ class ColorFilter<Erasure> : public DisplayOutput {
     output_.fillRects(mode, bgcolor_, x0, y0, x1, y1, count);
   }
 
+  void writeSpans(BlendingMode mode, Color* color, int16_t* x0, int16_t* y,
+                  int16_t* x1, uint16_t count) override {
+    output_.fillSpans(mode, bgcolor_, x0, y, x1, count);
+  }
+
+  void fillSpans(BlendingMode mode, Color color, int16_t* x0, int16_t* y,
+                 int16_t* x1, uint16_t count) override {
+    output_.fillSpans(mode, bgcolor_, x0, y, x1, count);
+  }
+
   void writePixels(BlendingMode mode, Color* color, int16_t* x, int16_t* y,
                    uint16_t pixel_count) override {
     output_.fillPixels(mode, bgcolor_, x, y, pixel_count);
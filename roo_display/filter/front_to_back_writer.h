@@ -63,6 +63,40 @@ class FrontToBackWriter : public DisplayOutput {
     }
   }
 
+  void writeSpans(BlendingMode mode, Color* color, int16_t* x0, int16_t* y,
+                  int16_t* x1, uint16_t count) override {
+    for (int i = 0; i < count; i++) {
+      Box clipped = Box::Intersect(offscreen_.extents(),
+                                   Box(x0[i], y[i], x1[i], y[i]));
+      uint32_t pixel_count = x1[i] - x0[i] + 1;
+      mask_filter_.writeSpans(mode, color, &x0[i], &y[i], &x1[i], 1);
+      color += pixel_count;
+      if (!clipped.empty()) {
+        offscreen_.output().fillRect(
+            mode,
+            clipped.translate(-offscreen_.extents().xMin(),
+                              -offscreen_.extents().yMin()),
+            color::Black);
+      }
+    }
+  }
+
+  void fillSpans(BlendingMode mode, Color color, int16_t* x0, int16_t* y,
+                 int16_t* x1, uint16_t count) override {
+    for (int i = 0; i < count; i++) {
+      Box clipped = Box::Intersect(offscreen_.extents(),
+                                   Box(x0[i], y[i], x1[i], y[i]));
+      mask_filter_.fillSpans(mode, color, &x0[i], &y[i], &x1[i], 1);
+      if (!clipped.empty()) {
+        offscreen_.output().fillRect(
+            mode,
+            clipped.translate(-offscreen_.extents().xMin(),
+                              -offscreen_.extents().yMin()),
+            color::Black);
+      }
+    }
+  }
+
   void writePixels(BlendingMode mode, Color* color, int16_t* x, int16_t* y,
                    uint16_t pixel_count) override {
     for (int i = 0; i < pixel_count; ++i) {
@@ -0,0 +1,248 @@
+#include "roo_display/filter/instrumented.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace roo_display {
+
+void DisplayOutputStats::reset() {
+  memset(calls_, 0, sizeof(calls_));
+  memset(pixels_, 0, sizeof(pixels_));
+  memset(batch_size_histogram_, 0, sizeof(batch_size_histogram_));
+  memset(rect_area_histogram_, 0, sizeof(rect_area_histogram_));
+  memset(blending_mode_calls_, 0, sizeof(blending_mode_calls_));
+  address_window_switches_ = 0;
+}
+
+uint32_t DisplayOutputStats::totalCalls() const {
+  uint32_t result = 0;
+  for (int i = 0; i < kPrimitiveCount; ++i) result += calls_[i];
+  return result;
+}
+
+uint64_t DisplayOutputStats::totalPixels() const {
+  // setAddress does not draw anything by itself.
+  uint64_t result = 0;
+  for (int i = WRITE; i < kPrimitiveCount; ++i) result += pixels_[i];
+  return result;
+}
+
+int DisplayOutputStats::Bucket(uint64_t value) {
+  int bucket = 0;
+  while (value > 1 && bucket < kHistogramBuckets - 1) {
+    value >>= 1;
+    ++bucket;
+  }
+  return bucket;
+}
+
+const char *DisplayOutputStats::PrimitiveName(Primitive primitive) {
+  switch (primitive) {
+    case SET_ADDRESS:
+      return "setAddress";
+    case WRITE:
+      return "write";
+    case WRITE_PIXELS:
+      return "writePixels";
+    case FILL_PIXELS:
+      return "fillPixels";
+    case WRITE_RECTS:
+      return "writeRects";
+    case FILL_RECTS:
+      return "fillRects";
+    case WRITE_SPANS:
+      return "writeSpans";
+    case FILL_SPANS:
+      return "fillSpans";
+    default:
+      return "unknown";
+  }
+}
+
+namespace {
+
+const char *BlendingModeName(BlendingMode mode) {
+  switch (mode) {
+    case BLENDING_MODE_SOURCE:
+      return "SOURCE";
+    case BLENDING_MODE_SOURCE_OVER:
+      return "SOURCE_OVER";
+    case BLENDING_MODE_SOURCE_IN:
+      return "SOURCE_IN";
+    case BLENDING_MODE_SOURCE_ATOP:
+      return "SOURCE_ATOP";
+    case BLENDING_MODE_DESTINATION:
+      return "DESTINATION";
+    case BLENDING_MODE_DESTINATION_OVER:
+      return "DESTINATION_OVER";
+    case BLENDING_MODE_DESTINATION_IN:
+      return "DESTINATION_IN";
+    case BLENDING_MODE_DESTINATION_ATOP:
+      return "DESTINATION_ATOP";
+    case BLENDING_MODE_CLEAR:
+      return "CLEAR";
+    case BLENDING_MODE_SOURCE_OUT:
+      return "SOURCE_OUT";
+    case BLENDING_MODE_DESTINATION_OUT:
+      return "DESTINATION_OUT";
+    case BLENDING_MODE_EXCLUSIVE_OR:
+      return "EXCLUSIVE_OR";
+    case BLENDING_MODE_SOURCE_OVER_OPAQUE:
+      return "SOURCE_OVER_OPAQUE";
+    case BLENDING_MODE_DESTINATION_OVER_OPAQUE:
+      return "DESTINATION_OVER_OPAQUE";
+    default:
+      return "unknown";
+  }
+}
+
+// Prints the non-empty buckets of the histogram, on a single line.
+void PrintHistogram(Print &out, const char *label, const uint32_t *histogram) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "  %-12s", label);
+  out.print(buf);
+  for (int i = 0; i < DisplayOutputStats::kHistogramBuckets; ++i) {
+    if (histogram[i] == 0) continue;
+    if (i == 0) {
+      snprintf(buf, sizeof(buf), " [0-1]:%" PRIu32, histogram[i]);
+    } else if (i == DisplayOutputStats::kHistogramBuckets - 1) {
+      snprintf(buf, sizeof(buf), " [%" PRIu32 "+]:%" PRIu32, (uint32_t)1 << i,
+               histogram[i]);
+    } else {
+      snprintf(buf, sizeof(buf), " [%" PRIu32 "-%" PRIu32 "]:%" PRIu32,
+               (uint32_t)1 << i, ((uint32_t)1 << (i + 1)) - 1, histogram[i]);
+    }
+    out.print(buf);
+  }
+  out.print("\n");
+}
+
+}  // namespace
+
+void DisplayOutputStats::print(Print &out) const {
+  char buf[96];
+  out.print("primitive          calls        pixels  pixels/call\n");
+  for (int i = 0; i < kPrimitiveCount; ++i) {
+    if (calls_[i] == 0) continue;
+    snprintf(buf, sizeof(buf), "%-12s %11" PRIu32 " %13" PRIu64 " %12.1f\n",
+             PrimitiveName((Primitive)i), calls_[i], pixels_[i],
+             (double)pixels_[i] / calls_[i]);
+    out.print(buf);
+  }
+  snprintf(buf, sizeof(buf),
+           "total calls: %" PRIu32 ", pixels: %" PRIu64
+           ", address window switches: %" PRIu32 "\n",
+           totalCalls(), totalPixels(), address_window_switches_);
+  out.print(buf);
+  out.print("blending modes:");
+  for (int i = 0; i < kBlendingModeCount; ++i) {
+    if (blending_mode_calls_[i] == 0) continue;
+    snprintf(buf, sizeof(buf), " %s:%" PRIu32,
+             BlendingModeName((BlendingMode)i), blending_mode_calls_[i]);
+    out.print(buf);
+  }
+  out.print("\n");
+  out.print("batch sizes:\n");
+  for (int i = 0; i < kPrimitiveCount; ++i) {
+    if (calls_[i] == 0 || i == SET_ADDRESS) continue;
+    PrintHistogram(out, PrimitiveName((Primitive)i), batch_size_histogram_[i]);
+  }
+  out.print("rect areas:\n");
+  PrintHistogram(out, "", rect_area_histogram_);
+}
+
+void InstrumentedDisplayOutput::setAddress(uint16_t x0, uint16_t y0,
+                                           uint16_t x1, uint16_t y1,
+                                           BlendingMode mode) {
+  if (!has_window_ || x0 != window_x0_ || y0 != window_y0_ ||
+      x1 != window_x1_ || y1 != window_y1_ || mode != window_mode_) {
+    ++stats_.address_window_switches_;
+  }
+  has_window_ = true;
+  window_x0_ = x0;
+  window_y0_ = y0;
+  window_x1_ = x1;
+  window_y1_ = y1;
+  window_mode_ = mode;
+  uint64_t area = 0;
+  stats_.recordRect(x0, y0, x1, y1, area);
+  stats_.record(DisplayOutputStats::SET_ADDRESS, mode, 1, area);
+  output_.setAddress(x0, y0, x1, y1, mode);
+}
+
+void InstrumentedDisplayOutput::write(Color *color, uint32_t pixel_count) {
+  stats_.record(DisplayOutputStats::WRITE, window_mode_, pixel_count,
+                pixel_count);
+  output_.write(color, pixel_count);
+}
+
+void InstrumentedDisplayOutput::writeRaw(const uint8_t *data,
+                                         uint32_t pixel_count) {
+  stats_.record(DisplayOutputStats::WRITE, window_mode_, pixel_count,
+                pixel_count);
+  output_.writeRaw(data, pixel_count);
+}
+
+void InstrumentedDisplayOutput::writePixels(BlendingMode mode, Color *color,
+                                            int16_t *x, int16_t *y,
+                                            uint16_t pixel_count) {
+  stats_.record(DisplayOutputStats::WRITE_PIXELS, mode, pixel_count,
+                pixel_count);
+  output_.writePixels(mode, color, x, y, pixel_count);
+}
+
+void InstrumentedDisplayOutput::fillPixels(BlendingMode mode, Color color,
+                                           int16_t *x, int16_t *y,
+                                           uint16_t pixel_count) {
+  stats_.record(DisplayOutputStats::FILL_PIXELS, mode, pixel_count,
+                pixel_count);
+  output_.fillPixels(mode, color, x, y, pixel_count);
+}
+
+void InstrumentedDisplayOutput::writeRects(BlendingMode mode, Color *color,
+                                           int16_t *x0, int16_t *y0,
+                                           int16_t *x1, int16_t *y1,
+                                           uint16_t count) {
+  uint64_t pixel_count = 0;
+  for (uint16_t i = 0; i < count; ++i) {
+    stats_.recordRect(x0[i], y0[i], x1[i], y1[i], pixel_count);
+  }
+  stats_.record(DisplayOutputStats::WRITE_RECTS, mode, count, pixel_count);
+  output_.writeRects(mode, color, x0, y0, x1, y1, count);
+}
+
+void InstrumentedDisplayOutput::fillRects(BlendingMode mode, Color color,
+                                          int16_t *x0, int16_t *y0,
+                                          int16_t *x1, int16_t *y1,
+                                          uint16_t count) {
+  uint64_t pixel_count = 0;
+  for (uint16_t i = 0; i < count; ++i) {
+    stats_.recordRect(x0[i], y0[i], x1[i], y1[i], pixel_count);
+  }
+  stats_.record(DisplayOutputStats::FILL_RECTS, mode, count, pixel_count);
+  output_.fillRects(mode, color, x0, y0, x1, y1, count);
+}
+
+void InstrumentedDisplayOutput::writeSpans(BlendingMode mode, Color *color,
+                                           int16_t *x0, int16_t *y,
+                                           int16_t *x1, uint16_t count) {
+  uint64_t pixel_count = 0;
+  for (uint16_t i = 0; i < count; ++i) {
+    pixel_count += x1[i] - x0[i] + 1;
+  }
+  stats_.record(DisplayOutputStats::WRITE_SPANS, mode, count, pixel_count);
+  output_.writeSpans(mode, color, x0, y, x1, count);
+}
+
+void InstrumentedDisplayOutput::fillSpans(BlendingMode mode, Color color,
+                                          int16_t *x0, int16_t *y,
+                                          int16_t *x1, uint16_t count) {
+  uint64_t pixel_count = 0;
+  for (uint16_t i = 0; i < count; ++i) {
+    pixel_count += x1[i] - x0[i] + 1;
+  }
+  stats_.record(DisplayOutputStats::FILL_SPANS, mode, count, pixel_count);
+  output_.fillSpans(mode, color, x0, y, x1, count);
+}
+
+}  // namespace roo_display
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <Print.h>
+#include <inttypes.h>
+
+#include "roo_display/color/blending.h"
+#include "roo_display/core/device.h"
+
+namespace roo_display {
+
+// Statistics of the traffic sent to a DisplayOutput, collected by
+// InstrumentedDisplayOutput (see below).
+class DisplayOutputStats {
+ public:
+  enum Primitive {
+    SET_ADDRESS = 0,
+    WRITE,
+    WRITE_PIXELS,
+    FILL_PIXELS,
+    WRITE_RECTS,
+    FILL_RECTS,
+    WRITE_SPANS,
+    FILL_SPANS,
+  };
+
+  static const int kPrimitiveCount = FILL_SPANS + 1;
+
+  static const int kBlendingModeCount =
+      BLENDING_MODE_DESTINATION_OVER_OPAQUE + 1;
+
+  // Histograms use power-of-two buckets: bucket 0 counts values 0 and 1, and
+  // bucket i > 0 counts values in [2^i, 2^(i+1) - 1]. The last bucket also
+  // counts all the larger values.
+  static const int kHistogramBuckets = 20;
+
+  DisplayOutputStats() { reset(); }
+
+  void reset();
+
+  // Returns the number of calls of the specified primitive.
+  uint32_t calls(Primitive primitive) const { return calls_[primitive]; }
+
+  // Returns the number of pixels drawn by the specified primitive. For
+  // setAddress, returns the total area of the address windows.
+  uint64_t pixels(Primitive primitive) const { return pixels_[primitive]; }
+
+  uint32_t totalCalls() const;
+  uint64_t totalPixels() const;
+
+  // Returns the count of calls of the specified primitive whose batch size
+  // (pixel count for write, writePixels, and fillPixels; rectangle or span
+  // count for the others) fell into the specified bucket.
+  uint32_t batchSizeHistogram(Primitive primitive, int bucket) const {
+    return batch_size_histogram_[primitive][bucket];
+  }
+
+  // Returns the count of rectangles (in writeRects and fillRects), and
+  // address windows, whose area fell into the specified bucket.
+  uint32_t rectAreaHistogram(int bucket) const {
+    return rect_area_histogram_[bucket];
+  }
+
+  // Returns the number of calls that used the specified blending mode. Calls
+  // to write() are attributed to the blending mode of the address window.
+  uint32_t blendingModeCalls(BlendingMode mode) const {
+    return blending_mode_calls_[mode];
+  }
+
+  // Returns the number of setAddress() calls that changed the address window
+  // (or its blending mode), as opposed to re-setting the same one.
+  uint32_t addressWindowSwitches() const { return address_window_switches_; }
+
+  // Writes a human-readable summary, e.g. to Serial.
+  void print(Print &out) const;
+
+  // Returns the histogram bucket for the specified value.
+  static int Bucket(uint64_t value);
+
+  static const char *PrimitiveName(Primitive primitive);
+
+ private:
+  friend class InstrumentedDisplayOutput;
+
+  void record(Primitive primitive, BlendingMode mode, uint32_t batch_size,
+              uint64_t pixel_count) {
+    ++calls_[primitive];
+    pixels_[primitive] += pixel_count;
+    ++batch_size_histogram_[primitive][Bucket(batch_size)];
+    ++blending_mode_calls_[mode];
+  }
+
+  void recordRect(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                  uint64_t &pixel_count) {
+    uint32_t area = (uint32_t)(x1 - x0 + 1) * (y1 - y0 + 1);
+    ++rect_area_histogram_[Bucket(area)];
+    pixel_count += area;
+  }
+
+  uint32_t calls_[kPrimitiveCount];
+  uint64_t pixels_[kPrimitiveCount];
+  uint32_t batch_size_histogram_[kPrimitiveCount][kHistogramBuckets];
+  uint32_t rect_area_histogram_[kHistogramBuckets];
+  uint32_t blending_mode_calls_[kBlendingModeCount];
+  uint32_t address_window_switches_;
+};
+
+// DisplayOutput decorator that forwards all calls to the underlying output,
+// collecting statistics about them. Useful for finding out what the library
+// actually sends to the device, e.g. to detect code paths that degrade into
+// single-pixel writes.
+//
+// Example:
+//
+//   InstrumentedDisplayOutput instrumented(offscreen.output());
+//   ...draw to instrumented...
+//   instrumented.stats().print(Serial);
+class InstrumentedDisplayOutput : public DisplayOutput {
+ public:
+  InstrumentedDisplayOutput(DisplayOutput &output)
+      : output_(output),
+        window_mode_(BLENDING_MODE_SOURCE_OVER),
+        window_x0_(0),
+        window_y0_(0),
+        window_x1_(0),
+        window_y1_(0),
+        has_window_(false) {}
+
+  // Returns the statistics collected so far.
+  const DisplayOutputStats &stats() const { return stats_; }
+
+  // Returns a copy of the statistics collected so far.
+  DisplayOutputStats snapshot() const { return stats_; }
+
+  // Clears the statistics.
+  void reset() { stats_.reset(); }
+
+  void begin() override { output_.begin(); }
+
+  void end() override { output_.end(); }
+
+  void setAddress(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1,
+                  BlendingMode mode) override;
+
+  void write(Color *color, uint32_t pixel_count) override;
+
+  bool acceptsRaw(const RawPixelFormat &format) const override {
+    return output_.acceptsRaw(format);
+  }
+
+  // Recorded as WRITE.
+  void writeRaw(const uint8_t *data, uint32_t pixel_count) override;
+
+  void writePixels(BlendingMode mode, Color *color, int16_t *x, int16_t *y,
+                   uint16_t pixel_count) override;
+
+  void fillPixels(BlendingMode mode, Color color, int16_t *x, int16_t *y,
+                  uint16_t pixel_count) override;
+
+  void writeRects(BlendingMode mode, Color *color, int16_t *x0, int16_t *y0,
+                  int16_t *x1, int16_t *y1, uint16_t count) override;
+
+  void fillRects(BlendingMode mode, Color color, int16_t *x0, int16_t *y0,
+                 int16_t *x1, int16_t *y1, uint16_t count) override;
+
+  void writeSpans(BlendingMode mode, Color *color, int16_t *x0, int16_t *y,
+                  int16_t *x1, uint16_t count) override;
+
+  void fillSpans(BlendingMode mode, Color color, int16_t *x0, int16_t *y,
+                 int16_t *x1, uint16_t count) override;
+
+ private:
+  DisplayOutput &output_;
+  DisplayOutputStats stats_;
+
+  // The most recent address window.
+  BlendingMode window_mode_;
+  uint16_t window_x0_;
+  uint16_t window_y0_;
+  uint16_t window_x1_;
+  uint16_t window_y1_;
+  bool has_window_;
+};
+
+// DisplayDevice adapter for InstrumentedDisplayOutput, so that the statistics
+// can be collected for a Display:
+//
+//   InstrumentedDisplayDevice instrumented(device);
+//   Display display(instrumented);
+//   ...
+//   instrumented.stats().print(Serial);
+//
+// Orientation set on this device is propagated to the underlying device.
+class InstrumentedDisplayDevice : public DisplayDevice {
+ public:
+  InstrumentedDisplayDevice(DisplayDevice &device)
+      : DisplayDevice(device.orientation(), device.raw_width(),
+                      device.raw_height()),
+        device_(device),
+        output_(device) {}
+
+  const DisplayOutputStats &stats() const { return output_.stats(); }
+  DisplayOutputStats snapshot() const { return output_.snapshot(); }
+  void reset() { output_.reset(); }
+
+  void init() override { device_.init(); }
+
+  void orientationUpdated() override { device_.setOrientation(orientation()); }
+
+  void setBgColorHint(Color bgcolor) override {
+    device_.setBgColorHint(bgcolor);
+  }
+
+  void begin() override { output_.begin(); }
+
+  void end() override { output_.end(); }
+
+  void setAddress(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1,
+                  BlendingMode mode) override {
+    output_.setAddress(x0, y0, x1, y1, mode);
+  }
+
+  void write(Color *color, uint32_t pixel_count) override {
+    output_.write(color, pixel_count);
+  }
+
+  bool acceptsRaw(const RawPixelFormat &format) const override {
+    return output_.acceptsRaw(format);
+  }
+
+  void writeRaw(const uint8_t *data, uint32_t pixel_count) override {
+    output_.writeRaw(data, pixel_count);
+  }
+
+  void writePixels(BlendingMode mode, Color *color, int16_t *x, int16_t *y,
+                   uint16_t pixel_count) override {
+    output_.writePixels(mode, color, x, y, pixel_count);
+  }
+
+  void fillPixels(BlendingMode mode, Color color, int16_t *x, int16_t *y,
+                  uint16_t pixel_count) override {
+    output_.fillPixels(mode, color, x, y, pixel_count);
+  }
+
+  void writeRects(BlendingMode mode, Color *color, int16_t *x0, int16_t *y0,
+                  int16_t *x1, int16_t *y1, uint16_t count) override {
+    output_.writeRects(mode, color, x0, y0, x1, y1, count);
+  }
+
+  void fillRects(BlendingMode mode, Color color, int16_t *x0, int16_t *y0,
+                 int16_t *x1, int16_t *y1, uint16_t count) override {
+    output_.fillRects(mode, color, x0, y0, x1, y1, count);
+  }
+
+  void writeSpans(BlendingMode mode, Color *color, int16_t *x0, int16_t *y,
+                  int16_t *x1, uint16_t count) override {
+    output_.writeSpans(mode, color, x0, y, x1, count);
+  }
+
+  void fillSpans(BlendingMode mode, Color color, int16_t *x0, int16_t *y,
+                 int16_t *x1, uint16_t count) override {
+    output_.fillSpans(mode, color, x0, y, x1, count);
+  }
+
+ private:
+  DisplayDevice &device_;
+  InstrumentedDisplayOutput output_;
+};
+
+}  // namespace roo_display
@@ -345,4 +345,87 @@ void TransformedDisplayOutput::fillRects(BlendingMode mode, Color color,
   }
 }
 
+void TransformedDisplayOutput::writeSpans(BlendingMode mode, Color *color,
+                                          int16_t *x0, int16_t *y, int16_t *x1,
+                                          uint16_t count) {
+  if (transformation_.is_rescaled() || transformation_.xy_swap()) {
+    // Spans do not map to spans; write them pixel-by-pixel (or
+    // rect-by-rect), using the address window.
+    while (count-- > 0) {
+      uint32_t pixel_count = *x1 - *x0 + 1;
+      setAddress(*x0++, *y, *x1++, *y, mode);
+      ++y;
+      write(color, pixel_count);
+      color += pixel_count;
+    }
+    return;
+  }
+  // Translate and clip the spans in place. Clipping only removes pixels, so
+  // the colors can be compacted in place, too.
+  int16_t dx = transformation_.x_offset();
+  int16_t dy = transformation_.y_offset();
+  Color *color_in = color;
+  Color *color_out = color;
+  uint16_t new_count = 0;
+  for (uint16_t i = 0; i < count; ++i) {
+    int16_t xMin = x0[i] + dx;
+    int16_t xMax = x1[i] + dx;
+    int16_t yc = y[i] + dy;
+    uint16_t pixel_count = xMax - xMin + 1;
+    if (yc < clip_box_.yMin() || yc > clip_box_.yMax() ||
+        xMax < clip_box_.xMin() || xMin > clip_box_.xMax()) {
+      color_in += pixel_count;
+      continue;
+    }
+    uint16_t skip = 0;
+    if (xMin < clip_box_.xMin()) {
+      skip = clip_box_.xMin() - xMin;
+      xMin = clip_box_.xMin();
+    }
+    if (xMax > clip_box_.xMax()) xMax = clip_box_.xMax();
+    uint16_t visible = xMax - xMin + 1;
+    if (color_out != color_in + skip) {
+      memmove(color_out, color_in + skip, visible * sizeof(Color));
+    }
+    color_in += pixel_count;
+    color_out += visible;
+    x0[new_count] = xMin;
+    y[new_count] = yc;
+    x1[new_count] = xMax;
+    ++new_count;
+  }
+  if (new_count > 0) {
+    delegate_.writeSpans(mode, color, x0, y, x1, new_count);
+  }
+}
+
+void TransformedDisplayOutput::fillSpans(BlendingMode mode, Color color,
+                                         int16_t *x0, int16_t *y, int16_t *x1,
+                                         uint16_t count) {
+  if (transformation_.is_rescaled() || transformation_.xy_swap()) {
+    // Spans do not map to spans; fill them as rectangles.
+    fillRects(mode, color, x0, y, x1, y, count);
+    return;
+  }
+  int16_t dx = transformation_.x_offset();
+  int16_t dy = transformation_.y_offset();
+  uint16_t new_count = 0;
+  for (uint16_t i = 0; i < count; ++i) {
+    int16_t xMin = x0[i] + dx;
+    int16_t xMax = x1[i] + dx;
+    int16_t yc = y[i] + dy;
+    if (yc < clip_box_.yMin() || yc > clip_box_.yMax() ||
+        xMax < clip_box_.xMin() || xMin > clip_box_.xMax()) {
+      continue;
+    }
+    x0[new_count] = std::max(xMin, clip_box_.xMin());
+    y[new_count] = yc;
+    x1[new_count] = std::min(xMax, clip_box_.xMax());
+    ++new_count;
+  }
+  if (new_count > 0) {
+    delegate_.fillSpans(mode, color, x0, y, x1, new_count);
+  }
+}
+
 }  // namespace roo_display
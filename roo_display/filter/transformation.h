@@ -106,6 +106,12 @@ class TransformedDisplayOutput : public DisplayOutput {
   void fillRects(BlendingMode mode, Color color, int16_t *x0, int16_t *y0,
                  int16_t *x1, int16_t *y1, uint16_t count) override;
 
+  void writeSpans(BlendingMode mode, Color *color, int16_t *x0, int16_t *y,
+                  int16_t *x1, uint16_t count) override;
+
+  void fillSpans(BlendingMode mode, Color color, int16_t *x0, int16_t *y,
+                 int16_t *x1, uint16_t count) override;
+
   const Box &clip_box() const { return clip_box_; }
 
  private:
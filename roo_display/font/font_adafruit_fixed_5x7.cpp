@@ -138,28 +138,47 @@ void drawGlyph(const Surface& s, unicode_t code, Color color, bool whitespace) {
   }
   y -= ascent;
   if (code < 32 || code > 127) return;
+  // The glyph data is column-major (one byte per column, LSB on top).
+  uint8_t columns[5];
+  for (int8_t i = 0; i < 5; i++) {
+    columns[i] = pgm_read_byte(font + code * 5 + i);
+  }
   if (s.fill_mode() == FILL_MODE_VISIBLE) {
-    ClippingBufferedPixelFiller filler(s.out(), color, s.clip_box(),
-                                       s.blending_mode());
+    // The glyphs are mostly made of vertical strokes, so we emit vertical
+    // runs; they map to fewer address windows than horizontal spans.
+    ClippingBufferedRectFiller filler(s.out(), color, s.clip_box(),
+                                      s.blending_mode());
     for (int8_t i = 0; i < 5; i++) {
-      uint8_t line = pgm_read_byte(font + code * 5 + i);
-      for (int8_t j = 0; j < 8; j++) {
-        if (line & 0x1) filler.fillPixel(x + i, y + j);
-        line >>= 1;
+      uint8_t line = columns[i];
+      int8_t j = 0;
+      while (line != 0) {
+        if ((line & 0x1) == 0) {
+          line >>= 1;
+          ++j;
+          continue;
+        }
+        int8_t start = j;
+        while (line & 0x1) {
+          line >>= 1;
+          ++j;
+        }
+        filler.fillVLine(x + i, y + start, y + j - 1);
       }
     }
   } else {
-    ClippingBufferedPixelWriter writer(s.out(), s.clip_box(), s.blending_mode());
-    for (int8_t i = 0; i < 5; i++) {
-      uint8_t line = pgm_read_byte(font + code * 5 + i);
-      for (int8_t j = 0; j < 8; j++) {
-        writer.writePixel(x + i, y + j, (line & 0x1) ? color : s.bgcolor());
-        line >>= 1;
-      }
-      if (whitespace) {
-        for (int8_t j = 0; j < 8; j++) {
-          writer.writePixel(x + 5, y + j, s.bgcolor());
-        }
+    Box box = Box::Intersect(Box(x, y, x + (whitespace ? 5 : 4), y + 7),
+                             s.clip_box());
+    if (box.empty()) return;
+    // The (clipped) glyph cell is a rectangle, so we stream it in a single
+    // address window.
+    s.out().setAddress(box, s.blending_mode());
+    BufferedColorWriter writer(s.out());
+    for (int16_t yp = box.yMin(); yp <= box.yMax(); ++yp) {
+      int8_t j = yp - y;
+      for (int16_t xp = box.xMin(); xp <= box.xMax(); ++xp) {
+        int8_t i = xp - x;
+        bool set = (i < 5 && ((columns[i] >> j) & 0x1) != 0);
+        writer.writeColor(set ? color : s.bgcolor());
       }
     }
   }
@@ -0,0 +1,106 @@
+#pragma once
+
+// Utility methods for copying runs of sub-byte pixels between buffers, at
+// arbitrary (not necessarily byte-aligned) positions. Used to blit offscreens
+// in color modes such as Monochrome, Alpha4, or Grayscale4. Whole bytes are
+// copied using memcpy when the source and the destination are aligned the
+// same way, and using funnel shifts otherwise; only the partial bytes at the
+// ends of the run are masked.
+
+#include <inttypes.h>
+
+#include <cstring>
+
+namespace roo_display {
+
+namespace internal {
+
+// Bit numbering within a byte. With msb_first, bit offset 0 refers to the
+// most significant bit of the first byte; otherwise, to the least significant
+// bit.
+template <bool msb_first>
+struct BitOrder;
+
+template <>
+struct BitOrder<true> {
+  // Returns 'count' (<= 8) bits at the given bit offset.
+  static uint8_t read(const uint8_t* buf, uint32_t offset, int count) {
+    buf += offset / 8;
+    int shift = offset % 8;
+    uint16_t window = buf[0] << 8;
+    if (shift + count > 8) window |= buf[1];
+    return (window >> (16 - shift - count)) & ((1 << count) - 1);
+  }
+
+  // Writes 'count' bits, such that shift + count <= 8.
+  static void write(uint8_t* buf, int shift, int count, uint8_t value) {
+    int pos = 8 - shift - count;
+    uint8_t mask = ((1 << count) - 1) << pos;
+    *buf = (*buf & ~mask) | (value << pos);
+  }
+
+  // Returns the byte composed of the (8 - shift) trailing bits of 'first',
+  // followed by the 'shift' leading bits of 'second'. Requires shift > 0.
+  static uint8_t funnel(uint8_t first, uint8_t second, int shift) {
+    return (first << shift) | (second >> (8 - shift));
+  }
+};
+
+template <>
+struct BitOrder<false> {
+  static uint8_t read(const uint8_t* buf, uint32_t offset, int count) {
+    buf += offset / 8;
+    int shift = offset % 8;
+    uint16_t window = buf[0];
+    if (shift + count > 8) window |= buf[1] << 8;
+    return (window >> shift) & ((1 << count) - 1);
+  }
+
+  static void write(uint8_t* buf, int shift, int count, uint8_t value) {
+    uint8_t mask = ((1 << count) - 1) << shift;
+    *buf = (*buf & ~mask) | (value << shift);
+  }
+
+  static uint8_t funnel(uint8_t first, uint8_t second, int shift) {
+    return (first >> shift) | (second << (8 - shift));
+  }
+};
+
+}  // namespace internal
+
+// Copies 'count' consecutive bits from the src buffer, starting at the given
+// bit offset, to the dst buffer, starting at the given bit offset. See
+// internal::BitOrder for the meaning of msb_first. The ranges must not
+// overlap.
+template <bool msb_first>
+inline void bit_copy(uint8_t* dst, uint32_t dst_offset, const uint8_t* src,
+                     uint32_t src_offset, uint32_t count) {
+  typedef internal::BitOrder<msb_first> Order;
+  dst += dst_offset / 8;
+  int dst_shift = dst_offset % 8;
+  if (dst_shift > 0) {
+    // Align the destination to the byte boundary.
+    uint32_t n = 8 - dst_shift;
+    if (n > count) n = count;
+    Order::write(dst, dst_shift, n, Order::read(src, src_offset, n));
+    ++dst;
+    src_offset += n;
+    count -= n;
+  }
+  src += src_offset / 8;
+  int src_shift = src_offset % 8;
+  uint32_t bytes = count / 8;
+  if (src_shift == 0) {
+    memcpy(dst, src, bytes);
+  } else {
+    for (uint32_t i = 0; i < bytes; ++i) {
+      dst[i] = Order::funnel(src[i], src[i + 1], src_shift);
+    }
+  }
+  count %= 8;
+  if (count == 0) return;
+  Order::write(dst + bytes, 0, count,
+               Order::read(src + bytes, src_shift, count));
+}
+
+}  // namespace roo_display
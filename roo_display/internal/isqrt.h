@@ -0,0 +1,24 @@
+#pragma once
+
+// Integer square root, for evaluating distances without floating point.
+
+#include <inttypes.h>
+
+namespace roo_display {
+
+// Returns floor(sqrt(x)). Determines the result bit by bit, starting at the
+// highest bit that can be set, and without data-dependent branches.
+inline uint16_t isqrt32(uint32_t x) {
+  if (x == 0) return 0;
+  uint32_t r = 0, r2 = 0;
+  for (int p = (31 - __builtin_clz(x)) >> 1; p >= 0; --p) {
+    // (r + 2^p)^2 = r^2 + r * 2^(p+1) + 2^(2p).
+    uint32_t tr2 = r2 + (r << (p + 1)) + ((uint32_t)1u << (p + p));
+    uint32_t mask = -(uint32_t)(tr2 <= x);
+    r2 = (r2 & ~mask) | (tr2 & mask);
+    r |= (mask & ((uint32_t)1u << p));
+  }
+  return r;
+}
+
+}  // namespace roo_display
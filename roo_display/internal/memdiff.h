@@ -0,0 +1,47 @@
+#pragma once
+
+// Utility methods for finding the differences between memory blocks. Used to
+// detect which pixels actually changed as a result of drawing.
+
+#include <inttypes.h>
+
+#include <cstring>
+
+namespace roo_display {
+
+namespace internal {
+
+inline uint32_t load_word(const uint8_t* p) {
+  uint32_t result;
+  memcpy(&result, p, 4);
+  return result;
+}
+
+}  // namespace internal
+
+// Finds the first and the last byte at which the specified memory blocks, of
+// the specified size, differ. Returns false if the blocks are equal, in which
+// case first and last are left unmodified. The blocks are compared a 32-bit
+// word at a time, from both ends.
+inline bool mem_diff(const uint8_t* a, const uint8_t* b, uint32_t size,
+                     uint32_t* first, uint32_t* last) {
+  uint32_t begin = 0;
+  while (begin + 4 <= size &&
+         internal::load_word(a + begin) == internal::load_word(b + begin)) {
+    begin += 4;
+  }
+  while (begin < size && a[begin] == b[begin]) ++begin;
+  if (begin == size) return false;
+  uint32_t end = size;
+  while (end >= begin + 4 && internal::load_word(a + end - 4) ==
+                                 internal::load_word(b + end - 4)) {
+    end -= 4;
+  }
+  // Terminates, since a[begin] != b[begin].
+  while (a[end - 1] == b[end - 1]) --end;
+  *first = begin;
+  *last = end - 1;
+  return true;
+}
+
+}  // namespace roo_display
@@ -43,7 +43,7 @@ struct RectFillerVisible {
   void operator()(DisplayOutput &output, const Box &extents, Color bgcolor,
                   RawPixelStream *stream, BlendingMode mode,
                   TransparencyMode transparency_mode) const {
-    BufferedPixelWriter writer(output, mode);
+    BufferedSpanWriter writer(output, mode);
     if (bgcolor.a() == 0) {
       for (int16_t j = extents.yMin(); j <= extents.yMax(); ++j) {
         for (int16_t i = extents.xMin(); i <= extents.xMax(); ++i) {
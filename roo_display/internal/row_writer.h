@@ -0,0 +1,73 @@
+#pragma once
+
+// Writing rows of colors, computed by a rasterizer, to a surface.
+
+#include "roo_display/color/blending.h"
+#include "roo_display/color/color.h"
+#include "roo_display/core/buffered_drawing.h"
+#include "roo_display/core/drawable.h"
+
+namespace roo_display {
+namespace internal {
+
+// Writes rows of colors to a surface, alpha-blending them over the surface's
+// background. Runs of the same color, at least kMinFilledRun long, are filled
+// as rectangles rather than written pixel-by-pixel. Transparent pixels are
+// skipped, unless the fill mode is FILL_MODE_RECTANGLE.
+class RowWriter {
+ public:
+  static constexpr int kMinFilledRun = 4;
+
+  RowWriter(const Surface& s)
+      : out_(s.out()),
+        blending_mode_(s.blending_mode()),
+        fill_mode_(s.fill_mode()),
+        bgcolor_(s.bgcolor()),
+        pixels_(s.out(), s.blending_mode()) {}
+
+  // Writes n colors, to the pixels starting at (x, y), in the device
+  // coordinates.
+  void write(int16_t x, int16_t y, const Color* colors, int n) {
+    int i = 0;
+    while (i < n) {
+      Color color = colors[i];
+      int j = i + 1;
+      while (j < n && colors[j] == color) ++j;
+      if (color.a() == 0) {
+        if (fill_mode_ == FILL_MODE_RECTANGLE) {
+          out_.fillRect(blending_mode_, Box(x + i, y, x + j - 1, y), bgcolor_);
+        }
+      } else {
+        color = AlphaBlend(bgcolor_, color);
+        if (j - i >= kMinFilledRun) {
+          out_.fillRect(blending_mode_, Box(x + i, y, x + j - 1, y), color);
+        } else {
+          for (int k = i; k < j; ++k) pixels_.writePixel(x + k, y, color);
+        }
+      }
+      i = j;
+    }
+  }
+
+  // Fills the rectangle, in the device coordinates, with the color, the same
+  // way as write() would fill a run of that color.
+  void fill(const Box& box, Color color) {
+    if (color.a() == 0) {
+      if (fill_mode_ == FILL_MODE_RECTANGLE) {
+        out_.fillRect(blending_mode_, box, bgcolor_);
+      }
+    } else {
+      out_.fillRect(blending_mode_, box, AlphaBlend(bgcolor_, color));
+    }
+  }
+
+ private:
+  DisplayOutput& out_;
+  BlendingMode blending_mode_;
+  FillMode fill_mode_;
+  Color bgcolor_;
+  BufferedSpanWriter pixels_;
+};
+
+}  // namespace internal
+}  // namespace roo_display
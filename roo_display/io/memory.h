@@ -91,10 +91,10 @@ class MemoryStream : public ResourceStream {
 
   // Returns true on success.
   bool seek(uint32_t offset) override {
-    if (current_ + offset > end_) {
+    if (offset > end_ - begin_) {
       current_ = end_;
     } else {
-      current_ += offset;
+      current_ = begin_ + offset;
     }
     return true;
   }
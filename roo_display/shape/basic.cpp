@@ -3,48 +3,63 @@
 
 namespace roo_display {
 
+// Lines are drawn as sequences of horizontal (for non-steep lines) or vertical
+// (for steep lines) runs, which get filled as rectangles. The runs are the same
+// as in Bresenham's algorithm, but rather than stepping pixel by pixel, their
+// lengths are calculated directly ('run-slice'). All runs except the first and
+// the last one are either q or (q + 1) pixels long, where q is the integer part
+// of the slope's inverse.
+
+// Requires x0 < x1 and 0 < y1 - y0 <= x1 - x0.
 template <typename HLineFiller>
 void drawNonSteepLine(HLineFiller *drawer, int16_t x0, int16_t y0, int16_t x1,
                       int16_t y1, bool flip_diag) {
-  int16_t dx = x1 - x0, dy = y1 - y0;
-  int16_t err = dx >> 1, xs = x0, dlen = 0;
+  int32_t dx = x1 - x0, dy = y1 - y0;
   int16_t y = flip_diag ? y1 : y0;
   int16_t ystep = flip_diag ? -1 : 1;
-
-  for (; x0 <= x1; x0++) {
-    dlen++;
-    err -= dy;
-    if (err < 0) {
-      err += dx;
-      drawer->fillHLine(xs, y, x0);
-      dlen = 0;
-      y += ystep;
-      xs = x0 + 1;
-    }
+  // Bresenham's error term starts at dx / 2, and decreases by dy with each
+  // pixel. The run ends at the pixel where it drops below zero, after which it
+  // increases by dx. Starting at the error term of e >= 0, the run is
+  // therefore e / dy + 1 pixels long. After the first run, e is always within
+  // [dx - dy, dx), which leaves two possible lengths.
+  int32_t q = dx / dy;
+  int32_t q_dy = q * dy;
+  int32_t err = dx >> 1;
+  int32_t len = err / dy + 1;
+  err += dx - len * dy;
+  int32_t xs = x0;
+  while (xs + len <= x1) {
+    drawer->fillHLine(xs, y, xs + len - 1);
+    xs += len;
+    y += ystep;
+    len = (err >= q_dy) ? q + 1 : q;
+    err += dx - len * dy;
   }
-  if (dlen > 0) drawer->fillHLine(xs, y, x1);
+  drawer->fillHLine(xs, y, x1);
 }
 
+// Requires y0 < y1 and 0 < x1 - x0 < y1 - y0.
 template <typename VLineFiller>
 void drawSteepLine(VLineFiller *drawer, int16_t x0, int16_t y0, int16_t x1,
                    int16_t y1, bool flip_diag) {
-  int16_t dy = y1 - y0, dx = x1 - x0;
-  int16_t err = dy >> 1, ys = y0, dlen = 0;
+  int32_t dy = y1 - y0, dx = x1 - x0;
   int16_t x = flip_diag ? x1 : x0;
   int16_t xstep = flip_diag ? -1 : 1;
-
-  for (; y0 <= y1; y0++) {
-    dlen++;
-    err -= dx;
-    if (err < 0) {
-      err += dy;
-      drawer->fillVLine(x, ys, y0);
-      dlen = 0;
-      x += xstep;
-      ys = y0 + 1;
-    }
+  // See drawNonSteepLine().
+  int32_t q = dy / dx;
+  int32_t q_dx = q * dx;
+  int32_t err = dy >> 1;
+  int32_t len = err / dx + 1;
+  err += dy - len * dx;
+  int32_t ys = y0;
+  while (ys + len <= y1) {
+    drawer->fillVLine(x, ys, ys + len - 1);
+    ys += len;
+    x += xstep;
+    len = (err >= q_dx) ? q + 1 : q;
+    err += dy - len * dx;
   }
-  if (dlen > 0) drawer->fillVLine(x, ys, y1);
+  drawer->fillVLine(x, ys, y1);
 }
 
 void drawHLine(DisplayOutput &device, int16_t x0, int16_t y0, int16_t x1,
@@ -185,9 +200,28 @@ std::unique_ptr<PixelStream> FilledRect::createStream(const Box &bounds) const {
   return std::unique_ptr<PixelStream>(new FilledRectStream(color()));
 }
 
-// Also used to draw regular circles.
-template <typename PixelFiller>
-void drawRoundRectCorners(PixelFiller &drawer, int16_t x0, int16_t y0, int x1,
+// Draws the runs of pixels, in the eight octants of the corners, at the
+// distance y from the center, spanning [xa, xb] across.
+template <typename RectFiller>
+inline void drawRoundRectCornerRuns(RectFiller &filler, int16_t x0, int16_t y0,
+                                    int x1, int y1, int16_t xa, int16_t xb,
+                                    int16_t y) {
+  filler.fillHLine(x1 + xa, y1 + y, x1 + xb);
+  filler.fillHLine(x0 - xb, y1 + y, x0 - xa);
+  filler.fillHLine(x0 - xb, y0 - y, x0 - xa);
+  filler.fillHLine(x1 + xa, y0 - y, x1 + xb);
+
+  filler.fillVLine(x1 + y, y1 + xa, y1 + xb);
+  filler.fillVLine(x0 - y, y1 + xa, y1 + xb);
+  filler.fillVLine(x0 - y, y0 - xb, y0 - xa);
+  filler.fillVLine(x1 + y, y0 - xb, y0 - xa);
+}
+
+// Also used to draw regular circles. The pixels of each octant are drawn as
+// runs: horizontal ones in the octants adjacent to the vertical axis, and
+// vertical ones in the octants adjacent to the horizontal axis.
+template <typename RectFiller>
+void drawRoundRectCorners(RectFiller &filler, int16_t x0, int16_t y0, int x1,
                           int y1, int16_t r) {
   // Optimized midpoint circle algorithm.
   int16_t x = 0;
@@ -195,11 +229,15 @@ void drawRoundRectCorners(PixelFiller &drawer, int16_t x0, int16_t y0, int x1,
   int16_t dx = 1;
   int16_t dy = r + r;
   int16_t p = -(r >> 1);
+  // Start of the current run, i.e. the first x with the current y.
+  int16_t xs = 1;
 
   while (x < y) {
     if (p >= 0) {
       dy -= 2;
       p -= dy;
+      if (xs <= x) drawRoundRectCornerRuns(filler, x0, y0, x1, y1, xs, x, y);
+      xs = x + 1;
       y--;
     }
 
@@ -207,19 +245,8 @@ void drawRoundRectCorners(PixelFiller &drawer, int16_t x0, int16_t y0, int x1,
     p += dx;
 
     x++;
-
-    // These are ordered to minimise coordinate changes in x or y
-    // drawPixel can then send fewer bounding box commands.
-    drawer.fillPixel(x1 + x, y1 + y);
-    drawer.fillPixel(x0 - x, y1 + y);
-    drawer.fillPixel(x0 - x, y0 - y);
-    drawer.fillPixel(x1 + x, y0 - y);
-
-    drawer.fillPixel(x1 + y, y1 + x);
-    drawer.fillPixel(x0 - y, y1 + x);
-    drawer.fillPixel(x0 - y, y0 - x);
-    drawer.fillPixel(x1 + y, y0 - x);
   }
+  if (xs <= x) drawRoundRectCornerRuns(filler, x0, y0, x1, y1, xs, x, y);
 }
 
 template <typename HlineFiller>
@@ -299,11 +326,8 @@ void drawRoundRect(DisplayOutput &output, const Box &bbox, int16_t radius,
   int16_t x1 = bbox.xMax() - radius;
   int16_t y1 = bbox.yMax() - radius;
   if (clip_box.contains(bbox)) {
-    {
-      BufferedPixelFiller drawer(output, color, mode);
-      drawRoundRectCorners(drawer, x0, y0, x1, y1, radius);
-    }
     BufferedRectFiller filler(output, color, mode);
+    drawRoundRectCorners(filler, x0, y0, x1, y1, radius);
     if (x0 <= x1) {
       filler.fillHLine(x0, bbox.yMin(), x1);
       filler.fillHLine(x0, bbox.yMax(), x1);
@@ -313,11 +337,8 @@ void drawRoundRect(DisplayOutput &output, const Box &bbox, int16_t radius,
       filler.fillVLine(bbox.xMax(), y0, y1);
     }
   } else {
-    {
-      ClippingBufferedPixelFiller drawer(output, color, clip_box, mode);
-      drawRoundRectCorners(drawer, x0, y0, x1, y1, radius);
-    }
     ClippingBufferedRectFiller filler(output, color, clip_box, mode);
+    drawRoundRectCorners(filler, x0, y0, x1, y1, radius);
     if (x0 <= x1) {
       filler.fillHLine(x0, bbox.yMin(), x1);
       filler.fillHLine(x0, bbox.yMax(), x1);
@@ -143,6 +143,11 @@ class FilledRect : public RectBase, public Rasterizable {
     FillColor(result, count, color());
   }
 
+  void readColorRow(int16_t y, int16_t x0, int16_t x1,
+                    Color *result) const override {
+    FillColor(result, x1 - x0 + 1, color());
+  }
+
  private:
   void drawTo(const Surface &s) const override;
 };
@@ -1,63 +1,17 @@
 #include "roo_display/shape/shadow.h"
 
-namespace roo_display {
+#include <algorithm>
 
-namespace {
+#include "roo_display/internal/isqrt.h"
+#include "roo_display/internal/row_writer.h"
 
-inline uint16_t isqrt32(uint32_t x) {
-  uint32_t r = 0, r2 = 0;
-  for (int p = 15; p >= 0; --p) {
-    uint32_t tr2 = r2 + (r << (p + 1)) + ((uint32_t)1u << (p + p));
-    if (tr2 <= x) {
-      r2 = tr2;
-      r |= ((uint32_t)1u << p);
-    }
-  }
-  return r;
-}
+namespace roo_display {
 
-// Returns the diffusion of the shadow at the specified (x, y) pixel within a
-// shadow given by the spec. Returned value is from 0 (no diffusion) to 16 *
-// extents.
-inline uint16_t calcShadowDiffusion(const RoundRectShadow::Spec& spec,
-                                    int16_t x, int16_t y) {
-  x -= spec.x;
-  y -= spec.y;
-
-  // We need to consider 9 cases:
-  //
-  // 123
-  // 456
-  // 789
-  //
-  // We will fold them to
-  //
-  // 12
-  // 34
-  if (x >= spec.w - spec.radius) {
-    x += spec.radius - spec.w + 1;
-  } else {
-    x = spec.radius - x;
-  }
-  if (y >= spec.h - spec.radius) {
-    y += spec.radius - spec.h + 1;
-  } else {
-    y = spec.radius - y;
-  }
-  if (x <= 0) {
-    if (y > 0) return 16 * y;  // Case 2.
-    return 0;                  // Case 4.
-  }
-  if (y <= 0) return 16 * x;  // Case 3.
-  // Now what's left is Case 1.
-  return isqrt32(256 * (x * x + y * y));
-}
+namespace {
 
-// Calculates alpha component of the specified (x, y) point within a shadow
-// given by the spec.
-inline uint8_t calcShadowAlpha(const RoundRectShadow::Spec& spec, int16_t x,
-                               int16_t y) {
-  uint16_t d = calcShadowDiffusion(spec, x, y);
+// Calculates alpha component of a point at the specified diffusion, from 0 (no
+// diffusion) to 16 * radius, within a shadow given by the spec.
+inline uint8_t calcShadowAlpha(const RoundRectShadow::Spec& spec, uint16_t d) {
   if (d > spec.border * 16) {
     if (d > spec.radius * 16) {
       return 0;
@@ -69,12 +23,35 @@ inline uint8_t calcShadowAlpha(const RoundRectShadow::Spec& spec, int16_t x,
   return spec.alpha_start;
 }
 
+// Folds the coordinate (relative to the start of the shadow) of a shadow of
+// the specified size, so that it becomes the distance from the straight
+// (non-diffused) part, or zero within that part. Coordinates outside of the
+// shadow fold to radius + 1.
+inline int16_t foldCoordinate(int32_t v, int16_t size, uint8_t radius) {
+  if (v >= size - radius) {
+    v += radius - size + 1;
+  } else {
+    v = radius - v;
+  }
+  return v < 0 ? 0 : v > radius + 1 ? radius + 1 : v;
+}
+
+// Calculates the range [begin, end), relative to the start of the shadow of
+// the specified size, in which the fold of the coordinate is zero. Below it,
+// and at and above it, the shadow diffuses.
+inline void midRange(int16_t size, uint8_t radius, int16_t& begin,
+                     int16_t& end) {
+  begin = std::max<int16_t>(0, std::min<int16_t>(radius, size - radius));
+  end = std::max<int16_t>(begin, size - radius);
+}
+
 }  // namespace
 
 RoundRectShadow::RoundRectShadow(roo_display::Box extents, Color color,
                                  uint8_t blur_radius, uint8_t dx, uint8_t dy,
-                                 uint8_t corner_radius)
-    : object_extents_(extents), corner_radius_(corner_radius), color_(color) {
+                                 uint8_t corner_radius,
+                                 RoundRectShadowCache* cache)
+    : color_(color), cached_table_(nullptr) {
   spec_.radius = blur_radius + corner_radius;
   spec_.x = extents.xMin() - blur_radius + dx;
   spec_.y = extents.yMin() - blur_radius + dy;
@@ -87,55 +64,167 @@ RoundRectShadow::RoundRectShadow(roo_display::Box extents, Color color,
 
   shadow_extents_ =
       Box(spec_.x, spec_.y, spec_.x + spec_.w - 1, spec_.y + spec_.h - 1);
+
+  if (cache != nullptr) {
+    cached_table_ = cache->get(spec_);
+  } else {
+    table_.resize((spec_.radius + 2) * (spec_.radius + 2));
+    BuildTable(spec_, table_.data());
+  }
+}
+
+void RoundRectShadow::BuildTable(const Spec& spec, uint8_t* table) {
+  // The table covers the top-left corner, folded so that (0, 0) is the corner
+  // of the interior. Row 0 and column 0 hold the profile of the straight
+  // edges. The last row and column, outside of the shadow, are transparent.
+  // The table is symmetric, so the diffusion is calculated only once for each
+  // pair of the mirrored cells.
+  int16_t stride = spec.radius + 2;
+  for (int16_t y = 0; y < stride; ++y) {
+    for (int16_t x = y; x < stride; ++x) {
+      uint16_t d = (y == 0) ? 16 * x : isqrt32(256 * (x * x + y * y));
+      uint8_t alpha = calcShadowAlpha(spec, d);
+      table[y * stride + x] = alpha;
+      table[x * stride + y] = alpha;
+    }
+  }
+}
+
+int16_t RoundRectShadow::tableColumn(int16_t x) const {
+  return foldCoordinate((int32_t)x - spec_.x, spec_.w, spec_.radius);
+}
+
+int16_t RoundRectShadow::tableRow(int16_t y) const {
+  return foldCoordinate((int32_t)y - spec_.y, spec_.h, spec_.radius);
 }
 
 void RoundRectShadow::readColors(const int16_t* x, const int16_t* y,
                                  uint32_t count, Color* result) const {
+  const uint8_t* t = table();
+  int16_t stride = spec_.radius + 2;
   while (count-- > 0) {
-    *result++ = color_.withA(calcShadowAlpha(spec_, *x++, *y++));
+    *result++ = color_.withA(t[tableRow(*y++) * stride + tableColumn(*x++)]);
+  }
+}
+
+void RoundRectShadow::readColorRow(int16_t y, int16_t x0, int16_t x1,
+                                   Color* result) const {
+  const uint8_t* row = table() + tableRow(y) * (spec_.radius + 2);
+  for (int16_t x = x0; x <= x1; ++x) {
+    *result++ = color_.withA(row[tableColumn(x)]);
   }
 }
 
 bool RoundRectShadow::readColorRect(int16_t xMin, int16_t yMin, int16_t xMax,
                                     int16_t yMax,
                                     roo_display::Color* result) const {
-  if (xMin >= object_extents_.xMin() + corner_radius_ &&
-      xMax <= object_extents_.xMax() - corner_radius_) {
-    if (yMin >= object_extents_.yMin() && yMax <= object_extents_.yMax()) {
+  int16_t x_begin, x_end, y_begin, y_end;
+  midRange(spec_.w, spec_.radius, x_begin, x_end);
+  midRange(spec_.h, spec_.radius, y_begin, y_end);
+  bool mid_columns = xMin - spec_.x >= x_begin && xMax - spec_.x < x_end;
+  bool mid_rows = yMin - spec_.y >= y_begin && yMax - spec_.y < y_end;
+  int16_t width = xMax - xMin + 1;
+  if (mid_columns) {
+    if (mid_rows) {
       // Interior of the shadow.
-      *result = color_;
+      *result = color_.withA(spec_.alpha_start);
       return true;
     }
     // Pixel color in this range does not depend on the specific x value at
     // all, so we can compute only one vertical stripe and replicate it.
+    const uint8_t* t = table();
     for (int16_t y = yMin; y <= yMax; ++y) {
-      Color c = color_.withA(calcShadowAlpha(spec_, xMin, y));
-      for (int16_t x = xMin; x <= xMax; ++x) {
-        *result++ = c;
-      }
+      FillColor(result, width,
+                color_.withA(t[tableRow(y) * (spec_.radius + 2)]));
+      result += width;
     }
     return false;
-  } else if (yMin >= object_extents_.yMin() + corner_radius_ &&
-             yMax <= object_extents_.yMax() - corner_radius_) {
-    // Pixel color in this range does not depend on the specific y value
-    // at all, so we can compute only one horizontal stripe and replicate it.
-    for (int16_t x = xMin; x <= xMax; ++x) {
-      Color c = color_.withA(calcShadowAlpha(spec_, x, yMin));
-      Color* ptr = result++;
-      int16_t stride = (xMax - xMin + 1);
-      for (int16_t y = yMin; y <= yMax; ++y) {
-        *ptr = c;
-        ptr += stride;
+  }
+  readColorRow(yMin, xMin, xMax, result);
+  for (int16_t y = yMin + 1; y <= yMax; ++y) {
+    if (mid_rows) {
+      // Pixel color in this range does not depend on the specific y value
+      // at all, so we can compute only one horizontal stripe and replicate it.
+      std::copy(result, result + width, result + (y - yMin) * width);
+    } else {
+      readColorRow(y, xMin, xMax, result + (y - yMin) * width);
+    }
+  }
+  return false;
+}
+
+void RoundRectShadow::drawTo(const Surface& s) const {
+  Box box =
+      Box::Intersect(shadow_extents_.translate(s.dx(), s.dy()), s.clip_box());
+  if (box.empty()) return;
+  // Splits the shadow into 3x3 regions: the corners, the edges, and the
+  // interior.
+  int16_t x_begin, x_end, y_begin, y_end;
+  midRange(spec_.w, spec_.radius, x_begin, x_end);
+  midRange(spec_.h, spec_.radius, y_begin, y_end);
+  int16_t x0 = spec_.x + s.dx();
+  int16_t y0 = spec_.y + s.dy();
+  const int16_t xs[] = {x0, (int16_t)(x0 + x_begin), (int16_t)(x0 + x_end),
+                        (int16_t)(x0 + spec_.w)};
+  const int16_t ys[] = {y0, (int16_t)(y0 + y_begin), (int16_t)(y0 + y_end),
+                        (int16_t)(y0 + spec_.h)};
+  const uint8_t* t = table();
+  int16_t stride = spec_.radius + 2;
+  internal::RowWriter writer(s);
+  std::unique_ptr<Color[]> colors;
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      Box region = Box::Intersect(
+          Box(xs[j], ys[i], xs[j + 1] - 1, ys[i + 1] - 1), box);
+      if (region.empty()) continue;
+      if (i == 1 && j == 1) {
+        // Interior.
+        writer.fill(region, color_.withA(spec_.alpha_start));
+      } else if (i == 1) {
+        // Left or right edge; the alpha only changes with x.
+        for (int16_t x = region.xMin(); x <= region.xMax(); ++x) {
+          writer.fill(Box(x, region.yMin(), x, region.yMax()),
+                      color_.withA(t[tableColumn(x - s.dx())]));
+        }
+      } else if (j == 1) {
+        // Top or bottom edge; the alpha only changes with y.
+        for (int16_t y = region.yMin(); y <= region.yMax(); ++y) {
+          writer.fill(Box(region.xMin(), y, region.xMax(), y),
+                      color_.withA(t[tableRow(y - s.dy()) * stride]));
+        }
+      } else {
+        // Corner; at most radius pixels wide.
+        if (colors == nullptr) colors.reset(new Color[spec_.radius]);
+        for (int16_t y = region.yMin(); y <= region.yMax(); ++y) {
+          const uint8_t* row = t + tableRow(y - s.dy()) * stride;
+          for (int16_t x = region.xMin(); x <= region.xMax(); ++x) {
+            colors[x - region.xMin()] =
+                color_.withA(row[tableColumn(x - s.dx())]);
+          }
+          writer.write(region.xMin(), y, colors.get(), region.width());
+        }
       }
     }
-    return false;
   }
-  for (int16_t y = yMin; y <= yMax; ++y) {
-    for (int16_t x = xMin; x <= xMax; ++x) {
-      *result++ = color_.withA(calcShadowAlpha(spec_, x, y));
+}
+
+const uint8_t* RoundRectShadowCache::get(const RoundRectShadow::Spec& spec) {
+  for (const auto& entry : entries_) {
+    if (entry->radius == spec.radius && entry->border == spec.border &&
+        entry->alpha_start == spec.alpha_start &&
+        entry->alpha_step == spec.alpha_step) {
+      return entry->table.data();
     }
   }
-  return false;
+  std::unique_ptr<Entry> entry(new Entry);
+  entry->radius = spec.radius;
+  entry->border = spec.border;
+  entry->alpha_start = spec.alpha_start;
+  entry->alpha_step = spec.alpha_step;
+  entry->table.resize((spec.radius + 2) * (spec.radius + 2));
+  RoundRectShadow::BuildTable(spec, entry->table.data());
+  entries_.push_back(std::move(entry));
+  return entries_.back()->table.data();
 }
 
 }  // namespace roo_display
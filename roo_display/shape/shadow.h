@@ -1,9 +1,27 @@
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include "roo_display/core/rasterizable.h"
 
 namespace roo_display {
 
+class RoundRectShadowCache;
+
+// Shadow of a (possibly round-cornered) rectangle, diffused linearly over the
+// blur radius.
+//
+// The alpha of the shadow is symmetric, and depends only on the distance from
+// the shadow's (rounded) edge. It is precomputed into a table covering one
+// corner (and, in the first row and column, the straight edges), so that
+// evaluating it is a lookup. Drawing fills the uniform interior, and the edges
+// (in which the alpha changes only in one direction) as rectangles; only the
+// corners are written pixel by pixel.
+//
+// The table takes (radius + 2)^2 bytes, where radius is the sum of the blur
+// radius and the corner radius. Shadows that have the same parameters (e.g.
+// of many identical cards) can share the table via RoundRectShadowCache.
 class RoundRectShadow : public Rasterizable {
  public:
   struct Spec {
@@ -29,24 +47,91 @@ class RoundRectShadow : public Rasterizable {
   // The `blur_radius` signifies the object's elevation, i.e. how much larger
   // the shadow is compared to the object casting the shadow. A non-zero
   // 'corner_radius' indicates that corners of the object casting shadow are
-  // themselves rounded.
+  // themselves rounded. If the cache is specified, the alpha table is taken
+  // from (or added to) the cache, which must then outlive the shadow.
   RoundRectShadow(roo_display::Box extents, Color color, uint8_t blur_radius,
-                  uint8_t dx, uint8_t dy, uint8_t corner_radius);
+                  uint8_t dx, uint8_t dy, uint8_t corner_radius,
+                  RoundRectShadowCache* cache = nullptr);
 
   Box extents() const override { return shadow_extents_; }
 
   void readColors(const int16_t* x, const int16_t* y, uint32_t count,
                   Color* result) const override;
 
+  void readColorRow(int16_t y, int16_t x0, int16_t x1,
+                    Color* result) const override;
+
   bool readColorRect(int16_t xMin, int16_t yMin, int16_t xMax, int16_t yMax,
                      roo_display::Color* result) const override;
 
  private:
+  friend class RoundRectShadowCache;
+
+  void drawTo(const Surface& s) const override;
+
+  // Returns the alpha table: (radius + 2) rows of (radius + 2) values,
+  // indexed by tableRow() and tableColumn().
+  const uint8_t* table() const {
+    return cached_table_ != nullptr ? cached_table_ : table_.data();
+  }
+
+  // Returns the index of the column of the table for the specified x.
+  int16_t tableColumn(int16_t x) const;
+
+  // Returns the index of the table's row for the specified y.
+  int16_t tableRow(int16_t y) const;
+
+  // Fills the table for the shadow with the specified spec.
+  static void BuildTable(const Spec& spec, uint8_t* table);
+
   Spec spec_;
-  Box object_extents_;
   Box shadow_extents_;
-  uint8_t corner_radius_;
   Color color_;
+
+  // Unless the table comes from the cache, the shadow owns it.
+  std::vector<uint8_t> table_;
+  const uint8_t* cached_table_;
+};
+
+// Alpha tables of round rect shadows, shared by the shadows with the same
+// blur radius, corner radius, and alpha. The tables are kept until the cache
+// is cleared or destroyed.
+//
+// Example:
+//
+//   RoundRectShadowCache shadows;
+//   for (const Box& card : cards) {
+//     dc.draw(RoundRectShadow(card, Color(0x80000000), 10, 2, 3, 8, &shadows));
+//   }
+class RoundRectShadowCache {
+ public:
+  RoundRectShadowCache() = default;
+
+  RoundRectShadowCache(const RoundRectShadowCache&) = delete;
+  RoundRectShadowCache& operator=(const RoundRectShadowCache&) = delete;
+
+  // Returns the number of distinct tables in the cache.
+  size_t size() const { return entries_.size(); }
+
+  // Removes all tables. No shadows created with this cache may be used
+  // afterwards.
+  void clear() { entries_.clear(); }
+
+ private:
+  friend class RoundRectShadow;
+
+  struct Entry {
+    uint8_t radius;
+    uint8_t border;
+    uint8_t alpha_start;
+    uint16_t alpha_step;
+    std::vector<uint8_t> table;
+  };
+
+  // Returns the table for the specified spec, building it if needed.
+  const uint8_t* get(const RoundRectShadow::Spec& spec);
+
+  std::vector<std::unique_ptr<Entry>> entries_;
 };
 
 }  // namespace roo_display
\ No newline at end of file
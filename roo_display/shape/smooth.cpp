@@ -3,7 +3,19 @@
 #include <Arduino.h>
 #include <math.h>
 
+#include <limits>
+
 #include "roo_display/core/buffered_drawing.h"
+#include "roo_display/internal/isqrt.h"
+
+// If set to 1, smooth shapes are evaluated in fixed-point arithmetic, rather
+// than in floating point. Intended for microcontrollers without an FPU (e.g.
+// ESP32-S2, or RISC-V cores without the F extension), but disabled by default
+// until it has been benchmarked on such a target; on targets with an FPU, it
+// is slower.
+#ifndef ROO_DISPLAY_SMOOTH_FIXED_POINT
+#define ROO_DISPLAY_SMOOTH_FIXED_POINT 0
+#endif
 
 namespace roo_display {
 
@@ -349,10 +361,382 @@ SmoothShape SmoothFilledTriangle(FpPoint a, FpPoint b, FpPoint c, Color color) {
                             (a.x - c.x) / d31, (a.y - c.y) / d31, color});
 };
 
-// Helper functions for wedge.
-
 namespace {
 
+// Scanline rendering.
+//
+// The color of each smooth shape is piecewise constant, except within narrow
+// bands around its boundaries, where it is anti-aliased (or where it changes
+// from one constant to another). For each row, the shape reports the
+// x-intervals in which the row crosses these bands. The pixels within the
+// intervals are evaluated individually. The color of each of the remaining runs
+// is evaluated once, and the run is drawn as a single fill. Since the per-pixel
+// color functions are the same in both cases, the results are identical to
+// evaluating every pixel.
+
+// Half-width of the bands around boundaries at which the color functions
+// anti-alias over the distance of 1 (i.e., from -0.5 to 0.5 from the
+// boundary), with a margin for float rounding.
+constexpr float kBandHalfWidth = 0.5f + 1.0f / 16;
+
+// The intersection of a row with the bands of a shape.
+class RowBands {
+ public:
+  static constexpr int kMaxBands = 16;
+
+  // Creates bands for the specified range of pixels of the row.
+  RowBands(int16_t xMin, int16_t xMax)
+      : x0_(xMin), x1_(xMax), count_(0), b0_(), b1_() {}
+
+  // Restricts the range to [x0, x1]. Pixels outside that range must be
+  // transparent. Must be called before adding any bands.
+  void clip(float x0, float x1) {
+    x0_ = std::max(x0_, x0);
+    x1_ = std::min(x1_, x1);
+  }
+
+  // Marks all pixels of the row as transparent.
+  void clear() { x1_ = x0_ - 1; }
+
+  // Restricts the range to where a * x + b <= max.
+  void clipLinear(float a, float b, float max) {
+    if (a > 0) {
+      clip(x0_, (max - b) / a);
+    } else if (a < 0) {
+      clip((max - b) / a, x1_);
+    } else if (b > max) {
+      clear();
+    }
+  }
+
+  // Returns true if all pixels of the range are transparent.
+  bool empty() const { return !(x0_ <= x1_) || begin() > end(); }
+
+  // The first and the last pixel that may be non-transparent.
+  int16_t begin() const { return (int16_t)ceilf(x0_); }
+  int16_t end() const { return (int16_t)floorf(x1_); }
+
+  // Adds a band, crossing the row at [x0, x1].
+  void add(float x0, float x1) {
+    x0 = std::max(x0, x0_);
+    x1 = std::min(x1, x1_);
+    if (!(x0 <= x1)) return;
+    int16_t b0 = (int16_t)ceilf(x0);
+    int16_t b1 = (int16_t)floorf(x1);
+    if (b0 > b1) return;
+    if (count_ == kMaxBands) {
+      // Should not happen; merging bands is always safe.
+      merge(b0, b1);
+      return;
+    }
+    // Keep sorted by the starting point.
+    int i = count_++;
+    while (i > 0 && b0_[i - 1] > b0) {
+      b0_[i] = b0_[i - 1];
+      b1_[i] = b1_[i - 1];
+      --i;
+    }
+    b0_[i] = b0;
+    b1_[i] = b1;
+  }
+
+  // Adds the band where a * x + b is within [min, max].
+  void addLinear(float a, float b, float min, float max) {
+    if (a > 0) {
+      add((min - b) / a, (max - b) / a);
+    } else if (a < 0) {
+      add((max - b) / a, (min - b) / a);
+    } else if (b >= min && b <= max) {
+      add(x0_, x1_);
+    }
+  }
+
+  // Adds the band of points whose distance from the horizontal segment
+  // [cx0, cx1] is within [r0, r1], given the vertical distance dy >= 0 between
+  // the segment and the row.
+  void addRing(float cx0, float cx1, float dy, float r0, float r1) {
+    if (dy > r1) return;
+    float w1 = sqrtf(r1 * r1 - dy * dy);
+    if (dy >= r0) {
+      add(cx0 - w1, cx1 + w1);
+      return;
+    }
+    float w0 = sqrtf(r0 * r0 - dy * dy);
+    add(cx0 - w1, cx0 - w0);
+    add(cx1 + w0, cx1 + w1);
+  }
+
+  int count() const { return count_; }
+  int16_t bandBegin(int i) const { return b0_[i]; }
+  int16_t bandEnd(int i) const { return b1_[i]; }
+
+ private:
+  // Widens the band preceding [b0, b1] in the sorted order (or the first
+  // one) to cover it, and coalesces the subsequent bands that it now
+  // overlaps.
+  void merge(int16_t b0, int16_t b1) {
+    int i = 0;
+    while (i + 1 < count_ && b0_[i + 1] <= b0) ++i;
+    b0_[i] = std::min(b0_[i], b0);
+    b1_[i] = std::max(b1_[i], b1);
+    int j = i + 1;
+    while (j < count_ && b0_[j] <= b1_[i]) {
+      b1_[i] = std::max(b1_[i], b1_[j]);
+      ++j;
+    }
+    int removed = j - i - 1;
+    for (; j < count_; ++j) {
+      b0_[j - removed] = b0_[j];
+      b1_[j - removed] = b1_[j];
+    }
+    count_ -= removed;
+  }
+
+  float x0_;
+  float x1_;
+  int count_;
+  int16_t b0_[kMaxBands];
+  int16_t b1_[kMaxBands];
+};
+
+// Returns the half-width of the chord at the distance dy from the center of
+// the circle with the specified radius, or a negative value if the chord does
+// not exist.
+inline float ChordHalfWidth(float r, float dy) {
+  return dy > r ? -1.0f : sqrtf(r * r - dy * dy);
+}
+
+// Scans the [xMin, xMax] range of the specified row of the shape, calling
+// sink.run(x0, x1, color) for each run of uniform color, and
+// sink.pixel(x, color) for each pixel evaluated individually, left to right.
+template <typename Shape, typename Sink>
+void ScanRow(const Shape& shape, int16_t y, int16_t xMin, int16_t xMax,
+             Sink& sink) {
+  RowBands bands(xMin, xMax);
+  shape.getBands(y, bands);
+  // Outside of the clipped range, the shape is transparent. The color is still
+  // evaluated, since the color functions may return transparent colors with
+  // non-zero RGB components.
+  if (bands.empty()) {
+    sink.run(xMin, xMax, shape.getColor(xMin, y));
+    return;
+  }
+  int16_t x = bands.begin();
+  int16_t end = bands.end();
+  if (x > xMin) sink.run(xMin, x - 1, shape.getColor(xMin, y));
+  for (int i = 0; i < bands.count(); ++i) {
+    int16_t b1 = bands.bandEnd(i);
+    if (b1 < x) continue;
+    int16_t b0 = bands.bandBegin(i);
+    if (b0 > x) {
+      sink.run(x, b0 - 1, shape.getColor(x, y));
+      x = b0;
+    }
+    for (; x <= b1; ++x) sink.pixel(x, shape.getColor(x, y));
+  }
+  if (x <= end) sink.run(x, end, shape.getColor(x, y));
+  if (end < xMax) sink.run(end + 1, xMax, shape.getColor(end + 1, y));
+}
+
+// Sink that stores the scanned colors in an array.
+class ColorRowSink {
+ public:
+  ColorRowSink(int16_t x0, Color* result) : x0_(x0), result_(result) {}
+
+  void run(int16_t x0, int16_t x1, Color color) {
+    FillColor(result_ + (x0 - x0_), x1 - x0 + 1, color);
+  }
+
+  void pixel(int16_t x, Color color) { result_[x - x0_] = color; }
+
+ private:
+  int16_t x0_;
+  Color* result_;
+};
+
+template <typename Shape>
+void ReadShapeRow(const Shape& shape, int16_t y, int16_t x0, int16_t x1,
+                  Color* result) {
+  ColorRowSink sink(x0, result);
+  ScanRow(shape, y, x0, x1, sink);
+}
+
+// Sink that draws the scanned rows to a surface. Pixels are written as spans.
+// Runs of uniform color are merged with identical runs directly above, and
+// filled as rectangles (letting the output pick the fastest way to fill with
+// the specific color).
+class SurfaceRowSink {
+ public:
+  // The (optional) palette specifies the pre-blended colors to use for the
+  // specific colors of the shape; the others are alpha-blended over the
+  // surface's background.
+  SurfaceRowSink(const Surface& s, const Color* colors = nullptr,
+                 const Color* blended = nullptr, int palette_size = 0)
+      : out_(s.out()),
+        blending_mode_(s.blending_mode()),
+        fill_mode_(s.fill_mode()),
+        bgcolor_(s.bgcolor()),
+        colors_(colors),
+        blended_(blended),
+        palette_size_(palette_size),
+        pixels_(s.out(), s.blending_mode()),
+        y_(0),
+        prev_count_(0),
+        count_(0) {}
+
+  ~SurfaceRowSink() {
+    for (int i = 0; i < prev_count_; ++i) emit(prev_[i], y_ - 1);
+    for (int i = 0; i < count_; ++i) emit(runs_[i], y_);
+  }
+
+  // Must be called before scanning each row, in the top-to-bottom order.
+  void beginRow(int16_t y) {
+    // Runs of the row above the one just scanned, not continued by it.
+    for (int i = 0; i < prev_count_; ++i) emit(prev_[i], y_ - 1);
+    for (int i = 0; i < count_; ++i) prev_[i] = runs_[i];
+    prev_count_ = count_;
+    count_ = 0;
+    y_ = y;
+  }
+
+  void run(int16_t x0, int16_t x1, Color color) {
+    if (!blend(color)) return;
+    for (int i = 0; i < prev_count_; ++i) {
+      const Run& r = prev_[i];
+      if (r.x0 == x0 && r.x1 == x1 && r.color == color) {
+        // Continues the run from the previous row.
+        runs_[count_++] = r;
+        prev_[i] = prev_[--prev_count_];
+        return;
+      }
+    }
+    if (count_ == kMaxRuns) {
+      out_.fillRect(blending_mode_, Box(x0, y_, x1, y_), color);
+      return;
+    }
+    runs_[count_++] = Run{x0, x1, y_, color};
+  }
+
+  void pixel(int16_t x, Color color) {
+    if (blend(color)) pixels_.writePixel(x, y_, color);
+  }
+
+ private:
+  static constexpr int kMaxRuns = RowBands::kMaxBands + 3;
+
+  struct Run {
+    int16_t x0;
+    int16_t x1;
+    int16_t y0;
+    Color color;
+  };
+
+  // Replaces the color with the one to write. Returns false if nothing needs
+  // to be written.
+  bool blend(Color& color) const {
+    if (color.a() == 0) {
+      if (fill_mode_ == FILL_MODE_VISIBLE) return false;
+      color = bgcolor_;
+      return true;
+    }
+    for (int i = 0; i < palette_size_; ++i) {
+      if (color == colors_[i]) {
+        color = blended_[i];
+        return true;
+      }
+    }
+    color = AlphaBlend(bgcolor_, color);
+    return true;
+  }
+
+  void emit(const Run& run, int16_t y1) {
+    out_.fillRect(blending_mode_, Box(run.x0, run.y0, run.x1, y1), run.color);
+  }
+
+  DisplayOutput& out_;
+  BlendingMode blending_mode_;
+  FillMode fill_mode_;
+  Color bgcolor_;
+  const Color* colors_;
+  const Color* blended_;
+  int palette_size_;
+  BufferedSpanWriter pixels_;
+  int16_t y_;
+  int prev_count_;
+  int count_;
+  Run prev_[kMaxRuns];
+  Run runs_[kMaxRuns];
+};
+
+template <typename Shape>
+void DrawShapeRows(const Shape& shape, const Surface& s, const Box& box,
+                   const Color* colors = nullptr,
+                   const Color* blended = nullptr, int palette_size = 0) {
+  SurfaceRowSink sink(s, colors, blended, palette_size);
+  for (int16_t y = box.yMin(); y <= box.yMax(); ++y) {
+    sink.beginRow(y);
+    ScanRow(shape, y, box.xMin(), box.xMax(), sink);
+  }
+}
+
+
+
+// Fixed-point evaluation.
+//
+// On microcontrollers without an FPU (e.g. ESP32-S2, ESP32-C3), float
+// arithmetic is emulated in software, and the per-pixel color functions
+// dominate the cost of drawing smooth shapes. The fixed-point evaluators
+// compute the same functions in integer arithmetic: positions and distances in
+// Q8 (1/256 of a pixel), their squares in Q16 (64-bit), and unit vectors in
+// Q30. Square roots are only needed close to the boundaries, where they are
+// used to refine the distance from the boundary, known to be small. The colors
+// differ from those calculated in floating point by at most 2 (out of 255) per
+// channel, except for rare pixels lying exactly at the discontinuities of the
+// color functions (e.g. where a very thin outline meets the interior).
+
+inline int32_t ToQ8(float v) { return (int32_t)lroundf(v * 256.0f); }
+
+inline int64_t ToQ16(float v) { return (int64_t)llroundf(v * 65536.0f); }
+
+inline int32_t ToQ30(float v) { return (int32_t)lroundf(v * 1073741824.0f); }
+
+inline int64_t SqQ16(int32_t v) { return (int64_t)v * v; }
+
+// Multiplies a Q8 value by a Q30 one, returning Q8.
+inline int32_t MulQ30(int32_t a, int32_t b) {
+  return (int32_t)(((int64_t)a * b) >> 30);
+}
+
+// Returns sqrt(x), with the relative error below 2^-15.
+inline uint32_t ApproxSqrt64(uint64_t x) {
+  int shift = 0;
+  while ((x >> 32) != 0) {
+    x >>= 2;
+    ++shift;
+  }
+  return (uint32_t)isqrt32((uint32_t)x) << shift;
+}
+
+// Returns r - sqrt(d_sq) (Q8), given r in Q8 and d_sq in Q16, for d within a
+// couple of pixels from r. Calculated as (r^2 - d^2) / (r + d), which makes the
+// result insensitive to the error of the approximate square root.
+inline int32_t DistanceFromRadius(int64_t d_sq, int32_t r) {
+  int64_t num = SqQ16(r) - d_sq;
+  int32_t den = (int32_t)ApproxSqrt64(d_sq) + r;
+  if (den <= 0) return 0;
+  if (num == (int32_t)num) return (int32_t)num / den;
+  return (int32_t)(num / den);
+}
+
+// Returns the alpha scaled by t (Q8), clamped to [0, 1].
+inline uint8_t ScaleAlpha(uint8_t alpha, int32_t t) {
+  if (t <= 0) return 0;
+  if (t >= 256) return alpha;
+  return (uint8_t)((alpha * t) >> 8);
+}
+
+// Helper functions for wedge.
+
 struct WedgeDrawSpec {
   float r;
   float dr;
@@ -422,19 +806,12 @@ inline uint8_t GetWedgeShapeAlpha(const WedgeDrawSpec& spec, float xpax,
   return (uint8_t)(d * spec.max_alpha);
 }
 
-void DrawWedge(const SmoothShape::Wedge& wedge, const Surface& s,
-               const Box& box) {
-  int16_t dx = s.dx();
-  int16_t dy = s.dy();
-  float ax = wedge.ax + dx;
-  float ay = wedge.ay + dy;
-  float bx = wedge.bx + dx;
-  float by = wedge.by + dy;
-  uint8_t max_alpha = wedge.color.a();
-  float bax = bx - ax;
-  float bay = by - ay;
+WedgeDrawSpec ReadWedgeSpec(const SmoothShape::Wedge& wedge) {
+  float bax = wedge.bx - wedge.ax;
+  float bay = wedge.by - wedge.ay;
   float bay_dsq = bax * bax + bay * bay;
-  WedgeDrawSpec spec{
+  return WedgeDrawSpec{
+      // Widen the boundary to simplify calculations.
       .r = wedge.ar + 0.5f,
       .dr = wedge.ar - wedge.br,
       .bax = wedge.bx - wedge.ax,
@@ -444,109 +821,228 @@ void DrawWedge(const SmoothShape::Wedge& wedge, const Surface& s,
       .max_alpha = wedge.color.a(),
       .round_endings = wedge.round_endings,
   };
+}
 
-  // Establish x start and y start.
-  int32_t ys = wedge.ay;
-  if ((ax - wedge.ar) > (bx - wedge.br)) ys = wedge.by;
-
-  uint8_t alpha = max_alpha;
-  float xpax, ypay;
-  bool can_minimize_scan =
-      spec.round_endings && s.fill_mode() != FILL_MODE_RECTANGLE;
-
-  ys += dy;
-  if (ys < box.yMin()) ys = box.yMin();
-  int32_t xs = box.xMin();
-  Color preblended = AlphaBlend(s.bgcolor(), wedge.color);
-
-  BufferedPixelWriter writer(s.out(), s.blending_mode());
-
-  // Scan bounding box from ys down, calculate pixel intensity from distance
-  // to line.
-  for (int32_t yp = ys; yp <= box.yMax(); yp++) {
-    bool endX = false;  // Flag to skip pixels
-    ypay = yp - ay;
-    for (int32_t xp = xs; xp <= box.xMax(); xp++) {
-      if (endX && alpha == 0 && can_minimize_scan) break;  // Skip right side.
-      xpax = xp - ax;
-      // alpha = getAlpha(ar, xpax, ypay, bax, bay, rdt, max_alpha);
-      alpha = GetWedgeShapeAlpha(spec, xpax, ypay);
-      if (alpha == 0 && can_minimize_scan) continue;
-      // Track the edge to minimize calculations.
-      if (!endX) {
-        endX = true;
-        if (can_minimize_scan) {
-          xs = xp;
-        }
-      }
-      if (alpha != 0 || s.fill_mode() == FILL_MODE_RECTANGLE) {
-        writer.writePixel(
-            xp, yp,
-            alpha == max_alpha
-                ? preblended
-                : AlphaBlend(s.bgcolor(), wedge.color.withA(alpha)));
-      }
-    }
+class FloatWedgeEvaluator {
+ public:
+  explicit FloatWedgeEvaluator(const SmoothShape::Wedge& wedge)
+      : wedge_(wedge), spec_(ReadWedgeSpec(wedge)) {}
+
+  Color colorAt(int16_t x, int16_t y) const {
+    return wedge_.color.withA(
+        GetWedgeShapeAlpha(spec_, x - wedge_.ax, y - wedge_.ay));
   }
 
-  if (ys > box.yMax()) ys = box.yMax();
-  // Reset x start to left side of box.
-  xs = box.xMin();
-  // Scan bounding box from ys-1 up, calculate pixel intensity from distance
-  // to line.
-  for (int32_t yp = ys - 1; yp >= box.yMin(); yp--) {
-    bool endX = false;  // Flag to skip pixels
-    ypay = yp - ay;
-    for (int32_t xp = xs; xp <= box.xMax(); xp++) {
-      if (endX && alpha == 0 && can_minimize_scan)
-        break;  // Skip right side of drawn line.
-      xpax = xp - ax;
-      // alpha = getAlpha(ar, xpax, ypay, bax, bay, rdt, max_alpha);
-      alpha = GetWedgeShapeAlpha(spec, xpax, ypay);
-      if (alpha == 0 && can_minimize_scan) continue;
-      // Track line boundary.
-      if (!endX) {
-        endX = true;
-        if (can_minimize_scan) {
-          xs = xp;
-        }
+ private:
+  const SmoothShape::Wedge& wedge_;
+  WedgeDrawSpec spec_;
+};
+
+// Fixed-point version of GetWedgeShapeAlpha. Rather than calculating the
+// (trimmed) position along the axis as the fraction of its length, projects the
+// point onto the axis and its normal, which needs no division.
+class FixedWedgeEvaluator {
+ public:
+  explicit FixedWedgeEvaluator(const SmoothShape::Wedge& wedge)
+      : color_(wedge.color), round_endings_(wedge.round_endings) {
+    WedgeDrawSpec spec = ReadWedgeSpec(wedge);
+    ax_ = ToQ8(wedge.ax);
+    ay_ = ToQ8(wedge.ay);
+    ux_ = ToQ30(spec.bax / spec.sqrt_hd);
+    uy_ = ToQ30(spec.bay / spec.sqrt_hd);
+    len_ = ToQ8(spec.sqrt_hd);
+    r_ = ToQ8(spec.r);
+    dr_per_len_ = (int64_t)llroundf(spec.dr / spec.sqrt_hd * 65536.0f);
+  }
+
+  Color colorAt(int16_t x, int16_t y) const {
+    return color_.withA(alphaAt(x, y));
+  }
+
+ private:
+  uint8_t alphaAt(int16_t x, int16_t y) const {
+    uint8_t max_alpha = color_.a();
+    int32_t px = x * 256 - ax_;
+    int32_t py = y * 256 - ay_;
+    // Position along the axis, and the distance from it.
+    int32_t t = MulQ30(px, ux_) + MulQ30(py, uy_);
+    int32_t n = MulQ30(px, uy_) - MulQ30(py, ux_);
+    int32_t tc = t < 0 ? 0 : t > len_ ? len_ : t;
+    int64_t l_sq = SqQ16(n) + SqQ16(t - tc);
+    // The (widened) radius at tc.
+    int32_t adj = r_ - (int32_t)((tc * dr_per_len_) >> 16);
+    if (SqQ16(adj) < l_sq) return 0;
+    if (!round_endings_) {
+      if (t < 128) {
+        if (t < -128) return 0;
+        return ScaleAlpha(max_alpha, std::min(distance(l_sq, adj), t + 128));
       }
-      if (alpha != 0 || s.fill_mode() == FILL_MODE_RECTANGLE) {
-        writer.writePixel(
-            xp, yp,
-            alpha == max_alpha
-                ? preblended
-                : AlphaBlend(s.bgcolor(), wedge.color.withA(alpha)));
+      int32_t d2 = len_ - t;
+      if (d2 < 128) {
+        if (d2 < -128) return 0;
+        return ScaleAlpha(max_alpha, std::min(distance(l_sq, adj), d2 + 128));
       }
     }
-  }
-}
+    if (adj < 256) {
+      // Sub-pixel width; l_sq < 1.
+      int32_t l = isqrt32((uint32_t)l_sq);
+      return ScaleAlpha(max_alpha, l + adj < 256 ? 2 * adj - 256 : adj - l);
+    }
+    if (SqQ16(adj - 256) > l_sq) return max_alpha;
+    return ScaleAlpha(max_alpha, DistanceFromRadius(l_sq, adj));
+  }
+
+  // Returns the distance of the point from the (widened) boundary, capped
+  // at 1.
+  int32_t distance(int64_t l_sq, int32_t adj) const {
+    if (adj >= 256 && l_sq <= SqQ16(adj - 256)) return 256;
+    return DistanceFromRadius(l_sq, adj);
+  }
+
+  Color color_;
+  bool round_endings_;
+  int32_t ax_;
+  int32_t ay_;
+  // Unit vector along the axis.
+  int32_t ux_;
+  int32_t uy_;
+  int32_t len_;
+  int32_t r_;
+  // Q16.
+  int64_t dr_per_len_;
+};
+
+#if ROO_DISPLAY_SMOOTH_FIXED_POINT
+typedef FixedWedgeEvaluator WedgeEvaluator;
+#else
+typedef FloatWedgeEvaluator WedgeEvaluator;
+#endif
 
 void ReadWedgeColors(const SmoothShape::Wedge& wedge, const int16_t* x,
                      const int16_t* y, uint32_t count, Color* result) {
   // This default rasterizable implementation seems to be ~50% slower than
   // drawTo (but it allows to use wedges as backgrounds or overlays, e.g.
   // indicator needles).
-  float bax = wedge.bx - wedge.ax;
-  float bay = wedge.by - wedge.ay;
-  float bay_dsq = bax * bax + bay * bay;
-  WedgeDrawSpec spec{
-      // Widen the boundary to simplify calculations.
-      .r = wedge.ar + 0.5f,
-      .dr = wedge.ar - wedge.br,
-      .bax = wedge.bx - wedge.ax,
-      .bay = wedge.by - wedge.ay,
-      .hd = bay_dsq,
-      .sqrt_hd = sqrtf(bay_dsq),
-      .max_alpha = wedge.color.a(),
-      .round_endings = wedge.round_endings,
-  };
+  WedgeEvaluator eval(wedge);
   while (count-- > 0) {
-    *result++ = wedge.color.withA(
-        GetWedgeShapeAlpha(spec, *x++ - wedge.ax, *y++ - wedge.ay));
+    *result++ = eval.colorAt(*x++, *y++);
   }
 }
 
+// Adds the intersection of the row at y with the convex polygon to [x0, x1].
+inline void AddConvexPolygonRow(const float* px, const float* py, int n,
+                                float y, float& x0, float& x1) {
+  for (int i = 0, j = n - 1; i < n; j = i++) {
+    if ((py[i] > y) == (py[j] > y)) {
+      if (py[i] == y) {
+        x0 = std::min(x0, px[i]);
+        x1 = std::max(x1, px[i]);
+      }
+      continue;
+    }
+    float x = px[i] + (y - py[i]) * (px[j] - px[i]) / (py[j] - py[i]);
+    x0 = std::min(x0, x);
+    x1 = std::max(x1, x);
+  }
+}
+
+// Adds the chord of the circle, at the row at y, to [x0, x1].
+inline void AddCircleRow(float cx, float cy, float r, float y, float& x0,
+                         float& x1) {
+  float w = ChordHalfWidth(r, fabsf(y - cy));
+  if (w < 0) return;
+  x0 = std::min(x0, cx - w);
+  x1 = std::max(x1, cx + w);
+}
+
+// The wedge is anti-aliased within the distance of 0.5 from its boundary,
+// which consists of the end circles (or, for flat endings, the lines
+// perpendicular to the axis), and the two lines tangent to the end circles.
+class WedgeShape {
+ public:
+  explicit WedgeShape(const SmoothShape::Wedge& wedge)
+      : wedge_(wedge), eval_(wedge) {
+    WedgeDrawSpec spec = ReadWedgeSpec(wedge);
+    float len = spec.sqrt_hd;
+    ux_ = spec.bax / len;
+    uy_ = spec.bay / len;
+    len_ = len;
+    // The distance from the axis, minus the radius at the point's projection
+    // onto the axis, is a linear function, zero on the sides.
+    float dr = spec.dr / len;
+    side_ax_[0] = -uy_ + dr * ux_;
+    side_ay_[0] = ux_ + dr * uy_;
+    side_ax_[1] = uy_ + dr * ux_;
+    side_ay_[1] = -ux_ + dr * uy_;
+    // Bounding polygon of the area between the end circles.
+    float ra = wedge.ar + kBandHalfWidth;
+    float rb = wedge.br + kBandHalfWidth;
+    px_[0] = wedge.ax - uy_ * ra;
+    py_[0] = wedge.ay + ux_ * ra;
+    px_[1] = wedge.bx - uy_ * rb;
+    py_[1] = wedge.by + ux_ * rb;
+    px_[2] = wedge.bx + uy_ * rb;
+    py_[2] = wedge.by - ux_ * rb;
+    px_[3] = wedge.ax + uy_ * ra;
+    py_[3] = wedge.ay - ux_ * ra;
+  }
+
+  void getBands(int16_t y, RowBands& bands) const {
+    const float e = kBandHalfWidth;
+    float x0 = std::numeric_limits<float>::infinity();
+    float x1 = -x0;
+    AddCircleRow(wedge_.ax, wedge_.ay, wedge_.ar + e, y, x0, x1);
+    AddCircleRow(wedge_.bx, wedge_.by, wedge_.br + e, y, x0, x1);
+    AddConvexPolygonRow(px_, py_, 4, y, x0, x1);
+    bands.clip(x0, x1);
+    float dy = y - wedge_.ay;
+    for (int i = 0; i < 2; ++i) {
+      bands.addLinear(side_ax_[i],
+                      dy * side_ay_[i] - side_ax_[i] * wedge_.ax - wedge_.ar,
+                      -e, e);
+    }
+    if (wedge_.round_endings) {
+      bands.addRing(wedge_.ax, wedge_.ax, fabsf(dy), wedge_.ar - e,
+                    wedge_.ar + e);
+      bands.addRing(wedge_.bx, wedge_.bx, fabsf(y - wedge_.by), wedge_.br - e,
+                    wedge_.br + e);
+    } else {
+      // The distance along the axis from 'a'.
+      float b = dy * uy_ - ux_ * wedge_.ax;
+      bands.addLinear(ux_, b, -e, e);
+      bands.addLinear(ux_, b, len_ - e, len_ + e);
+    }
+  }
+
+  Color getColor(int16_t x, int16_t y) const { return eval_.colorAt(x, y); }
+
+ private:
+  const SmoothShape::Wedge& wedge_;
+  WedgeEvaluator eval_;
+  // Unit vector along the axis, from 'a' to 'b'.
+  float ux_;
+  float uy_;
+  float len_;
+  // Coefficients of the linear functions that are zero on the sides.
+  float side_ax_[2];
+  float side_ay_[2];
+  float px_[4];
+  float py_[4];
+};
+
+void DrawWedge(SmoothShape::Wedge wedge, const Surface& s, const Box& box) {
+  wedge.ax += s.dx();
+  wedge.ay += s.dy();
+  wedge.bx += s.dx();
+  wedge.by += s.dy();
+  DrawShapeRows(WedgeShape(wedge), s, box);
+}
+
+void ReadWedgeRow(const SmoothShape::Wedge& wedge, int16_t y, int16_t x0,
+                  int16_t x1, Color* result) {
+  ReadShapeRow(WedgeShape(wedge), y, x0, x1, result);
+}
+
 // Helper functions for round rect.
 
 inline Color GetSmoothRoundRectPixelColor(const SmoothShape::RoundRect& rect,
@@ -605,6 +1101,89 @@ inline Color GetSmoothRoundRectPixelColor(const SmoothShape::RoundRect& rect,
                                                            (ri - d + 0.5f)))));
 }
 
+class FloatRoundRectEvaluator {
+ public:
+  explicit FloatRoundRectEvaluator(const SmoothShape::RoundRect& rect)
+      : rect_(rect) {}
+
+  Color colorAt(int16_t x, int16_t y) const {
+    if (rect_.inner_mid.contains(x, y) || rect_.inner_wide.contains(x, y) ||
+        rect_.inner_tall.contains(x, y)) {
+      return rect_.interior_color;
+    }
+    return GetSmoothRoundRectPixelColor(rect_, x, y);
+  }
+
+ private:
+  const SmoothShape::RoundRect& rect_;
+};
+
+// Fixed-point version of GetSmoothRoundRectPixelColor.
+class FixedRoundRectEvaluator {
+ public:
+  explicit FixedRoundRectEvaluator(const SmoothShape::RoundRect& rect)
+      : rect_(rect),
+        x0_(ToQ8(rect.x0)),
+        y0_(ToQ8(rect.y0)),
+        x1_(ToQ8(rect.x1)),
+        y1_(ToQ8(rect.y1)),
+        ro_(ToQ8(rect.ro)),
+        ri_(ToQ8(rect.ri)),
+        ro_min_sq_(ToQ16(rect.ro_sq_adj - rect.ro)),
+        ro_max_sq_(ToQ16(rect.ro_sq_adj + rect.ro)),
+        ri_min_sq_(ToQ16(rect.ri_sq_adj - rect.ri)),
+        ri_max_sq_(ToQ16(rect.ri_sq_adj + rect.ri)) {}
+
+  Color colorAt(int16_t x, int16_t y) const {
+    if (rect_.inner_mid.contains(x, y) || rect_.inner_wide.contains(x, y) ||
+        rect_.inner_tall.contains(x, y)) {
+      return rect_.interior_color;
+    }
+    int32_t xq = x * 256;
+    int32_t yq = y * 256;
+    int32_t dx = xq < x0_ ? xq - x0_ : xq > x1_ ? xq - x1_ : 0;
+    int32_t dy = yq < y0_ ? yq - y0_ : yq > y1_ ? yq - y1_ : 0;
+    int64_t d_sq = SqQ16(dx) + SqQ16(dy);
+    Color interior = rect_.interior_color;
+    Color outline = rect_.outline_color;
+    if (d_sq <= ri_min_sq_) return interior;
+    if (d_sq >= ro_max_sq_) return color::Transparent;
+    bool fully_within_outer = d_sq <= ro_min_sq_;
+    bool fully_outside_inner = rect_.ro == rect_.ri || d_sq >= ri_max_sq_;
+    if (fully_within_outer && fully_outside_inner) return outline;
+    if (fully_outside_inner) {
+      return outline.withA(
+          ScaleAlpha(outline.a(), DistanceFromRadius(d_sq, ro_) + 128));
+    }
+    if (fully_within_outer) {
+      return AlphaBlend(interior,
+                        outline.withA(ScaleAlpha(
+                            outline.a(), 128 - DistanceFromRadius(d_sq, ri_))));
+    }
+    return AlphaBlend(interior,
+                      outline.withA(ScaleAlpha(outline.a(), ro_ - ri_)));
+  }
+
+ private:
+  const SmoothShape::RoundRect& rect_;
+  int32_t x0_;
+  int32_t y0_;
+  int32_t x1_;
+  int32_t y1_;
+  int32_t ro_;
+  int32_t ri_;
+  int64_t ro_min_sq_;
+  int64_t ro_max_sq_;
+  int64_t ri_min_sq_;
+  int64_t ri_max_sq_;
+};
+
+#if ROO_DISPLAY_SMOOTH_FIXED_POINT
+typedef FixedRoundRectEvaluator RoundRectEvaluator;
+#else
+typedef FloatRoundRectEvaluator RoundRectEvaluator;
+#endif
+
 enum RectColor {
   NON_UNIFORM = 0,
   TRANSPARENT = 1,
@@ -725,10 +1304,11 @@ bool ReadColorRectOfRoundRect(const SmoothShape::RoundRect& rect, int16_t xMin,
     default:
       break;
   }
+  RoundRectEvaluator eval(rect);
   Color* out = result;
   for (int16_t y = yMin; y <= yMax; ++y) {
     for (int16_t x = xMin; x <= xMax; ++x) {
-      *out++ = GetSmoothRoundRectPixelColor(rect, x, y);
+      *out++ = eval.colorAt(x, y);
     }
   }
   // This is now very unlikely to be true, or we would have caught it above.
@@ -743,117 +1323,49 @@ bool ReadColorRectOfRoundRect(const SmoothShape::RoundRect& rect, int16_t xMin,
 
 void ReadRoundRectColors(const SmoothShape::RoundRect& rect, const int16_t* x,
                          const int16_t* y, uint32_t count, Color* result) {
+  RoundRectEvaluator eval(rect);
   while (count-- > 0) {
-    if (rect.inner_mid.contains(*x, *y) || rect.inner_wide.contains(*x, *y) ||
-        rect.inner_tall.contains(*x, *y)) {
-      *result = rect.interior_color;
-    } else {
-      *result = GetSmoothRoundRectPixelColor(rect, *x, *y);
-    }
-    ++x;
-    ++y;
-    ++result;
+    *result++ = eval.colorAt(*x++, *y++);
   }
 }
 
-struct RoundRectDrawSpec {
-  DisplayOutput* out;
-  FillMode fill_mode;
-  BlendingMode blending_mode;
-  Color bgcolor;
-  Color pre_blended_outline;
-  Color pre_blended_interior;
-};
-
-// Called for rectangles with area <= 64 pixels.
-inline void FillSubrectOfRoundRect(const SmoothShape::RoundRect& rect,
-                                   const RoundRectDrawSpec& spec,
-                                   const Box& box) {
-  Color interior = rect.interior_color;
-  Color outline = rect.outline_color;
-  switch (DetermineRectColorForRoundRect(rect, box)) {
-    case TRANSPARENT: {
-      if (spec.fill_mode == FILL_MODE_RECTANGLE) {
-        spec.out->fillRect(spec.blending_mode, box, spec.bgcolor);
-      }
+// The round rect is anti-aliased within the distance of 0.5 from its outer and
+// inner boundaries, which are at the distances ro and ri from the (x0, y0, x1,
+// y1) rectangle.
+class RoundRectShape {
+ public:
+  explicit RoundRectShape(const SmoothShape::RoundRect& rect)
+      : rect_(rect), eval_(rect) {}
+
+  void getBands(int16_t y, RowBands& bands) const {
+    const float e = kBandHalfWidth;
+    float dy = y < rect_.y0 ? rect_.y0 - y : y > rect_.y1 ? y - rect_.y1 : 0;
+    float w = ChordHalfWidth(rect_.ro + e, dy);
+    if (w < 0) {
+      bands.clear();
       return;
     }
-    case INTERIOR: {
-      if (spec.fill_mode == FILL_MODE_RECTANGLE ||
-          interior != color::Transparent) {
-        spec.out->fillRect(spec.blending_mode, box, spec.pre_blended_interior);
-      }
-      return;
-    }
-    case OUTLINE_ACTIVE: {
-      if (spec.fill_mode == FILL_MODE_RECTANGLE ||
-          outline != color::Transparent) {
-        spec.out->fillRect(spec.blending_mode, box, spec.pre_blended_outline);
-        return;
-      }
+    bands.clip(rect_.x0 - w, rect_.x1 + w);
+    bands.addRing(rect_.x0, rect_.x1, dy, rect_.ro - e, rect_.ro + e);
+    if (rect_.ri != rect_.ro) {
+      bands.addRing(rect_.x0, rect_.x1, dy, rect_.ri - e, rect_.ri + e);
     }
-    default:
-      break;
   }
 
-  // Slow case; evaluate every pixel from the rectangle.
-  if (spec.fill_mode == FILL_MODE_VISIBLE) {
-    BufferedPixelWriter writer(*spec.out, spec.blending_mode);
-    for (int16_t y = box.yMin(); y <= box.yMax(); ++y) {
-      for (int16_t x = box.xMin(); x <= box.xMax(); ++x) {
-        Color c = GetSmoothRoundRectPixelColor(rect, x, y);
-        if (c == color::Transparent) continue;
-        writer.writePixel(x, y,
-                          c == interior  ? spec.pre_blended_interior
-                          : c == outline ? spec.pre_blended_outline
-                                         : AlphaBlend(spec.bgcolor, c));
-      }
-    }
-  } else {
-    Color color[64];
-    int cnt = 0;
-    for (int16_t y = box.yMin(); y <= box.yMax(); ++y) {
-      for (int16_t x = box.xMin(); x <= box.xMax(); ++x) {
-        Color c = GetSmoothRoundRectPixelColor(rect, x, y);
-        color[cnt++] = c.a() == 0      ? spec.bgcolor
-                       : c == interior ? spec.pre_blended_interior
-                       : c == outline  ? spec.pre_blended_outline
-                                       : AlphaBlend(spec.bgcolor, c);
-      }
-    }
-    spec.out->setAddress(box, spec.blending_mode);
-    spec.out->write(color, cnt);
-  }
-}
+  Color getColor(int16_t x, int16_t y) const { return eval_.colorAt(x, y); }
 
-void FillSubrectangle(const SmoothShape::RoundRect& rect,
-                      const RoundRectDrawSpec& spec, const Box& box) {
-  const int16_t xMinOuter = (box.xMin() / 8) * 8;
-  const int16_t yMinOuter = (box.yMin() / 8) * 8;
-  const int16_t xMaxOuter = (box.xMax() / 8) * 8 + 7;
-  const int16_t yMaxOuter = (box.yMax() / 8) * 8 + 7;
-  for (int16_t y = yMinOuter; y < yMaxOuter; y += 8) {
-    for (int16_t x = xMinOuter; x < xMaxOuter; x += 8) {
-      FillSubrectOfRoundRect(
-          rect, spec,
-          Box(std::max(x, box.xMin()), std::max(y, box.yMin()),
-              std::min((int16_t)(x + 7), box.xMax()),
-              std::min((int16_t)(y + 7), box.yMax())));
-    }
-  }
+ private:
+  const SmoothShape::RoundRect& rect_;
+  RoundRectEvaluator eval_;
+};
+
+void ReadRoundRectRow(const SmoothShape::RoundRect& rect, int16_t y,
+                      int16_t x0, int16_t x1, Color* result) {
+  ReadShapeRow(RoundRectShape(rect), y, x0, x1, result);
 }
 
 void DrawRoundRect(SmoothShape::RoundRect rect, const Surface& s,
                    const Box& box) {
-  RoundRectDrawSpec spec{
-      .out = &s.out(),
-      .fill_mode = s.fill_mode(),
-      .blending_mode = s.blending_mode(),
-      .bgcolor = s.bgcolor(),
-      .pre_blended_outline = AlphaBlend(
-          AlphaBlend(s.bgcolor(), rect.interior_color), rect.outline_color),
-      .pre_blended_interior = AlphaBlend(s.bgcolor(), rect.interior_color),
-  };
   if (s.dx() != 0 || s.dy() != 0) {
     rect.x0 += s.dx();
     rect.y0 += s.dy();
@@ -863,46 +1375,14 @@ void DrawRoundRect(SmoothShape::RoundRect rect, const Surface& s,
     rect.inner_mid = rect.inner_mid.translate(s.dx(), s.dy());
     rect.inner_tall = rect.inner_tall.translate(s.dx(), s.dy());
   }
-  {
-    uint32_t pixel_count = box.area();
-    if (pixel_count <= 64) {
-      FillSubrectOfRoundRect(rect, spec, box);
-      return;
-    }
-  }
-  if (rect.inner_mid.width() <= 16) {
-    FillSubrectangle(rect, spec, box);
-  } else {
-    const Box& inner = rect.inner_mid;
-    FillSubrectangle(rect, spec,
-                     Box(box.xMin(), box.yMin(), box.xMax(), inner.yMin() - 1));
-    FillSubrectangle(
-        rect, spec,
-        Box(box.xMin(), inner.yMin(), inner.xMin() - 1, inner.yMax()));
-    if (s.fill_mode() == FILL_MODE_RECTANGLE ||
-        rect.interior_color != color::Transparent) {
-      s.out().fillRect(BLENDING_MODE_SOURCE, inner, spec.pre_blended_interior);
-    }
-    FillSubrectangle(
-        rect, spec,
-        Box(inner.xMax() + 1, inner.yMin(), box.xMax(), inner.yMax()));
-    FillSubrectangle(rect, spec,
-                     Box(box.xMin(), inner.yMax() + 1, box.xMax(), box.yMax()));
-  }
+  Color interior = AlphaBlend(s.bgcolor(), rect.interior_color);
+  Color colors[] = {rect.interior_color, rect.outline_color};
+  Color blended[] = {interior, AlphaBlend(interior, rect.outline_color)};
+  DrawShapeRows(RoundRectShape(rect), s, box, colors, blended, 2);
 }
 
 // Arc.
 
-struct ArcDrawSpec {
-  DisplayOutput* out;
-  FillMode fill_mode;
-  BlendingMode blending_mode;
-  Color bgcolor;
-  Color pre_blended_outline_active;
-  Color pre_blended_outline_inactive;
-  Color pre_blended_interior;
-};
-
 Color GetSmoothArcPixelColor(const SmoothShape::Arc& spec, int16_t x,
                              int16_t y) {
   float dx = x - spec.xc;
@@ -1008,6 +1488,131 @@ Color GetSmoothArcPixelColor(const SmoothShape::Arc& spec, int16_t x,
                                                    (spec.ri - d + 0.5f)))));
 }
 
+class FloatArcEvaluator {
+ public:
+  explicit FloatArcEvaluator(const SmoothShape::Arc& arc) : arc_(arc) {}
+
+  Color colorAt(int16_t x, int16_t y) const {
+    return GetSmoothArcPixelColor(arc_, x, y);
+  }
+
+ private:
+  const SmoothShape::Arc& arc_;
+};
+
+// Fixed-point version of GetSmoothArcPixelColor.
+class FixedArcEvaluator {
+ public:
+  explicit FixedArcEvaluator(const SmoothShape::Arc& arc)
+      : arc_(arc),
+        xc_(ToQ8(arc.xc)),
+        yc_(ToQ8(arc.yc)),
+        ro_(ToQ8(arc.ro)),
+        ri_(ToQ8(arc.ri)),
+        rm_(ToQ8(arc.rm)),
+        ro_min_sq_(ToQ16(arc.ro_sq_adj - arc.ro)),
+        ro_max_sq_(ToQ16(arc.ro_sq_adj + arc.ro)),
+        ri_min_sq_(ToQ16(arc.ri_sq_adj - arc.ri)),
+        ri_max_sq_(ToQ16(arc.ri_sq_adj + arc.ri)),
+        rm_min_sq_(ToQ16(arc.rm_sq_adj - arc.rm)),
+        rm_max_sq_(ToQ16(arc.rm_sq_adj + arc.rm)),
+        start_x_slope_(ToQ30(arc.start_x_slope)),
+        start_y_slope_(ToQ30(arc.start_y_slope)),
+        end_x_slope_(ToQ30(arc.end_x_slope)),
+        end_y_slope_(ToQ30(arc.end_y_slope)),
+        start_x_rc_(ToQ8(arc.start_x_rc)),
+        start_y_rc_(ToQ8(arc.start_y_rc)),
+        end_x_rc_(ToQ8(arc.end_x_rc)),
+        end_y_rc_(ToQ8(arc.end_y_rc)) {}
+
+  Color colorAt(int16_t x, int16_t y) const {
+    if (arc_.inner_mid.contains(x, y)) return arc_.interior_color;
+    int32_t dx = x * 256 - xc_;
+    int32_t dy = y * 256 - yc_;
+    int64_t d_sq = SqQ16(dx) + SqQ16(dy);
+    if (d_sq <= ri_min_sq_) return arc_.interior_color;
+    if (d_sq >= ro_max_sq_) return color::Transparent;
+    Color active = arc_.outline_active_color;
+    Color inactive = arc_.outline_inactive_color;
+    Color color = active;
+    int32_t n1 = MulQ30(dx, start_y_slope_) - MulQ30(dy, start_x_slope_);
+    int32_t n2 = MulQ30(dy, end_x_slope_) - MulQ30(dx, end_y_slope_);
+    bool within_range = arc_.range_angle_sharp ? (n1 <= -128 && n2 <= -128)
+                                               : (n1 <= -128 || n2 <= -128);
+    if (!within_range) {
+      if (arc_.round_endings) {
+        int64_t smaller_dist_sq =
+            std::min(SqQ16(dx - start_x_rc_) + SqQ16(dy - start_y_rc_),
+                     SqQ16(dx - end_x_rc_) + SqQ16(dy - end_y_rc_));
+        if (smaller_dist_sq > rm_max_sq_) {
+          color = inactive;
+        } else if (smaller_dist_sq >= rm_min_sq_) {
+          color = AlphaBlend(
+              inactive,
+              active.withA(ScaleAlpha(
+                  active.a(), DistanceFromRadius(smaller_dist_sq, rm_) + 128)));
+        }
+      } else {
+        bool outside_range = arc_.range_angle_sharp
+                                 ? (n1 >= 128 || n2 >= 128)
+                                 : (n1 >= 128 && n2 >= 128);
+        if (outside_range) {
+          color = inactive;
+        } else {
+          int32_t alpha = 256;
+          if (n1 > -128 && n1 < 128) alpha = (alpha * (128 - n1)) >> 8;
+          if (n2 > -128 && n2 < 128) alpha = (alpha * (128 - n2)) >> 8;
+          color = AlphaBlend(inactive,
+                             active.withA(ScaleAlpha(active.a(), alpha)));
+        }
+      }
+    }
+    bool fully_within_outer = d_sq <= ro_min_sq_;
+    bool fully_outside_inner =
+        arc_.ro == arc_.ri || d_sq >= ri_max_sq_ || arc_.ri == 0;
+    if (fully_within_outer && fully_outside_inner) return color;
+    if (fully_outside_inner) {
+      return color.withA(
+          ScaleAlpha(color.a(), DistanceFromRadius(d_sq, ro_) + 128));
+    }
+    if (fully_within_outer) {
+      return AlphaBlend(arc_.interior_color,
+                        color.withA(ScaleAlpha(
+                            color.a(), 128 - DistanceFromRadius(d_sq, ri_))));
+    }
+    return AlphaBlend(arc_.interior_color,
+                      color.withA(ScaleAlpha(color.a(), ro_ - ri_)));
+  }
+
+ private:
+  const SmoothShape::Arc& arc_;
+  int32_t xc_;
+  int32_t yc_;
+  int32_t ro_;
+  int32_t ri_;
+  int32_t rm_;
+  int64_t ro_min_sq_;
+  int64_t ro_max_sq_;
+  int64_t ri_min_sq_;
+  int64_t ri_max_sq_;
+  int64_t rm_min_sq_;
+  int64_t rm_max_sq_;
+  int32_t start_x_slope_;
+  int32_t start_y_slope_;
+  int32_t end_x_slope_;
+  int32_t end_y_slope_;
+  int32_t start_x_rc_;
+  int32_t start_y_rc_;
+  int32_t end_x_rc_;
+  int32_t end_y_rc_;
+};
+
+#if ROO_DISPLAY_SMOOTH_FIXED_POINT
+typedef FixedArcEvaluator ArcEvaluator;
+#else
+typedef FloatArcEvaluator ArcEvaluator;
+#endif
+
 inline float CalcDistSq(float x1, float y1, int16_t x2, int16_t y2) {
   float dx = x1 - x2;
   float dy = y1 - y2;
@@ -1181,128 +1786,6 @@ inline RectColor DetermineRectColorForArc(const SmoothShape::Arc& arc,
   return NON_UNIFORM;
 }
 
-// Called for arcs with area <= 64 pixels.
-void FillSubrectOfArc(const SmoothShape::Arc& arc, const ArcDrawSpec& spec,
-                      const Box& box) {
-  Color interior = arc.interior_color;
-  Color outline_active = arc.outline_active_color;
-  Color outline_inactive = arc.outline_inactive_color;
-  switch (DetermineRectColorForArc(arc, box)) {
-    case TRANSPARENT: {
-      if (spec.fill_mode == FILL_MODE_RECTANGLE) {
-        spec.out->fillRect(spec.blending_mode, box, spec.bgcolor);
-      }
-      return;
-    }
-    case INTERIOR: {
-      if (spec.fill_mode == FILL_MODE_RECTANGLE ||
-          interior != color::Transparent) {
-        spec.out->fillRect(spec.blending_mode, box, spec.pre_blended_interior);
-      }
-      return;
-    }
-    case OUTLINE_ACTIVE: {
-      if (spec.fill_mode == FILL_MODE_RECTANGLE ||
-          outline_active != color::Transparent) {
-        spec.out->fillRect(spec.blending_mode, box,
-                           spec.pre_blended_outline_active);
-        return;
-      }
-    }
-    case OUTLINE_INACTIVE: {
-      if (spec.fill_mode == FILL_MODE_RECTANGLE ||
-          outline_inactive != color::Transparent) {
-        spec.out->fillRect(spec.blending_mode, box,
-                           spec.pre_blended_outline_inactive);
-        return;
-      }
-    }
-    default:
-      break;
-  }
-
-  // Slow case; evaluate every pixel from the rectangle.
-  if (spec.fill_mode == FILL_MODE_VISIBLE) {
-    BufferedPixelWriter writer(*spec.out, spec.blending_mode);
-    for (int16_t y = box.yMin(); y <= box.yMax(); ++y) {
-      for (int16_t x = box.xMin(); x <= box.xMax(); ++x) {
-        Color c = GetSmoothArcPixelColor(arc, x, y);
-        if (c == color::Transparent) continue;
-        writer.writePixel(
-            x, y,
-            c == interior           ? spec.pre_blended_interior
-            : c == outline_active   ? spec.pre_blended_outline_active
-            : c == outline_inactive ? spec.pre_blended_outline_inactive
-                                    : AlphaBlend(spec.bgcolor, c));
-      }
-    }
-  } else {
-    Color color[64];
-    int cnt = 0;
-    for (int16_t y = box.yMin(); y <= box.yMax(); ++y) {
-      for (int16_t x = box.xMin(); x <= box.xMax(); ++x) {
-        Color c = GetSmoothArcPixelColor(arc, x, y);
-        color[cnt++] = c.a() == 0            ? spec.bgcolor
-                       : c == interior       ? spec.pre_blended_interior
-                       : c == outline_active ? spec.pre_blended_outline_active
-                       : c == outline_inactive
-                           ? spec.pre_blended_outline_inactive
-                           : AlphaBlend(spec.bgcolor, c);
-      }
-    }
-    spec.out->setAddress(box, spec.blending_mode);
-    spec.out->write(color, cnt);
-  }
-}
-
-void DrawArc(SmoothShape::Arc arc, const Surface& s, const Box& box) {
-  ArcDrawSpec spec{
-      .out = &s.out(),
-      .fill_mode = s.fill_mode(),
-      .blending_mode = s.blending_mode(),
-      .bgcolor = s.bgcolor(),
-      .pre_blended_outline_active =
-          AlphaBlend(AlphaBlend(s.bgcolor(), arc.interior_color),
-                     arc.outline_active_color),
-      .pre_blended_outline_inactive =
-          AlphaBlend(AlphaBlend(s.bgcolor(), arc.interior_color),
-                     arc.outline_inactive_color),
-      .pre_blended_interior = AlphaBlend(s.bgcolor(), arc.interior_color),
-  };
-  if (s.dx() != 0 || s.dy() != 0) {
-    arc.xc += s.dx();
-    arc.yc += s.dy();
-    arc.start_x_rc += s.dx();
-    arc.start_y_rc += s.dy();
-    arc.end_x_rc += s.dx();
-    arc.end_y_rc += s.dy();
-    arc.inner_mid = arc.inner_mid.translate(s.dx(), s.dy());
-  }
-  int16_t xMin = box.xMin();
-  int16_t xMax = box.xMax();
-  int16_t yMin = box.yMin();
-  int16_t yMax = box.yMax();
-  {
-    uint32_t pixel_count = box.area();
-    if (pixel_count <= 64) {
-      FillSubrectOfArc(arc, spec, box);
-      return;
-    }
-  }
-  const int16_t xMinOuter = (xMin / 8) * 8;
-  const int16_t yMinOuter = (yMin / 8) * 8;
-  const int16_t xMaxOuter = (xMax / 8) * 8 + 7;
-  const int16_t yMaxOuter = (yMax / 8) * 8 + 7;
-  for (int16_t y = yMinOuter; y < yMaxOuter; y += 8) {
-    for (int16_t x = xMinOuter; x < xMaxOuter; x += 8) {
-      FillSubrectOfArc(arc, spec,
-                       Box(std::max(x, box.xMin()), std::max(y, box.yMin()),
-                           std::min((int16_t)(x + 7), box.xMax()),
-                           std::min((int16_t)(y + 7), box.yMax())));
-    }
-  }
-}
-
 bool ReadColorRectOfArc(const SmoothShape::Arc& arc, int16_t xMin, int16_t yMin,
                         int16_t xMax, int16_t yMax, Color* result) {
   Box box(xMin, yMin, xMax, yMax);
@@ -1326,10 +1809,11 @@ bool ReadColorRectOfArc(const SmoothShape::Arc& arc, int16_t xMin, int16_t yMin,
     default:
       break;
   }
+  ArcEvaluator eval(arc);
   Color* out = result;
   for (int16_t y = yMin; y <= yMax; ++y) {
     for (int16_t x = xMin; x <= xMax; ++x) {
-      *out++ = GetSmoothArcPixelColor(arc, x, y);
+      *out++ = eval.colorAt(x, y);
     }
   }
   // // This is now very unlikely to be true, or we would have caught it above.
@@ -1343,21 +1827,73 @@ bool ReadColorRectOfArc(const SmoothShape::Arc& arc, int16_t xMin, int16_t yMin,
 
 void ReadArcColors(const SmoothShape::Arc& arc, const int16_t* x,
                    const int16_t* y, uint32_t count, Color* result) {
+  ArcEvaluator eval(arc);
   while (count-- > 0) {
-    *result++ = GetSmoothArcPixelColor(arc, *x++, *y++);
+    *result++ = eval.colorAt(*x++, *y++);
   }
 }
 
-// Triangle.
+// The arc is anti-aliased within the distance of 0.5 from its outer and inner
+// circles, from the lines through the center at the start and end angles, and
+// (for round endings) from the circles of the endings.
+class ArcShape {
+ public:
+  explicit ArcShape(const SmoothShape::Arc& arc) : arc_(arc), eval_(arc) {}
+
+  void getBands(int16_t y, RowBands& bands) const {
+    const float e = kBandHalfWidth;
+    float dy = y - arc_.yc;
+    float w = ChordHalfWidth(arc_.ro + e, fabsf(dy));
+    if (w < 0) {
+      bands.clear();
+      return;
+    }
+    bands.clip(arc_.xc - w, arc_.xc + w);
+    bands.addRing(arc_.xc, arc_.xc, fabsf(dy), arc_.ro - e, arc_.ro + e);
+    if (arc_.ri != arc_.ro && arc_.ri != 0) {
+      bands.addRing(arc_.xc, arc_.xc, fabsf(dy), arc_.ri - e, arc_.ri + e);
+    }
+    bands.addLinear(arc_.start_y_slope,
+                    -arc_.start_y_slope * arc_.xc - arc_.start_x_slope * dy,
+                    -e, e);
+    bands.addLinear(-arc_.end_y_slope,
+                    arc_.end_y_slope * arc_.xc + arc_.end_x_slope * dy, -e, e);
+    if (arc_.round_endings) {
+      bands.addRing(arc_.xc + arc_.start_x_rc, arc_.xc + arc_.start_x_rc,
+                    fabsf(dy - arc_.start_y_rc), arc_.rm - e, arc_.rm + e);
+      bands.addRing(arc_.xc + arc_.end_x_rc, arc_.xc + arc_.end_x_rc,
+                    fabsf(dy - arc_.end_y_rc), arc_.rm - e, arc_.rm + e);
+    }
+  }
+
+  Color getColor(int16_t x, int16_t y) const { return eval_.colorAt(x, y); }
 
-struct TriangleDrawSpec {
-  DisplayOutput* out;
-  FillMode fill_mode;
-  BlendingMode blending_mode;
-  Color bgcolor;
-  Color pre_blended_interior;
+ private:
+  const SmoothShape::Arc& arc_;
+  ArcEvaluator eval_;
 };
 
+void DrawArc(SmoothShape::Arc arc, const Surface& s, const Box& box) {
+  if (s.dx() != 0 || s.dy() != 0) {
+    arc.xc += s.dx();
+    arc.yc += s.dy();
+    arc.inner_mid = arc.inner_mid.translate(s.dx(), s.dy());
+  }
+  Color interior = AlphaBlend(s.bgcolor(), arc.interior_color);
+  Color colors[] = {arc.interior_color, arc.outline_active_color,
+                    arc.outline_inactive_color};
+  Color blended[] = {interior, AlphaBlend(interior, arc.outline_active_color),
+                     AlphaBlend(interior, arc.outline_inactive_color)};
+  DrawShapeRows(ArcShape(arc), s, box, colors, blended, 3);
+}
+
+void ReadArcRow(const SmoothShape::Arc& arc, int16_t y, int16_t x0, int16_t x1,
+                Color* result) {
+  ReadShapeRow(ArcShape(arc), y, x0, x1, result);
+}
+
+// Triangle.
+
 Color GetSmoothTrianglePixelColor(const SmoothShape::Triangle& t, int16_t x,
                                   int16_t y) {
   float n1 = t.dy12 * (x - t.x1) - t.dx12 * (y - t.y1);
@@ -1379,6 +1915,71 @@ Color GetSmoothTrianglePixelColor(const SmoothShape::Triangle& t, int16_t x,
                               std::min(1.0f, 0.5f - n3)));
 }
 
+class FloatTriangleEvaluator {
+ public:
+  explicit FloatTriangleEvaluator(const SmoothShape::Triangle& t) : t_(t) {}
+
+  Color colorAt(int16_t x, int16_t y) const {
+    return GetSmoothTrianglePixelColor(t_, x, y);
+  }
+
+ private:
+  const SmoothShape::Triangle& t_;
+};
+
+// Fixed-point version of GetSmoothTrianglePixelColor.
+class FixedTriangleEvaluator {
+ public:
+  explicit FixedTriangleEvaluator(const SmoothShape::Triangle& t)
+      : color_(t.color),
+        x1_(ToQ8(t.x1)),
+        y1_(ToQ8(t.y1)),
+        dx12_(ToQ30(t.dx12)),
+        dy12_(ToQ30(t.dy12)),
+        x2_(ToQ8(t.x2)),
+        y2_(ToQ8(t.y2)),
+        dx23_(ToQ30(t.dx23)),
+        dy23_(ToQ30(t.dy23)),
+        x3_(ToQ8(t.x3)),
+        y3_(ToQ8(t.y3)),
+        dx31_(ToQ30(t.dx31)),
+        dy31_(ToQ30(t.dy31)) {}
+
+  Color colorAt(int16_t x, int16_t y) const {
+    int32_t xq = x * 256;
+    int32_t yq = y * 256;
+    int32_t n1 = MulQ30(xq - x1_, dy12_) - MulQ30(yq - y1_, dx12_);
+    int32_t n2 = MulQ30(xq - x2_, dy23_) - MulQ30(yq - y2_, dx23_);
+    int32_t n3 = MulQ30(xq - x3_, dy31_) - MulQ30(yq - y3_, dx31_);
+    if (n1 <= -128 && n2 <= -128 && n3 <= -128) return color_;
+    if (n1 >= 128 || n2 >= 128 || n3 >= 128) return color::Transparent;
+    int32_t c = (std::min(256, 128 - n1) * std::min(256, 128 - n2)) >> 8;
+    c = (c * std::min(256, 128 - n3)) >> 8;
+    return color_.withA((color_.a() * c + 128) >> 8);
+  }
+
+ private:
+  Color color_;
+  int32_t x1_;
+  int32_t y1_;
+  int32_t dx12_;
+  int32_t dy12_;
+  int32_t x2_;
+  int32_t y2_;
+  int32_t dx23_;
+  int32_t dy23_;
+  int32_t x3_;
+  int32_t y3_;
+  int32_t dx31_;
+  int32_t dy31_;
+};
+
+#if ROO_DISPLAY_SMOOTH_FIXED_POINT
+typedef FixedTriangleEvaluator TriangleEvaluator;
+#else
+typedef FloatTriangleEvaluator TriangleEvaluator;
+#endif
+
 inline bool IsPointWithinTriangle(const SmoothShape::Triangle& t, float x,
                                   float y) {
   float n1 = t.dy12 * (x - t.x1) - t.dx12 * (y - t.y1);
@@ -1433,99 +2034,6 @@ inline RectColor DetermineRectColorForTriangle(
   return NON_UNIFORM;
 }
 
-// Called for arcs with area <= 64 pixels.
-void FillSubrectOfTriangle(const SmoothShape::Triangle& triangle,
-                           const TriangleDrawSpec& spec, const Box& box) {
-  Color interior = triangle.color;
-  switch (DetermineRectColorForTriangle(triangle, box)) {
-    case TRANSPARENT: {
-      if (spec.fill_mode == FILL_MODE_RECTANGLE) {
-        spec.out->fillRect(spec.blending_mode, box, spec.bgcolor);
-      }
-      return;
-    }
-    case INTERIOR: {
-      if (spec.fill_mode == FILL_MODE_RECTANGLE ||
-          interior != color::Transparent) {
-        spec.out->fillRect(spec.blending_mode, box, spec.pre_blended_interior);
-      }
-      return;
-    }
-    default:
-      break;
-  }
-
-  // Slow case; evaluate every pixel from the rectangle.
-  if (spec.fill_mode == FILL_MODE_VISIBLE) {
-    BufferedPixelWriter writer(*spec.out, spec.blending_mode);
-    for (int16_t y = box.yMin(); y <= box.yMax(); ++y) {
-      for (int16_t x = box.xMin(); x <= box.xMax(); ++x) {
-        Color c = GetSmoothTrianglePixelColor(triangle, x, y);
-        if (c == color::Transparent) continue;
-        writer.writePixel(x, y,
-                          c == interior ? spec.pre_blended_interior
-                                        : AlphaBlend(spec.bgcolor, c));
-      }
-    }
-  } else {
-    Color color[64];
-    int cnt = 0;
-    for (int16_t y = box.yMin(); y <= box.yMax(); ++y) {
-      for (int16_t x = box.xMin(); x <= box.xMax(); ++x) {
-        Color c = GetSmoothTrianglePixelColor(triangle, x, y);
-        color[cnt++] = c.a() == 0      ? spec.bgcolor
-                       : c == interior ? spec.pre_blended_interior
-                                       : AlphaBlend(spec.bgcolor, c);
-      }
-    }
-    spec.out->setAddress(box, spec.blending_mode);
-    spec.out->write(color, cnt);
-  }
-}
-
-void DrawTriangle(SmoothShape::Triangle triangle, const Surface& s,
-                  const Box& box) {
-  TriangleDrawSpec spec{
-      .out = &s.out(),
-      .fill_mode = s.fill_mode(),
-      .blending_mode = s.blending_mode(),
-      .bgcolor = s.bgcolor(),
-      .pre_blended_interior = AlphaBlend(s.bgcolor(), triangle.color),
-  };
-  if (s.dx() != 0 || s.dy() != 0) {
-    triangle.x1 += s.dx();
-    triangle.y1 += s.dx();
-    triangle.x2 += s.dx();
-    triangle.y2 += s.dx();
-    triangle.x3 += s.dx();
-    triangle.y3 += s.dx();
-  }
-  int16_t xMin = box.xMin();
-  int16_t xMax = box.xMax();
-  int16_t yMin = box.yMin();
-  int16_t yMax = box.yMax();
-  {
-    uint32_t pixel_count = box.area();
-    if (pixel_count <= 64) {
-      FillSubrectOfTriangle(triangle, spec, box);
-      return;
-    }
-  }
-  const int16_t xMinOuter = (xMin / 8) * 8;
-  const int16_t yMinOuter = (yMin / 8) * 8;
-  const int16_t xMaxOuter = (xMax / 8) * 8 + 7;
-  const int16_t yMaxOuter = (yMax / 8) * 8 + 7;
-  for (int16_t y = yMinOuter; y < yMaxOuter; y += 8) {
-    for (int16_t x = xMinOuter; x < xMaxOuter; x += 8) {
-      FillSubrectOfTriangle(
-          triangle, spec,
-          Box(std::max(x, box.xMin()), std::max(y, box.yMin()),
-              std::min((int16_t)(x + 7), box.xMax()),
-              std::min((int16_t)(y + 7), box.yMax())));
-    }
-  }
-}
-
 bool ReadColorRectOfTriangle(const SmoothShape::Triangle& triangle,
                              int16_t xMin, int16_t yMin, int16_t xMax,
                              int16_t yMax, Color* result) {
@@ -1542,10 +2050,11 @@ bool ReadColorRectOfTriangle(const SmoothShape::Triangle& triangle,
     default:
       break;
   }
+  TriangleEvaluator eval(triangle);
   Color* out = result;
   for (int16_t y = yMin; y <= yMax; ++y) {
     for (int16_t x = xMin; x <= xMax; ++x) {
-      *out++ = GetSmoothTrianglePixelColor(triangle, x, y);
+      *out++ = eval.colorAt(x, y);
     }
   }
   // // // This is now very unlikely to be true, or we would have caught it
@@ -1559,9 +2068,51 @@ bool ReadColorRectOfTriangle(const SmoothShape::Triangle& triangle,
 
 void ReadTriangleColors(const SmoothShape::Triangle& triangle, const int16_t* x,
                         const int16_t* y, uint32_t count, Color* result) {
+  TriangleEvaluator eval(triangle);
   while (count-- > 0) {
-    *result++ = GetSmoothTrianglePixelColor(triangle, *x++, *y++);
+    *result++ = eval.colorAt(*x++, *y++);
+  }
+}
+
+// The triangle is anti-aliased within the distance of 0.5 from its edges.
+class TriangleShape {
+ public:
+  explicit TriangleShape(const SmoothShape::Triangle& t) : t_(t), eval_(t) {}
+
+  void getBands(int16_t y, RowBands& bands) const {
+    const float e = kBandHalfWidth;
+    // The (signed) distances from the edges, as linear functions of x.
+    float a[] = {t_.dy12, t_.dy23, t_.dy31};
+    float b[] = {-t_.dy12 * t_.x1 - t_.dx12 * (y - t_.y1),
+                 -t_.dy23 * t_.x2 - t_.dx23 * (y - t_.y2),
+                 -t_.dy31 * t_.x3 - t_.dx31 * (y - t_.y3)};
+    for (int i = 0; i < 3; ++i) bands.clipLinear(a[i], b[i], e);
+    for (int i = 0; i < 3; ++i) bands.addLinear(a[i], b[i], -e, e);
+  }
+
+  Color getColor(int16_t x, int16_t y) const { return eval_.colorAt(x, y); }
+
+ private:
+  const SmoothShape::Triangle& t_;
+  TriangleEvaluator eval_;
+};
+
+void DrawTriangle(SmoothShape::Triangle triangle, const Surface& s,
+                  const Box& box) {
+  if (s.dx() != 0 || s.dy() != 0) {
+    triangle.x1 += s.dx();
+    triangle.y1 += s.dy();
+    triangle.x2 += s.dx();
+    triangle.y2 += s.dy();
+    triangle.x3 += s.dx();
+    triangle.y3 += s.dy();
   }
+  DrawShapeRows(TriangleShape(triangle), s, box);
+}
+
+void ReadTriangleRow(const SmoothShape::Triangle& triangle, int16_t y,
+                     int16_t x0, int16_t x1, Color* result) {
+  ReadShapeRow(TriangleShape(triangle), y, x0, x1, result);
 }
 
 }  // namespace
@@ -1622,6 +2173,32 @@ void SmoothShape::readColors(const int16_t* x, const int16_t* y, uint32_t count,
   }
 }
 
+void SmoothShape::readColorRow(int16_t y, int16_t x0, int16_t x1,
+                               Color* result) const {
+  switch (kind_) {
+    case WEDGE: {
+      ReadWedgeRow(wedge_, y, x0, x1, result);
+      break;
+    }
+    case ROUND_RECT: {
+      ReadRoundRectRow(round_rect_, y, x0, x1, result);
+      break;
+    }
+    case ARC: {
+      ReadArcRow(arc_, y, x0, x1, result);
+      break;
+    }
+    case TRIANGLE: {
+      ReadTriangleRow(triangle_, y, x0, x1, result);
+      break;
+    }
+    case EMPTY: {
+      FillColor(result, x1 - x0 + 1, color::Transparent);
+      break;
+    }
+  }
+}
+
 bool SmoothShape::readColorRect(int16_t xMin, int16_t yMin, int16_t xMax,
                                 int16_t yMax, Color* result) const {
   switch (kind_) {
@@ -1647,4 +2224,39 @@ bool SmoothShape::readColorRect(int16_t xMin, int16_t yMin, int16_t xMax,
   return true;
 }
 
+namespace internal {
+
+void ReadSmoothShapeColorsFixedPoint(const SmoothShape& shape,
+                                     const int16_t* x, const int16_t* y,
+                                     uint32_t count, Color* result) {
+  switch (shape.kind_) {
+    case SmoothShape::WEDGE: {
+      FixedWedgeEvaluator eval(shape.wedge_);
+      while (count-- > 0) *result++ = eval.colorAt(*x++, *y++);
+      break;
+    }
+    case SmoothShape::ROUND_RECT: {
+      FixedRoundRectEvaluator eval(shape.round_rect_);
+      while (count-- > 0) *result++ = eval.colorAt(*x++, *y++);
+      break;
+    }
+    case SmoothShape::ARC: {
+      FixedArcEvaluator eval(shape.arc_);
+      while (count-- > 0) *result++ = eval.colorAt(*x++, *y++);
+      break;
+    }
+    case SmoothShape::TRIANGLE: {
+      FixedTriangleEvaluator eval(shape.triangle_);
+      while (count-- > 0) *result++ = eval.colorAt(*x++, *y++);
+      break;
+    }
+    case SmoothShape::EMPTY: {
+      FillColor(result, count, color::Transparent);
+      break;
+    }
+  }
+}
+
+}  // namespace internal
+
 }  // namespace roo_display
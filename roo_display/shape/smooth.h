@@ -96,6 +96,18 @@ SmoothShape SmoothFilledTriangle(FpPoint a, FpPoint b, FpPoint c, Color color);
 
 // Implementation details follow.
 
+class SmoothShape;
+
+namespace internal {
+
+// Reads the colors of the shape using the fixed-point evaluation, regardless of
+// ROO_DISPLAY_SMOOTH_FIXED_POINT. Used in tests.
+void ReadSmoothShapeColorsFixedPoint(const SmoothShape& shape,
+                                     const int16_t* x, const int16_t* y,
+                                     uint32_t count, Color* result);
+
+}  // namespace internal
+
 class SmoothShape : public Rasterizable {
  public:
   struct Wedge {
@@ -190,6 +202,9 @@ class SmoothShape : public Rasterizable {
   void readColors(const int16_t* x, const int16_t* y, uint32_t count,
                   Color* result) const override;
 
+  void readColorRow(int16_t y, int16_t x0, int16_t x1,
+                    Color* result) const override;
+
   bool readColorRect(int16_t xMin, int16_t yMin, int16_t xMax, int16_t yMax,
                      Color* result) const override;
 
@@ -215,6 +230,10 @@ class SmoothShape : public Rasterizable {
   friend SmoothShape SmoothFilledTriangle(FpPoint a, FpPoint b, FpPoint c,
                                           Color color);
 
+  friend void internal::ReadSmoothShapeColorsFixedPoint(
+      const SmoothShape& shape, const int16_t* x, const int16_t* y,
+      uint32_t count, Color* result);
+
   void drawTo(const Surface& s) const override;
 
   enum Kind { EMPTY = 0, WEDGE = 1, ROUND_RECT = 2, ARC = 3, TRIANGLE = 4 };
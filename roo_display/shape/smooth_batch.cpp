@@ -0,0 +1,277 @@
+#include "roo_display/shape/smooth_batch.h"
+
+#include <assert.h>
+
+#include <algorithm>
+
+#include <memory>
+
+#include "roo_display/color/blending.h"
+#include "roo_display/internal/row_writer.h"
+
+namespace roo_display {
+
+namespace {
+
+// Cells are at least 32x32 pixels; they grow (in powers of two) for batches
+// with large extents, so that the grid has at most kMaxGridSize rows and
+// columns.
+static const int16_t kMinCellShift = 5;
+static const int32_t kMaxGridSize = 32;
+
+// Number of pixels that are read from a single shape at once.
+static const int kMaxBufSize = 64;
+
+}  // namespace
+
+SmoothShapeBatch::SmoothShapeBatch()
+    : extents_(0, 0, -1, -1),
+      built_(true),
+      cell_shift_(kMinCellShift),
+      grid_x_(0),
+      grid_y_(0),
+      columns_(0),
+      rows_(0) {}
+
+void SmoothShapeBatch::add(const SmoothShape& shape) {
+  // The cells store shape indexes as uint16_t.
+  assert(shapes_.size() < 65535);
+  shapes_.push_back(shape);
+  const Box& e = shape.extents();
+  if (!e.empty()) {
+    extents_ = extents_.empty() ? e : Box::Extent(extents_, e);
+  }
+  built_ = false;
+}
+
+void SmoothShapeBatch::clear() {
+  shapes_.clear();
+  extents_ = Box(0, 0, -1, -1);
+  build();
+}
+
+void SmoothShapeBatch::build() {
+  built_ = true;
+  cell_shapes_.clear();
+  row_shapes_.clear();
+  if (extents_.empty()) {
+    columns_ = 0;
+    rows_ = 0;
+    cell_begin_.assign(1, 0);
+    row_begin_.assign(1, 0);
+    return;
+  }
+  // Arithmetic shifts round down, also for negative coordinates.
+  cell_shift_ = kMinCellShift;
+  while ((((int32_t)extents_.xMax() >> cell_shift_) -
+          ((int32_t)extents_.xMin() >> cell_shift_)) >= kMaxGridSize ||
+         (((int32_t)extents_.yMax() >> cell_shift_) -
+          ((int32_t)extents_.yMin() >> cell_shift_)) >= kMaxGridSize) {
+    ++cell_shift_;
+  }
+  grid_x_ = ((int32_t)extents_.xMin() >> cell_shift_) << cell_shift_;
+  grid_y_ = ((int32_t)extents_.yMin() >> cell_shift_) << cell_shift_;
+  columns_ = cellColumn(extents_.xMax()) + 1;
+  rows_ = cellRow(extents_.yMax()) + 1;
+
+  // Count the shapes in each cell, then place them at the offsets given by the
+  // prefix sums of the counts.
+  cell_begin_.assign(rows_ * columns_ + 1, 0);
+  row_begin_.assign(rows_ + 1, 0);
+  for (const SmoothShape& shape : shapes_) {
+    const Box& e = shape.extents();
+    if (e.empty()) continue;
+    for (int16_t row = cellRow(e.yMin()); row <= cellRow(e.yMax()); ++row) {
+      ++row_begin_[row + 1];
+      for (int16_t col = cellColumn(e.xMin()); col <= cellColumn(e.xMax());
+           ++col) {
+        ++cell_begin_[row * columns_ + col + 1];
+      }
+    }
+  }
+  for (size_t i = 1; i < cell_begin_.size(); ++i) {
+    cell_begin_[i] += cell_begin_[i - 1];
+  }
+  for (size_t i = 1; i < row_begin_.size(); ++i) {
+    row_begin_[i] += row_begin_[i - 1];
+  }
+  cell_shapes_.resize(cell_begin_.back());
+  row_shapes_.resize(row_begin_.back());
+  std::vector<uint32_t> next_cell(cell_begin_.begin(), cell_begin_.end() - 1);
+  std::vector<uint32_t> next_row(row_begin_.begin(), row_begin_.end() - 1);
+  for (uint16_t i = 0; i < shapes_.size(); ++i) {
+    const Box& e = shapes_[i].extents();
+    if (e.empty()) continue;
+    for (int16_t row = cellRow(e.yMin()); row <= cellRow(e.yMax()); ++row) {
+      row_shapes_[next_row[row]++] = i;
+      for (int16_t col = cellColumn(e.xMin()); col <= cellColumn(e.xMax());
+           ++col) {
+        cell_shapes_[next_cell[row * columns_ + col]++] = i;
+      }
+    }
+  }
+}
+
+void SmoothShapeBatch::readColors(const int16_t* x, const int16_t* y,
+                                  uint32_t count, Color* result) const {
+  assert(built_);
+  for (uint32_t i = 0; i < count; ++i) {
+    int16_t row = cellRow(y[i]);
+    int16_t col = cellColumn(x[i]);
+    Color c = color::Transparent;
+    for (const uint16_t* p = cellBegin(row, col); p != cellEnd(row, col);
+         ++p) {
+      const SmoothShape& shape = shapes_[*p];
+      if (!shape.extents().contains(x[i], y[i])) continue;
+      Color shape_color;
+      shape.readColors(&x[i], &y[i], 1, &shape_color);
+      c = AlphaBlend(c, shape_color);
+    }
+    result[i] = c;
+  }
+}
+
+void SmoothShapeBatch::readColorRow(int16_t y, int16_t x0, int16_t x1,
+                                    Color* result) const {
+  assert(built_);
+  int16_t row = cellRow(y);
+  Color buffer[kMaxBufSize];
+  FillColor(result, x1 - x0 + 1, color::Transparent);
+  // The range of pixels that the shapes read so far have covered. Outside of
+  // it, the result is transparent, so the shapes can be read directly into it.
+  int16_t covered_min = x1 + 1;
+  int16_t covered_max = x0 - 1;
+  for (const uint16_t* p = rowBegin(row); p != rowEnd(row); ++p) {
+    const SmoothShape& shape = shapes_[*p];
+    const Box& e = shape.extents();
+    if (y < e.yMin() || y > e.yMax()) continue;
+    int16_t xMin = std::max(x0, e.xMin());
+    int16_t xMax = std::min(x1, e.xMax());
+    if (xMin > xMax) continue;
+    if (xMax < covered_min || xMin > covered_max) {
+      Color* out = &result[xMin - x0];
+      shape.readColorRow(y, xMin, xMax, out);
+      // Same as blending over transparent.
+      for (int16_t i = 0; i <= xMax - xMin; ++i) {
+        if (out[i].a() == 0) out[i] = color::Transparent;
+      }
+      covered_min = std::min(covered_min, xMin);
+      covered_max = std::max(covered_max, xMax);
+      continue;
+    }
+    covered_min = std::min(covered_min, xMin);
+    covered_max = std::max(covered_max, xMax);
+    while (xMin <= xMax) {
+      int16_t xEnd = xMax;
+      if (xEnd - xMin >= kMaxBufSize) xEnd = xMin + kMaxBufSize - 1;
+      shape.readColorRow(y, xMin, xEnd, buffer);
+      ApplyBlendingInPlace(BLENDING_MODE_SOURCE_OVER, &result[xMin - x0],
+                           buffer, xEnd - xMin + 1);
+      xMin = xEnd + 1;
+    }
+  }
+}
+
+bool SmoothShapeBatch::readColorRect(int16_t xMin, int16_t yMin, int16_t xMax,
+                                     int16_t yMax, Color* result) const {
+  assert(built_);
+  int16_t row = cellRow(yMin);
+  int16_t col = cellColumn(xMin);
+  if (row != cellRow(yMax) || col != cellColumn(xMax)) {
+    // Spans multiple cells; read row by row.
+    return Rasterizable::readColorRect(xMin, yMin, xMax, yMax, result);
+  }
+  return readCellRect(cellBegin(row, col), cellEnd(row, col),
+                      Box(xMin, yMin, xMax, yMax), result);
+}
+
+bool SmoothShapeBatch::readCellRect(const uint16_t* begin, const uint16_t* end,
+                                    const Box& box, Color* result) const {
+  // Follows RasterizableStack::readColorRect: as long as all the shapes so far
+  // have been uniform over the entire rectangle, only result[0] is maintained.
+  bool is_uniform_color = true;
+  *result = color::Transparent;
+  int32_t pixel_count = box.area();
+  Color buffer[kMaxBufSize];
+  for (const uint16_t* p = begin; p != end; ++p) {
+    const SmoothShape& shape = shapes_[*p];
+    Box clipped = Box::Intersect(shape.extents(), box);
+    if (clipped.empty()) continue;
+    if (clipped.area() <= kMaxBufSize &&
+        shape.readColorRect(clipped.xMin(), clipped.yMin(), clipped.xMax(),
+                            clipped.yMax(), buffer)) {
+      Color c = buffer[0];
+      if (c.a() == 0) continue;
+      if (clipped.contains(box) && (is_uniform_color || c.a() == 0xFF)) {
+        // Either everything so far is uniform, or the shape is opaque, hiding
+        // everything below it.
+        *result = is_uniform_color ? AlphaBlend(*result, c) : c;
+        is_uniform_color = true;
+        continue;
+      }
+      if (is_uniform_color) {
+        is_uniform_color = false;
+        FillColor(&result[1], pixel_count - 1, *result);
+      }
+      for (int16_t y = clipped.yMin(); y <= clipped.yMax(); ++y) {
+        Color* row = &result[(y - box.yMin()) * box.width()];
+        ApplyBlendingSingleSourceInPlace(BLENDING_MODE_SOURCE_OVER,
+                                         &row[clipped.xMin() - box.xMin()], c,
+                                         clipped.width());
+      }
+      continue;
+    }
+    if (is_uniform_color) {
+      is_uniform_color = false;
+      FillColor(&result[1], pixel_count - 1, *result);
+    }
+    if (clipped.area() <= kMaxBufSize) {
+      // Already read into the buffer.
+      const Color* src = buffer;
+      for (int16_t y = clipped.yMin(); y <= clipped.yMax(); ++y) {
+        Color* row = &result[(y - box.yMin()) * box.width()];
+        ApplyBlendingInPlace(BLENDING_MODE_SOURCE_OVER,
+                             &row[clipped.xMin() - box.xMin()], src,
+                             clipped.width());
+        src += clipped.width();
+      }
+    } else {
+      // Too large for the buffer; read row by row, in chunks.
+      for (int16_t y = clipped.yMin(); y <= clipped.yMax(); ++y) {
+        Color* row = &result[(y - box.yMin()) * box.width()];
+        int16_t x = clipped.xMin();
+        while (x <= clipped.xMax()) {
+          int16_t xEnd = clipped.xMax();
+          if (xEnd - x >= kMaxBufSize) xEnd = x + kMaxBufSize - 1;
+          shape.readColorRow(y, x, xEnd, buffer);
+          ApplyBlendingInPlace(BLENDING_MODE_SOURCE_OVER,
+                               &row[x - box.xMin()], buffer, xEnd - x + 1);
+          x = xEnd + 1;
+        }
+      }
+    }
+  }
+  if (!is_uniform_color) {
+    // See if maybe it actually is.
+    for (int32_t i = 1; i < pixel_count; ++i) {
+      if (result[i] != result[0]) return false;
+    }
+  }
+  return true;
+}
+
+void SmoothShapeBatch::drawTo(const Surface& s) const {
+  assert(built_);
+  Box box = Box::Intersect(extents_.translate(s.dx(), s.dy()), s.clip_box());
+  if (box.empty()) return;
+  int n = box.width();
+  std::unique_ptr<Color[]> colors(new Color[n]);
+  internal::RowWriter writer(s);
+  for (int16_t y = box.yMin(); y <= box.yMax(); ++y) {
+    readColorRow(y - s.dy(), box.xMin() - s.dx(), box.xMax() - s.dx(),
+                 colors.get());
+    writer.write(box.xMin(), y, colors.get(), n);
+  }
+}
+
+}  // namespace roo_display
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <vector>
+
+#include "roo_display/color/color.h"
+#include "roo_display/core/box.h"
+#include "roo_display/core/rasterizable.h"
+#include "roo_display/shape/smooth.h"
+
+namespace roo_display {
+
+// Collection of smooth shapes, drawn together as a single rasterizable, with
+// the shapes composited (alpha-blended) in the order in which they have been
+// added.
+//
+// Compared to drawing the shapes one by one, each pixel is written once, even
+// where the shapes overlap. This avoids re-writing (and flickering of) the
+// overlapping regions, which pays off on displays where the transfer to the
+// device dominates the cost of drawing, for scenes made of many overlapping
+// shapes, such as the face, the tick marks, the arcs, and the needle of a
+// gauge. (Computing the composited colors costs more than drawing the shapes
+// directly, so for a few disjoint shapes, drawing them one by one is faster.)
+//
+// To quickly find the shapes that contribute to a given area, the extents of
+// the batch are divided into a coarse grid of cells, and each shape is
+// registered in the cells (and the rows of cells) that its extents overlap.
+// The cell size depends on the extents of the whole batch, so the grid is
+// laid out by build(), after all the shapes have been added, and before the
+// batch is drawn.
+//
+// The batch is drawn row by row: the rows of the contributing shapes are
+// composited, and the runs of the same color are filled, rather than written
+// pixel-by-pixel.
+//
+// Example:
+//
+//   SmoothShapeBatch gauge;
+//   gauge.add(SmoothThickArc(center, 100, 10, -2.5f, 2.5f, color::Gray));
+//   for (int i = 0; i <= 50; ++i) {
+//     gauge.add(SmoothThickLine(tick_start[i], tick_end[i], 2, color::Black));
+//   }
+//   gauge.add(SmoothWedgedLine(center, 8, needle_end, 0, color::Red));
+//   gauge.build();
+//   dc.draw(gauge);
+class SmoothShapeBatch : public Rasterizable {
+ public:
+  // Creates an empty batch.
+  SmoothShapeBatch();
+
+  // Adds the shape on top of the previously added ones.
+  void add(const SmoothShape& shape);
+
+  // Removes all shapes.
+  void clear();
+
+  // Bins the shapes into the grid. Must be called after adding the shapes,
+  // before the batch is drawn or read.
+  void build();
+
+  // Returns the number of shapes in the batch.
+  uint32_t size() const { return shapes_.size(); }
+
+  // Returns the union of the extents of the shapes.
+  Box extents() const override { return extents_; }
+
+  void readColors(const int16_t* x, const int16_t* y, uint32_t count,
+                  Color* result) const override;
+
+  void readColorRow(int16_t y, int16_t x0, int16_t x1,
+                    Color* result) const override;
+
+  bool readColorRect(int16_t xMin, int16_t yMin, int16_t xMax, int16_t yMax,
+                     Color* result) const override;
+
+ private:
+  void drawTo(const Surface& s) const override;
+
+  // Returns the column of the grid cell containing the specified x coordinate,
+  // which must be within the extents.
+  int16_t cellColumn(int16_t x) const {
+    return ((int32_t)x - grid_x_) >> cell_shift_;
+  }
+
+  // Returns the row of the grid cell containing the specified y coordinate,
+  // which must be within the extents.
+  int16_t cellRow(int16_t y) const {
+    return ((int32_t)y - grid_y_) >> cell_shift_;
+  }
+
+  // Returns the range of the shapes overlapping the specified row of cells.
+  const uint16_t* rowBegin(int16_t row) const {
+    return row_shapes_.data() + row_begin_[row];
+  }
+
+  const uint16_t* rowEnd(int16_t row) const {
+    return row_shapes_.data() + row_begin_[row + 1];
+  }
+
+  // Returns the range of the shapes overlapping the specified cell.
+  const uint16_t* cellBegin(int16_t row, int16_t column) const {
+    return cell_shapes_.data() + cell_begin_[row * columns_ + column];
+  }
+
+  const uint16_t* cellEnd(int16_t row, int16_t column) const {
+    return cell_shapes_.data() + cell_begin_[row * columns_ + column + 1];
+  }
+
+  // Composites the colors of the shapes in [begin, end) over the rectangle,
+  // which must be within a single cell.
+  bool readCellRect(const uint16_t* begin, const uint16_t* end,
+                    const Box& box, Color* result) const;
+
+  std::vector<SmoothShape> shapes_;
+
+  // Union of the extents of the shapes.
+  Box extents_;
+
+  // Whether the grid below is up to date with the shapes.
+  bool built_;
+  // Cells are squares with the side of (1 << cell_shift_) pixels, aligned to
+  // multiples of that size, so that the (also aligned) tiles in which the
+  // batch is drawn don't straddle them. (grid_x_, grid_y_) is the top-left
+  // corner of the first cell.
+  int16_t cell_shift_;
+  int32_t grid_x_;
+  int32_t grid_y_;
+  int16_t columns_;
+  int16_t rows_;
+  // For each cell (row by row), the offset of its shapes in cell_shapes_; with
+  // the total count appended at the end.
+  std::vector<uint32_t> cell_begin_;
+  // Indexes of the shapes, grouped by cells, in the order they were added.
+  std::vector<uint16_t> cell_shapes_;
+  // Same as above, for the rows of cells.
+  std::vector<uint32_t> row_begin_;
+  std::vector<uint16_t> row_shapes_;
+};
+
+}  // namespace roo_display
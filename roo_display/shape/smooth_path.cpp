@@ -0,0 +1,594 @@
+#include "roo_display/shape/smooth_path.h"
+
+#include <assert.h>
+#include <math.h>
+
+#include <algorithm>
+#include <memory>
+
+#include "roo_display/internal/row_writer.h"
+
+namespace roo_display {
+
+using internal::PathEdge;
+
+namespace {
+
+// Maximum distance between a curve and the line segments approximating it.
+static constexpr float kTolerance = 0.05f;
+
+static constexpr int kMaxCurveSegments = 256;
+
+// Miter joins longer than this (relative to the stroke width) are beveled.
+// Same as the SVG default.
+static constexpr float kMiterLimit = 4.0f;
+
+// Maximum number of pixels that are read at once. Bounds the stack usage of
+// the read methods.
+static constexpr int kRowChunkSize = 64;
+
+static constexpr float kTwoPi = 2 * M_PI;
+
+inline bool operator==(FpPoint a, FpPoint b) {
+  return a.x == b.x && a.y == b.y;
+}
+
+inline bool operator!=(FpPoint a, FpPoint b) { return !(a == b); }
+
+// Returns the unit vector pointing from a to b.
+inline FpPoint Direction(FpPoint a, FpPoint b) {
+  float dx = b.x - a.x;
+  float dy = b.y - a.y;
+  float len = sqrtf(dx * dx + dy * dy);
+  return FpPoint{dx / len, dy / len};
+}
+
+// Returns the number of line segments needed to approximate a Bezier curve of
+// the specified degree, whose control points have the second differences no
+// longer than m (Wang's formula).
+int CurveSegments(int degree, float m) {
+  float n = ceilf(sqrtf(degree * (degree - 1) * m / (8 * kTolerance)));
+  if (!(n >= 1)) return 1;
+  if (n > kMaxCurveSegments) return kMaxCurveSegments;
+  return (int)n;
+}
+
+inline float Length(float dx, float dy) { return sqrtf(dx * dx + dy * dy); }
+
+void AddEdge(FpPoint a, FpPoint b, float dir, std::vector<PathEdge>& edges) {
+  if (!(a.y != b.y)) return;
+  if (a.y > b.y) {
+    std::swap(a, b);
+    dir = -dir;
+  }
+  // Shifted by half a pixel, so that pixel (x, y) spans from (x, y) to
+  // (x + 1, y + 1).
+  edges.push_back(PathEdge{a.x + 0.5f, a.y + 0.5f, b.x + 0.5f, b.y + 0.5f,
+                           (b.x - a.x) / (b.y - a.y), dir});
+}
+
+// Adds the edges of the closed polygon. If positive is true, orients them so
+// that the interior of the polygon has a positive winding number (regardless
+// of the order of the vertices).
+void AddPolygon(const FpPoint* p, uint32_t n, bool positive,
+                std::vector<PathEdge>& edges) {
+  float dir = 1.0f;
+  if (positive) {
+    float area = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+      const FpPoint& a = p[i];
+      const FpPoint& b = p[(i + 1) % n];
+      area += a.x * b.y - b.x * a.y;
+    }
+    if (area < 0) dir = -1.0f;
+  }
+  for (uint32_t i = 0; i < n; ++i) {
+    AddEdge(p[i], p[(i + 1) % n], dir, edges);
+  }
+}
+
+// Converts strokes into polygons covering them: a rectangle for each segment,
+// and additional polygons for the joins and the endings. Joins at the smooth
+// points (within curves) are always rounded, which makes the stroke follow
+// the offset of the curve. All the polygons are
+// oriented the same way, so that they can be filled together with the
+// non-zero rule.
+class Stroker {
+ public:
+  Stroker(float width, JoinStyle join, EndingStyle ending,
+          std::vector<PathEdge>& edges)
+      : hw_(width / 2), join_(join), ending_(ending), edges_(edges) {
+    // The angle per segment of the approximated circles.
+    step_ = hw_ > kTolerance ? 2 * acosf(1 - kTolerance / hw_) : M_PI / 2;
+  }
+
+  void addSubpath(const FpPoint* p, const std::vector<bool>::const_iterator
+                                       smooth,
+                  uint32_t n, bool closed) {
+    pts_.clear();
+    smooth_.clear();
+    for (uint32_t i = 0; i < n; ++i) {
+      if (pts_.empty() || p[i] != pts_.back()) {
+        pts_.push_back(p[i]);
+        smooth_.push_back(smooth[i]);
+      }
+    }
+    if (closed && pts_.size() > 1 && pts_.front() == pts_.back()) {
+      pts_.pop_back();
+      smooth_.pop_back();
+    }
+    uint32_t m = pts_.size();
+    if (m == 1) {
+      // Zero-length subpath.
+      if (ending_ == ENDING_ROUNDED) addPie(pts_[0], 0, kTwoPi);
+      return;
+    }
+    uint32_t segments = closed ? m : m - 1;
+    for (uint32_t i = 0; i < segments; ++i) {
+      addSegment(pts_[i], pts_[(i + 1) % m]);
+    }
+    if (closed) {
+      for (uint32_t i = 0; i < m; ++i) {
+        addJoin(pts_[(i + m - 1) % m], pts_[i], pts_[(i + 1) % m],
+                smooth_[i] ? JOIN_ROUNDED : join_);
+      }
+      return;
+    }
+    for (uint32_t i = 1; i + 1 < m; ++i) {
+      addJoin(pts_[i - 1], pts_[i], pts_[i + 1],
+              smooth_[i] ? JOIN_ROUNDED : join_);
+    }
+    if (ending_ == ENDING_ROUNDED) {
+      // Half-circles, from the left side of the line, around the ending, to
+      // the right side.
+      FpPoint u = Direction(pts_[0], pts_[1]);
+      addPie(pts_[0], atan2f(u.x, -u.y), M_PI);
+      u = Direction(pts_[m - 2], pts_[m - 1]);
+      addPie(pts_[m - 1], atan2f(u.x, -u.y), -M_PI);
+    }
+  }
+
+ private:
+  void addSegment(FpPoint a, FpPoint b) {
+    FpPoint u = Direction(a, b);
+    float nx = -u.y * hw_;
+    float ny = u.x * hw_;
+    FpPoint quad[] = {{a.x + nx, a.y + ny},
+                      {b.x + nx, b.y + ny},
+                      {b.x - nx, b.y - ny},
+                      {a.x - nx, a.y - ny}};
+    AddPolygon(quad, 4, true, edges_);
+  }
+
+  // Adds the join at b, between the segments a-b and b-c. The segment
+  // rectangles already cover the inner side of the corner; the join fills the
+  // gap on the outer side.
+  void addJoin(FpPoint a, FpPoint b, FpPoint c, JoinStyle join) {
+    FpPoint u0 = Direction(a, b);
+    FpPoint u1 = Direction(b, c);
+    float cross = u0.x * u1.y - u0.y * u1.x;
+    float dot = u0.x * u1.x + u0.y * u1.y;
+    if (fabsf(cross) < 1e-6f && dot > 0) return;
+    // The outer side is the one opposite to the turn.
+    float side = cross > 0 ? -hw_ : hw_;
+    FpPoint n0{-u0.y * side, u0.x * side};
+    FpPoint n1{-u1.y * side, u1.x * side};
+    if (join == JOIN_ROUNDED) {
+      float turn = fabsf(atan2f(cross, dot));
+      addPie(b, atan2f(n0.y, n0.x), cross > 0 ? turn : -turn);
+      return;
+    }
+    // Cosine of half of the turn angle.
+    float cos_half = sqrtf((1 + dot) / 2);
+    if (join == JOIN_MITER && cos_half * kMiterLimit > 1) {
+      float k = 1 / (2 * cos_half * cos_half);
+      FpPoint miter[] = {b,
+                         {b.x + n0.x, b.y + n0.y},
+                         {b.x + (n0.x + n1.x) * k, b.y + (n0.y + n1.y) * k},
+                         {b.x + n1.x, b.y + n1.y}};
+      AddPolygon(miter, 4, true, edges_);
+      return;
+    }
+    FpPoint bevel[] = {b, {b.x + n0.x, b.y + n0.y}, {b.x + n1.x, b.y + n1.y}};
+    AddPolygon(bevel, 3, true, edges_);
+  }
+
+  // Adds the circular sector centered at c, starting at the specified angle,
+  // and spanning the specified (signed) angle. Sweep of 2 * pi adds the full
+  // circle.
+  void addPie(FpPoint c, float start, float sweep) {
+    bool full = fabsf(sweep) >= kTwoPi;
+    int n = (int)ceilf(fabsf(sweep) / step_);
+    if (n < 1) n = 1;
+    poly_.clear();
+    if (!full) poly_.push_back(c);
+    for (int i = 0; i <= n; ++i) {
+      if (full && i == n) break;
+      float angle = start + sweep * i / n;
+      poly_.push_back(
+          FpPoint{c.x + hw_ * cosf(angle), c.y + hw_ * sinf(angle)});
+    }
+    AddPolygon(&poly_[0], poly_.size(), true, edges_);
+  }
+
+  float hw_;
+  JoinStyle join_;
+  EndingStyle ending_;
+  float step_;
+  std::vector<PathEdge>& edges_;
+  std::vector<FpPoint> pts_;
+  std::vector<bool> smooth_;
+  std::vector<FpPoint> poly_;
+};
+
+// Adds the contribution of a line segment within a single row to the coverage
+// differences acc[0..n] of the n subsequent pixels starting at the position 0
+// (so that the coverage of the pixel i is the sum of acc[0..i]). The segment
+// goes from xa to xb, spanning the height d (negative if it goes up). Parts of
+// the segment to the left of the pixels contribute to acc[0]; parts to the
+// right are ignored.
+void AccumulateSegment(float xa, float xb, float d, int n, float* acc) {
+  if (xa > xb) std::swap(xa, xb);
+  if (xb <= 0) {
+    acc[0] += d;
+    return;
+  }
+  if (xa >= n) return;
+  float w = xb - xa;
+  if (w < 1e-6f) {
+    // Vertical (or almost).
+    if (xa < 0) xa = 0;
+    int i = (int)xa;
+    float m = xa - i;
+    acc[i] += d * (1 - m);
+    acc[i + 1] += d * m;
+    return;
+  }
+  // The height per unit of x.
+  float s = d / w;
+  if (xa < 0) {
+    acc[0] += -xa * s;
+    xa = 0;
+  }
+  if (xb > n) xb = n;
+  int i = (int)xa;
+  float x = xa;
+  while (x < xb) {
+    float xn = std::min((float)(i + 1), xb);
+    float h = (xn - x) * s;
+    // The part of the pixel to the right of the segment is covered.
+    float m = 0.5f * (x + xn) - i;
+    acc[i] += h * (1 - m);
+    acc[i + 1] += h * m;
+    x = xn;
+    ++i;
+  }
+}
+
+// Adds the contribution of the part of the edge within the row [y, y + 1) to
+// the coverage differences of the n pixels starting at x0.
+inline void AccumulateEdge(const PathEdge& e, float y, float x0, int n,
+                           float* acc) {
+  float ya, xa, yb, xb;
+  if (e.y0 > y) {
+    ya = e.y0;
+    xa = e.x0;
+  } else {
+    ya = y;
+    xa = e.x0 + (y - e.y0) * e.dxdy;
+  }
+  if (e.y1 < y + 1) {
+    yb = e.y1;
+    xb = e.x1;
+  } else {
+    yb = y + 1;
+    xb = e.x0 + (yb - e.y0) * e.dxdy;
+  }
+  AccumulateSegment(xa - x0, xb - x0, (yb - ya) * e.dir, n, acc);
+}
+
+// Adds the contributions of the (sorted) edges to the coverage differences of
+// the n pixels of the row y, starting at x0.
+void AccumulateRow(const std::vector<PathEdge>& edges, int16_t y, int16_t x0,
+                   int n, float* acc) {
+  float top = y;
+  for (const PathEdge& e : edges) {
+    if (e.y0 >= top + 1) break;
+    if (e.y1 <= top) continue;
+    AccumulateEdge(e, top, x0, n, acc);
+  }
+}
+
+// Returns true if any of the (sorted) edges passes through the interior of
+// the specified rectangle of pixels. If not, all the pixels have the same
+// coverage.
+bool CrossesRect(const std::vector<PathEdge>& edges, int16_t xMin,
+                 int16_t yMin, int16_t xMax, int16_t yMax) {
+  for (const PathEdge& e : edges) {
+    if (e.y0 >= yMax + 1) break;
+    if (e.y1 <= yMin) continue;
+    if (std::min(e.x0, e.x1) < xMax + 1 && std::max(e.x0, e.x1) > xMin) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Visits the rows top to bottom, maintaining the list of the (sorted) edges
+// that cross the current row.
+class EdgeSweep {
+ public:
+  EdgeSweep(const std::vector<PathEdge>& edges) : edges_(edges), next_(0) {}
+
+  // Moves to the row y, which must be below the previous one.
+  void advance(int16_t y) {
+    size_t j = 0;
+    for (size_t i = 0; i < active_.size(); ++i) {
+      if (active_[i]->y1 > y) active_[j++] = active_[i];
+    }
+    active_.resize(j);
+    while (next_ < edges_.size() && edges_[next_].y0 < y + 1) {
+      if (edges_[next_].y1 > y) active_.push_back(&edges_[next_]);
+      ++next_;
+    }
+    y_ = y;
+  }
+
+  void accumulate(int16_t x0, int n, float* acc) const {
+    for (const PathEdge* e : active_) AccumulateEdge(*e, y_, x0, n, acc);
+  }
+
+ private:
+  const std::vector<PathEdge>& edges_;
+  size_t next_;
+  int16_t y_;
+  std::vector<const PathEdge*> active_;
+};
+
+inline float NonZeroCoverage(float winding) {
+  return std::min(fabsf(winding), 1.0f);
+}
+
+inline float EvenOddCoverage(float winding) {
+  float w = fmodf(fabsf(winding), 2.0f);
+  return w > 1.0f ? 2.0f - w : w;
+}
+
+inline Color WithCoverage(Color color, float coverage) {
+  return color.withA((uint8_t)(color.a() * coverage + 0.5f));
+}
+
+}  // namespace
+
+SmoothPath::SmoothPath()
+    : open_(false),
+      start_{0, 0},
+      has_fill_(false),
+      fill_color_(color::Transparent),
+      fill_rule_(FILL_RULE_NONZERO),
+      has_stroke_(false),
+      stroke_color_(color::Transparent),
+      stroke_width_(0),
+      join_(JOIN_ROUNDED),
+      ending_(ENDING_ROUNDED),
+      built_(true),
+      extents_(0, 0, -1, -1) {}
+
+void SmoothPath::moveTo(FpPoint p) {
+  open_ = false;
+  start_ = p;
+  addPoint(p);
+}
+
+void SmoothPath::lineTo(FpPoint p) {
+  addPoint(p);
+}
+
+void SmoothPath::quadTo(FpPoint c, FpPoint p) {
+  FpPoint p0 = open_ ? points_.back() : start_;
+  int n = CurveSegments(
+      2, Length(p0.x - 2 * c.x + p.x, p0.y - 2 * c.y + p.y));
+  for (int i = 1; i < n; ++i) {
+    float t = (float)i / n;
+    float s = 1 - t;
+    float a = s * s, b = 2 * s * t, d = t * t;
+    addPoint(FpPoint{a * p0.x + b * c.x + d * p.x,
+                     a * p0.y + b * c.y + d * p.y},
+             true);
+  }
+  addPoint(p);
+}
+
+void SmoothPath::cubicTo(FpPoint c1, FpPoint c2, FpPoint p) {
+  FpPoint p0 = open_ ? points_.back() : start_;
+  int n = CurveSegments(
+      3, std::max(Length(p0.x - 2 * c1.x + c2.x, p0.y - 2 * c1.y + c2.y),
+                  Length(c1.x - 2 * c2.x + p.x, c1.y - 2 * c2.y + p.y)));
+  for (int i = 1; i < n; ++i) {
+    float t = (float)i / n;
+    float s = 1 - t;
+    float a = s * s * s, b = 3 * s * s * t, d = 3 * s * t * t, e = t * t * t;
+    addPoint(FpPoint{a * p0.x + b * c1.x + d * c2.x + e * p.x,
+                     a * p0.y + b * c1.y + d * c2.y + e * p.y},
+             true);
+  }
+  addPoint(p);
+}
+
+void SmoothPath::close() {
+  if (!open_) return;
+  subpaths_.back().closed = true;
+  start_ = points_[subpaths_.back().begin];
+  open_ = false;
+  built_ = false;
+}
+
+void SmoothPath::setFill(Color color, FillRule rule) {
+  has_fill_ = true;
+  fill_color_ = color;
+  fill_rule_ = rule;
+  built_ = false;
+}
+
+void SmoothPath::setStroke(Color color, float width, JoinStyle join,
+                           EndingStyle ending) {
+  has_stroke_ = true;
+  stroke_color_ = color;
+  stroke_width_ = width;
+  join_ = join;
+  ending_ = ending;
+  built_ = false;
+}
+
+void SmoothPath::addPoint(FpPoint p, bool smooth) {
+  if (!open_) {
+    uint32_t begin = points_.size();
+    subpaths_.push_back(Subpath{begin, begin, false});
+    if (p != start_) {
+      points_.push_back(start_);
+      smooth_.push_back(false);
+    }
+    open_ = true;
+  }
+  points_.push_back(p);
+  smooth_.push_back(smooth);
+  subpaths_.back().end = points_.size();
+  built_ = false;
+}
+
+void SmoothPath::build() {
+  fill_edges_.clear();
+  stroke_edges_.clear();
+  if (has_fill_) {
+    for (const Subpath& subpath : subpaths_) {
+      AddPolygon(&points_[subpath.begin], subpath.end - subpath.begin, false,
+                 fill_edges_);
+    }
+  }
+  if (has_stroke_ && stroke_width_ > 0) {
+    Stroker stroker(stroke_width_, join_, ending_, stroke_edges_);
+    for (const Subpath& subpath : subpaths_) {
+      uint32_t n = subpath.end - subpath.begin;
+      // A lone moveTo() draws nothing.
+      if (n == 1 && !subpath.closed) continue;
+      stroker.addSubpath(&points_[subpath.begin],
+                         smooth_.begin() + subpath.begin, n, subpath.closed);
+    }
+  }
+  auto by_top = [](const PathEdge& a, const PathEdge& b) {
+    return a.y0 < b.y0;
+  };
+  std::sort(fill_edges_.begin(), fill_edges_.end(), by_top);
+  std::sort(stroke_edges_.begin(), stroke_edges_.end(), by_top);
+
+  float xmin = INFINITY, ymin = INFINITY, xmax = -INFINITY, ymax = -INFINITY;
+  for (const std::vector<PathEdge>* edges : {&fill_edges_, &stroke_edges_}) {
+    for (const PathEdge& e : *edges) {
+      xmin = std::min(xmin, std::min(e.x0, e.x1));
+      xmax = std::max(xmax, std::max(e.x0, e.x1));
+      ymin = std::min(ymin, e.y0);
+      ymax = std::max(ymax, e.y1);
+    }
+  }
+  if (xmin <= xmax) {
+    extents_ = Box((int16_t)floorf(xmin), (int16_t)floorf(ymin),
+                   (int16_t)ceilf(xmax) - 1, (int16_t)ceilf(ymax) - 1);
+  } else {
+    extents_ = Box(0, 0, -1, -1);
+  }
+  built_ = true;
+}
+
+void SmoothPath::toColors(const float* fill_acc, const float* stroke_acc,
+                          int16_t n, Color* result) const {
+  float fill_winding = 0;
+  float stroke_winding = 0;
+  for (int16_t i = 0; i < n; ++i) {
+    Color color = color::Transparent;
+    if (has_fill_) {
+      fill_winding += fill_acc[i];
+      color = WithCoverage(fill_color_, fill_rule_ == FILL_RULE_EVEN_ODD
+                                            ? EvenOddCoverage(fill_winding)
+                                            : NonZeroCoverage(fill_winding));
+    }
+    if (has_stroke_) {
+      stroke_winding += stroke_acc[i];
+      Color stroke =
+          WithCoverage(stroke_color_, NonZeroCoverage(stroke_winding));
+      color = has_fill_ ? AlphaBlend(color, stroke) : stroke;
+    }
+    result[i] = color;
+  }
+}
+
+Box SmoothPath::extents() const {
+  assert(built_);
+  return extents_;
+}
+
+void SmoothPath::readColors(const int16_t* x, const int16_t* y, uint32_t count,
+                            Color* result) const {
+  // Reads the runs of horizontally adjacent points as rows.
+  uint32_t i = 0;
+  while (i < count) {
+    uint32_t j = i + 1;
+    while (j < count && y[j] == y[i] && x[j] == x[j - 1] + 1) ++j;
+    readColorRow(y[i], x[i], x[j - 1], result + i);
+    i = j;
+  }
+}
+
+void SmoothPath::readColorRow(int16_t y, int16_t x0, int16_t x1,
+                              Color* result) const {
+  assert(built_);
+  float fill_acc[kRowChunkSize + 1];
+  float stroke_acc[kRowChunkSize + 1];
+  int x = x0;
+  while (x <= x1) {
+    int n = std::min(x1 - x + 1, kRowChunkSize);
+    std::fill(fill_acc, fill_acc + n + 1, 0.0f);
+    std::fill(stroke_acc, stroke_acc + n + 1, 0.0f);
+    AccumulateRow(fill_edges_, y, x, n, fill_acc);
+    AccumulateRow(stroke_edges_, y, x, n, stroke_acc);
+    toColors(fill_acc, stroke_acc, n, result);
+    x += n;
+    result += n;
+  }
+}
+
+bool SmoothPath::readColorRect(int16_t xMin, int16_t yMin, int16_t xMax,
+                               int16_t yMax, Color* result) const {
+  assert(built_);
+  if (!CrossesRect(fill_edges_, xMin, yMin, xMax, yMax) &&
+      !CrossesRect(stroke_edges_, xMin, yMin, xMax, yMax)) {
+    readColorRow(yMin, xMin, xMin, result);
+    return true;
+  }
+  return Rasterizable::readColorRect(xMin, yMin, xMax, yMax, result);
+}
+
+void SmoothPath::drawTo(const Surface& s) const {
+  assert(built_);
+  Box box = Box::Intersect(extents_.translate(s.dx(), s.dy()), s.clip_box());
+  if (box.empty()) return;
+  int n = box.width();
+  int16_t x0 = box.xMin() - s.dx();
+  std::unique_ptr<float[]> fill_acc(new float[n + 1]);
+  std::unique_ptr<float[]> stroke_acc(new float[n + 1]);
+  std::unique_ptr<Color[]> colors(new Color[n]);
+  EdgeSweep fill_sweep(fill_edges_);
+  EdgeSweep stroke_sweep(stroke_edges_);
+  internal::RowWriter writer(s);
+  for (int16_t y = box.yMin(); y <= box.yMax(); ++y) {
+    fill_sweep.advance(y - s.dy());
+    stroke_sweep.advance(y - s.dy());
+    std::fill(fill_acc.get(), fill_acc.get() + n + 1, 0.0f);
+    std::fill(stroke_acc.get(), stroke_acc.get() + n + 1, 0.0f);
+    fill_sweep.accumulate(x0, n, fill_acc.get());
+    stroke_sweep.accumulate(x0, n, stroke_acc.get());
+    toColors(fill_acc.get(), stroke_acc.get(), n, colors.get());
+    writer.write(box.xMin(), y, colors.get(), n);
+  }
+}
+
+}  // namespace roo_display
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <vector>
+
+#include "roo_display.h"
+#include "roo_display/color/color.h"
+#include "roo_display/core/rasterizable.h"
+#include "roo_display/shape/point.h"
+#include "roo_display/shape/smooth.h"
+
+namespace roo_display {
+
+// Determines which points belong to the interior of a filled path, whose
+// outline intersects itself, or which consists of overlapping subpaths.
+enum FillRule {
+  // Points that the outline winds around a non-zero number of times (counting
+  // clockwise and counter-clockwise turns with opposite signs).
+  FILL_RULE_NONZERO = 0,
+
+  // Points that the outline winds around an odd number of times.
+  FILL_RULE_EVEN_ODD = 1,
+};
+
+// The shape of the corners at which the segments of a stroked path meet.
+enum JoinStyle {
+  JOIN_ROUNDED = 0,
+
+  // Sharp corners. Miters longer than 4 times the stroke width (which happens
+  // for angles below ~29 degrees) are beveled.
+  JOIN_MITER = 1,
+
+  JOIN_BEVEL = 2,
+};
+
+namespace internal {
+
+// Non-horizontal segment of a path outline, oriented top to bottom.
+struct PathEdge {
+  float x0;
+  float y0;
+  float x1;
+  float y1;
+  float dxdy;
+  // 1 if the segment of the outline goes down; -1 if it goes up.
+  float dir;
+};
+
+}  // namespace internal
+
+// Anti-aliased path, made of any number of subpaths, each consisting of
+// straight lines and quadratic and cubic Bezier curves. The path can be
+// filled, stroked, or both (in which case the stroke is drawn over the fill).
+// Uses the same coordinate conventions as the other smooth shapes: pixel
+// (x, y) spans from (x - 0.5, y - 0.5) to (x + 0.5, y + 0.5).
+//
+// Segments added when no subpath is open (i.e., after close(), or when no
+// moveTo() has been called) start a new subpath at the current point, which is
+// the start of the last closed subpath, or (0, 0).
+//
+// Curves are flattened into line segments as they are added, with the number
+// of segments adapted to the curvature. The stroke is converted to polygons
+// covering it. The polygons are rasterized in a single top-to-bottom sweep
+// over their edges, sorted by the top coordinate, calculating the exact area
+// of each pixel that they cover.
+//
+// The polygons and their edges are built by build(), which must be called
+// after the path is constructed (or modified), before it is drawn. Drawing
+// does not modify the path, so that it can be drawn from multiple threads.
+//
+// Example:
+//
+//   SmoothPath path;
+//   path.moveTo({10, 10});
+//   path.lineTo({50, 10});
+//   path.quadTo({70, 30}, {50, 50});
+//   path.close();
+//   path.setFill(color::Navy);
+//   path.setStroke(color::Black, 2.0f, JOIN_MITER);
+//   path.build();
+//   dc.draw(path);
+class SmoothPath : public Rasterizable {
+ public:
+  // Creates an empty path, with no fill and no stroke.
+  SmoothPath();
+
+  // Starts a new subpath at the specified point.
+  void moveTo(FpPoint p);
+
+  // Adds a straight line from the current point to the specified point.
+  void lineTo(FpPoint p);
+
+  // Adds a quadratic Bezier curve from the current point to p, with the
+  // control point c.
+  void quadTo(FpPoint c, FpPoint p);
+
+  // Adds a cubic Bezier curve from the current point to p, with the control
+  // points c1 and c2.
+  void cubicTo(FpPoint c1, FpPoint c2, FpPoint p);
+
+  // Closes the current subpath with a straight line to its starting point. A
+  // subsequent segment starts a new subpath at that same point.
+  void close();
+
+  // Fills the interior of the path with the specified color. When filling,
+  // all subpaths are implicitly closed.
+  void setFill(Color color, FillRule rule = FILL_RULE_NONZERO);
+
+  // Strokes the path with a line of the specified width and color. The join
+  // style applies to the corners between the subsequent lines and curves.
+  // (Within the curves, the line segments approximating them are always joined
+  // smoothly.) The ending style applies to the ends of the subpaths that
+  // haven't been closed.
+  void setStroke(Color color, float width, JoinStyle join = JOIN_ROUNDED,
+                 EndingStyle ending = ENDING_ROUNDED);
+
+  // Strokes the path, and sorts the edges of the resulting polygons. Must be
+  // called after the modifications above, before the path is drawn or read.
+  void build();
+
+  Box extents() const override;
+
+  void readColors(const int16_t* x, const int16_t* y, uint32_t count,
+                  Color* result) const override;
+
+  void readColorRow(int16_t y, int16_t x0, int16_t x1,
+                    Color* result) const override;
+
+  bool readColorRect(int16_t xMin, int16_t yMin, int16_t xMax, int16_t yMax,
+                     Color* result) const override;
+
+ private:
+  struct Subpath {
+    uint32_t begin;
+    uint32_t end;
+    bool closed;
+  };
+
+  void drawTo(const Surface& s) const override;
+
+  // Appends a point to the current subpath, starting one if needed. Points
+  // within curves are marked as smooth.
+  void addPoint(FpPoint p, bool smooth = false);
+
+  // Converts the coverage differences (n + 1 of them) of the fill and the
+  // stroke to the colors of n subsequent pixels.
+  void toColors(const float* fill_acc, const float* stroke_acc, int16_t n,
+                Color* result) const;
+
+  std::vector<FpPoint> points_;
+  // For each point, whether it's within a curve.
+  std::vector<bool> smooth_;
+  std::vector<Subpath> subpaths_;
+  // Whether the last subpath is still being added to.
+  bool open_;
+  FpPoint start_;
+
+  bool has_fill_;
+  Color fill_color_;
+  FillRule fill_rule_;
+
+  bool has_stroke_;
+  Color stroke_color_;
+  float stroke_width_;
+  JoinStyle join_;
+  EndingStyle ending_;
+
+  // Calculated from the above, by build().
+  bool built_;
+  Box extents_;
+  std::vector<internal::PathEdge> fill_edges_;
+  std::vector<internal::PathEdge> stroke_edges_;
+};
+
+}  // namespace roo_display
@@ -0,0 +1,67 @@
+#include "roo_display/transport/fake_spi.h"
+
+#include <string.h>
+
+namespace roo_display {
+
+FakeSpiBus::FakeSpiBus(SpiCostModel cost_model, bool log_commands)
+    : cost_model_(cost_model), log_commands_(log_commands) {
+  reset();
+}
+
+void FakeSpiBus::reset() {
+  commands_.clear();
+  memset(opcode_count_, 0, sizeof(opcode_count_));
+  total_commands_ = 0;
+  bytes_ = 0;
+  data_bytes_ = 0;
+  transactions_ = 0;
+  calls_ = 0;
+  gpio_toggles_ = 0;
+}
+
+uint64_t FakeSpiBus::estimatedWireTimeNs() const {
+  uint64_t clock_ns = (uint64_t)(bytes_ * 8 * 1e9 / cost_model_.clock_hz);
+  return clock_ns + transactions_ * cost_model_.transaction_overhead_ns +
+         calls_ * cost_model_.call_overhead_ns +
+         gpio_toggles_ * cost_model_.gpio_toggle_ns;
+}
+
+void FakeSpiBus::command(uint8_t opcode, uint32_t wire_bytes) {
+  ++opcode_count_[opcode];
+  ++total_commands_;
+  ++calls_;
+  bytes_ += wire_bytes;
+  if (log_commands_) {
+    commands_.push_back(SpiCommand{opcode, 0, {}});
+  }
+}
+
+void FakeSpiBus::data(const uint8_t *data, uint32_t len) {
+  ++calls_;
+  bytes_ += len;
+  data_bytes_ += len;
+  if (!log_commands_ || commands_.empty()) return;
+  SpiCommand &cmd = commands_.back();
+  cmd.data_bytes += len;
+  while (len-- > 0 && cmd.params.size() < SpiCommand::kMaxRecordedParams) {
+    cmd.params.push_back(*data++);
+  }
+}
+
+void FakeSpiBus::fill(const uint8_t *pattern, int pattern_size,
+                      uint32_t count) {
+  uint64_t len = (uint64_t)pattern_size * count;
+  ++calls_;
+  bytes_ += len;
+  data_bytes_ += len;
+  if (!log_commands_ || commands_.empty()) return;
+  SpiCommand &cmd = commands_.back();
+  cmd.data_bytes += len;
+  for (uint64_t i = 0;
+       i < len && cmd.params.size() < SpiCommand::kMaxRecordedParams; ++i) {
+    cmd.params.push_back(pattern[i % pattern_size]);
+  }
+}
+
+}  // namespace roo_display
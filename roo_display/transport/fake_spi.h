@@ -0,0 +1,204 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+namespace roo_display {
+
+// Approximate cost of the SPI traffic, used by FakeSpiBus to estimate the
+// time the transfers would take on real hardware. The defaults are rough
+// figures for an ESP32 driving the bus via the Arduino SPI library.
+struct SpiCostModel {
+  SpiCostModel(uint32_t clock_hz = 40000000,
+               uint32_t transaction_overhead_ns = 1000,
+               uint32_t call_overhead_ns = 250,
+               uint32_t gpio_toggle_ns = 50)
+      : clock_hz(clock_hz),
+        transaction_overhead_ns(transaction_overhead_ns),
+        call_overhead_ns(call_overhead_ns),
+        gpio_toggle_ns(gpio_toggle_ns) {}
+
+  // SPI clock frequency. Each byte takes 8 clock cycles.
+  uint32_t clock_hz;
+
+  // Fixed cost of beginTransaction() / endTransaction() (bus locking and
+  // reconfiguring the peripheral).
+  uint32_t transaction_overhead_ns;
+
+  // Fixed cost of each transfer call (write, writeBytes, fill16be, ...),
+  // setting up and waiting for the peripheral.
+  uint32_t call_overhead_ns;
+
+  // Cost of toggling the CS or the DC pin.
+  uint32_t gpio_toggle_ns;
+};
+
+// A single command recorded by FakeSpiBus: the opcode, sent with DC low, and
+// the data that followed it, until the next command.
+struct SpiCommand {
+  uint8_t opcode;
+
+  // Total number of data bytes sent after the command.
+  uint32_t data_bytes;
+
+  // The first (up to kMaxRecordedParams) data bytes sent after the command.
+  // For address window commands (e.g. CASET / RASET), these are the
+  // coordinates.
+  std::vector<uint8_t> params;
+
+  static constexpr int kMaxRecordedParams = 16;
+};
+
+// Host-side model of an SPI bus with a display attached, collecting the
+// traffic generated by FakeSpiTransport. Counts bytes, transactions,
+// transfer calls, and commands (per opcode); optionally, logs the command
+// stream. Reports the estimated wire time according to the cost model.
+//
+// Use it to measure the command efficiency of display drivers in tests and
+// benchmarks, without hardware:
+//
+//   FakeSpiBus bus;
+//   Ili9341<FakeSpiTransport> device{FakeSpiTransport(bus)};
+//   Display display(device);
+//   ...
+//   EXPECT_EQ(1, bus.commandCount(ili9341::CASET));
+class FakeSpiBus {
+ public:
+  FakeSpiBus(SpiCostModel cost_model = SpiCostModel(),
+             bool log_commands = true);
+
+  const SpiCostModel &cost_model() const { return cost_model_; }
+
+  // Enables or disables logging of the command stream. When disabled, only
+  // the counters are updated. Logging is best disabled in benchmarks, as the
+  // log grows without bounds.
+  void setCommandLogging(bool enabled) { log_commands_ = enabled; }
+
+  // Returns the logged command stream.
+  const std::vector<SpiCommand> &commands() const { return commands_; }
+
+  // Returns the number of commands with the specified opcode.
+  uint64_t commandCount(uint8_t opcode) const { return opcode_count_[opcode]; }
+
+  // Returns the total number of commands.
+  uint64_t totalCommands() const { return total_commands_; }
+
+  // Returns the total number of bytes sent, including commands and data.
+  uint64_t bytes() const { return bytes_; }
+
+  // Returns the number of bytes sent as data (with DC high).
+  uint64_t dataBytes() const { return data_bytes_; }
+
+  // Returns the number of beginTransaction() calls.
+  uint64_t transactions() const { return transactions_; }
+
+  // Returns the number of transfer calls.
+  uint64_t calls() const { return calls_; }
+
+  // Returns the number of CS and DC pin toggles.
+  uint64_t gpioToggles() const { return gpio_toggles_; }
+
+  // Returns the estimated time, in nanoseconds, that the recorded traffic
+  // would take on the wire, according to the cost model.
+  uint64_t estimatedWireTimeNs() const;
+
+  // Clears the counters and the command log.
+  void reset();
+
+  // Called by FakeSpiTransport.
+  void transaction() { ++transactions_; }
+  void gpioToggle() { ++gpio_toggles_; }
+  void command(uint8_t opcode, uint32_t wire_bytes);
+  void data(const uint8_t *data, uint32_t len);
+  void fill(const uint8_t *pattern, int pattern_size, uint32_t count);
+
+ private:
+  SpiCostModel cost_model_;
+  bool log_commands_;
+  std::vector<SpiCommand> commands_;
+  uint64_t opcode_count_[256];
+  uint64_t total_commands_;
+  uint64_t bytes_;
+  uint64_t data_bytes_;
+  uint64_t transactions_;
+  uint64_t calls_;
+  uint64_t gpio_toggles_;
+};
+
+// Fake SPI transport, implementing the contract expected by the display
+// drivers (see SpiTransport in spi.h). Discards the data, reporting the
+// traffic to the specified FakeSpiBus. Bytes written while DC is low (between
+// cmdBegin() and cmdEnd()) are interpreted as command opcodes.
+//
+// The transport is a lightweight handle; it can be freely moved into the
+// driver, while the bus remains accessible to the caller.
+class FakeSpiTransport {
+ public:
+  FakeSpiTransport(FakeSpiBus &bus) : bus_(&bus), dc_command_(false) {}
+
+  void beginTransaction() { bus_->transaction(); }
+  void endTransaction() {}
+
+  void begin() { bus_->gpioToggle(); }
+  void end() { bus_->gpioToggle(); }
+
+  void cmdBegin() { setDc(true); }
+  void cmdEnd() { setDc(false); }
+
+  void write(uint8_t data) {
+    if (dc_command_) {
+      bus_->command(data, 1);
+    } else {
+      bus_->data(&data, 1);
+    }
+  }
+
+  void write16(uint16_t data) {
+    if (dc_command_) {
+      // 16-bit command bus (e.g. ILI9486); the opcode is in the low byte.
+      bus_->command(data & 0xFF, 2);
+    } else {
+      uint8_t buf[] = {(uint8_t)(data >> 8), (uint8_t)data};
+      bus_->data(buf, 2);
+    }
+  }
+
+  void write16be(uint16_t data) { bus_->data((const uint8_t *)&data, 2); }
+
+  void write16x2(uint16_t a, uint16_t b) {
+    uint8_t buf[] = {(uint8_t)(a >> 8), (uint8_t)a, (uint8_t)(b >> 8),
+                     (uint8_t)b};
+    bus_->data(buf, 4);
+  }
+
+  void write32(uint32_t data) {
+    uint8_t buf[] = {(uint8_t)(data >> 24), (uint8_t)(data >> 16),
+                     (uint8_t)(data >> 8), (uint8_t)data};
+    bus_->data(buf, 4);
+  }
+
+  void write32be(uint32_t data) { bus_->data((const uint8_t *)&data, 4); }
+
+  void writeBytes(uint8_t *data, uint32_t len) { bus_->data(data, len); }
+
+  void fill16be(uint16_t data, uint32_t len) {
+    bus_->fill((const uint8_t *)&data, 2, len);
+  }
+
+  void fill24be(uint32_t data, uint32_t len) {
+    bus_->fill((const uint8_t *)&data + 1, 3, len);
+  }
+
+ private:
+  void setDc(bool command) {
+    if (dc_command_ == command) return;
+    dc_command_ = command;
+    bus_->gpioToggle();
+  }
+
+  FakeSpiBus *bus_;
+  bool dc_command_;
+};
+
+}  // namespace roo_display
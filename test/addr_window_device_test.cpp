@@ -213,6 +213,21 @@ TEST_P(AddrWindowDeviceTest, WritePixelsSnake) {
       std::get<0>(GetParam()), std::get<1>(GetParam()));
 }
 
+TEST_P(AddrWindowDeviceTest, FillSpans) {
+  TestFillSpans<Rgb565Device, FakeOffscreen<Rgb565>>(
+      std::get<0>(GetParam()), std::get<1>(GetParam()));
+}
+
+TEST_P(AddrWindowDeviceTest, WriteSpans) {
+  TestWriteSpans<Rgb565Device, FakeOffscreen<Rgb565>>(
+      std::get<0>(GetParam()), std::get<1>(GetParam()));
+}
+
+TEST_P(AddrWindowDeviceTest, WriteSpansStress) {
+  TestWriteSpansStress<Rgb565Device, FakeOffscreen<Rgb565>>(
+      std::get<0>(GetParam()), std::get<1>(GetParam()));
+}
+
 TEST_P(AddrWindowDeviceTest, WriteRectWindowSimple) {
   TestWriteRectWindowSimple<Rgb565Device, FakeOffscreen<Rgb565>>(
       std::get<0>(GetParam()), std::get<1>(GetParam()));
@@ -80,6 +80,10 @@ TEST(Background, SimpleTests) {
                                                      Orientation());
   TestWritePixelsSnake<TestDeviceSimple, RefDeviceSimple>(BLENDING_MODE_SOURCE,
                                                           Orientation());
+  TestFillSpans<TestDeviceSimple, RefDeviceSimple>(BLENDING_MODE_SOURCE,
+                                                   Orientation());
+  TestWriteSpans<TestDeviceSimple, RefDeviceSimple>(BLENDING_MODE_SOURCE,
+                                                    Orientation());
   TestWriteRectWindowSimple<TestDeviceSimple, RefDeviceSimple>(
       BLENDING_MODE_SOURCE, Orientation());
 }
@@ -87,6 +91,8 @@ TEST(Background, SimpleTests) {
 TEST(Background, StressTests) {
   TestWritePixelsStress<TestDeviceSimple, RefDeviceSimple>(BLENDING_MODE_SOURCE,
                                                            Orientation());
+  TestWriteSpansStress<TestDeviceSimple, RefDeviceSimple>(BLENDING_MODE_SOURCE,
+                                                          Orientation());
   TestWriteRectWindowStress<TestDeviceSimple, RefDeviceSimple>(
       BLENDING_MODE_SOURCE, Orientation());
 }
@@ -337,4 +337,62 @@ TEST(BasicShapes, DrawAnotherSteepLine) {
                                           "        "));
 }
 
+TEST(BasicShapes, DrawLongRunsLine) {
+  FakeOffscreen<Rgb565> test_screen(13, 5, color::Black);
+  Display display(test_screen);
+  {
+    DrawingContext dc(display);
+    dc.draw(Line(11, 3, 1, 1, color::White));
+  }
+  EXPECT_THAT(test_screen, MatchesContent(WhiteOnBlack(), 13, 5,
+                                          "             "
+                                          " ***         "
+                                          "    *****    "
+                                          "         *** "
+                                          "             "));
+}
+
+TEST(BasicShapes, DrawLongRunsSteepLine) {
+  FakeOffscreen<Rgb565> test_screen(12, 12, color::Black);
+  Display display(test_screen);
+  {
+    DrawingContext dc(display);
+    dc.draw(Line(10, 0, 9, 11, color::White));
+  }
+  EXPECT_THAT(test_screen, MatchesContent(WhiteOnBlack(), 12, 12,
+                                          "          * "
+                                          "          * "
+                                          "          * "
+                                          "          * "
+                                          "          * "
+                                          "          * "
+                                          "         *  "
+                                          "         *  "
+                                          "         *  "
+                                          "         *  "
+                                          "         *  "
+                                          "         *  "));
+}
+
+TEST(BasicShapes, DrawCircle) {
+  FakeOffscreen<Rgb565> test_screen(11, 11, color::Black);
+  Display display(test_screen);
+  {
+    DrawingContext dc(display);
+    dc.draw(Circle::ByRadius(5, 5, 4, color::White));
+  }
+  EXPECT_THAT(test_screen, MatchesContent(WhiteOnBlack(), 11, 11,
+                                          "           "
+                                          "    ***    "
+                                          "   *   *   "
+                                          "  *     *  "
+                                          " *       * "
+                                          " *       * "
+                                          " *       * "
+                                          "  *     *  "
+                                          "   *   *   "
+                                          "    ***    "
+                                          "           "));
+}
+
 }  // namespace roo_display
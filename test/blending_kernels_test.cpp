@@ -0,0 +1,144 @@
+#include "roo_display/color/blending_kernels.h"
+
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "roo_display/color/blending.h"
+#include "roo_display/color/color_modes.h"
+#include "roo_display/core/offscreen.h"
+#include "roo_display/internal/byte_order.h"
+
+namespace roo_display {
+namespace internal {
+
+// Random colors, biased towards the alpha values that trigger special cases
+// in the blending code (0x00 and 0xFF).
+Color RandomColor(std::mt19937& gen) {
+  uint32_t argb = gen();
+  switch (gen() % 4) {
+    case 0:
+      return Color(argb | 0xFF000000);
+    case 1:
+      return Color(argb & 0x00FFFFFF);
+    default:
+      return Color(argb);
+  }
+}
+
+template <typename Storage>
+Storage Swap(Storage v, bool swap) {
+  return swap ? byte_order::Swapper<Storage>()(v) : v;
+}
+
+// Checks the kernel against RawBlender, for a range of lengths (to cover the
+// vectorized loops, and the tails), and both byte orders.
+template <typename ColorMode, BlendingMode blending_mode, typename Kernel>
+void CheckWriteKernel(Kernel kernel, const ColorMode& mode = ColorMode()) {
+  typedef ColorStorageType<ColorMode> Storage;
+  std::mt19937 gen(1234);
+  RawBlender<ColorMode, blending_mode> blender;
+  for (bool swap : {false, true}) {
+    for (uint32_t count = 0; count < 70; ++count) {
+      std::vector<Storage> dst(count);
+      std::vector<Color> src(count);
+      std::vector<Storage> expected(count);
+      for (uint32_t i = 0; i < count; ++i) {
+        dst[i] = mode.fromArgbColor(RandomColor(gen));
+        src[i] = RandomColor(gen);
+        expected[i] = blender(dst[i], src[i], mode);
+        dst[i] = Swap(dst[i], swap);
+      }
+      kernel(dst.data(), src.data(), count, swap);
+      for (uint32_t i = 0; i < count; ++i) {
+        ASSERT_EQ(expected[i], Swap(dst[i], swap))
+            << "count: " << count << ", i: " << i << ", swap: " << swap
+            << ", isa: " << BlendingKernelIsa();
+      }
+    }
+  }
+}
+
+template <typename ColorMode, BlendingMode blending_mode, typename Kernel>
+void CheckFillKernel(Kernel kernel, const ColorMode& mode = ColorMode()) {
+  typedef ColorStorageType<ColorMode> Storage;
+  std::mt19937 gen(4321);
+  RawBlender<ColorMode, blending_mode> blender;
+  for (bool swap : {false, true}) {
+    for (uint32_t count = 0; count < 150; count += 7) {
+      std::vector<Storage> dst(count);
+      std::vector<Storage> expected(count);
+      Color src = RandomColor(gen);
+      for (uint32_t i = 0; i < count; ++i) {
+        dst[i] = mode.fromArgbColor(RandomColor(gen));
+        expected[i] = blender(dst[i], src, mode);
+        dst[i] = Swap(dst[i], swap);
+      }
+      kernel(dst.data(), src, count, swap);
+      for (uint32_t i = 0; i < count; ++i) {
+        ASSERT_EQ(expected[i], Swap(dst[i], swap))
+            << "count: " << count << ", i: " << i << ", swap: " << swap
+            << ", isa: " << BlendingKernelIsa();
+      }
+    }
+  }
+}
+
+TEST(BlendingKernels, Rgb565Source) {
+  CheckWriteKernel<Rgb565, BLENDING_MODE_SOURCE>(Rgb565WriteSource);
+}
+
+TEST(BlendingKernels, Rgb565SourceOverOpaque) {
+  CheckWriteKernel<Rgb565, BLENDING_MODE_SOURCE_OVER_OPAQUE>(
+      Rgb565WriteSourceOverOpaque);
+  CheckWriteKernel<Rgb565, BLENDING_MODE_SOURCE_OVER>(
+      Rgb565WriteSourceOverOpaque);
+  CheckFillKernel<Rgb565, BLENDING_MODE_SOURCE_OVER_OPAQUE>(
+      Rgb565FillSourceOverOpaque);
+}
+
+TEST(BlendingKernels, Argb8888Source) {
+  CheckWriteKernel<Argb8888, BLENDING_MODE_SOURCE>(Argb8888WriteSource);
+}
+
+TEST(BlendingKernels, Argb8888SourceOverOpaque) {
+  CheckWriteKernel<Argb8888, BLENDING_MODE_SOURCE_OVER_OPAQUE>(
+      Argb8888WriteSourceOverOpaque);
+  CheckFillKernel<Argb8888, BLENDING_MODE_SOURCE_OVER_OPAQUE>(
+      Argb8888FillSourceOverOpaque);
+}
+
+TEST(BlendingKernels, Argb8888SourceOver) {
+  CheckWriteKernel<Argb8888, BLENDING_MODE_SOURCE_OVER>(
+      Argb8888WriteSourceOver);
+  CheckFillKernel<Argb8888, BLENDING_MODE_SOURCE_OVER>(Argb8888FillSourceOver);
+}
+
+// The bulk blender must produce the same results as the per-pixel writer,
+// including at unaligned offsets.
+TEST(BlendingKernels, BulkBlenderMatchesPerPixel) {
+  std::mt19937 gen(42);
+  const int kSize = 50;
+  std::vector<Color> src(kSize);
+  for (Color& c : src) c = RandomColor(gen);
+  uint8_t expected[kSize * 4 + 4];
+  uint8_t actual[kSize * 4 + 4];
+  for (size_t i = 0; i < sizeof(expected); ++i) {
+    expected[i] = actual[i] = gen();
+  }
+  Argb8888 mode;
+  BlendingWriterOperator<Argb8888, COLOR_PIXEL_ORDER_MSB_FIRST,
+                         BYTE_ORDER_BIG_ENDIAN, BLENDING_MODE_SOURCE_OVER>
+      single(mode, src.data());
+  for (int i = 0; i < kSize - 1; ++i) single(expected, i + 1);
+  BlendingWriterOperator<Argb8888, COLOR_PIXEL_ORDER_MSB_FIRST,
+                         BYTE_ORDER_BIG_ENDIAN, BLENDING_MODE_SOURCE_OVER>
+      bulk(mode, src.data());
+  bulk(actual, 1, kSize - 1);
+  for (size_t i = 0; i < sizeof(expected); ++i) {
+    ASSERT_EQ(expected[i], actual[i]) << i;
+  }
+}
+
+}  // namespace internal
+}  // namespace roo_display
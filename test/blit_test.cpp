@@ -0,0 +1,282 @@
+#include <random>
+#include <vector>
+
+#include "roo_display/core/offscreen.h"
+#include "roo_display/driver/ili9341.h"
+#include "roo_display/internal/bitcopy.h"
+#include "roo_display/transport/fake_spi.h"
+#include "testing.h"
+
+using namespace testing;
+
+namespace roo_display {
+
+void RandomFill(uint8_t* buf, size_t size, std::mt19937& gen) {
+  for (size_t i = 0; i < size; ++i) buf[i] = gen();
+}
+
+template <bool msb_first>
+bool GetBit(const uint8_t* buf, uint32_t offset) {
+  return msb_first ? (buf[offset / 8] >> (7 - offset % 8)) & 1
+                   : (buf[offset / 8] >> (offset % 8)) & 1;
+}
+
+template <bool msb_first>
+void CheckBitCopy() {
+  std::mt19937 gen(5);
+  for (int i = 0; i < 1000; ++i) {
+    uint8_t src[16], dst[16], expected[16];
+    RandomFill(src, 16, gen);
+    RandomFill(dst, 16, gen);
+    uint32_t src_offset = gen() % 64;
+    uint32_t dst_offset = gen() % 64;
+    uint32_t count = gen() % 64;
+    memcpy(expected, dst, 16);
+    for (uint32_t j = 0; j < count; ++j) {
+      uint32_t pos = dst_offset + j;
+      uint8_t mask = msb_first ? 0x80 >> (pos % 8) : 1 << (pos % 8);
+      if (GetBit<msb_first>(src, src_offset + j)) {
+        expected[pos / 8] |= mask;
+      } else {
+        expected[pos / 8] &= ~mask;
+      }
+    }
+    bit_copy<msb_first>(dst, dst_offset, src, src_offset, count);
+    ASSERT_THAT(dst, ElementsAreArray(expected))
+        << src_offset << " " << dst_offset << " " << count;
+  }
+}
+
+TEST(BitCopy, MsbFirst) { CheckBitCopy<true>(); }
+
+TEST(BitCopy, LsbFirst) { CheckBitCopy<false>(); }
+
+// Blits random regions between offscreens of the same format, using
+// BLENDING_MODE_SOURCE (and thus the raw path), and compares the raw pixel
+// values against the expectation. If 'self' is true, the blits are within the
+// same offscreen.
+template <typename ColorMode,
+          ColorPixelOrder pixel_order = COLOR_PIXEL_ORDER_MSB_FIRST,
+          ByteOrder byte_order = BYTE_ORDER_BIG_ENDIAN>
+void CheckRawBlit(bool self, const ColorMode& color_mode = ColorMode()) {
+  typedef Offscreen<ColorMode, pixel_order, byte_order> Off;
+  internal::Reader<ColorMode, pixel_order, byte_order> read;
+  const int16_t w = 21, h = 11;
+  const size_t size = (w * h * ColorMode::bits_per_pixel + 7) / 8;
+  std::mt19937 gen(7);
+  for (int i = 0; i < 200; ++i) {
+    Off src(Box(3, 2, w + 2, h + 1), color_mode);
+    Off other(w, h, color_mode);
+    Off& dst = self ? src : other;
+    RandomFill(src.buffer(), size, gen);
+    RandomFill(other.buffer(), size, gen);
+    std::vector<uint8_t> src_copy(src.buffer(), src.buffer() + size);
+    std::vector<uint8_t> dst_copy(dst.buffer(), dst.buffer() + size);
+    const Box& src_ext = src.extents();
+    const Box& dst_ext = dst.extents();
+    int16_t x0 = gen() % 25 - 2, y0 = gen() % 15 - 2;
+    Box src_rect(x0, y0, x0 + gen() % 25, y0 + gen() % 15);
+    int16_t dx = gen() % 25 - 2, dy = gen() % 15 - 2;
+    Blit(src, src_rect, dst, dx, dy, BLENDING_MODE_SOURCE);
+    for (int16_t y = dst_ext.yMin(); y <= dst_ext.yMax(); ++y) {
+      for (int16_t x = dst_ext.xMin(); x <= dst_ext.xMax(); ++x) {
+        int16_t sx = x - dx + src_rect.xMin();
+        int16_t sy = y - dy + src_rect.yMin();
+        uint32_t dst_pos =
+            (y - dst_ext.yMin()) * dst_ext.width() + x - dst_ext.xMin();
+        auto expected = read(&dst_copy[0], dst_pos);
+        if (src_rect.contains(sx, sy) && src_ext.contains(sx, sy)) {
+          expected = read(&src_copy[0], (sy - src_ext.yMin()) * w + sx -
+                                            src_ext.xMin());
+        }
+        ASSERT_EQ(expected, read(dst.buffer(), dst_pos))
+            << "x: " << x << ", y: " << y << ", src_rect: " << src_rect
+            << ", dx: " << dx << ", dy: " << dy;
+      }
+    }
+  }
+}
+
+TEST(Blit, RawRgb565) {
+  CheckRawBlit<Rgb565>(false);
+  CheckRawBlit<Rgb565>(true);
+}
+
+TEST(Blit, RawArgb6666) {
+  CheckRawBlit<Argb6666>(false);
+  CheckRawBlit<Argb6666>(true);
+}
+
+TEST(Blit, RawGrayscale8) {
+  CheckRawBlit<Grayscale8>(false);
+  CheckRawBlit<Grayscale8>(true);
+}
+
+TEST(Blit, RawGrayscale4) {
+  CheckRawBlit<Grayscale4>(false);
+  CheckRawBlit<Grayscale4>(true);
+  CheckRawBlit<Grayscale4, COLOR_PIXEL_ORDER_LSB_FIRST>(false);
+  CheckRawBlit<Grayscale4, COLOR_PIXEL_ORDER_LSB_FIRST>(true);
+}
+
+TEST(Blit, RawAlpha4) {
+  CheckRawBlit<Alpha4>(false, Alpha4(color::Red));
+  CheckRawBlit<Alpha4>(true, Alpha4(color::Red));
+}
+
+TEST(Blit, RawMonochrome) {
+  CheckRawBlit<Monochrome>(false, WhiteOnBlack());
+  CheckRawBlit<Monochrome>(true, WhiteOnBlack());
+  CheckRawBlit<Monochrome, COLOR_PIXEL_ORDER_LSB_FIRST>(false, WhiteOnBlack());
+  CheckRawBlit<Monochrome, COLOR_PIXEL_ORDER_LSB_FIRST>(true, WhiteOnBlack());
+}
+
+// Blits with conversion and blending must match drawing the raster.
+TEST(Blit, ConvertedAndBlended) {
+  std::mt19937 gen(9);
+  Offscreen<Argb8888> src(Box(5, 5, 24, 19));
+  RandomFill(src.buffer(), 20 * 15 * 4, gen);
+  for (BlendingMode mode :
+       {BLENDING_MODE_SOURCE, BLENDING_MODE_SOURCE_OVER,
+        BLENDING_MODE_SOURCE_ATOP, BLENDING_MODE_DESTINATION_OVER}) {
+    Offscreen<Argb4444> expected(30, 30);
+    Offscreen<Argb4444> actual(30, 30);
+    RandomFill(expected.buffer(), 30 * 30 * 2, gen);
+    memcpy(actual.buffer(), expected.buffer(), 30 * 30 * 2);
+    Box src_rect(8, 6, 20, 30);
+    Blit(src, src_rect, actual, 12, 3, mode);
+    {
+      Surface s(expected.output(), 4, -3, Box(12, 3, 24, 16), false,
+                color::Transparent, FILL_MODE_RECTANGLE, mode);
+      s.drawObject(src);
+    }
+    EXPECT_EQ(0, memcmp(expected.buffer(), actual.buffer(), 30 * 30 * 2))
+        << mode;
+  }
+}
+
+// With a non-default orientation, the blit goes through the output.
+TEST(Blit, RotatedDestination) {
+  std::mt19937 gen(11);
+  Offscreen<Rgb565> src(16, 16);
+  RandomFill(src.buffer(), 16 * 16 * 2, gen);
+  Offscreen<Rgb565> expected(16, 16, color::Black);
+  Offscreen<Rgb565> actual(16, 16, color::Black);
+  expected.output().setOrientation(Orientation::Default().rotateRight());
+  actual.output().setOrientation(Orientation::Default().rotateRight());
+  Blit(src, Box(2, 3, 9, 7), actual, 4, 5, BLENDING_MODE_SOURCE);
+  {
+    Surface s(expected.output(), 2, 2, Box(4, 5, 11, 9), false,
+              color::Transparent, FILL_MODE_RECTANGLE, BLENDING_MODE_SOURCE);
+    s.drawObject(src);
+  }
+  EXPECT_EQ(0, memcmp(expected.buffer(), actual.buffer(), 16 * 16 * 2));
+}
+
+TEST(Blit, ToDevice) {
+  FakeSpiBus bus;
+  Ili9341<FakeSpiTransport> device{FakeSpiTransport(bus)};
+  std::mt19937 gen(13);
+  Offscreen<Rgb565> src(10, 10);
+  RandomFill(src.buffer(), 10 * 10 * 2, gen);
+  device.begin();
+  Blit(src, Box(2, 3, 5, 4), device, 100, 200);
+  device.end();
+  ASSERT_EQ(3, bus.commands().size());
+  EXPECT_THAT(bus.commands()[0].params, ElementsAre(0, 100, 0, 103));
+  EXPECT_THAT(bus.commands()[1].params, ElementsAre(0, 200, 0, 201));
+  std::vector<uint8_t> expected;
+  for (int y = 3; y <= 4; ++y) {
+    const uint8_t* row = src.buffer() + (y * 10 + 2) * 2;
+    expected.insert(expected.end(), row, row + 8);
+  }
+  EXPECT_THAT(bus.commands()[2].params, ElementsAreArray(expected));
+}
+
+// Returns, for each pixel of a device of the given raw geometry and
+// orientation, the offset of the corresponding pixel in the buffer.
+std::vector<uint32_t> OrientedOffsets(int16_t raw_width, int16_t raw_height,
+                                      Orientation orientation) {
+  Offscreen<Argb8888> marker(raw_width, raw_height);
+  marker.output().setOrientation(orientation);
+  int16_t w = marker.output().effective_width();
+  int16_t h = marker.output().effective_height();
+  for (int16_t y = 0; y < h; ++y) {
+    for (int16_t x = 0; x < w; ++x) {
+      marker.output().fillRect(BLENDING_MODE_SOURCE, Box(x, y, x, y),
+                               Color(y * w + x));
+    }
+  }
+  std::vector<uint32_t> offsets(w * h);
+  for (uint32_t i = 0; i < offsets.size(); ++i) {
+    internal::Reader<Argb8888, COLOR_PIXEL_ORDER_MSB_FIRST,
+                     BYTE_ORDER_BIG_ENDIAN>
+        read;
+    offsets[read(marker.buffer(), i)] = i;
+  }
+  return offsets;
+}
+
+template <typename ColorMode,
+          ColorPixelOrder pixel_order = COLOR_PIXEL_ORDER_MSB_FIRST>
+void CheckCopyRect(const ColorMode& color_mode = ColorMode()) {
+  internal::Reader<ColorMode, pixel_order, BYTE_ORDER_BIG_ENDIAN> read;
+  const int16_t raw_width = 19, raw_height = 13;
+  const size_t size =
+      (raw_width * raw_height * ColorMode::bits_per_pixel + 7) / 8;
+  std::mt19937 gen(3);
+  for (int o = 0; o < 8; ++o) {
+    Orientation orientation = Orientation::RightDown();
+    for (int i = 0; i < (o & 3); ++i) orientation = orientation.rotateRight();
+    if (o & 4) orientation = orientation.flipHorizontally();
+    std::vector<uint32_t> offsets =
+        OrientedOffsets(raw_width, raw_height, orientation);
+    for (int i = 0; i < 50; ++i) {
+      Offscreen<ColorMode, pixel_order> offscreen(raw_width, raw_height,
+                                                  color_mode);
+      auto& device = offscreen.output();
+      device.setOrientation(orientation);
+      RandomFill(offscreen.buffer(), size, gen);
+      std::vector<uint8_t> orig(offscreen.buffer(), offscreen.buffer() + size);
+      int16_t w = device.effective_width();
+      int16_t h = device.effective_height();
+      int16_t x0 = gen() % (w + 4) - 2, y0 = gen() % (h + 4) - 2;
+      Box src(x0, y0, x0 + gen() % w, y0 + gen() % h);
+      // Mostly small shifts, so that the regions overlap.
+      int16_t dst_x = x0 + gen() % 7 - 3, dst_y = y0 + gen() % 7 - 3;
+      device.copyRect(src, dst_x, dst_y);
+      Box bounds(0, 0, w - 1, h - 1);
+      for (int16_t y = 0; y < h; ++y) {
+        for (int16_t x = 0; x < w; ++x) {
+          int16_t sx = x - dst_x + src.xMin();
+          int16_t sy = y - dst_y + src.yMin();
+          uint32_t offset = offsets[y * w + x];
+          auto expected = read(&orig[0], offset);
+          if (src.contains(sx, sy) && bounds.contains(sx, sy)) {
+            expected = read(&orig[0], offsets[sy * w + sx]);
+          }
+          ASSERT_EQ(expected, read(offscreen.buffer(), offset))
+              << "x: " << x << ", y: " << y << ", src: " << src
+              << ", dst: " << dst_x << ", " << dst_y
+              << ", orientation: " << orientation;
+        }
+      }
+    }
+  }
+}
+
+TEST(CopyRect, Rgb565) { CheckCopyRect<Rgb565>(); }
+
+TEST(CopyRect, Grayscale8) { CheckCopyRect<Grayscale8>(); }
+
+TEST(CopyRect, Grayscale4) {
+  CheckCopyRect<Grayscale4>();
+  CheckCopyRect<Grayscale4, COLOR_PIXEL_ORDER_LSB_FIRST>();
+}
+
+TEST(CopyRect, Monochrome) {
+  CheckCopyRect<Monochrome>(WhiteOnBlack());
+  CheckCopyRect<Monochrome, COLOR_PIXEL_ORDER_LSB_FIRST>(WhiteOnBlack());
+}
+
+}  // namespace roo_display
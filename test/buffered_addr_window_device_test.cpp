@@ -0,0 +1,222 @@
+#include "roo_display/driver/common/buffered_addr_window_device.h"
+
+#include <random>
+#include <vector>
+
+#include "roo_display.h"
+#include "roo_display/core/offscreen.h"
+#include "roo_display/shape/basic.h"
+#include "testing.h"
+
+using namespace testing;
+
+namespace roo_display {
+
+// Simulated panel, receiving the flushed rectangles.
+template <typename ColorMode>
+struct FakePanel {
+  FakePanel(int16_t width, int16_t height, Color initial = color::Black)
+      : width(width),
+        height(height),
+        content(width, height, initial),
+        flushed_pixels(0) {}
+
+  int16_t width;
+  int16_t height;
+  Offscreen<ColorMode> content;
+  std::vector<Box> flushed;
+  int32_t flushed_pixels;
+};
+
+template <typename CM>
+class FakeTarget {
+ public:
+  typedef CM ColorMode;
+
+  FakeTarget() : panel_(nullptr) {}
+  FakeTarget(FakePanel<ColorMode>* panel) : panel_(panel) {}
+
+  int16_t width() const { return panel_->width; }
+  int16_t height() const { return panel_->height; }
+
+  void init() {}
+  void begin() {}
+  void end() {}
+  void setOrientation(Orientation orientation) {}
+
+  void flushRect(ConstDramRaster<ColorMode>& buffer, int16_t x0, int16_t y0,
+                 int16_t x1, int16_t y1) {
+    Box box(x0, y0, x1, y1);
+    panel_->flushed.push_back(box);
+    panel_->flushed_pixels += box.area();
+    for (int16_t y = y0; y <= y1; ++y) {
+      for (int16_t x = x0; x <= x1; ++x) {
+        panel_->content.output().fillPixels(BLENDING_MODE_SOURCE,
+                                            buffer.get(x, y), &x, &y, 1);
+      }
+    }
+  }
+
+ private:
+  FakePanel<ColorMode>* panel_;
+};
+
+template <typename ColorMode, BufferedFlushMode flush_mode>
+using FakeDevice =
+    BufferedAddrWindowDevice<FakeTarget<ColorMode>, flush_mode>;
+
+// Draws a 'label' (a bar of the specified length) in a single pass, as e.g. a
+// text label drawn with FILL_MODE_RECTANGLE would be.
+void DrawLabel(DisplayDevice& device, int16_t length) {
+  Offscreen<Rgb565> label(60, 20, color::White);
+  label.output().fillRect(BLENDING_MODE_SOURCE, Box(10, 5, 9 + length, 14),
+                          color::Black);
+  Display display(device);
+  DrawingContext dc(display);
+  dc.draw(label);
+}
+
+template <typename ColorMode>
+std::vector<Color> Contents(const Rasterizable& raster, int16_t w, int16_t h) {
+  std::vector<int16_t> xs, ys;
+  for (int16_t y = 0; y < h; ++y) {
+    for (int16_t x = 0; x < w; ++x) {
+      xs.push_back(x);
+      ys.push_back(y);
+    }
+  }
+  std::vector<Color> result(w * h);
+  raster.readColors(&xs[0], &ys[0], w * h, &result[0]);
+  return result;
+}
+
+TEST(BufferedAddrWindowDevice, DiffSkipsUnchangedRedraw) {
+  FakePanel<Rgb565> panel(60, 20);
+  FakeDevice<Rgb565, BUFFERED_FLUSH_DIFF> device(Orientation::Default(),
+                                                 FakeTarget<Rgb565>(&panel));
+  DrawLabel(device, 25);
+  EXPECT_GT(panel.flushed_pixels, 0);
+
+  // Redrawing the same content doesn't send anything.
+  panel.flushed.clear();
+  panel.flushed_pixels = 0;
+  DrawLabel(device, 25);
+  EXPECT_THAT(panel.flushed, ElementsAre());
+
+  // Changing the content sends only the changed pixels.
+  DrawLabel(device, 33);
+  EXPECT_THAT(panel.flushed, ElementsAre(Box(35, 5, 42, 14)));
+}
+
+// The first flush overwrites whatever the panel has been showing.
+TEST(BufferedAddrWindowDevice, DiffFirstFlushSendsEverything) {
+  FakePanel<Rgb565> panel(60, 20, color::Red);
+  FakeDevice<Rgb565, BUFFERED_FLUSH_DIFF> device(Orientation::Default(),
+                                                 FakeTarget<Rgb565>(&panel));
+  device.begin();
+  device.fillRect(BLENDING_MODE_SOURCE, Box(5, 5, 14, 9), color::White);
+  device.end();
+  Offscreen<Rgb565> expected(60, 20, color::Black);
+  expected.output().fillRect(BLENDING_MODE_SOURCE, Box(5, 5, 14, 9),
+                             color::White);
+  EXPECT_EQ(60 * 20, panel.flushed_pixels);
+  EXPECT_THAT(Contents<Rgb565>(panel.content, 60, 20),
+              ElementsAreArray(Contents<Rgb565>(expected, 60, 20)));
+
+  // Subsequent flushes send only the changes.
+  panel.flushed.clear();
+  device.begin();
+  device.fillRect(BLENDING_MODE_SOURCE, Box(5, 5, 14, 9), color::White);
+  device.end();
+  EXPECT_THAT(panel.flushed, ElementsAre());
+}
+
+TEST(BufferedAddrWindowDevice, DamageFlushesRedraw) {
+  FakePanel<Rgb565> panel(60, 20);
+  FakeDevice<Rgb565, BUFFERED_FLUSH_DAMAGE> device(Orientation::Default(),
+                                                   FakeTarget<Rgb565>(&panel));
+  DrawLabel(device, 25);
+  panel.flushed_pixels = 0;
+  DrawLabel(device, 25);
+  EXPECT_EQ(60 * 20, panel.flushed_pixels);
+}
+
+// After random drawing, the panel receives all the changes.
+template <typename ColorMode>
+void CheckRandomDrawing() {
+  std::mt19937 gen(11);
+  const int16_t w = 45, h = 30;
+  FakePanel<ColorMode> panel(w, h);
+  FakeDevice<ColorMode, BUFFERED_FLUSH_DIFF> device(
+      Orientation::Default(), FakeTarget<ColorMode>(&panel));
+  Offscreen<ColorMode> expected(w, h, color::Black);
+  DisplayOutput* outputs[] = {&expected.output(), &device};
+  for (int frame = 0; frame < 10; ++frame) {
+    device.begin();
+    for (int op = 0; op < 10; ++op) {
+      int kind = gen() % 5;
+      int16_t x0 = gen() % w, y0 = gen() % h;
+      int16_t x1 = x0 + gen() % (w - x0), y1 = y0 + gen() % (h - y0);
+      // Few distinct colors, so that many writes don't change anything.
+      Color colors[64];
+      for (Color& c : colors) c = (gen() % 2) ? color::White : color::Black;
+      for (DisplayOutput* out : outputs) {
+        switch (kind) {
+          case 0: {
+            out->fillRect(BLENDING_MODE_SOURCE, Box(x0, y0, x1, y1),
+                          colors[0]);
+            break;
+          }
+          case 1: {
+            int16_t xs[] = {x0, x1, x0, x0, x0}, ys[] = {y0, y1, y1, y0, y1};
+            out->writePixels(BLENDING_MODE_SOURCE, colors, xs, ys, 5);
+            out->fillPixels(BLENDING_MODE_SOURCE, colors[5], xs, ys, 3);
+            break;
+          }
+          case 2: {
+            Box box(x0, y0, x0 + (x1 - x0) % 8, y0 + (y1 - y0) % 8);
+            out->setAddress(box.xMin(), box.yMin(), box.xMax(), box.yMax(),
+                            BLENDING_MODE_SOURCE);
+            uint32_t count = box.area();
+            out->write(colors, count / 2);
+            out->write(colors + count / 2, count - count / 2);
+            break;
+          }
+          case 3: {
+            int16_t xs0[] = {x0, x0}, ys[] = {y0, y1};
+            int16_t xs1[] = {(int16_t)(x0 + (x1 - x0) % 30),
+                             (int16_t)(x0 + (x1 - x0) % 20)};
+            out->writeSpans(BLENDING_MODE_SOURCE, colors, xs0, ys, xs1, 2);
+            break;
+          }
+          case 4: {
+            int16_t xs0[] = {x0, x1}, ys0[] = {y0, y1};
+            int16_t xs1[] = {x1, x1}, ys1[] = {y1, y1};
+            out->writeRects(BLENDING_MODE_SOURCE_OVER, colors, xs0, ys0, xs1,
+                            ys1, 2);
+            break;
+          }
+        }
+      }
+    }
+    panel.flushed_pixels = 0;
+    device.end();
+    EXPECT_THAT(Contents<ColorMode>(panel.content, w, h),
+                ElementsAreArray(Contents<ColorMode>(expected, w, h)))
+        << frame;
+  }
+}
+
+TEST(BufferedAddrWindowDevice, DiffRandomRgb565) {
+  CheckRandomDrawing<Rgb565>();
+}
+
+TEST(BufferedAddrWindowDevice, DiffRandomGrayscale4) {
+  CheckRandomDrawing<Grayscale4>();
+}
+
+TEST(BufferedAddrWindowDevice, DiffRandomRgb888) {
+  CheckRandomDrawing<Rgb888>();
+}
+
+}  // namespace roo_display
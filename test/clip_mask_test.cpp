@@ -130,6 +130,10 @@ TEST(ClipMask, SimpleTests) {
                                                      Orientation());
   TestWritePixelsSnake<TestDeviceSimple, RefDeviceSimple>(BLENDING_MODE_SOURCE,
                                                           Orientation());
+  TestFillSpans<TestDeviceSimple, RefDeviceSimple>(BLENDING_MODE_SOURCE,
+                                                   Orientation());
+  TestWriteSpans<TestDeviceSimple, RefDeviceSimple>(BLENDING_MODE_SOURCE,
+                                                    Orientation());
   TestWriteRectWindowSimple<TestDeviceSimple, RefDeviceSimple>(
       BLENDING_MODE_SOURCE, Orientation());
 }
@@ -137,6 +141,8 @@ TEST(ClipMask, SimpleTests) {
 TEST(ClipMask, StressTests) {
   TestWritePixelsStress<TestDeviceSimple, RefDeviceSimple>(BLENDING_MODE_SOURCE,
                                                            Orientation());
+  TestWriteSpansStress<TestDeviceSimple, RefDeviceSimple>(BLENDING_MODE_SOURCE,
+                                                          Orientation());
   TestWriteRectWindowStress<TestDeviceSimple, RefDeviceSimple>(
       BLENDING_MODE_SOURCE, Orientation());
 }
@@ -0,0 +1,213 @@
+#include "roo_display/core/compressed_offscreen.h"
+
+#include <random>
+#include <vector>
+
+#include "roo_display.h"
+#include "roo_display/core/offscreen.h"
+#include "roo_display/shape/basic.h"
+#include "testing.h"
+
+using namespace testing;
+
+namespace roo_display {
+
+template <int8_t unit_size>
+void CheckRoundTrip(const std::vector<uint8_t>& row) {
+  typedef internal::RleRowCodec<unit_size> Codec;
+  std::vector<uint8_t> encoded(Codec::MaxEncodedSize(row.size()));
+  uint32_t size = Codec::Encode(&row[0], row.size(), &encoded[0]);
+  EXPECT_LE(size, encoded.size());
+  std::vector<uint8_t> decoded(row.size());
+  Codec::Decode(&encoded[0], row.size(), &decoded[0]);
+  EXPECT_THAT(decoded, ElementsAreArray(row));
+}
+
+TEST(RleRowCodec, RoundTrip) {
+  std::mt19937 gen(3);
+  for (int i = 0; i < 100; ++i) {
+    std::vector<uint8_t> row;
+    // Mix of runs of varying lengths (including ones longer than a group),
+    // and of random data.
+    while (row.size() < 1200) {
+      uint8_t v = gen();
+      int n = gen() % 300;
+      bool run = gen() % 2;
+      for (int j = 0; j < n; ++j) row.push_back(run ? v : (uint8_t)gen());
+    }
+    row.resize(1200);
+    CheckRoundTrip<1>(row);
+    CheckRoundTrip<2>(row);
+    CheckRoundTrip<3>(row);
+    CheckRoundTrip<4>(row);
+  }
+}
+
+TEST(RleRowCodec, Uniform) {
+  typedef internal::RleRowCodec<2> Codec;
+  std::vector<uint8_t> row(960, 0x5A);
+  std::vector<uint8_t> encoded(Codec::MaxEncodedSize(row.size()));
+  // 480 units: 4 runs, 3 bytes each.
+  EXPECT_EQ(12, Codec::Encode(&row[0], row.size(), &encoded[0]));
+}
+
+// Applies the same sequence of random drawing operations to the linear and the
+// compressed offscreen, using the specified orientation.
+template <typename Linear, typename Compressed>
+void DrawRandom(Linear& linear, Compressed& compressed,
+                Orientation orientation, std::mt19937& gen) {
+  DisplayOutput* outputs[] = {&linear.output(), &compressed.output()};
+  linear.output().setOrientation(orientation);
+  compressed.output().setOrientation(orientation);
+  int16_t w = linear.output().effective_width();
+  int16_t h = linear.output().effective_height();
+  const BlendingMode modes[] = {BLENDING_MODE_SOURCE, BLENDING_MODE_SOURCE_OVER,
+                                BLENDING_MODE_SOURCE_OVER_OPAQUE,
+                                BLENDING_MODE_DESTINATION_OVER};
+  for (int op = 0; op < 40; ++op) {
+    BlendingMode mode = modes[gen() % 4];
+    int kind = gen() % 5;
+    int16_t x0 = gen() % w, y0 = gen() % h;
+    int16_t x1 = x0 + gen() % (w - x0), y1 = y0 + gen() % (h - y0);
+    Color colors[64];
+    for (Color& c : colors) c = Color(gen());
+    for (DisplayOutput* out : outputs) {
+      switch (kind) {
+        case 0: {
+          out->fillRect(mode, Box(x0, y0, x1, y1), colors[0]);
+          break;
+        }
+        case 1: {
+          int16_t xs0[] = {x0, x1}, ys0[] = {y0, y1};
+          int16_t xs1[] = {x1, x1}, ys1[] = {y1, y1};
+          out->writeRects(mode, colors, xs0, ys0, xs1, ys1, 2);
+          break;
+        }
+        case 2: {
+          int16_t xs[] = {x0, x1, x0}, ys[] = {y0, y1, y1};
+          out->writePixels(mode, colors, xs, ys, 3);
+          out->fillPixels(mode, colors[5], xs, ys, 2);
+          break;
+        }
+        case 3: {
+          // Address window, written in chunks.
+          Box box(x0, y0, x0 + (x1 - x0) % 8, y0 + (y1 - y0) % 8);
+          out->setAddress(box, mode);
+          uint32_t count = box.area();
+          out->write(colors, count / 2);
+          out->write(colors + count / 2, count - count / 2);
+          break;
+        }
+        case 4: {
+          int16_t xs0[] = {x0, x0}, ys[] = {y0, y1};
+          int16_t xs1[] = {(int16_t)(x0 + (x1 - x0) % 30),
+                           (int16_t)(x0 + (x1 - x0) % 20)};
+          out->writeSpans(mode, colors, xs0, ys, xs1, 2);
+          break;
+        }
+      }
+    }
+  }
+}
+
+template <typename ColorMode>
+void CheckDrawing(const ColorMode& color_mode = ColorMode()) {
+  std::mt19937 gen(5);
+  const int16_t w = 37, h = 21;
+  for (int o = 0; o < 8; ++o) {
+    Orientation orientation = Orientation::RightDown();
+    for (int i = 0; i < (o & 3); ++i) orientation = orientation.rotateRight();
+    if (o & 4) orientation = orientation.flipHorizontally();
+    Offscreen<ColorMode> linear(w, h, color::Black, color_mode);
+    CompressedOffscreen<ColorMode> compressed(w, h, color::Black, color_mode);
+    DrawRandom(linear, compressed, orientation, gen);
+    std::vector<int16_t> xs, ys;
+    for (int16_t y = 0; y < h; ++y) {
+      for (int16_t x = 0; x < w; ++x) {
+        xs.push_back(x);
+        ys.push_back(y);
+      }
+    }
+    // Read back both before and after the pending row gets compressed.
+    std::vector<Color> expected(w * h), actual(w * h);
+    linear.readColors(&xs[0], &ys[0], w * h, &expected[0]);
+    compressed.readColors(&xs[0], &ys[0], w * h, &actual[0]);
+    EXPECT_THAT(actual, ElementsAreArray(expected)) << orientation;
+    compressed.output().flush();
+    compressed.readColors(&xs[0], &ys[0], w * h, &actual[0]);
+    EXPECT_THAT(actual, ElementsAreArray(expected)) << orientation;
+  }
+}
+
+TEST(CompressedOffscreen, Rgb565) { CheckDrawing<Rgb565>(); }
+
+TEST(CompressedOffscreen, Argb4444) { CheckDrawing<Argb4444>(); }
+
+TEST(CompressedOffscreen, Rgb888) { CheckDrawing<Rgb888>(); }
+
+TEST(CompressedOffscreen, Grayscale4) { CheckDrawing<Grayscale4>(); }
+
+TEST(CompressedOffscreen, Monochrome) {
+  CheckDrawing<Monochrome>(WhiteOnBlack());
+}
+
+// Drawing the compressed offscreen (via its stream) gives the same result as
+// drawing the linear one.
+TEST(CompressedOffscreen, Draw) {
+  std::mt19937 gen(7);
+  const int16_t w = 29, h = 19;
+  Offscreen<Argb8888> linear(Box(3, 4, w + 2, h + 3), color::Transparent);
+  CompressedOffscreen<Argb8888> compressed(Box(3, 4, w + 2, h + 3),
+                                           color::Transparent);
+  DrawRandom(linear, compressed, Orientation::RightDown(), gen);
+  for (const Box& clip : {Box(0, 0, 39, 39), Box(5, 7, 20, 13)}) {
+    for (BlendingMode mode :
+         {BLENDING_MODE_SOURCE, BLENDING_MODE_SOURCE_OVER}) {
+      Offscreen<Argb8888> expected(40, 40, color::Red);
+      Offscreen<Argb8888> actual(40, 40, color::Red);
+      {
+        Surface s(expected.output(), 2, 1, clip, false, color::Transparent,
+                  FILL_MODE_RECTANGLE, mode);
+        s.drawObject(linear);
+      }
+      {
+        Surface s(actual.output(), 2, 1, clip, false, color::Transparent,
+                  FILL_MODE_RECTANGLE, mode);
+        s.drawObject(compressed);
+      }
+      EXPECT_EQ(0, memcmp(expected.buffer(), actual.buffer(), 40 * 40 * 4))
+          << clip << " " << mode;
+    }
+  }
+}
+
+// A typical screen, consisting of a few flat-colored areas, takes a small
+// fraction of the uncompressed size.
+TEST(CompressedOffscreen, FlatScreenSize) {
+  CompressedOffscreen<Rgb565> offscreen(480, 320, color::White);
+  {
+    DrawingContext dc(offscreen);
+    dc.draw(FilledRect(0, 0, 479, 39, color::DarkBlue));
+    dc.draw(FilledRoundRect(20, 60, 219, 299, 8, color::LightGray));
+    dc.draw(FilledRoundRect(260, 60, 459, 299, 8, color::LightGray));
+    dc.draw(FilledCircle::ByRadius(120, 180, 50, color::Red));
+  }
+  EXPECT_LT(offscreen.compressed_size(), 480 * 320 * 2 / 10);
+
+  Offscreen<Rgb565> expected(480, 320, color::White);
+  {
+    DrawingContext dc(expected);
+    dc.draw(FilledRect(0, 0, 479, 39, color::DarkBlue));
+    dc.draw(FilledRoundRect(20, 60, 219, 299, 8, color::LightGray));
+    dc.draw(FilledRoundRect(260, 60, 459, 299, 8, color::LightGray));
+    dc.draw(FilledCircle::ByRadius(120, 180, 50, color::Red));
+  }
+  Offscreen<Rgb565> actual(480, 320, color::Black);
+  {
+    DrawingContext dc(actual);
+    dc.draw(offscreen);
+  }
+  EXPECT_EQ(0, memcmp(expected.buffer(), actual.buffer(), 480 * 320 * 2));
+}
+
+}  // namespace roo_display
@@ -0,0 +1,133 @@
+#include "roo_display/core/damage.h"
+
+#include "gtest/gtest.h"
+#include "roo_display.h"
+#include "roo_display/shape/basic.h"
+#include "testing.h"
+
+namespace roo_display {
+
+TEST(DamageTracker, Empty) {
+  DamageTracker damage;
+  EXPECT_FALSE(damage.isDirty());
+  EXPECT_EQ(0, damage.size());
+  EXPECT_TRUE(damage.bounds().empty());
+  EXPECT_EQ(0, damage.area());
+  EXPECT_FALSE(damage.intersects(Box(0, 0, 100, 100)));
+}
+
+TEST(DamageTracker, IgnoresEmptyBoxes) {
+  DamageTracker damage;
+  damage.add(Box(5, 5, 4, 4));
+  EXPECT_FALSE(damage.isDirty());
+}
+
+TEST(DamageTracker, DisjointRects) {
+  DamageTracker damage;
+  damage.add(Box(0, 0, 9, 9));
+  damage.add(Box(20, 20, 29, 29));
+  EXPECT_TRUE(damage.isDirty());
+  EXPECT_EQ(2, damage.size());
+  EXPECT_EQ(200, damage.area());
+  EXPECT_EQ(Box(0, 0, 29, 29), damage.bounds());
+  EXPECT_TRUE(damage.intersects(Box(5, 5, 6, 6)));
+  EXPECT_FALSE(damage.intersects(Box(12, 12, 15, 15)));
+}
+
+TEST(DamageTracker, ContainedRectIsAbsorbed) {
+  DamageTracker damage;
+  damage.add(Box(0, 0, 9, 9));
+  damage.add(Box(2, 2, 4, 4));
+  EXPECT_EQ(1, damage.size());
+  EXPECT_EQ(Box(0, 0, 9, 9), damage[0]);
+}
+
+TEST(DamageTracker, OverlappingRectsMerge) {
+  DamageTracker damage;
+  damage.add(Box(0, 0, 9, 9));
+  damage.add(Box(20, 0, 29, 9));
+  // Bridges the two.
+  damage.add(Box(5, 5, 25, 6));
+  EXPECT_EQ(1, damage.size());
+  EXPECT_EQ(Box(0, 0, 29, 9), damage[0]);
+}
+
+TEST(DamageTracker, CapacityIsBounded) {
+  DamageTracker damage;
+  for (int i = 0; i < 2 * DamageTracker::kMaxRects; ++i) {
+    damage.add(Box(i * 10, 0, i * 10 + 1, 1));
+  }
+  EXPECT_LE(damage.size(), DamageTracker::kMaxRects);
+  // Everything that was added must still be covered.
+  for (int i = 0; i < 2 * DamageTracker::kMaxRects; ++i) {
+    Box box(i * 10, 0, i * 10 + 1, 1);
+    bool covered = false;
+    for (const Box& r : damage) {
+      if (r.contains(box)) covered = true;
+    }
+    EXPECT_TRUE(covered) << i;
+  }
+  // The rectangles are disjoint.
+  for (int i = 0; i < damage.size(); ++i) {
+    for (int j = i + 1; j < damage.size(); ++j) {
+      EXPECT_FALSE(damage[i].intersects(damage[j]));
+    }
+  }
+}
+
+TEST(DamageTracker, Clear) {
+  DamageTracker damage;
+  damage.add(Box(0, 0, 9, 9));
+  damage.clear();
+  EXPECT_FALSE(damage.isDirty());
+  EXPECT_EQ(0, damage.size());
+}
+
+TEST(DamageTracker, ReportedByDrawingContext) {
+  FakeOffscreen<Argb4444> test_screen(40, 30, color::Black);
+  Display display(test_screen);
+  DamageTracker damage;
+  display.setDamageTracker(&damage);
+  {
+    DrawingContext dc(display);
+    dc.draw(FilledRect(1, 2, 3, 4, color::White));
+    // Clipped to the screen.
+    dc.draw(FilledRect(35, 25, 50, 50, color::White));
+    // Entirely out of bounds; not reported.
+    dc.draw(FilledRect(60, 60, 70, 70, color::White));
+  }
+  EXPECT_EQ(2, damage.size());
+  EXPECT_TRUE(damage.intersects(Box(1, 2, 3, 4)));
+  EXPECT_TRUE(damage.intersects(Box(35, 25, 39, 29)));
+  EXPECT_EQ(Box(1, 2, 39, 29), damage.bounds());
+  EXPECT_EQ(3 * 3 + 5 * 5, damage.area());
+}
+
+TEST(DamageTracker, ReportedWithClipBoxAndOffset) {
+  FakeOffscreen<Argb4444> test_screen(40, 30, color::Black);
+  Display display(test_screen);
+  DamageTracker damage;
+  display.setDamageTracker(&damage);
+  {
+    DrawingContext dc(display);
+    dc.setClipBox(0, 0, 9, 9);
+    dc.draw(FilledRect(0, 0, 19, 19, color::White), 5, 5);
+  }
+  EXPECT_EQ(1, damage.size());
+  EXPECT_EQ(Box(5, 5, 9, 9), damage[0]);
+}
+
+TEST(DamageTracker, NotReportedWhenDisabled) {
+  FakeOffscreen<Argb4444> test_screen(40, 30, color::Black);
+  Display display(test_screen);
+  DamageTracker damage;
+  display.setDamageTracker(&damage);
+  display.setDamageTracker(nullptr);
+  {
+    DrawingContext dc(display);
+    dc.draw(FilledRect(1, 2, 3, 4, color::White));
+  }
+  EXPECT_FALSE(damage.isDirty());
+}
+
+}  // namespace roo_display
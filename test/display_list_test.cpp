@@ -0,0 +1,275 @@
+#include "roo_display/composition/display_list.h"
+
+#include <vector>
+
+#include "roo_display.h"
+#include "roo_display/core/offscreen.h"
+#include "roo_display/shape/basic.h"
+#include "roo_display/shape/smooth.h"
+#include "testing.h"
+
+using namespace testing;
+
+namespace roo_display {
+
+namespace {
+
+// Draws a scene that exercises the address-window writes (the offscreen),
+// rect fills (the basic shapes), and semi-transparent spans (the smooth
+// shapes).
+void DrawScene(DrawingContext& dc, const Offscreen<Rgb565>& image) {
+  dc.draw(FilledRect(3, 4, 40, 30, color::Red));
+  dc.draw(FilledCircle::ByRadius(35, 25, 12, color::Blue));
+  dc.draw(SmoothFilledCircle({30.5, 20.3}, 10.2, Color(0x80FF4020)));
+  dc.draw(SmoothThickLine({2, 45}, {66, 3}, 3.5, Color(0x90FFFF00)));
+  dc.draw(Line(0, 0, 69, 49, color::White));
+  dc.draw(image, 45, 5);
+}
+
+void PaintImage(Offscreen<Rgb565>& image) {
+  DrawingContext dc(image);
+  dc.draw(FilledRect(2, 2, 5, 6, color::Yellow));
+}
+
+}  // namespace
+
+TEST(DisplayList, Empty) {
+  RecordingDisplayOutput recorder(70, 50);
+  DisplayList list = recorder.displayList();
+  EXPECT_TRUE(list.valid());
+  EXPECT_TRUE(list.extents().empty());
+  FakeOffscreen<Argb8888> screen(70, 50, color::Black);
+  list.replay(screen);
+  EXPECT_THAT(screen,
+              MatchesContent(RasterOf(FakeOffscreen<Argb8888>(
+                  70, 50, color::Black))));
+}
+
+TEST(DisplayList, Invalid) {
+  const uint8_t data[] = {'X', 'Y', 'Z', 1, 0, 0, 0, 0, 5, 0, 5, 0};
+  DisplayList list(data, sizeof(data));
+  EXPECT_FALSE(list.valid());
+  EXPECT_TRUE(list.extents().empty());
+}
+
+// A truncated recording replays the complete commands, and stops at the cut
+// one.
+TEST(DisplayList, Truncated) {
+  RecordingDisplayOutput recorder(20, 20);
+  recorder.fillRect(BLENDING_MODE_SOURCE, Box(1, 1, 5, 5), color::Red);
+  size_t first_size = recorder.size();
+  recorder.fillRect(BLENDING_MODE_SOURCE, Box(8, 8, 12, 12), color::Blue);
+  std::vector<uint8_t> data(recorder.data(), recorder.data() + recorder.size());
+  FakeOffscreen<Argb8888> expected(20, 20, color::Black);
+  expected.fillRect(BLENDING_MODE_SOURCE, Box(1, 1, 5, 5), color::Red);
+  for (size_t size = first_size; size < data.size(); ++size) {
+    // Exactly-sized copy, so that reading past the end is detectable.
+    std::vector<uint8_t> truncated(data.begin(), data.begin() + size);
+    FakeOffscreen<Argb8888> screen(20, 20, color::Black);
+    DisplayList(truncated.data(), truncated.size()).replay(screen);
+    EXPECT_THAT(screen, MatchesContent(RasterOf(expected))) << size;
+  }
+}
+
+// Any prefix of a recording of all kinds of commands replays safely.
+TEST(DisplayList, TruncatedScene) {
+  Offscreen<Rgb565> image(12, 9, color::DarkGreen);
+  PaintImage(image);
+  RecordingDisplayOutput recorder(70, 50);
+  {
+    Display display(recorder);
+    DrawingContext dc(display);
+    DrawScene(dc, image);
+  }
+  std::vector<uint8_t> data(recorder.data(), recorder.data() + recorder.size());
+  for (size_t size = 0; size < data.size(); ++size) {
+    std::vector<uint8_t> truncated(data.begin(), data.begin() + size);
+    FakeOffscreen<Argb8888> screen(70, 50, color::Black);
+    DisplayList(truncated.data(), truncated.size()).replay(screen);
+  }
+}
+
+TEST(DisplayList, Extents) {
+  RecordingDisplayOutput recorder(70, 50);
+  {
+    Display display(recorder);
+    DrawingContext dc(display);
+    dc.draw(FilledRect(3, 4, 10, 12, color::Red));
+    dc.draw(FilledRect(20, 2, 25, 5, color::Red));
+  }
+  EXPECT_EQ(Box(3, 2, 25, 12), recorder.displayList().extents());
+}
+
+TEST(DisplayList, ReplayMatchesDirectDrawing) {
+  Offscreen<Rgb565> image(12, 9, color::DarkGreen);
+  PaintImage(image);
+  FakeOffscreen<Argb8888> expected(70, 50, Color(0xFF203040));
+  {
+    Display display(expected);
+    DrawingContext dc(display);
+    DrawScene(dc, image);
+  }
+  RecordingDisplayOutput recorder(70, 50);
+  {
+    Display display(recorder);
+    DrawingContext dc(display);
+    DrawScene(dc, image);
+  }
+  FakeOffscreen<Argb8888> replayed(70, 50, Color(0xFF203040));
+  {
+    Display display(replayed);
+    DrawingContext dc(display);
+    dc.draw(recorder.displayList());
+  }
+  EXPECT_THAT(replayed, MatchesContent(RasterOf(expected)));
+}
+
+TEST(DisplayList, TranslatedAndClipped) {
+  Offscreen<Rgb565> image(12, 9, color::DarkGreen);
+  PaintImage(image);
+  const Box clip_box(7, 5, 50, 33);
+  const int16_t dx = 9;
+  const int16_t dy = -4;
+  FakeOffscreen<Argb8888> expected(70, 50, Color(0xFF203040));
+  {
+    Display display(expected);
+    Offscreen<Argb8888> scene(70, 50, color::Transparent);
+    {
+      DrawingContext dc(scene);
+      DrawScene(dc, image);
+    }
+    DrawingContext dc(display);
+    dc.setClipBox(clip_box);
+    dc.draw(scene, dx, dy);
+  }
+  // Records the same composition, so that the blending matches exactly.
+  RecordingDisplayOutput recorder(70, 50);
+  {
+    Display display(recorder);
+    Offscreen<Argb8888> scene(70, 50, color::Transparent);
+    {
+      DrawingContext dc(scene);
+      DrawScene(dc, image);
+    }
+    DrawingContext dc(display);
+    dc.draw(scene);
+  }
+  FakeOffscreen<Argb8888> replayed(70, 50, Color(0xFF203040));
+  {
+    Display display(replayed);
+    DrawingContext dc(display);
+    dc.setClipBox(clip_box);
+    dc.draw(recorder.displayList(), dx, dy);
+  }
+  EXPECT_THAT(replayed, MatchesContent(RasterOf(expected)));
+}
+
+TEST(DisplayList, ClippedAddressWindow) {
+  // Exercises replaying address-window writes that straddle the clip box.
+  Offscreen<Rgb565> image(12, 9, color::DarkGreen);
+  PaintImage(image);
+  RecordingDisplayOutput recorder(12, 9);
+  {
+    Display display(recorder);
+    DrawingContext dc(display);
+    dc.draw(image);
+  }
+  FakeOffscreen<Rgb565> expected(20, 20, color::Black);
+  {
+    Display display(expected);
+    DrawingContext dc(display);
+    dc.setClipBox(5, 4, 9, 15);
+    dc.draw(image, 3, 2);
+  }
+  FakeOffscreen<Rgb565> replayed(20, 20, color::Black);
+  replayed.begin();
+  recorder.displayList().replay(replayed, 3, 2, Box(5, 4, 9, 15));
+  replayed.end();
+  EXPECT_THAT(replayed, MatchesContent(RasterOf(expected)));
+}
+
+TEST(DisplayList, SerializedRoundTrip) {
+  Offscreen<Rgb565> image(12, 9, color::DarkGreen);
+  PaintImage(image);
+  std::vector<uint8_t> serialized;
+  {
+    RecordingDisplayOutput recorder(70, 50);
+    {
+      Display display(recorder);
+      DrawingContext dc(display);
+      DrawScene(dc, image);
+    }
+    serialized.assign(recorder.data(), recorder.data() + recorder.size());
+  }
+  FakeOffscreen<Argb8888> expected(70, 50, Color(0xFF203040));
+  {
+    Display display(expected);
+    DrawingContext dc(display);
+    DrawScene(dc, image);
+  }
+  DisplayList list(serialized.data(), serialized.size());
+  EXPECT_TRUE(list.valid());
+  FakeOffscreen<Argb8888> replayed(70, 50, Color(0xFF203040));
+  {
+    Display display(replayed);
+    DrawingContext dc(display);
+    dc.draw(list);
+  }
+  EXPECT_THAT(replayed, MatchesContent(RasterOf(expected)));
+}
+
+TEST(DisplayList, RecordsAllPrimitives) {
+  RecordingDisplayOutput recorder(20, 20);
+  FakeOffscreen<Argb4444> expected(20, 20, color::Black);
+  Color colors[] = {color::Red, color::Green, color::Blue, color::White,
+                    color::Red, color::Green, color::Blue, color::White};
+  int16_t x0[] = {1, 5, 2};
+  int16_t y0[] = {1, 6, 12};
+  int16_t x1[] = {3, 8, 4};
+  int16_t y1[] = {2, 9, 12};
+  auto draw = [&](DisplayOutput& out) {
+    Color c[8];
+    std::copy(colors, colors + 8, c);
+    out.setAddress(10, 10, 11, 11, BLENDING_MODE_SOURCE);
+    out.write(c, 4);
+    std::copy(colors, colors + 8, c);
+    out.writePixels(BLENDING_MODE_SOURCE, c, x0, y0, 3);
+    out.fillPixels(BLENDING_MODE_SOURCE, color::Yellow, x1, y1, 3);
+    std::copy(colors, colors + 8, c);
+    out.writeRects(BLENDING_MODE_SOURCE, c, x0, y0, x1, y1, 3);
+    out.fillRects(BLENDING_MODE_SOURCE_OVER, Color(0x80FFFFFF), x0, y1, x1,
+                  y1, 3);
+    std::copy(colors, colors + 8, c);
+    // Spans: 3 + 4 + 1 pixels.
+    int16_t sx0[] = {14, 15, 19};
+    int16_t sy[] = {1, 2, 3};
+    int16_t sx1[] = {16, 18, 19};
+    out.writeSpans(BLENDING_MODE_SOURCE, c, sx0, sy, sx1, 3);
+    out.fillSpans(BLENDING_MODE_SOURCE, color::Cyan, sx0, y1, sx1, 3);
+  };
+  expected.begin();
+  draw(expected);
+  expected.end();
+  draw(recorder);
+  FakeOffscreen<Argb4444> replayed(20, 20, color::Black);
+  replayed.begin();
+  recorder.displayList().replay(replayed);
+  replayed.end();
+  EXPECT_THAT(replayed, MatchesContent(RasterOf(expected)));
+}
+
+TEST(DisplayList, Clear) {
+  RecordingDisplayOutput recorder(20, 20);
+  size_t empty_size = recorder.size();
+  {
+    Display display(recorder);
+    DrawingContext dc(display);
+    dc.draw(FilledRect(3, 4, 10, 12, color::Red));
+  }
+  EXPECT_GT(recorder.size(), empty_size);
+  recorder.clear();
+  EXPECT_EQ(empty_size, recorder.size());
+  EXPECT_TRUE(recorder.displayList().extents().empty());
+}
+
+}  // namespace roo_display
@@ -0,0 +1,129 @@
+#include "roo_display/transport/fake_spi.h"
+
+#include "roo_display.h"
+#include "roo_display/driver/ili9341.h"
+#include "roo_display/font/font_adafruit_fixed_5x7.h"
+#include "roo_display/shape/basic.h"
+#include "roo_display/ui/text_label.h"
+#include "testing.h"
+
+using namespace testing;
+
+namespace roo_display {
+
+TEST(FakeSpi, RecordsCommandStream) {
+  FakeSpiBus bus;
+  Ili9341<FakeSpiTransport> device{FakeSpiTransport(bus)};
+  Display display(device);
+  {
+    DrawingContext dc(display);
+    dc.draw(FilledRect(10, 20, 13, 21, color::White));
+  }
+  ASSERT_EQ(3, bus.commands().size());
+  const SpiCommand& caset = bus.commands()[0];
+  EXPECT_EQ(ili9341::CASET, caset.opcode);
+  EXPECT_EQ(4, caset.data_bytes);
+  EXPECT_THAT(caset.params, ElementsAre(0, 10, 0, 13));
+  const SpiCommand& paset = bus.commands()[1];
+  EXPECT_EQ(ili9341::PASET, paset.opcode);
+  EXPECT_THAT(paset.params, ElementsAre(0, 20, 0, 21));
+  const SpiCommand& ramwr = bus.commands()[2];
+  EXPECT_EQ(ili9341::RAMWR, ramwr.opcode);
+  EXPECT_EQ(4 * 2 * 2, ramwr.data_bytes);
+  EXPECT_THAT(ramwr.params, Each(0xFF));
+
+  EXPECT_EQ(3, bus.totalCommands());
+  EXPECT_EQ(1, bus.commandCount(ili9341::CASET));
+  EXPECT_EQ(3 + 4 + 4 + 16, bus.bytes());
+  EXPECT_EQ(4 + 4 + 16, bus.dataBytes());
+  EXPECT_EQ(1, bus.transactions());
+}
+
+TEST(FakeSpi, ReusesAddressWindowCoordinates) {
+  FakeSpiBus bus;
+  Ili9341<FakeSpiTransport> device{FakeSpiTransport(bus)};
+  Display display(device);
+  {
+    DrawingContext dc(display);
+    // Same columns; only the rows change.
+    dc.draw(FilledRect(10, 20, 13, 21, color::White));
+    dc.draw(FilledRect(10, 30, 13, 31, color::White));
+  }
+  EXPECT_EQ(1, bus.commandCount(ili9341::CASET));
+  EXPECT_EQ(2, bus.commandCount(ili9341::PASET));
+  EXPECT_EQ(2, bus.commandCount(ili9341::RAMWR));
+}
+
+TEST(FakeSpi, CountsAddressWindowsPerGlyph) {
+  FakeSpiBus bus;
+  Ili9341<FakeSpiTransport> device{FakeSpiTransport(bus)};
+  Display display(device);
+  {
+    DrawingContext dc(display);
+    FontAdafruitFixed5x7 font;
+    dc.draw(TextLabel("Hi", font, color::White), kLeft | kTop);
+  }
+  // Golden values; a change means that the address window strategy for
+  // glyphs has changed.
+  EXPECT_EQ(8, bus.commandCount(ili9341::CASET));
+  EXPECT_EQ(8, bus.commandCount(ili9341::PASET));
+  EXPECT_EQ(10, bus.commandCount(ili9341::RAMWR));
+}
+
+TEST(FakeSpi, EstimatesWireTime) {
+  // 8 MHz: 1 us per byte.
+  FakeSpiBus bus(SpiCostModel(8000000, 0, 0, 0));
+  FakeSpiTransport transport(bus);
+  uint8_t data[100] = {0};
+  transport.beginTransaction();
+  transport.begin();
+  transport.writeBytes(data, 100);
+  transport.fill16be(0, 50);
+  transport.end();
+  transport.endTransaction();
+  EXPECT_EQ(200, bus.bytes());
+  EXPECT_EQ(200000, bus.estimatedWireTimeNs());
+
+  bus = FakeSpiBus(SpiCostModel(8000000, 1000, 100, 10));
+  transport = FakeSpiTransport(bus);
+  transport.beginTransaction();
+  transport.begin();
+  transport.cmdBegin();
+  transport.write(0x2C);
+  transport.cmdEnd();
+  transport.writeBytes(data, 100);
+  transport.end();
+  transport.endTransaction();
+  // 101 bytes; 1 transaction; 2 calls; 4 toggles (CS, DC).
+  EXPECT_EQ(2, bus.calls());
+  EXPECT_EQ(4, bus.gpioToggles());
+  EXPECT_EQ(101000 + 1000 + 200 + 40, bus.estimatedWireTimeNs());
+}
+
+TEST(FakeSpi, Reset) {
+  FakeSpiBus bus;
+  FakeSpiTransport transport(bus);
+  transport.cmdBegin();
+  transport.write(0x2A);
+  transport.cmdEnd();
+  transport.write16x2(1, 2);
+  bus.reset();
+  EXPECT_EQ(0, bus.bytes());
+  EXPECT_EQ(0, bus.totalCommands());
+  EXPECT_EQ(0, bus.commandCount(0x2A));
+  EXPECT_TRUE(bus.commands().empty());
+}
+
+TEST(FakeSpi, CommandLoggingDisabled) {
+  FakeSpiBus bus(SpiCostModel(), false);
+  FakeSpiTransport transport(bus);
+  transport.cmdBegin();
+  transport.write(0x2A);
+  transport.cmdEnd();
+  transport.write16x2(1, 2);
+  EXPECT_TRUE(bus.commands().empty());
+  EXPECT_EQ(1, bus.commandCount(0x2A));
+  EXPECT_EQ(5, bus.bytes());
+}
+
+}  // namespace roo_display
@@ -0,0 +1,147 @@
+#include "roo_display/color/gradient.h"
+
+#include <cstdlib>
+#include <vector>
+
+#include "testing.h"
+
+using namespace testing;
+
+namespace roo_display {
+
+// Returns the maximum per-channel difference between the colors.
+int ColorDistance(Color a, Color b) {
+  return std::max(std::max(std::abs(a.a() - b.a()), std::abs(a.r() - b.r())),
+                  std::max(std::abs(a.g() - b.g()), std::abs(a.b() - b.b())));
+}
+
+ColorGradient MakeGradient(ColorGradient::Boundary boundary) {
+  // Periodic gradients wrap around seamlessly, so that the quantization of the
+  // value doesn't matter at the period boundaries.
+  return ColorGradient(
+      {{-20, color::Red},
+       {30, Color(0x8000FF00)},
+       {80, boundary == ColorGradient::PERIODIC ? color::Red : color::Blue}},
+      boundary);
+}
+
+TEST(ColorGradient, BakedApproximatesInterpolated) {
+  for (auto boundary : {ColorGradient::EXTENDED, ColorGradient::TRUNCATED,
+                        ColorGradient::PERIODIC}) {
+    ColorGradient exact = MakeGradient(boundary);
+    ColorGradient baked = MakeGradient(boundary);
+    baked.bake(1024);
+    EXPECT_TRUE(baked.baked());
+    EXPECT_FALSE(exact.baked());
+    for (float v = -300; v <= 300; v += 0.37f) {
+      // Skip the fade-out margins of truncated gradients, which are steep.
+      if (boundary == ColorGradient::TRUNCATED &&
+          (std::abs(v + 20) < 1.5f || std::abs(v - 80) < 1.5f)) {
+        continue;
+      }
+      EXPECT_LE(ColorDistance(exact.getColor(v), baked.getColor(v)), 2)
+          << boundary << " " << v;
+    }
+  }
+}
+
+TEST(ColorGradient, BakedBoundaries) {
+  ColorGradient extended = MakeGradient(ColorGradient::EXTENDED).bake();
+  EXPECT_EQ(color::Red, extended.getColor(-1000));
+  EXPECT_EQ(color::Blue, extended.getColor(1000));
+  EXPECT_EQ(color::Red, extended.lookup(-(1LL << 46)));
+  EXPECT_EQ(color::Blue, extended.lookup(1LL << 46));
+
+  ColorGradient truncated = MakeGradient(ColorGradient::TRUNCATED).bake();
+  EXPECT_EQ(color::Transparent, truncated.getColor(-1000));
+  EXPECT_EQ(color::Transparent, truncated.getColor(1000));
+
+  ColorGradient periodic = MakeGradient(ColorGradient::PERIODIC).bake();
+  for (float v = -17.5f; v < 80; v += 2.5f) {
+    EXPECT_EQ(periodic.getColor(v), periodic.getColor(v + 100)) << v;
+    EXPECT_EQ(periodic.getColor(v), periodic.getColor(v - 300)) << v;
+  }
+}
+
+TEST(ColorGradient, BakeRequiresNonEmptyDomain) {
+  ColorGradient gradient({{5, color::Red}});
+  gradient.bake();
+  EXPECT_FALSE(gradient.baked());
+  EXPECT_EQ(color::Red, gradient.getColor(3));
+}
+
+// Checks that all read methods of the rasterizable agree with each other.
+void CheckConsistentReads(const Rasterizable& input, const Box& box) {
+  int16_t w = box.width();
+  std::vector<int16_t> xs, ys;
+  for (int16_t y = box.yMin(); y <= box.yMax(); ++y) {
+    for (int16_t x = box.xMin(); x <= box.xMax(); ++x) {
+      xs.push_back(x);
+      ys.push_back(y);
+    }
+  }
+  std::vector<Color> expected(box.area()), actual(box.area());
+  input.readColors(&xs[0], &ys[0], box.area(), &expected[0]);
+  for (int16_t y = box.yMin(); y <= box.yMax(); ++y) {
+    input.readColorRow(y, box.xMin(), box.xMax(),
+                       &actual[(y - box.yMin()) * w]);
+  }
+  EXPECT_THAT(actual, ElementsAreArray(expected));
+  if (input.readColorRect(box.xMin(), box.yMin(), box.xMax(), box.yMax(),
+                          &actual[0])) {
+    FillColor(&actual[0], box.area(), actual[0]);
+  }
+  EXPECT_THAT(actual, ElementsAreArray(expected));
+}
+
+// Checks that the baked rasterizable closely approximates the exact one.
+void CheckApproximates(const Rasterizable& exact, const Rasterizable& baked,
+                       const Box& box) {
+  for (int16_t y = box.yMin(); y <= box.yMax(); ++y) {
+    std::vector<Color> expected(box.width()), actual(box.width());
+    exact.readColorRow(y, box.xMin(), box.xMax(), &expected[0]);
+    baked.readColorRow(y, box.xMin(), box.xMax(), &actual[0]);
+    for (int16_t i = 0; i < box.width(); ++i) {
+      ASSERT_LE(ColorDistance(expected[i], actual[i]), 3)
+          << (box.xMin() + i) << ", " << y;
+    }
+  }
+}
+
+TEST(LinearGradient, Baked) {
+  Box box(-30, -20, 89, 59);
+  for (auto boundary : {ColorGradient::EXTENDED, ColorGradient::PERIODIC}) {
+    for (float dx : {0.0f, 1.0f, 0.63f, -2.1f}) {
+      for (float dy : {0.0f, 1.0f, 0.41f}) {
+        LinearGradient exact({5, 7}, dx, dy, MakeGradient(boundary));
+        LinearGradient baked({5, 7}, dx, dy,
+                             MakeGradient(boundary).bake(1024));
+        CheckConsistentReads(baked, box);
+        CheckApproximates(exact, baked, box);
+      }
+    }
+  }
+}
+
+TEST(RadialGradientSq, Baked) {
+  Box box(-30, -20, 89, 59);
+  ColorGradient gradient({{0, color::White}, {2500, color::Navy}});
+  RadialGradientSq exact({25, 15}, gradient);
+  RadialGradientSq baked({25, 15}, ColorGradient(gradient).bake(1024));
+  CheckConsistentReads(baked, box);
+  CheckApproximates(exact, baked, box);
+}
+
+TEST(RadialGradient, Baked) {
+  Box box(-30, -20, 89, 59);
+  for (FpPoint center : {FpPoint{25, 15}, FpPoint{-3.3f, 40.7f}}) {
+    ColorGradient gradient(
+        {{0, color::White}, {20, color::Red}, {40, color::Navy}});
+    RadialGradient exact(center, gradient);
+    RadialGradient baked(center, ColorGradient(gradient).bake(1024));
+    CheckConsistentReads(baked, box);
+    CheckApproximates(exact, baked, box);
+  }
+}
+
+}  // namespace roo_display
@@ -0,0 +1,149 @@
+#include "roo_display/filter/instrumented.h"
+
+#include "roo_display.h"
+#include "roo_display/shape/basic.h"
+#include "roo_display/ui/string_printer.h"
+#include "testing.h"
+
+using namespace testing;
+
+namespace roo_display {
+
+typedef DisplayOutputStats Stats;
+
+TEST(DisplayOutputStats, Bucket) {
+  EXPECT_EQ(0, Stats::Bucket(0));
+  EXPECT_EQ(0, Stats::Bucket(1));
+  EXPECT_EQ(1, Stats::Bucket(2));
+  EXPECT_EQ(1, Stats::Bucket(3));
+  EXPECT_EQ(2, Stats::Bucket(4));
+  EXPECT_EQ(6, Stats::Bucket(64));
+  EXPECT_EQ(Stats::kHistogramBuckets - 1, Stats::Bucket(0xFFFFFFFFFFull));
+}
+
+TEST(InstrumentedDisplayOutput, CountsCallsAndPixels) {
+  int16_t x0[] = {1, 5};
+  int16_t y0[] = {1, 6};
+  int16_t x1[] = {3, 8};
+  int16_t y1[] = {2, 9};
+  auto draw = [&](DisplayOutput& out) {
+    Color colors[] = {color::Red, color::Green, color::Blue, color::White};
+    out.begin();
+    out.setAddress(10, 10, 11, 11, BLENDING_MODE_SOURCE);
+    out.write(colors, 4);
+    out.writePixels(BLENDING_MODE_SOURCE_OVER, colors, x0, y0, 2);
+    out.fillPixels(BLENDING_MODE_SOURCE_OVER, color::Red, x0, y0, 2);
+    out.writeRects(BLENDING_MODE_SOURCE, colors, x0, y0, x1, y1, 2);
+    out.fillRects(BLENDING_MODE_SOURCE, color::Red, x0, y0, x1, y1, 2);
+    out.writeSpans(BLENDING_MODE_SOURCE, colors, x0, y0, x0, 2);
+    out.fillSpans(BLENDING_MODE_SOURCE, color::Red, x0, y1, x1, 2);
+    out.end();
+  };
+  FakeOffscreen<Rgb565> expected(20, 20, color::Black);
+  draw(expected);
+  FakeOffscreen<Rgb565> screen(20, 20, color::Black);
+  InstrumentedDisplayOutput out(screen);
+  draw(out);
+
+  const Stats& stats = out.stats();
+  EXPECT_EQ(1, stats.calls(Stats::SET_ADDRESS));
+  EXPECT_EQ(4, stats.pixels(Stats::SET_ADDRESS));
+  EXPECT_EQ(1, stats.calls(Stats::WRITE));
+  EXPECT_EQ(4, stats.pixels(Stats::WRITE));
+  EXPECT_EQ(1, stats.calls(Stats::WRITE_PIXELS));
+  EXPECT_EQ(2, stats.pixels(Stats::WRITE_PIXELS));
+  EXPECT_EQ(1, stats.calls(Stats::FILL_PIXELS));
+  EXPECT_EQ(2, stats.pixels(Stats::FILL_PIXELS));
+  EXPECT_EQ(1, stats.calls(Stats::WRITE_RECTS));
+  EXPECT_EQ(3 * 2 + 4 * 4, stats.pixels(Stats::WRITE_RECTS));
+  EXPECT_EQ(1, stats.calls(Stats::FILL_RECTS));
+  EXPECT_EQ(3 * 2 + 4 * 4, stats.pixels(Stats::FILL_RECTS));
+  EXPECT_EQ(1, stats.calls(Stats::WRITE_SPANS));
+  EXPECT_EQ(2, stats.pixels(Stats::WRITE_SPANS));
+  EXPECT_EQ(1, stats.calls(Stats::FILL_SPANS));
+  EXPECT_EQ(3 + 4, stats.pixels(Stats::FILL_SPANS));
+  EXPECT_EQ(8, stats.totalCalls());
+  EXPECT_EQ(4 + 2 + 2 + 22 + 22 + 2 + 7, stats.totalPixels());
+
+  // write() is attributed to the address window's blending mode.
+  EXPECT_EQ(6, stats.blendingModeCalls(BLENDING_MODE_SOURCE));
+  EXPECT_EQ(2, stats.blendingModeCalls(BLENDING_MODE_SOURCE_OVER));
+
+  EXPECT_EQ(1, stats.batchSizeHistogram(Stats::WRITE, 2));
+  EXPECT_EQ(1, stats.batchSizeHistogram(Stats::WRITE_PIXELS, 1));
+  // The address window (4), and two rects each from writeRects and fillRects
+  // (6 and 16).
+  EXPECT_EQ(3, stats.rectAreaHistogram(2));
+  EXPECT_EQ(2, stats.rectAreaHistogram(4));
+  EXPECT_EQ(1, stats.addressWindowSwitches());
+
+  // The calls are forwarded.
+  EXPECT_THAT(screen, MatchesContent(RasterOf(expected)));
+}
+
+TEST(InstrumentedDisplayOutput, AddressWindowSwitches) {
+  FakeOffscreen<Rgb565> screen(20, 20, color::Black);
+  InstrumentedDisplayOutput out(screen);
+  out.begin();
+  out.setAddress(0, 0, 3, 3, BLENDING_MODE_SOURCE);
+  out.setAddress(0, 0, 3, 3, BLENDING_MODE_SOURCE);
+  out.setAddress(0, 0, 3, 4, BLENDING_MODE_SOURCE);
+  out.setAddress(0, 0, 3, 4, BLENDING_MODE_SOURCE_OVER);
+  out.end();
+  EXPECT_EQ(4, out.stats().calls(Stats::SET_ADDRESS));
+  EXPECT_EQ(3, out.stats().addressWindowSwitches());
+}
+
+TEST(InstrumentedDisplayOutput, SnapshotAndReset) {
+  FakeOffscreen<Rgb565> screen(20, 20, color::Black);
+  InstrumentedDisplayOutput out(screen);
+  int16_t x[] = {1};
+  int16_t y[] = {1};
+  out.begin();
+  out.fillPixels(BLENDING_MODE_SOURCE, color::Red, x, y, 1);
+  Stats snapshot = out.snapshot();
+  out.fillPixels(BLENDING_MODE_SOURCE, color::Red, x, y, 1);
+  out.end();
+  EXPECT_EQ(1, snapshot.calls(Stats::FILL_PIXELS));
+  EXPECT_EQ(2, out.stats().calls(Stats::FILL_PIXELS));
+  out.reset();
+  EXPECT_EQ(0, out.stats().totalCalls());
+  EXPECT_EQ(0, out.stats().addressWindowSwitches());
+  EXPECT_EQ(0, out.stats().blendingModeCalls(BLENDING_MODE_SOURCE));
+}
+
+TEST(InstrumentedDisplayDevice, WrapsDisplay) {
+  FakeOffscreen<Rgb565> screen(20, 10, color::Black);
+  InstrumentedDisplayDevice device(screen);
+  Display display(device);
+  EXPECT_EQ(20, display.width());
+  EXPECT_EQ(10, display.height());
+  {
+    DrawingContext dc(display);
+    dc.draw(FilledRect(1, 1, 4, 3, color::White));
+  }
+  EXPECT_EQ(1, device.stats().calls(Stats::FILL_RECTS));
+  EXPECT_EQ(12, device.stats().pixels(Stats::FILL_RECTS));
+  EXPECT_EQ(12, device.stats().totalPixels());
+}
+
+TEST(DisplayOutputStats, Print) {
+  FakeOffscreen<Rgb565> screen(20, 20, color::Black);
+  InstrumentedDisplayOutput out(screen);
+  int16_t x0[] = {1};
+  int16_t y0[] = {1};
+  int16_t x1[] = {4};
+  int16_t y1[] = {4};
+  out.begin();
+  out.fillRects(BLENDING_MODE_SOURCE_OVER, color::Red, x0, y0, x1, y1, 1);
+  out.end();
+  StringPrinter printer;
+  out.stats().print(printer);
+  const std::string& dump = printer.get();
+  EXPECT_THAT(dump, HasSubstr("fillRects"));
+  EXPECT_THAT(dump, HasSubstr("SOURCE_OVER:1"));
+  EXPECT_THAT(dump, HasSubstr("[16-31]:1"));
+  EXPECT_THAT(dump, Not(HasSubstr("writePixels")));
+}
+
+}  // namespace roo_display
@@ -3,6 +3,7 @@
 
 #include <memory>
 #include <random>
+#include <vector>
 
 #include "gtest/gtest-param-test.h"
 #include "roo_display.h"
@@ -726,6 +727,22 @@ TEST_P(OffscreenTest, WritePixelsSnake) {
                                                 std::get<1>(GetParam()));
 }
 
+TEST_P(OffscreenTest, FillSpans) {
+  TestFillSpans<OffscreenDeviceForTest<Argb4444>, FakeOffscreen<Argb4444>>(
+      std::get<0>(GetParam()), std::get<1>(GetParam()));
+}
+
+TEST_P(OffscreenTest, WriteSpans) {
+  TestWriteSpans<OffscreenDeviceForTest<Argb4444>, FakeOffscreen<Argb4444>>(
+      std::get<0>(GetParam()), std::get<1>(GetParam()));
+}
+
+TEST_P(OffscreenTest, WriteSpansStress) {
+  TestWriteSpansStress<OffscreenDeviceForTest<Argb4444>,
+                       FakeOffscreen<Argb4444>>(std::get<0>(GetParam()),
+                                                std::get<1>(GetParam()));
+}
+
 TEST_P(OffscreenTest, WriteRectWindowSimple) {
   TestWriteRectWindowSimple<OffscreenDeviceForTest<Argb4444>,
                             FakeOffscreen<Argb4444>>(std::get<0>(GetParam()),
@@ -876,4 +893,32 @@ TEST_F(OffscreenTest, DrawingOffscreenRasterizable) {
                                           "*************"));
 }
 
+// Address windows in XY-swapped orientations advance by whole raw rows; large
+// windows must not overflow the advance offsets.
+TEST(Offscreen, LargeSwappedAddressWindow) {
+  const int16_t w = 200, h = 180;
+  Offscreen<Grayscale8> actual(w, h, color::Black);
+  Offscreen<Grayscale8> expected(w, h, color::Black);
+  Orientation orientation = Orientation::RightDown().swapXY();
+  actual.output().setOrientation(orientation);
+  expected.output().setOrientation(orientation);
+  std::vector<Color> colors;
+  std::vector<int16_t> xs, ys;
+  for (int16_t y = 0; y < w; ++y) {
+    for (int16_t x = 0; x < h; ++x) {
+      colors.push_back(Color(0xFF000000 | ((x + y) & 0xFF) * 0x010101));
+      xs.push_back(x);
+      ys.push_back(y);
+    }
+  }
+  actual.output().setAddress(0, 0, h - 1, w - 1, BLENDING_MODE_SOURCE);
+  actual.output().write(&colors[0], w * h);
+  for (uint32_t i = 0; i < colors.size(); i += 1000) {
+    uint16_t n = std::min<uint32_t>(1000, colors.size() - i);
+    expected.output().writePixels(BLENDING_MODE_SOURCE, &colors[i], &xs[i],
+                                  &ys[i], n);
+  }
+  EXPECT_EQ(0, memcmp(expected.buffer(), actual.buffer(), w * h));
+}
+
 }  // namespace roo_display
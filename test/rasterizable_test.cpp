@@ -1,7 +1,16 @@
 
 #include "roo_display/core/rasterizable.h"
 
+#include <random>
+
 #include "roo_display/color/color.h"
+#include "roo_display/color/gradient.h"
+#include "roo_display/composition/rasterizable_stack.h"
+#include "roo_display/core/offscreen.h"
+#include "roo_display/filter/instrumented.h"
+#include "roo_display/shape/basic.h"
+#include "roo_display/shape/shadow.h"
+#include "roo_display/shape/smooth.h"
 #include "testing.h"
 
 // Tests drawing and clipping rasterizables via their default drawTo method, and
@@ -119,4 +128,170 @@ TEST(Rasterizable, SimpleFilledCircleClippedAsStreamable) {
                                           "         "));
 }
 
+// Uniform tiles, and uniform parts of non-uniform tiles, get merged into large
+// rectangles; only the remaining pixels are written.
+TEST(Rasterizable, MergesUniformTiles) {
+  auto getter = [](int16_t x, int16_t y) -> Color {
+    return x < 20 ? color::Red : x == 20 ? Color(0xFF800080) : color::Blue;
+  };
+  auto input = MakeRasterizable(Box(0, 0, 63, 47), getter, TRANSPARENCY_NONE);
+  FakeOffscreen<Argb8888> test_screen(64, 48, color::Black);
+  InstrumentedDisplayOutput out(test_screen);
+  out.begin();
+  Surface s(out, 0, 0, Box(0, 0, 63, 47), false, color::Transparent,
+            FILL_MODE_RECTANGLE, BLENDING_MODE_SOURCE);
+  s.drawObject(input);
+  out.end();
+  const DisplayOutputStats& stats = out.stats();
+  // Red (0-19) and blue (24-63); the 4-pixel-wide column containing the edge
+  // is written.
+  EXPECT_EQ(2, stats.calls(DisplayOutputStats::FILL_RECTS));
+  EXPECT_EQ(48 * 4, stats.pixels(DisplayOutputStats::WRITE));
+  for (int16_t y = 0; y < 48; ++y) {
+    for (int16_t x = 0; x < 64; ++x) {
+      ASSERT_EQ(getter(x, y), test_screen.buffer()[y * 64 + x])
+          << x << ", " << y;
+    }
+  }
+}
+
+// The tile-based drawTo gives the same result as drawing via the stream, for
+// all combinations of fill modes, blending modes, and backgrounds.
+TEST(Rasterizable, TiledDrawingMatchesStream) {
+  std::mt19937 gen(17);
+  const Color palette[] = {color::Red, color::Blue, color::Transparent,
+                           Color(0x80FF8000), Color(0x4000FF00)};
+  std::vector<Color> blocks(8 * 8);
+  for (Color& c : blocks) c = palette[gen() % 5];
+  // Blocks of varying sizes, not aligned to tiles, with a few random pixels.
+  auto input = MakeRasterizable(
+      Box(0, 0, 59, 49), [&blocks](int16_t x, int16_t y) -> Color {
+        if ((x * 7 + y * 13) % 61 == 0) return Color(0xFF123456);
+        return blocks[(y / 7) * 8 + (x / 9)];
+      });
+  for (FillMode fill_mode : {FILL_MODE_RECTANGLE, FILL_MODE_VISIBLE}) {
+    for (BlendingMode blending_mode :
+         {BLENDING_MODE_SOURCE, BLENDING_MODE_SOURCE_OVER}) {
+      for (Color bgcolor :
+           {color::Transparent, color::White, Color(0x80808080)}) {
+        for (const Box& clip : {Box(0, 0, 69, 59), Box(5, 3, 44, 28),
+                                Box(10, 10, 15, 12)}) {
+          FakeOffscreen<Argb8888> expected(70, 60, color::Black);
+          FakeOffscreen<Argb8888> actual(70, 60, color::Black);
+          Draw(expected, 3, 5, clip, ForcedStreamable(&input), fill_mode,
+               blending_mode, bgcolor);
+          Draw(actual, 3, 5, clip, input, fill_mode, blending_mode, bgcolor);
+          EXPECT_EQ(0, memcmp(expected.buffer(), actual.buffer(),
+                              70 * 60 * sizeof(Color)))
+              << fill_mode << " " << blending_mode << " " << bgcolor << " "
+              << clip;
+        }
+      }
+    }
+  }
+}
+
+// The default readColorRow and readColorRect process arbitrarily large areas in
+// bounded chunks.
+TEST(Rasterizable, ReadLargeRect) {
+  auto getter = [](int16_t x, int16_t y) -> Color {
+    return Color(0xFF000000 | ((x * 0x10305) ^ (y * 0x7011)));
+  };
+  auto input = MakeRasterizable(Box(-300, -20, 299, 179), getter);
+  std::vector<Color> result(600 * 200);
+  EXPECT_FALSE(input.readColorRect(-300, -20, 299, 179, &result[0]));
+  for (int16_t y = -20; y < 180; ++y) {
+    for (int16_t x = -300; x < 300; ++x) {
+      ASSERT_EQ(getter(x, y), result[(y + 20) * 600 + x + 300])
+          << x << ", " << y;
+    }
+  }
+  auto uniform = MakeRasterizable(
+      Box(0, 0, 999, 99), [](int16_t x, int16_t y) { return color::Red; });
+  EXPECT_TRUE(uniform.readColorRect(0, 0, 999, 99, &result[0]));
+  EXPECT_EQ(color::Red, result[0]);
+
+  // Streams, spanning multiple rows per read.
+  std::unique_ptr<PixelStream> stream =
+      input.createStream(Box(-5, 3, 94, 12));
+  std::vector<Color> streamed(100 * 10);
+  stream->Read(&streamed[0], 7);
+  stream->Read(&streamed[7], 250);
+  stream->Skip(100);
+  stream->Read(&streamed[357], 643);
+  for (int16_t y = 3; y <= 12; ++y) {
+    for (int16_t x = -5; x <= 94; ++x) {
+      int i = (y - 3) * 100 + x + 5;
+      if (i >= 257 && i < 357) continue;
+      ASSERT_EQ(getter(x, y), streamed[i]) << x << ", " << y;
+    }
+  }
+}
+
+// Checks that readColorRow returns the same colors as readColors, for all rows
+// of the specified box, both in full and in part.
+void CheckReadColorRow(const Rasterizable& input, const Box& box) {
+  int16_t w = box.width();
+  std::vector<int16_t> xs(w), ys(w);
+  std::vector<Color> expected(w), actual(w);
+  for (int16_t y = box.yMin(); y <= box.yMax(); ++y) {
+    for (int16_t i = 0; i < w; ++i) {
+      xs[i] = box.xMin() + i;
+      ys[i] = y;
+    }
+    input.readColors(&xs[0], &ys[0], w, &expected[0]);
+    input.readColorRow(y, box.xMin(), box.xMax(), &actual[0]);
+    ASSERT_THAT(actual, ElementsAreArray(expected)) << y;
+    input.readColorRow(y, box.xMin() + 3, box.xMax() - 2, &actual[0]);
+    ASSERT_THAT(std::vector<Color>(actual.begin(), actual.end() - 5),
+                ElementsAreArray(expected.begin() + 3, expected.end() - 2))
+        << y;
+  }
+}
+
+TEST(Rasterizable, ReadColorRow) {
+  Box box(-10, -5, 69, 54);
+  Offscreen<Argb4444> offscreen(box, color::Transparent);
+  {
+    DrawingContext dc(offscreen);
+    dc.draw(SmoothFilledCircle({30, 25}, 20, color::Red));
+  }
+  CheckReadColorRow(offscreen, box);
+  CheckReadColorRow(offscreen.raster(), box);
+  CheckReadColorRow(FilledRect(box, color::Blue), box);
+
+  ColorGradient gradient({{0, color::Red}, {30, color::Blue},
+                          {45, Color(0x8000FF00)}});
+  CheckReadColorRow(LinearGradient({3, 4}, 0.7f, 0.0f, gradient), box);
+  CheckReadColorRow(LinearGradient({3, 4}, 0.0f, 1.0f, gradient), box);
+  CheckReadColorRow(LinearGradient({3, 4}, 0.7f, -0.3f, gradient), box);
+  CheckReadColorRow(RadialGradient({20.5f, 10.2f}, gradient), box);
+  CheckReadColorRow(
+      RadialGradientSq({20, 10},
+                       ColorGradient({{0, color::Red}, {900, color::Blue}})),
+      box);
+  CheckReadColorRow(AngularGradient({20.5f, 10.2f},
+                                    ColorGradient({{-M_PI, color::Red},
+                                                   {M_PI, color::Blue}})),
+                    box);
+
+  CheckReadColorRow(SmoothThickLine({0, 0}, {50, 30}, 5.5f, color::Red), box);
+  CheckReadColorRow(
+      SmoothThickRoundRect(2, 3, 45, 40, 8, 3, color::Red, color::Blue), box);
+  CheckReadColorRow(SmoothThickArcWithBackground({30, 25}, 20, 4, 0.3f, 2.5f,
+                                                 color::Red, color::Gray,
+                                                 color::Blue),
+                    box);
+  CheckReadColorRow(
+      SmoothFilledTriangle({0, 0}, {50, 10}, {20, 45}, color::Red), box);
+  CheckReadColorRow(
+      RoundRectShadow(Box(10, 10, 40, 30), color::Black, 6, 2, 3, 5), box);
+
+  FilledRect rect(Box(5, 5, 19, 19), Color(0x800000FF));
+  RasterizableStack stack(box);
+  stack.addInput(&offscreen);
+  stack.addInput(&rect, 10, 20);
+  CheckReadColorRow(stack, box);
+}
+
 }  // namespace roo_display
@@ -0,0 +1,190 @@
+#include <random>
+#include <vector>
+
+#include "roo_display/color/raw_pixel_format.h"
+#include "roo_display/core/offscreen.h"
+#include "roo_display/core/raster.h"
+#include "roo_display/driver/ili9341.h"
+#include "roo_display/filter/instrumented.h"
+#include "roo_display/image/image.h"
+#include "roo_display/io/memory.h"
+#include "roo_display/transport/fake_spi.h"
+#include "testing.h"
+
+using namespace testing;
+
+namespace roo_display {
+
+// Counts the pixels that arrive via the raw path.
+class RawCountingOutput : public InstrumentedDisplayOutput {
+ public:
+  RawCountingOutput(DisplayOutput& output)
+      : InstrumentedDisplayOutput(output), raw_pixels_(0) {}
+
+  void writeRaw(const uint8_t* data, uint32_t pixel_count) override {
+    raw_pixels_ += pixel_count;
+    InstrumentedDisplayOutput::writeRaw(data, pixel_count);
+  }
+
+  uint32_t raw_pixels() const { return raw_pixels_; }
+
+ private:
+  uint32_t raw_pixels_;
+};
+
+// Draws the object to the output, returning the number of pixels that went
+// through the raw path.
+uint32_t Draw(DisplayOutput& output, int16_t dx, int16_t dy, const Box& clip,
+              const Drawable& object,
+              BlendingMode blending_mode = BLENDING_MODE_SOURCE_OVER,
+              FillMode fill_mode = FILL_MODE_VISIBLE,
+              Color bgcolor = color::Transparent) {
+  RawCountingOutput counting(output);
+  counting.begin();
+  Surface s(counting, dx, dy, clip, false, bgcolor, fill_mode, blending_mode);
+  s.drawObject(object);
+  counting.end();
+  return counting.raw_pixels();
+}
+
+// Returns random pixel data, as well as the same data with the bytes of each
+// pixel reversed.
+void RandomData(int bytes_per_pixel, int pixel_count, std::vector<uint8_t>& be,
+                std::vector<uint8_t>& le) {
+  std::mt19937 gen(17);
+  be.resize(bytes_per_pixel * pixel_count);
+  le.resize(bytes_per_pixel * pixel_count);
+  for (int i = 0; i < pixel_count; ++i) {
+    for (int j = 0; j < bytes_per_pixel; ++j) {
+      uint8_t b = gen();
+      be[i * bytes_per_pixel + j] = b;
+      le[i * bytes_per_pixel + bytes_per_pixel - 1 - j] = b;
+    }
+  }
+}
+
+TEST(RawPixelFormat, Matching) {
+  EXPECT_EQ((RawPixelFormatOf<Rgb565, BYTE_ORDER_BIG_ENDIAN>()),
+            (RawPixelFormatOf<Rgb565, BYTE_ORDER_BIG_ENDIAN>()));
+  EXPECT_NE((RawPixelFormatOf<Rgb565, BYTE_ORDER_BIG_ENDIAN>()),
+            (RawPixelFormatOf<Rgb565, BYTE_ORDER_LITTLE_ENDIAN>()));
+  EXPECT_NE((RawPixelFormatOf<Rgb565, BYTE_ORDER_BIG_ENDIAN>()),
+            (RawPixelFormatOf<Argb4444, BYTE_ORDER_BIG_ENDIAN>()));
+  EXPECT_EQ((RawPixelFormatOf<Grayscale8, BYTE_ORDER_BIG_ENDIAN>()),
+            (RawPixelFormatOf<Grayscale8, BYTE_ORDER_LITTLE_ENDIAN>()));
+  EXPECT_EQ(2, (RawPixelFormatOf<Rgb565, BYTE_ORDER_BIG_ENDIAN>()
+                    .bytes_per_pixel()));
+  // Stateful and sub-byte color modes are not supported.
+  EXPECT_FALSE((RawPixelFormatOf<Alpha8, BYTE_ORDER_BIG_ENDIAN>().valid()));
+  EXPECT_FALSE(
+      (RawPixelFormatOf<Rgb565WithTransparency, BYTE_ORDER_BIG_ENDIAN>()
+           .valid()));
+  EXPECT_FALSE((RawPixelFormatOf<Grayscale4, BYTE_ORDER_BIG_ENDIAN>().valid()));
+  EXPECT_NE(RawPixelFormat(), RawPixelFormat());
+}
+
+// Draws a raster in the matching format (taking the raw path), and the same
+// content in a non-matching byte order (taking the conversion path), at
+// various positions and clip boxes, and under all orientations, verifying that
+// the results are identical.
+TEST(RawPixels, RasterRgb565ToOffscreen) {
+  const int16_t w = 13, h = 7;
+  std::vector<uint8_t> be, le;
+  RandomData(2, w * h, be, le);
+  RasterRgb565<const uint8_t*> raw(w, h, &be[0]);
+  RasterRgb565<const uint8_t*, BYTE_ORDER_LITTLE_ENDIAN> converted(w, h,
+                                                                   &le[0]);
+  const Box clips[] = {Box(0, 0, 19, 19), Box(3, 2, 12, 8), Box(5, 0, 6, 19)};
+  for (Orientation orientation :
+       {Orientation::Default(), Orientation::Default().rotateLeft(),
+        Orientation::Default().flipHorizontally()}) {
+    for (const Box& clip : clips) {
+      Offscreen<Rgb565> expected(20, 20, color::Black);
+      Offscreen<Rgb565> actual(20, 20, color::Black);
+      expected.output().setOrientation(orientation);
+      actual.output().setOrientation(orientation);
+      EXPECT_EQ(0, Draw(expected.output(), 2, 3, clip, converted));
+      Box drawn = Box::Intersect(clip, raw.extents().translate(2, 3));
+      EXPECT_EQ(drawn.area(), Draw(actual.output(), 2, 3, clip, raw));
+      EXPECT_EQ(0, memcmp(expected.buffer(), actual.buffer(), 20 * 20 * 2))
+          << clip;
+    }
+  }
+}
+
+TEST(RawPixels, SimpleImageRgb565ToOffscreen) {
+  const int16_t w = 9, h = 5;
+  std::vector<uint8_t> be, le;
+  RandomData(2, w * h, be, le);
+  SimpleImageRgb565<ConstDramPtr> raw(w, h, &be[0]);
+  SimpleImageRgb565<ConstDramPtr, BYTE_ORDER_LITTLE_ENDIAN> converted(w, h,
+                                                                      &le[0]);
+  for (const Box& clip : {Box(0, 0, 19, 19), Box(4, 3, 8, 6)}) {
+    Offscreen<Rgb565> expected(20, 20, color::Black);
+    Offscreen<Rgb565> actual(20, 20, color::Black);
+    EXPECT_EQ(0, Draw(expected.output(), 1, 2, clip, converted));
+    Box drawn = Box::Intersect(clip, raw.extents().translate(1, 2));
+    EXPECT_EQ(drawn.area(), Draw(actual.output(), 1, 2, clip, raw));
+    EXPECT_EQ(0, memcmp(expected.buffer(), actual.buffer(), 20 * 20 * 2))
+        << clip;
+  }
+}
+
+// Content with transparency takes the raw path only when it replaces the
+// destination.
+TEST(RawPixels, TransparentContent) {
+  const int16_t w = 6, h = 4;
+  std::vector<uint8_t> be, le;
+  RandomData(4, w * h, be, le);
+  RasterArgb8888<const uint8_t*> raw(w, h, &be[0]);
+  RasterArgb8888<const uint8_t*, BYTE_ORDER_LITTLE_ENDIAN> converted(w, h,
+                                                                     &le[0]);
+  Box clip(0, 0, 9, 9);
+  {
+    Offscreen<Argb8888> expected(10, 10, color::Red);
+    Offscreen<Argb8888> actual(10, 10, color::Red);
+    EXPECT_EQ(0, Draw(expected.output(), 0, 0, clip, converted));
+    EXPECT_EQ(0, Draw(actual.output(), 0, 0, clip, raw));
+    EXPECT_EQ(0, memcmp(expected.buffer(), actual.buffer(), 10 * 10 * 4));
+  }
+  {
+    Offscreen<Argb8888> expected(10, 10, color::Red);
+    Offscreen<Argb8888> actual(10, 10, color::Red);
+    EXPECT_EQ(0, Draw(expected.output(), 0, 0, clip, converted,
+                      BLENDING_MODE_SOURCE, FILL_MODE_RECTANGLE));
+    EXPECT_EQ(w * h, Draw(actual.output(), 0, 0, clip, raw,
+                          BLENDING_MODE_SOURCE, FILL_MODE_RECTANGLE));
+    EXPECT_EQ(0, memcmp(expected.buffer(), actual.buffer(), 10 * 10 * 4));
+  }
+  {
+    // Background color needs blending.
+    Offscreen<Argb8888> actual(10, 10, color::Red);
+    EXPECT_EQ(0, Draw(actual.output(), 0, 0, clip, raw, BLENDING_MODE_SOURCE,
+                      FILL_MODE_RECTANGLE, color::White));
+  }
+}
+
+TEST(RawPixels, RasterRgb565ToAddrWindowDevice) {
+  FakeSpiBus bus;
+  Ili9341<FakeSpiTransport> device{FakeSpiTransport(bus)};
+  const int16_t w = 4, h = 2;
+  std::vector<uint8_t> be, le;
+  RandomData(2, w * h, be, le);
+  RasterRgb565<const uint8_t*> raster(w, h, &be[0]);
+  Box clip(0, 0, device.effective_width() - 1, device.effective_height() - 1);
+  EXPECT_EQ(w * h, Draw(device, 10, 20, clip, raster));
+  ASSERT_EQ(3, bus.commands().size());
+  const SpiCommand& ramwr = bus.commands()[2];
+  EXPECT_EQ(ili9341::RAMWR, ramwr.opcode);
+  EXPECT_THAT(ramwr.params, ElementsAreArray(be));
+
+  // Unaligned rows.
+  bus.reset();
+  RasterRgb565<const uint8_t*> unaligned(w - 1, h, &be[2]);
+  EXPECT_EQ((w - 1) * h, Draw(device, 10, 20, clip, unaligned));
+  ASSERT_EQ(ili9341::RAMWR, bus.commands().back().opcode);
+  EXPECT_THAT(bus.commands().back().params,
+              ElementsAreArray(be.begin() + 2, be.begin() + 14));
+}
+
+}  // namespace roo_display
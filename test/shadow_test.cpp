@@ -0,0 +1,184 @@
+#include "roo_display/shape/shadow.h"
+
+#include <random>
+#include <vector>
+
+#include "roo_display/core/offscreen.h"
+#include "roo_display/internal/isqrt.h"
+#include "testing.h"
+
+using namespace testing;
+
+namespace roo_display {
+
+// Calculates the alpha of the shadow directly, pixel by pixel.
+uint8_t ReferenceShadowAlpha(const RoundRectShadow::Spec& spec, int16_t x,
+                             int16_t y) {
+  int32_t fx = x - spec.x;
+  int32_t fy = y - spec.y;
+  fx = (fx >= spec.w - spec.radius) ? fx + spec.radius - spec.w + 1
+                                    : spec.radius - fx;
+  fy = (fy >= spec.h - spec.radius) ? fy + spec.radius - spec.h + 1
+                                    : spec.radius - fy;
+  uint32_t d;
+  if (fx <= 0) {
+    d = (fy > 0) ? 16 * fy : 0;
+  } else if (fy <= 0) {
+    d = 16 * fx;
+  } else {
+    d = isqrt32(256 * (fx * fx + fy * fy));
+  }
+  if (d <= spec.border * 16u) return spec.alpha_start;
+  if (d > spec.radius * 16u) return 0;
+  return spec.alpha_start -
+         ((uint32_t)((d - spec.border * 16) * spec.alpha_step) / 256 / 16);
+}
+
+struct ShadowParams {
+  Box extents;
+  Color color;
+  uint8_t blur_radius;
+  uint8_t dx;
+  uint8_t dy;
+  uint8_t corner_radius;
+};
+
+ShadowParams RandomShadowParams(std::mt19937& gen) {
+  int16_t x = gen() % 40;
+  int16_t y = gen() % 30;
+  return ShadowParams{Box(x, y, x + gen() % 40, y + gen() % 30),
+                      Color(gen() % 2 ? 0x80000000 : gen()),
+                      (uint8_t)(gen() % 12),
+                      (uint8_t)(gen() % 4),
+                      (uint8_t)(gen() % 4),
+                      (uint8_t)(gen() % 10)};
+}
+
+RoundRectShadow MakeShadow(const ShadowParams& p,
+                           RoundRectShadowCache* cache = nullptr) {
+  return RoundRectShadow(p.extents, p.color, p.blur_radius, p.dx, p.dy,
+                         p.corner_radius, cache);
+}
+
+std::vector<Color> Reference(const ShadowParams& p, const Box& box) {
+  RoundRectShadow::Spec spec;
+  spec.radius = p.blur_radius + p.corner_radius;
+  spec.x = p.extents.xMin() - p.blur_radius + p.dx;
+  spec.y = p.extents.yMin() - p.blur_radius + p.dy;
+  spec.w = p.extents.width() + 2 * p.blur_radius;
+  spec.h = p.extents.height() + 2 * p.blur_radius;
+  spec.alpha_start = p.color.a();
+  spec.alpha_step =
+      (p.blur_radius == 0) ? 0 : 256 * spec.alpha_start / p.blur_radius;
+  spec.border = p.corner_radius;
+  std::vector<Color> result;
+  for (int16_t y = box.yMin(); y <= box.yMax(); ++y) {
+    for (int16_t x = box.xMin(); x <= box.xMax(); ++x) {
+      result.push_back(p.color.withA(ReferenceShadowAlpha(spec, x, y)));
+    }
+  }
+  return result;
+}
+
+std::vector<Color> ReadRect(const Rasterizable& obj, const Box& box) {
+  std::vector<int16_t> xs, ys;
+  for (int16_t y = box.yMin(); y <= box.yMax(); ++y) {
+    for (int16_t x = box.xMin(); x <= box.xMax(); ++x) {
+      xs.push_back(x);
+      ys.push_back(y);
+    }
+  }
+  std::vector<Color> result(xs.size());
+  obj.readColors(&xs[0], &ys[0], xs.size(), &result[0]);
+  return result;
+}
+
+TEST(RoundRectShadow, ReadsMatchReference) {
+  std::mt19937 gen(43);
+  RoundRectShadowCache cache;
+  for (int i = 0; i < 100; ++i) {
+    ShadowParams p = RandomShadowParams(gen);
+    RoundRectShadow shadow = MakeShadow(p, (i % 2) ? &cache : nullptr);
+    Box extents = shadow.extents();
+    Box box(extents.xMin() - 2, extents.yMin() - 2, extents.xMax() + 2,
+            extents.yMax() + 2);
+    std::vector<Color> expected = Reference(p, box);
+    ASSERT_THAT(ReadRect(shadow, box), ElementsAreArray(expected)) << i;
+    std::vector<Color> actual(box.area());
+    for (int16_t y = box.yMin(); y <= box.yMax(); ++y) {
+      shadow.readColorRow(y, box.xMin(), box.xMax(),
+                          &actual[(y - box.yMin()) * box.width()]);
+    }
+    ASSERT_THAT(actual, ElementsAreArray(expected)) << i;
+    for (int j = 0; j < 50; ++j) {
+      int16_t x = extents.xMin() + gen() % extents.width();
+      int16_t y = extents.yMin() + gen() % extents.height();
+      Box rect = Box::Intersect(Box(x, y, x + gen() % 12, y + gen() % 12),
+                                extents);
+      std::vector<Color> colors(rect.area());
+      if (shadow.readColorRect(rect.xMin(), rect.yMin(), rect.xMax(),
+                               rect.yMax(), &colors[0])) {
+        std::fill(colors.begin(), colors.end(), colors[0]);
+      }
+      ASSERT_THAT(colors, ElementsAreArray(Reference(p, rect))) << i;
+    }
+  }
+}
+
+TEST(RoundRectShadow, CacheSharesTables) {
+  RoundRectShadowCache cache;
+  RoundRectShadow a(Box(10, 10, 40, 30), Color(0x80000000), 6, 2, 3, 5,
+                    &cache);
+  // Same parameters, at a different place and with a different RGB.
+  RoundRectShadow b(Box(50, 20, 90, 25), Color(0x80FF0000), 6, 0, 0, 5,
+                    &cache);
+  EXPECT_EQ(1, cache.size());
+  RoundRectShadow c(Box(10, 10, 40, 30), Color(0x80000000), 6, 2, 3, 4,
+                    &cache);
+  RoundRectShadow d(Box(10, 10, 40, 30), Color(0x40000000), 6, 2, 3, 5,
+                    &cache);
+  EXPECT_EQ(3, cache.size());
+  RoundRectShadow e(Box(10, 10, 40, 30), Color(0x80000000), 6, 2, 3, 5);
+  EXPECT_THAT(ReadRect(a, a.extents()),
+              ElementsAreArray(ReadRect(e, e.extents())));
+  cache.clear();
+  EXPECT_EQ(0, cache.size());
+}
+
+// Drawing the shadow gives the same result as drawing its individual pixels.
+TEST(RoundRectShadow, DrawMatchesReadColors) {
+  std::mt19937 gen(47);
+  const Color canvas = Color(0xFF204060);
+  for (int i = 0; i < 60; ++i) {
+    ShadowParams p = RandomShadowParams(gen);
+    RoundRectShadow shadow = MakeShadow(p);
+    FillMode fill_mode = (i % 2) ? FILL_MODE_RECTANGLE : FILL_MODE_VISIBLE;
+    Color bgcolor = (i % 3) ? Color(0xFFC0C0C0) : color::Transparent;
+    int16_t dx = gen() % 11 - 5;
+    int16_t dy = gen() % 11 - 5;
+    Box clip(gen() % 20, gen() % 10, 60 + gen() % 30, 40 + gen() % 30);
+    Offscreen<Argb8888> actual(100, 80, canvas);
+    {
+      Surface s(actual.output(), dx, dy, clip, false, bgcolor, fill_mode,
+                BLENDING_MODE_SOURCE_OVER);
+      s.drawObject(shadow);
+    }
+    Offscreen<Argb8888> expected(100, 80, canvas);
+    Box box = Box::Intersect(shadow.extents().translate(dx, dy), clip);
+    if (!box.empty()) {
+      std::vector<Color> colors = ReadRect(shadow, box.translate(-dx, -dy));
+      for (int16_t y = box.yMin(); y <= box.yMax(); ++y) {
+        for (int16_t x = box.xMin(); x <= box.xMax(); ++x) {
+          Color c = colors[(y - box.yMin()) * box.width() + x - box.xMin()];
+          if (c.a() == 0 && fill_mode == FILL_MODE_VISIBLE) continue;
+          expected.output().fillPixels(BLENDING_MODE_SOURCE_OVER,
+                                       AlphaBlend(bgcolor, c), &x, &y, 1);
+        }
+      }
+    }
+    ASSERT_EQ(0, memcmp(expected.buffer(), actual.buffer(), 100 * 80 * 4))
+        << i;
+  }
+}
+
+}  // namespace roo_display
@@ -0,0 +1,229 @@
+#include "roo_display/shape/smooth_batch.h"
+
+#include <random>
+#include <vector>
+
+#include "roo_display/core/offscreen.h"
+#include "testing.h"
+
+using namespace testing;
+
+namespace roo_display {
+
+float RandomFloat(std::mt19937& gen, float min, float max) {
+  return min + (max - min) * (gen() % 10001) / 10000.0f;
+}
+
+FpPoint RandomPoint(std::mt19937& gen) {
+  return FpPoint{RandomFloat(gen, -10, 110), RandomFloat(gen, -10, 90)};
+}
+
+SmoothShape RandomShape(std::mt19937& gen) {
+  Color color(gen());
+  switch (gen() % 5) {
+    case 0: {
+      return SmoothThickLine(RandomPoint(gen), RandomPoint(gen),
+                             RandomFloat(gen, 0.5f, 5), color);
+    }
+    case 1: {
+      FpPoint a = RandomPoint(gen);
+      FpPoint b = RandomPoint(gen);
+      return SmoothThickRoundRect(a.x, a.y, b.x, b.y, RandomFloat(gen, 0, 15),
+                                  RandomFloat(gen, 0, 6), color,
+                                  (gen() % 2) ? color::Transparent
+                                              : Color(gen() | 0xFF000000));
+    }
+    case 2: {
+      float start = RandomFloat(gen, -4, 4);
+      return SmoothThickArc(RandomPoint(gen), RandomFloat(gen, 1, 40),
+                            RandomFloat(gen, 0.5f, 10), start,
+                            start + RandomFloat(gen, 0.1f, 6), color);
+    }
+    case 3: {
+      return SmoothFilledCircle(RandomPoint(gen), RandomFloat(gen, 0, 30),
+                                Color(color.asArgb() | 0xFF000000));
+    }
+    default: {
+      return SmoothFilledTriangle(RandomPoint(gen), RandomPoint(gen),
+                                  RandomPoint(gen), color);
+    }
+  }
+}
+
+// Returns the colors of the shapes, blended one over another, in the specified
+// rectangle, reading each pixel of each shape individually.
+std::vector<Color> Composite(const std::vector<SmoothShape>& shapes,
+                             const Box& box) {
+  std::vector<Color> result(box.area(), color::Transparent);
+  for (const SmoothShape& shape : shapes) {
+    uint32_t i = 0;
+    for (int16_t y = box.yMin(); y <= box.yMax(); ++y) {
+      for (int16_t x = box.xMin(); x <= box.xMax(); ++x, ++i) {
+        Color c;
+        shape.readColorsMaybeOutOfBounds(&x, &y, 1, &c);
+        result[i] = AlphaBlend(result[i], c);
+      }
+    }
+  }
+  return result;
+}
+
+std::vector<Color> ReadRect(const Rasterizable& obj, const Box& box) {
+  std::vector<int16_t> xs, ys;
+  for (int16_t y = box.yMin(); y <= box.yMax(); ++y) {
+    for (int16_t x = box.xMin(); x <= box.xMax(); ++x) {
+      xs.push_back(x);
+      ys.push_back(y);
+    }
+  }
+  std::vector<Color> result(xs.size());
+  obj.readColors(&xs[0], &ys[0], xs.size(), &result[0]);
+  return result;
+}
+
+TEST(SmoothShapeBatch, Empty) {
+  SmoothShapeBatch batch;
+  EXPECT_TRUE(batch.extents().empty());
+  batch.add(SmoothShape());
+  EXPECT_EQ(1, batch.size());
+  EXPECT_TRUE(batch.extents().empty());
+}
+
+TEST(SmoothShapeBatch, LaterShapesOnTop) {
+  SmoothShapeBatch batch;
+  batch.add(SmoothFilledRoundRect(0, 0, 9, 9, 0, color::Red));
+  batch.add(SmoothFilledRoundRect(5, 5, 14, 14, 0, Color(0x800000FF)));
+  batch.add(SmoothFilledRoundRect(12, 12, 20, 20, 0, color::Lime));
+  batch.build();
+  EXPECT_EQ(Box(0, 0, 20, 20), batch.extents());
+  EXPECT_THAT(ReadRect(batch, Box(2, 2, 2, 2)), ElementsAre(color::Red));
+  EXPECT_THAT(ReadRect(batch, Box(7, 7, 7, 7)),
+              ElementsAre(AlphaBlend(color::Red, Color(0x800000FF))));
+  EXPECT_THAT(ReadRect(batch, Box(11, 11, 13, 11)),
+              ElementsAre(Color(0x800000FF), Color(0x800000FF),
+                          Color(0x800000FF)));
+  EXPECT_THAT(ReadRect(batch, Box(13, 13, 13, 13)), ElementsAre(color::Lime));
+  EXPECT_THAT(ReadRect(batch, Box(2, 18, 2, 18)),
+              ElementsAre(color::Transparent));
+
+  batch.clear();
+  EXPECT_EQ(0, batch.size());
+  EXPECT_TRUE(batch.extents().empty());
+}
+
+TEST(SmoothShapeBatch, ReadsMatchComposite) {
+  std::mt19937 gen(37);
+  for (int i = 0; i < 30; ++i) {
+    std::vector<SmoothShape> shapes;
+    SmoothShapeBatch batch;
+    int count = 1 + gen() % 20;
+    for (int j = 0; j < count; ++j) {
+      shapes.push_back(RandomShape(gen));
+      batch.add(shapes.back());
+    }
+    batch.build();
+    Box extents = batch.extents();
+    if (extents.empty()) continue;
+    ASSERT_THAT(ReadRect(batch, extents),
+                ElementsAreArray(Composite(shapes, extents)))
+        << i;
+    for (int16_t y = extents.yMin(); y <= extents.yMax(); ++y) {
+      std::vector<Color> row(extents.width());
+      batch.readColorRow(y, extents.xMin(), extents.xMax(), &row[0]);
+      ASSERT_THAT(row, ElementsAreArray(ReadRect(
+                           batch, Box(extents.xMin(), y, extents.xMax(), y))))
+          << i << ", " << y;
+    }
+    for (int j = 0; j < 50; ++j) {
+      int16_t x = extents.xMin() + gen() % extents.width();
+      int16_t y = extents.yMin() + gen() % extents.height();
+      Box box = Box::Intersect(
+          Box(x, y, x + gen() % 12, y + gen() % 12), extents);
+      std::vector<Color> actual(box.area());
+      if (batch.readColorRect(box.xMin(), box.yMin(), box.xMax(), box.yMax(),
+                              &actual[0])) {
+        std::fill(actual.begin(), actual.end(), actual[0]);
+      }
+      ASSERT_THAT(actual, ElementsAreArray(ReadRect(batch, box))) << i;
+    }
+  }
+}
+
+// Shapes far apart make the grid cells grow.
+TEST(SmoothShapeBatch, LargeExtents) {
+  std::vector<SmoothShape> shapes;
+  shapes.push_back(SmoothFilledCircle({-3000, -2000}, 5, color::Red));
+  shapes.push_back(SmoothFilledCircle({4000, 3000}, 5, color::Blue));
+  shapes.push_back(SmoothThickLine({-3000, -2000}, {4000, 3000}, 2,
+                                   Color(0x80008000)));
+  SmoothShapeBatch batch;
+  for (const SmoothShape& shape : shapes) batch.add(shape);
+  batch.build();
+  EXPECT_EQ(Box(-3005, -2005, 4005, 3005), batch.extents());
+  Box boxes[] = {Box(-3008, -2008, -2992, -1992), Box(3992, 2992, 4005, 3005),
+                 Box(490, 350, 510, 370)};
+  for (const Box& box : boxes) {
+    EXPECT_THAT(ReadRect(batch, box),
+                ElementsAreArray(Composite(shapes, box)));
+  }
+}
+
+// Adding shapes doesn't lay out the grid; build() does it once.
+TEST(SmoothShapeBatch, ManyShapes) {
+  std::mt19937 gen(43);
+  std::vector<SmoothShape> shapes;
+  SmoothShapeBatch batch;
+  for (int i = 0; i < 5000; ++i) {
+    FpPoint center{RandomFloat(gen, 0, 300), RandomFloat(gen, 0, 200)};
+    shapes.push_back(
+        SmoothFilledCircle(center, RandomFloat(gen, 1, 4), Color(gen())));
+    batch.add(shapes.back());
+  }
+  batch.build();
+  Box boxes[] = {Box(0, 0, 9, 9), Box(140, 90, 149, 99),
+                 Box(294, 194, 303, 203)};
+  for (const Box& box : boxes) {
+    EXPECT_THAT(ReadRect(batch, box),
+                ElementsAreArray(Composite(shapes, box)));
+  }
+}
+
+// Drawing the batch gives the same result as drawing its individual pixels.
+TEST(SmoothShapeBatch, DrawMatchesReadColors) {
+  std::mt19937 gen(41);
+  const Color canvas = Color(0xFF204060);
+  for (int i = 0; i < 60; ++i) {
+    SmoothShapeBatch batch;
+    int count = 1 + gen() % 20;
+    for (int j = 0; j < count; ++j) batch.add(RandomShape(gen));
+    batch.build();
+    FillMode fill_mode = (i % 2) ? FILL_MODE_RECTANGLE : FILL_MODE_VISIBLE;
+    Color bgcolor = (i % 3) ? Color(0xFFC0C0C0) : color::Transparent;
+    int16_t dx = gen() % 11 - 5;
+    int16_t dy = gen() % 11 - 5;
+    Box clip(gen() % 20, gen() % 10, 80 + gen() % 30, 60 + gen() % 30);
+    Offscreen<Argb8888> actual(110, 90, canvas);
+    {
+      Surface s(actual.output(), dx, dy, clip, false, bgcolor, fill_mode,
+                BLENDING_MODE_SOURCE_OVER);
+      s.drawObject(batch);
+    }
+    Offscreen<Argb8888> expected(110, 90, canvas);
+    Box box = Box::Intersect(batch.extents().translate(dx, dy), clip);
+    if (!box.empty()) {
+      std::vector<Color> colors = ReadRect(batch, box.translate(-dx, -dy));
+      for (int16_t y = box.yMin(); y <= box.yMax(); ++y) {
+        for (int16_t x = box.xMin(); x <= box.xMax(); ++x) {
+          Color c = colors[(y - box.yMin()) * box.width() + x - box.xMin()];
+          if (c.a() == 0 && fill_mode == FILL_MODE_VISIBLE) continue;
+          expected.output().fillPixels(BLENDING_MODE_SOURCE_OVER,
+                                       AlphaBlend(bgcolor, c), &x, &y, 1);
+        }
+      }
+    }
+    ASSERT_EQ(0, memcmp(expected.buffer(), actual.buffer(), 110 * 90 * 4))
+        << i;
+  }
+}
+
+}  // namespace roo_display
@@ -0,0 +1,329 @@
+#include "roo_display/shape/smooth_path.h"
+
+#include <math.h>
+
+#include <random>
+#include <vector>
+
+#include "roo_display.h"
+#include "roo_display/core/offscreen.h"
+#include "testing.h"
+
+using namespace testing;
+
+namespace roo_display {
+
+std::vector<Color> ReadRect(const Rasterizable& shape, const Box& box) {
+  std::vector<int16_t> xs, ys;
+  for (int16_t y = box.yMin(); y <= box.yMax(); ++y) {
+    for (int16_t x = box.xMin(); x <= box.xMax(); ++x) {
+      xs.push_back(x);
+      ys.push_back(y);
+    }
+  }
+  std::vector<Color> result(xs.size());
+  shape.readColors(&xs[0], &ys[0], xs.size(), &result[0]);
+  return result;
+}
+
+// Returns the total coverage (in pixels) of the shape.
+float Area(const Rasterizable& shape) {
+  float area = 0;
+  for (Color c : ReadRect(shape, shape.extents())) area += c.a() / 255.0f;
+  return area;
+}
+
+void AddRect(SmoothPath& path, float x0, float y0, float x1, float y1) {
+  path.moveTo({x0, y0});
+  path.lineTo({x1, y0});
+  path.lineTo({x1, y1});
+  path.lineTo({x0, y1});
+  path.close();
+}
+
+TEST(SmoothPath, Empty) {
+  SmoothPath path;
+  path.setFill(color::Black);
+  path.build();
+  EXPECT_TRUE(path.extents().empty());
+}
+
+TEST(SmoothPath, PixelAlignedRect) {
+  SmoothPath path;
+  AddRect(path, 1.5, 1.5, 4.5, 3.5);
+  path.setFill(color::Red);
+  path.build();
+  EXPECT_EQ(Box(2, 2, 4, 3), path.extents());
+  Box box(0, 0, 6, 5);
+  std::vector<Color> colors = ReadRect(path, box);
+  for (int16_t y = 0; y <= 5; ++y) {
+    for (int16_t x = 0; x <= 6; ++x) {
+      Color expected =
+          path.extents().contains(x, y) ? color::Red : color::Transparent;
+      EXPECT_EQ(expected.a(), colors[y * 7 + x].a()) << x << ", " << y;
+    }
+  }
+}
+
+TEST(SmoothPath, PartialCoverage) {
+  SmoothPath path;
+  AddRect(path, 2, 2, 5, 4);
+  path.setFill(color::Black);
+  path.build();
+  EXPECT_EQ(Box(2, 2, 5, 4), path.extents());
+  EXPECT_THAT(ReadRect(path, Box(1, 2, 5, 2)),
+              ElementsAre(color::Transparent, Color(0x40000000),
+                          Color(0x80000000), Color(0x80000000),
+                          Color(0x40000000)));
+  EXPECT_THAT(ReadRect(path, Box(1, 3, 5, 3)),
+              ElementsAre(color::Transparent, Color(0x80000000),
+                          Color(0xFF000000), Color(0xFF000000),
+                          Color(0x80000000)));
+}
+
+TEST(SmoothPath, FillRules) {
+  SmoothPath path;
+  AddRect(path, 0, 0, 20, 20);
+  AddRect(path, 5, 5, 15, 15);
+  path.setFill(color::Black, FILL_RULE_NONZERO);
+  path.build();
+  EXPECT_NEAR(400, Area(path), 0.5);
+  path.setFill(color::Black, FILL_RULE_EVEN_ODD);
+  path.build();
+  EXPECT_NEAR(300, Area(path), 0.5);
+
+  // With the inner rect reversed, both rules leave a hole.
+  SmoothPath reversed;
+  AddRect(reversed, 0, 0, 20, 20);
+  AddRect(reversed, 5, 15, 15, 5);
+  reversed.setFill(color::Black, FILL_RULE_NONZERO);
+  reversed.build();
+  EXPECT_NEAR(300, Area(reversed), 0.5);
+}
+
+TEST(SmoothPath, Curves) {
+  // The area of a parabolic segment is 2/3 of its bounding rectangle.
+  SmoothPath quad;
+  quad.moveTo({0, 0});
+  quad.quadTo({20, 40}, {40, 0});
+  quad.setFill(color::Black);
+  quad.build();
+  EXPECT_NEAR(40 * 20 * 2 / 3.0f, Area(quad), 2.0);
+
+  // A circle, approximated by four cubic curves.
+  const float r = 20;
+  const float k = 0.5523f * r;
+  SmoothPath circle;
+  circle.moveTo({r, 0});
+  circle.cubicTo({r, k}, {k, r}, {0, r});
+  circle.cubicTo({-k, r}, {-r, k}, {-r, 0});
+  circle.cubicTo({-r, -k}, {-k, -r}, {0, -r});
+  circle.cubicTo({k, -r}, {r, -k}, {r, 0});
+  circle.setFill(color::Black);
+  circle.build();
+  EXPECT_EQ(Box(-20, -20, 20, 20), circle.extents());
+  EXPECT_NEAR(M_PI * r * r, Area(circle), 5.0);
+}
+
+TEST(SmoothPath, StrokeFlatEnds) {
+  SmoothPath path;
+  path.moveTo({2, 5});
+  path.lineTo({12, 5});
+  path.setStroke(color::Black, 2, JOIN_ROUNDED, ENDING_FLAT);
+  path.build();
+  EXPECT_EQ(Box(2, 4, 12, 6), path.extents());
+  EXPECT_THAT(ReadRect(path, Box(1, 4, 4, 4)),
+              ElementsAre(color::Transparent, Color(0x40000000),
+                          Color(0x80000000), Color(0x80000000)));
+  EXPECT_THAT(ReadRect(path, Box(1, 5, 4, 5)),
+              ElementsAre(color::Transparent, Color(0x80000000),
+                          Color(0xFF000000), Color(0xFF000000)));
+  EXPECT_NEAR(20, Area(path), 0.1);
+
+  path.setStroke(color::Black, 2, JOIN_ROUNDED, ENDING_ROUNDED);
+  path.build();
+  EXPECT_NEAR(20 + M_PI, Area(path), 0.3);
+}
+
+// A closed square, stroked with miter joins, is the difference of two squares.
+// The exception are the pixels at the inner corners, where the rectangles of
+// the adjacent sides overlap, and their coverage is over-estimated.
+TEST(SmoothPath, StrokeMiterJoins) {
+  SmoothPath stroke;
+  AddRect(stroke, 5.3, 5.3, 15.3, 15.3);
+  stroke.setStroke(color::Black, 3, JOIN_MITER);
+  stroke.build();
+  SmoothPath frame;
+  AddRect(frame, 3.8, 3.8, 16.8, 16.8);
+  AddRect(frame, 6.8, 6.8, 13.8, 13.8);
+  frame.setFill(color::Black, FILL_RULE_EVEN_ODD);
+  frame.build();
+  EXPECT_EQ(frame.extents(), stroke.extents());
+  std::vector<Color> actual = ReadRect(stroke, stroke.extents());
+  std::vector<Color> expected = ReadRect(frame, frame.extents());
+  for (size_t i = 0; i < actual.size(); ++i) {
+    int16_t x = stroke.extents().xMin() + i % stroke.extents().width();
+    int16_t y = stroke.extents().yMin() + i / stroke.extents().width();
+    if ((x == 7 || x == 14) && (y == 7 || y == 14)) continue;
+    EXPECT_NEAR(expected[i].a(), actual[i].a(), 1) << x << ", " << y;
+  }
+
+  // Bevel cuts the corners in half.
+  stroke.setStroke(color::Black, 3, JOIN_BEVEL);
+  stroke.build();
+  EXPECT_NEAR(13 * 13 - 7 * 7 - 4 * 1.5 * 1.5 / 2, Area(stroke), 1.0);
+
+  // Round corners are quarter-circles.
+  stroke.setStroke(color::Black, 3, JOIN_ROUNDED);
+  stroke.build();
+  EXPECT_NEAR(13 * 13 - 7 * 7 - 4 * 1.5 * 1.5 + M_PI * 1.5 * 1.5,
+              Area(stroke), 1.0);
+}
+
+TEST(SmoothPath, FillAndStroke) {
+  SmoothPath path;
+  AddRect(path, 0.5, 0.5, 10.5, 10.5);
+  path.setFill(color::White);
+  path.setStroke(color::Black, 1);
+  path.build();
+  EXPECT_THAT(ReadRect(path, Box(0, 5, 2, 5)),
+              ElementsAre(Color(0x80000000), Color(0xFF7F7F7F), color::White));
+}
+
+// A chart-like polyline of many segments: construction and building stay
+// linear in the number of segments.
+TEST(SmoothPath, ManySegments) {
+  const int kSegments = 5000;
+  SmoothPath path;
+  path.moveTo({0, 30});
+  for (int i = 1; i <= kSegments; ++i) {
+    float x = i * 0.1f;
+    path.lineTo({x, 30 + 20 * sinf(x / 8)});
+  }
+  path.setStroke(color::Black, 2, JOIN_MITER, ENDING_FLAT);
+  path.build();
+  EXPECT_EQ(Box(-1, 9, 501, 51), path.extents());
+  // Near the first peak, at x = 4 * pi, the line is flat at y ~= 50.
+  EXPECT_THAT(ReadRect(path, Box(13, 46, 13, 46)),
+              ElementsAre(color::Transparent));
+  EXPECT_THAT(ReadRect(path, Box(13, 50, 13, 50)),
+              ElementsAre(color::Black));
+
+  Offscreen<Argb8888> actual(500, 60, color::White);
+  {
+    DrawingContext dc(actual);
+    dc.draw(path);
+  }
+  Box e = Box::Intersect(path.extents(), actual.extents());
+  std::vector<Color> expected = ReadRect(path, e);
+  for (int16_t y = e.yMin(); y <= e.yMax(); y += 7) {
+    for (int16_t x = e.xMin(); x <= e.xMax(); x += 13) {
+      Color c = expected[(y - e.yMin()) * e.width() + x - e.xMin()];
+      ASSERT_EQ(AlphaBlend(color::White, c),
+                ReadRect(actual, Box(x, y, x, y))[0])
+          << x << ", " << y;
+    }
+  }
+}
+
+FpPoint RandomPoint(std::mt19937& gen) {
+  return FpPoint{(gen() % 8001) / 100.0f - 10, (gen() % 6001) / 100.0f - 10};
+}
+
+SmoothPath RandomPath(std::mt19937& gen) {
+  SmoothPath path;
+  int segments = 1 + gen() % 8;
+  for (int i = 0; i < segments; ++i) {
+    switch (gen() % 6) {
+      case 0: {
+        path.moveTo(RandomPoint(gen));
+        break;
+      }
+      case 1: {
+        path.close();
+        break;
+      }
+      case 2: {
+        FpPoint c = RandomPoint(gen);
+        path.quadTo(c, RandomPoint(gen));
+        break;
+      }
+      case 3: {
+        FpPoint c1 = RandomPoint(gen);
+        FpPoint c2 = RandomPoint(gen);
+        path.cubicTo(c1, c2, RandomPoint(gen));
+        break;
+      }
+      default: {
+        path.lineTo(RandomPoint(gen));
+        break;
+      }
+    }
+  }
+  if (gen() % 3 != 0) {
+    path.setFill(Color(gen() | 0x80000000),
+                 gen() % 2 ? FILL_RULE_NONZERO : FILL_RULE_EVEN_ODD);
+  }
+  if (gen() % 3 != 0) {
+    path.setStroke(Color(gen() | 0x80000000), (gen() % 600) / 100.0f,
+                   (JoinStyle)(gen() % 3),
+                   gen() % 2 ? ENDING_ROUNDED : ENDING_FLAT);
+  }
+  path.build();
+  return path;
+}
+
+TEST(SmoothPath, ReadColorRectMatchesReadColors) {
+  std::mt19937 gen(29);
+  for (int i = 0; i < 200; ++i) {
+    SmoothPath path = RandomPath(gen);
+    for (int j = 0; j < 20; ++j) {
+      int16_t x = gen() % 80 - 10;
+      int16_t y = gen() % 60 - 10;
+      Box box(x, y, x + gen() % 8, y + gen() % 8);
+      std::vector<Color> actual(box.area());
+      if (path.readColorRect(box.xMin(), box.yMin(), box.xMax(), box.yMax(),
+                             &actual[0])) {
+        std::fill(actual.begin(), actual.end(), actual[0]);
+      }
+      ASSERT_THAT(actual, ElementsAreArray(ReadRect(path, box))) << i;
+    }
+  }
+}
+
+// Drawing the path gives the same result as drawing its individual pixels.
+TEST(SmoothPath, DrawMatchesReadColors) {
+  std::mt19937 gen(31);
+  const Color canvas = Color(0xFF204060);
+  for (int i = 0; i < 200; ++i) {
+    SmoothPath path = RandomPath(gen);
+    FillMode fill_mode = (i % 2) ? FILL_MODE_RECTANGLE : FILL_MODE_VISIBLE;
+    Color bgcolor = (i % 3) ? Color(0xFFC0C0C0) : color::Transparent;
+    int16_t dx = gen() % 11 - 5;
+    int16_t dy = gen() % 11 - 5;
+    Box clip(gen() % 20, gen() % 10, 50 + gen() % 30, 30 + gen() % 30);
+    Offscreen<Argb8888> actual(80, 60, canvas);
+    {
+      Surface s(actual.output(), dx, dy, clip, false, bgcolor, fill_mode,
+                BLENDING_MODE_SOURCE_OVER);
+      s.drawObject(path);
+    }
+    Offscreen<Argb8888> expected(80, 60, canvas);
+    Box box = Box::Intersect(path.extents().translate(dx, dy), clip);
+    if (!box.empty()) {
+      std::vector<Color> colors = ReadRect(path, box.translate(-dx, -dy));
+      for (int16_t y = box.yMin(); y <= box.yMax(); ++y) {
+        for (int16_t x = box.xMin(); x <= box.xMax(); ++x) {
+          Color c = colors[(y - box.yMin()) * box.width() + x - box.xMin()];
+          if (c.a() == 0 && fill_mode == FILL_MODE_VISIBLE) continue;
+          expected.output().fillPixels(BLENDING_MODE_SOURCE_OVER,
+                                       AlphaBlend(bgcolor, c), &x, &y, 1);
+        }
+      }
+    }
+    ASSERT_EQ(0, memcmp(expected.buffer(), actual.buffer(), 80 * 60 * 4))
+        << i;
+  }
+}
+
+}  // namespace roo_display
@@ -0,0 +1,171 @@
+#include "roo_display/shape/smooth.h"
+
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "roo_display/core/offscreen.h"
+#include "testing.h"
+
+using namespace testing;
+
+namespace roo_display {
+
+float RandomFloat(std::mt19937& gen, float min, float max) {
+  return min + (max - min) * (gen() % 10001) / 10000.0f;
+}
+
+FpPoint RandomPoint(std::mt19937& gen) {
+  return FpPoint{RandomFloat(gen, -10, 70), RandomFloat(gen, -10, 50)};
+}
+
+// Outline and interior colors are opaque or transparent, so that the
+// pre-blending of these colors during drawing doesn't affect the result.
+Color RandomColor(std::mt19937& gen, bool opaque) {
+  if (opaque) {
+    return (gen() % 4 == 0) ? color::Transparent : Color(gen() | 0xFF000000);
+  }
+  return Color(gen());
+}
+
+SmoothShape RandomShape(std::mt19937& gen) {
+  EndingStyle ending = (gen() % 2) ? ENDING_ROUNDED : ENDING_FLAT;
+  switch (gen() % 6) {
+    case 0: {
+      return SmoothWedgedLine(RandomPoint(gen), RandomFloat(gen, 0, 12),
+                              RandomPoint(gen), RandomFloat(gen, 0, 12),
+                              RandomColor(gen, false), ending);
+    }
+    case 1: {
+      return SmoothThickLine(RandomPoint(gen), RandomPoint(gen),
+                             RandomFloat(gen, 0.2f, 4), RandomColor(gen, false),
+                             ending);
+    }
+    case 2: {
+      FpPoint a = RandomPoint(gen);
+      FpPoint b = RandomPoint(gen);
+      return SmoothThickRoundRect(a.x, a.y, b.x, b.y, RandomFloat(gen, 0, 15),
+                                  RandomFloat(gen, 0, 6),
+                                  RandomColor(gen, true),
+                                  RandomColor(gen, true));
+    }
+    case 3: {
+      float start = RandomFloat(gen, -4, 4);
+      return SmoothThickArcWithBackground(
+          RandomPoint(gen), RandomFloat(gen, 1, 25), RandomFloat(gen, 0.5f, 15),
+          start, start + RandomFloat(gen, 0.1f, 6), RandomColor(gen, true),
+          RandomColor(gen, true), RandomColor(gen, true), ending);
+    }
+    case 4: {
+      return SmoothThickCircle(RandomPoint(gen), RandomFloat(gen, 0, 25),
+                               RandomFloat(gen, 0, 8), RandomColor(gen, true),
+                               RandomColor(gen, true));
+    }
+    default: {
+      return SmoothFilledTriangle(RandomPoint(gen), RandomPoint(gen),
+                                  RandomPoint(gen), RandomColor(gen, false));
+    }
+  }
+}
+
+std::vector<Color> ReadPixels(const Rasterizable& shape, int16_t y, int16_t x0,
+                              int16_t x1) {
+  std::vector<int16_t> xs, ys;
+  for (int16_t x = x0; x <= x1; ++x) {
+    xs.push_back(x);
+    ys.push_back(y);
+  }
+  std::vector<Color> result(xs.size());
+  shape.readColors(&xs[0], &ys[0], xs.size(), &result[0]);
+  return result;
+}
+
+TEST(SmoothShape, ReadColorRowMatchesReadColors) {
+  std::mt19937 gen(17);
+  for (int i = 0; i < 300; ++i) {
+    SmoothShape shape = RandomShape(gen);
+    for (int16_t y = -15; y <= 55; ++y) {
+      std::vector<Color> actual(81);
+      shape.readColorRow(y, -15, 65, &actual[0]);
+      ASSERT_THAT(actual, ElementsAreArray(ReadPixels(shape, y, -15, 65)))
+          << i << ", " << y;
+    }
+  }
+}
+
+// Drawing the shape gives the same result as drawing its individual pixels.
+TEST(SmoothShape, DrawMatchesReadColors) {
+  std::mt19937 gen(19);
+  const Color canvas = Color(0xFF204060);
+  for (int i = 0; i < 300; ++i) {
+    SmoothShape shape = RandomShape(gen);
+    FillMode fill_mode = (i % 2) ? FILL_MODE_RECTANGLE : FILL_MODE_VISIBLE;
+    Color bgcolor = (i % 3) ? Color(0xFFC0C0C0) : color::Transparent;
+    int16_t dx = gen() % 11 - 5;
+    int16_t dy = gen() % 11 - 5;
+    Box clip(gen() % 20, gen() % 10, 50 + gen() % 30, 30 + gen() % 30);
+    Offscreen<Argb8888> actual(80, 60, canvas);
+    {
+      Surface s(actual.output(), dx, dy, clip, false, bgcolor, fill_mode,
+                BLENDING_MODE_SOURCE_OVER);
+      s.drawObject(shape);
+    }
+    Offscreen<Argb8888> expected(80, 60, canvas);
+    Box box = Box::Intersect(shape.extents().translate(dx, dy), clip);
+    for (int16_t y = box.yMin(); y <= box.yMax(); ++y) {
+      std::vector<Color> row =
+          ReadPixels(shape, y - dy, box.xMin() - dx, box.xMax() - dx);
+      for (int16_t x = box.xMin(); x <= box.xMax(); ++x) {
+        Color c = row[x - box.xMin()];
+        if (c.a() == 0 && fill_mode == FILL_MODE_VISIBLE) continue;
+        expected.output().fillPixels(BLENDING_MODE_SOURCE_OVER,
+                                     AlphaBlend(bgcolor, c), &x, &y, 1);
+      }
+    }
+    ASSERT_EQ(0, memcmp(expected.buffer(), actual.buffer(), 80 * 60 * 4))
+        << i;
+  }
+}
+
+// Returns the maximum per-channel difference between the colors, when drawn
+// over the specified (opaque) background.
+int ColorDistance(Color bg, Color a, Color b) {
+  a = AlphaBlend(bg, a);
+  b = AlphaBlend(bg, b);
+  return std::max(std::abs(a.r() - b.r()),
+                  std::max(std::abs(a.g() - b.g()), std::abs(a.b() - b.b())));
+}
+
+// The fixed-point evaluation approximates the floating-point one. The color
+// functions are discontinuous in a few places (e.g. where a very thin outline
+// meets the interior), and there, the slightly different positions can give a
+// different color. Such pixels are rare.
+TEST(SmoothShape, FixedPointMatchesFloat) {
+  std::mt19937 gen(23);
+  const Color bg = Color(0xFF808080);
+  int visible = 0;
+  int mismatched = 0;
+  for (int i = 0; i < 300; ++i) {
+    SmoothShape shape = RandomShape(gen);
+    for (int16_t y = -15; y <= 55; ++y) {
+      std::vector<Color> expected = ReadPixels(shape, y, -15, 65);
+      std::vector<int16_t> xs, ys;
+      for (int16_t x = -15; x <= 65; ++x) {
+        xs.push_back(x);
+        ys.push_back(y);
+      }
+      std::vector<Color> actual(xs.size());
+      internal::ReadSmoothShapeColorsFixedPoint(shape, &xs[0], &ys[0],
+                                                xs.size(), &actual[0]);
+      for (size_t j = 0; j < xs.size(); ++j) {
+        if (expected[j].a() == 0 && actual[j].a() == 0) continue;
+        ++visible;
+        if (ColorDistance(bg, expected[j], actual[j]) > 2) ++mismatched;
+      }
+    }
+  }
+  EXPECT_GT(visible, 100000);
+  EXPECT_LE(mismatched, visible / 10000);
+}
+
+}  // namespace roo_display
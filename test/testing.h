@@ -1238,6 +1238,16 @@ class FilteredOutput : public DisplayOutput {
     filter_->fillRects(mode, color, x0, y0, x1, y1, count);
   }
 
+  void writeSpans(BlendingMode mode, Color* color, int16_t* x0, int16_t* y,
+                  int16_t* x1, uint16_t count) override {
+    filter_->writeSpans(mode, color, x0, y, x1, count);
+  }
+
+  void fillSpans(BlendingMode mode, Color color, int16_t* x0, int16_t* y,
+                 int16_t* x1, uint16_t count) override {
+    filter_->fillSpans(mode, color, x0, y, x1, count);
+  }
+
   const FakeOffscreen<ColorMode>& offscreen() const { return offscreen_; }
 
  private:
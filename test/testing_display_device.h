@@ -1,6 +1,7 @@
 
 #include <memory>
 #include <random>
+#include <vector>
 
 #include "gtest/gtest-param-test.h"
 #include "roo_display/color/color.h"
@@ -69,6 +70,18 @@ class TestDisplayDevice : public DisplayDevice {
     test_.fillRects(mode, color, x0, y0, x1, y1, count);
   }
 
+  void writeSpans(BlendingMode mode, Color* color, int16_t* x0, int16_t* y,
+                  int16_t* x1, uint16_t count) override {
+    refc_.writeSpans(mode, color, x0, y, x1, count);
+    test_.writeSpans(mode, color, x0, y, x1, count);
+  }
+
+  void fillSpans(BlendingMode mode, Color color, int16_t* x0, int16_t* y,
+                 int16_t* x1, uint16_t count) override {
+    refc_.fillSpans(mode, color, x0, y, x1, count);
+    test_.fillSpans(mode, color, x0, y, x1, count);
+  }
+
   const ReferenceDevice& refc() const { return refc_; };
   const TestedDevice& test() const { return test_; }
 
@@ -107,6 +120,18 @@ void TestFillHLines(BlendingMode blending_mode, Orientation orientation) {
   EXPECT_CONSISTENT(screen);
 }
 
+template <typename TestedDevice, typename ReferenceDevice>
+void TestFillSpans(BlendingMode blending_mode, Orientation orientation) {
+  TestDisplayDevice<TestedDevice, ReferenceDevice> screen(37, 33,
+                                                          Color(0xFF101050));
+  screen.setOrientation(orientation);
+  int16_t x0[] = {4, 14, 7, 0};
+  int16_t y[] = {14, 1, 12, 32};
+  int16_t x1[] = {12, 31, 7, 32};
+  screen.fillSpans(blending_mode, Color(0xF27445A6), x0, y, x1, 4);
+  EXPECT_CONSISTENT(screen);
+}
+
 template <typename TestedDevice, typename ReferenceDevice>
 void TestFillVLines(BlendingMode blending_mode, Orientation orientation) {
   TestDisplayDevice<TestedDevice, ReferenceDevice> screen(31, 35,
@@ -169,6 +194,58 @@ void TestWriteHLines(BlendingMode blending_mode, Orientation orientation) {
   EXPECT_CONSISTENT(screen);
 }
 
+template <typename TestedDevice, typename ReferenceDevice>
+void TestWriteSpans(BlendingMode blending_mode, Orientation orientation) {
+  TestDisplayDevice<TestedDevice, ReferenceDevice> screen(35, 27,
+                                                          Color(0xFF101050));
+  screen.setOrientation(orientation);
+  int16_t x0[] = {4, 14, 7};
+  int16_t y[] = {14, 1, 12};
+  int16_t x1[] = {7, 17, 7};
+  Color c[] = {Color(0x77145456), Color(0xF27445AE), Color(0xDD991133),
+               Color(0x00000000), Color(0xFF123456), Color(0x80FFFFFF),
+               Color(0x10203040), Color(0xFF000000), Color(0x44114411)};
+  screen.writeSpans(blending_mode, c, x0, y, x1, 3);
+  EXPECT_CONSISTENT(screen);
+}
+
+template <typename TestedDevice, typename ReferenceDevice>
+void TestWriteSpansStress(BlendingMode blending_mode, Orientation orientation) {
+  TestDisplayDevice<TestedDevice, ReferenceDevice> screen(50, 90,
+                                                          Color(0x12345678));
+  screen.setOrientation(orientation);
+
+  std::uniform_int_distribution<
+      ColorStorageType<ColorModeOfDevice<ReferenceDevice>>>
+      color_distribution;
+  std::uniform_int_distribution<uint16_t> count_distribution(1, 32);
+  std::uniform_int_distribution<uint16_t> x_distribution(
+      0, screen.effective_width() - 1);
+  std::uniform_int_distribution<uint16_t> y_distribution(
+      0, screen.effective_height() - 1);
+  ColorModeOfDevice<ReferenceDevice> color_mode;
+  const int kBatches = 64;
+  for (int batch = 0; batch < kBatches; ++batch) {
+    uint16_t count = count_distribution(generator);
+    int16_t x0[32];
+    int16_t y[32];
+    int16_t x1[32];
+    std::vector<Color> colors;
+    for (uint16_t i = 0; i < count; ++i) {
+      int16_t a = x_distribution(generator);
+      int16_t b = x_distribution(generator);
+      x0[i] = std::min(a, b);
+      x1[i] = std::max(a, b);
+      y[i] = y_distribution(generator);
+      for (int16_t x = x0[i]; x <= x1[i]; ++x) {
+        colors.push_back(color_mode.toArgbColor(color_distribution(generator)));
+      }
+    }
+    screen.writeSpans(blending_mode, colors.data(), x0, y, x1, count);
+  }
+  EXPECT_CONSISTENT(screen);
+}
+
 template <typename TestedDevice, typename ReferenceDevice>
 void TestWriteVLines(BlendingMode blending_mode, Orientation orientation) {
   TestDisplayDevice<TestedDevice, ReferenceDevice> screen(36, 32,
@@ -0,0 +1,171 @@
+#include "roo_display/core/tiled_offscreen.h"
+
+#include <random>
+#include <vector>
+
+#include "roo_display.h"
+#include "roo_display/core/offscreen.h"
+#include "testing.h"
+
+using namespace testing;
+
+namespace roo_display {
+
+TEST(TileLayout, Index) {
+  internal::TileLayout<4, 2> layout(10, 5);
+  EXPECT_EQ(3 * 3 * 8, layout.pixel_count());
+  EXPECT_EQ(0, layout.index(0, 0));
+  EXPECT_EQ(3, layout.index(3, 0));
+  EXPECT_EQ(4, layout.index(0, 1));
+  EXPECT_EQ(8, layout.index(4, 0));
+  EXPECT_EQ(24, layout.index(0, 2));
+  EXPECT_EQ(24 + 16 + 4 + 1, layout.index(9, 3));
+}
+
+// Applies the same sequence of random drawing operations to the linear and the
+// tiled offscreen, using the specified orientation.
+template <typename Linear, typename Tiled>
+void DrawRandom(Linear& linear, Tiled& tiled, Orientation orientation,
+                std::mt19937& gen) {
+  DisplayOutput* outputs[] = {&linear.output(), &tiled.output()};
+  linear.output().setOrientation(orientation);
+  tiled.output().setOrientation(orientation);
+  int16_t w = linear.output().effective_width();
+  int16_t h = linear.output().effective_height();
+  const BlendingMode modes[] = {BLENDING_MODE_SOURCE, BLENDING_MODE_SOURCE_OVER,
+                                BLENDING_MODE_SOURCE_OVER_OPAQUE,
+                                BLENDING_MODE_DESTINATION_OVER};
+  for (int op = 0; op < 40; ++op) {
+    BlendingMode mode = modes[gen() % 4];
+    int kind = gen() % 5;
+    int16_t x0 = gen() % w, y0 = gen() % h;
+    int16_t x1 = x0 + gen() % (w - x0), y1 = y0 + gen() % (h - y0);
+    Color colors[64];
+    for (Color& c : colors) c = Color(gen());
+    for (DisplayOutput* out : outputs) {
+      switch (kind) {
+        case 0: {
+          out->fillRect(mode, Box(x0, y0, x1, y1), colors[0]);
+          break;
+        }
+        case 1: {
+          int16_t xs0[] = {x0, x1}, ys0[] = {y0, y1};
+          int16_t xs1[] = {x1, x1}, ys1[] = {y1, y1};
+          out->writeRects(mode, colors, xs0, ys0, xs1, ys1, 2);
+          break;
+        }
+        case 2: {
+          int16_t xs[] = {x0, x1, x0}, ys[] = {y0, y1, y1};
+          out->writePixels(mode, colors, xs, ys, 3);
+          out->fillPixels(mode, colors[5], xs, ys, 2);
+          break;
+        }
+        case 3: {
+          // Address window, written in chunks.
+          Box box(x0, y0, x0 + (x1 - x0) % 8, y0 + (y1 - y0) % 8);
+          out->setAddress(box, mode);
+          uint32_t count = box.area();
+          out->write(colors, count / 2);
+          out->write(colors + count / 2, count - count / 2);
+          break;
+        }
+        case 4: {
+          int16_t xs0[] = {x0, x0}, ys[] = {y0, y1};
+          int16_t xs1[] = {(int16_t)(x0 + (x1 - x0) % 30),
+                           (int16_t)(x0 + (x1 - x0) % 20)};
+          out->writeSpans(mode, colors, xs0, ys, xs1, 2);
+          break;
+        }
+      }
+    }
+  }
+}
+
+template <typename ColorMode>
+void CheckDrawing(const ColorMode& color_mode = ColorMode()) {
+  std::mt19937 gen(5);
+  const int16_t w = 37, h = 21;
+  for (int o = 0; o < 8; ++o) {
+    Orientation orientation = Orientation::RightDown();
+    for (int i = 0; i < (o & 3); ++i) orientation = orientation.rotateRight();
+    if (o & 4) orientation = orientation.flipHorizontally();
+    Offscreen<ColorMode> linear(w, h, color::Black, color_mode);
+    TiledOffscreen<ColorMode, 8, 4> tiled(w, h, color::Black, color_mode);
+    DrawRandom(linear, tiled, orientation, gen);
+    std::vector<int16_t> xs, ys;
+    for (int16_t y = 0; y < h; ++y) {
+      for (int16_t x = 0; x < w; ++x) {
+        xs.push_back(x);
+        ys.push_back(y);
+      }
+    }
+    std::vector<Color> expected(w * h), actual(w * h);
+    linear.readColors(&xs[0], &ys[0], w * h, &expected[0]);
+    tiled.readColors(&xs[0], &ys[0], w * h, &actual[0]);
+    EXPECT_THAT(actual, ElementsAreArray(expected)) << orientation;
+  }
+}
+
+TEST(TiledOffscreen, Rgb565) { CheckDrawing<Rgb565>(); }
+
+TEST(TiledOffscreen, Argb4444) { CheckDrawing<Argb4444>(); }
+
+TEST(TiledOffscreen, Grayscale4) { CheckDrawing<Grayscale4>(); }
+
+TEST(TiledOffscreen, Monochrome) { CheckDrawing<Monochrome>(WhiteOnBlack()); }
+
+// Drawing the tiled offscreen (via the de-tiling stream) gives the same result
+// as drawing the linear one.
+TEST(TiledOffscreen, Draw) {
+  std::mt19937 gen(7);
+  const int16_t w = 29, h = 19;
+  Offscreen<Argb8888> linear(Box(3, 4, w + 2, h + 3), color::Transparent);
+  TiledOffscreen<Argb8888, 4, 4> tiled(Box(3, 4, w + 2, h + 3),
+                                       color::Transparent);
+  DrawRandom(linear, tiled, Orientation::RightDown(), gen);
+  for (const Box& clip : {Box(0, 0, 39, 39), Box(5, 7, 20, 13)}) {
+    for (BlendingMode mode :
+         {BLENDING_MODE_SOURCE, BLENDING_MODE_SOURCE_OVER}) {
+      Offscreen<Argb8888> expected(40, 40, color::Red);
+      Offscreen<Argb8888> actual(40, 40, color::Red);
+      {
+        Surface s(expected.output(), 2, 1, clip, false, color::Transparent,
+                  FILL_MODE_RECTANGLE, mode);
+        s.drawObject(linear);
+      }
+      {
+        Surface s(actual.output(), 2, 1, clip, false, color::Transparent,
+                  FILL_MODE_RECTANGLE, mode);
+        s.drawObject(tiled);
+      }
+      EXPECT_EQ(0, memcmp(expected.buffer(), actual.buffer(), 40 * 40 * 4))
+          << clip << " " << mode;
+    }
+  }
+}
+
+TEST(TiledOffscreen, DrawingContext) {
+  Offscreen<Rgb565> linear(20, 10, color::Black);
+  TiledOffscreen<Rgb565> tiled(20, 10, color::Black);
+  {
+    DrawingContext dc(linear);
+    dc.fill(color::Red);
+  }
+  {
+    DrawingContext dc(tiled);
+    dc.fill(color::Red);
+  }
+  Offscreen<Rgb565> expected(20, 10, color::Black);
+  Offscreen<Rgb565> actual(20, 10, color::Black);
+  {
+    DrawingContext dc(expected);
+    dc.draw(linear);
+  }
+  {
+    DrawingContext dc(actual);
+    dc.draw(tiled);
+  }
+  EXPECT_EQ(0, memcmp(expected.buffer(), actual.buffer(), 20 * 10 * 2));
+}
+
+}  // namespace roo_display
@@ -0,0 +1,130 @@
+#include "roo_display/composition/tiled_renderer.h"
+
+#include "roo_display.h"
+#include "roo_display/color/color.h"
+#include "roo_display/shape/basic.h"
+#include "roo_display/shape/smooth.h"
+#include "testing.h"
+
+using namespace testing;
+
+namespace roo_display {
+
+namespace {
+
+void DrawScene(DrawingContext& dc, const std::vector<const Drawable*>& scene) {
+  for (const Drawable* d : scene) {
+    dc.draw(*d);
+  }
+}
+
+// Compositing the tiles over the screen rounds differently than drawing the
+// objects one by one; allow small per-channel differences.
+void ExpectNear(const FakeOffscreen<Argb8888>& expected,
+                const FakeOffscreen<Argb8888>& actual) {
+  const int kTolerance = 2;
+  int16_t w = expected.raw_width();
+  int16_t h = expected.raw_height();
+  auto raster_expected = RasterOf(expected);
+  auto raster_actual = RasterOf(actual);
+  auto s_expected = raster_expected.createRawStream();
+  auto s_actual = raster_actual.createRawStream();
+  for (int16_t y = 0; y < h; ++y) {
+    for (int16_t x = 0; x < w; ++x) {
+      Color e = s_expected->next();
+      Color a = s_actual->next();
+      EXPECT_NEAR(e.a(), a.a(), kTolerance) << "at (" << x << ", " << y << ")";
+      EXPECT_NEAR(e.r(), a.r(), kTolerance) << "at (" << x << ", " << y << ")";
+      EXPECT_NEAR(e.g(), a.g(), kTolerance) << "at (" << x << ", " << y << ")";
+      EXPECT_NEAR(e.b(), a.b(), kTolerance) << "at (" << x << ", " << y << ")";
+    }
+  }
+}
+
+void ExpectTiledMatchesSequential(const std::vector<const Drawable*>& scene,
+                                  int16_t tile_width, int16_t tile_height,
+                                  int num_threads, Color bgcolor,
+                                  Box clip_box = Box::MaximumBox()) {
+  FakeOffscreen<Argb8888> expected_screen(70, 50, Color(0xFF203040));
+  {
+    Display display(expected_screen);
+    DrawingContext dc(display);
+    dc.setBackgroundColor(bgcolor);
+    dc.setClipBox(clip_box);
+    DrawScene(dc, scene);
+  }
+  FakeOffscreen<Argb8888> tiled_screen(70, 50, Color(0xFF203040));
+  {
+    Display display(tiled_screen);
+    TiledRenderer<Argb8888> renderer(display.extents(), tile_width,
+                                     tile_height, num_threads);
+    for (const Drawable* d : scene) renderer.addInput(d);
+    EXPECT_EQ(num_threads, renderer.num_threads());
+    DrawingContext dc(display);
+    dc.setBackgroundColor(bgcolor);
+    dc.setClipBox(clip_box);
+    dc.draw(renderer);
+  }
+  ExpectNear(expected_screen, tiled_screen);
+}
+
+}  // namespace
+
+TEST(TiledRenderer, Empty) {
+  ExpectTiledMatchesSequential({}, 16, 16, 2, color::Transparent);
+}
+
+TEST(TiledRenderer, OpaqueShapes) {
+  FilledRect r1(3, 4, 40, 30, color::Red);
+  FilledCircle c1 = FilledCircle::ByRadius(35, 25, 17, color::Blue);
+  ExpectTiledMatchesSequential({&r1, &c1}, 16, 16, 2, color::Transparent);
+}
+
+TEST(TiledRenderer, SemiTransparentSmoothShapes) {
+  FilledRect r1(0, 0, 69, 49, Color(0x40FFFFFF));
+  auto c1 = SmoothFilledCircle({30.5, 20.3}, 18.2, Color(0x80FF4020));
+  auto c2 = SmoothThickCircle({40.2, 28.7}, 15.1, 4.5, Color(0xC02080F0));
+  auto l1 = SmoothThickLine({2, 45}, {66, 3}, 3.5, Color(0x90FFFF00));
+  ExpectTiledMatchesSequential({&r1, &c1, &c2, &l1}, 13, 9, 3,
+                               color::Transparent);
+}
+
+TEST(TiledRenderer, WithBackgroundColor) {
+  auto c1 = SmoothFilledCircle({30.5, 20.3}, 18.2, Color(0x80FF4020));
+  auto c2 = SmoothThickCircle({40.2, 28.7}, 15.1, 4.5, Color(0xC02080F0));
+  ExpectTiledMatchesSequential({&c1, &c2}, 32, 8, 4, Color(0xFF105010));
+}
+
+TEST(TiledRenderer, ClipBox) {
+  auto c1 = SmoothFilledCircle({30.5, 20.3}, 18.2, Color(0x80FF4020));
+  FilledRect r1(3, 4, 40, 30, Color(0x7F00FF00));
+  ExpectTiledMatchesSequential({&c1, &r1}, 7, 11, 2, color::Transparent,
+                               Box(5, 7, 50, 33));
+}
+
+TEST(TiledRenderer, SingleThreaded) {
+  auto c1 = SmoothFilledCircle({30.5, 20.3}, 18.2, Color(0x80FF4020));
+  FilledRect r1(3, 4, 40, 30, Color(0x7F00FF00));
+  ExpectTiledMatchesSequential({&c1, &r1}, 16, 16, 0, color::Transparent);
+}
+
+TEST(TiledRenderer, RepeatedDraws) {
+  auto c1 = SmoothFilledCircle({30.5, 20.3}, 18.2, Color(0x80FF4020));
+  FakeOffscreen<Argb8888> screen(70, 50, Color(0xFF203040));
+  Display display(screen);
+  TiledRenderer<Argb8888> renderer(display.extents(), 8, 8, 4);
+  renderer.addInput(&c1);
+  for (int i = 0; i < 20; ++i) {
+    DrawingContext dc(display);
+    dc.draw(renderer);
+  }
+  FakeOffscreen<Argb8888> expected(70, 50, Color(0xFF203040));
+  {
+    Display display(expected);
+    DrawingContext dc(display);
+    for (int i = 0; i < 20; ++i) dc.draw(c1);
+  }
+  ExpectNear(expected, screen);
+}
+
+}  // namespace roo_display